@@ -142,6 +142,11 @@ def copy_binaries():
             os.remove(binary_out)
 
         copy(binary_in, binary_out)
+
+        # executes slaves configured to run in a worker process, located next to the library
+        worker_in = binary_in.parent / 'pyfmu_worker'
+        if(worker_in.is_file()):
+            copy(worker_in, binary_out.parent / 'pyfmu_worker')
     except Exception as e:
         raise RuntimeError(
             f"Failed to copy binaries into the resources, an exception was thrown:\n{e}") from e
@@ -0,0 +1,208 @@
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "fmi/fmi2FunctionTypes.h"
+#include "Logger.hpp"
+#include "Slave.hpp"
+
+#ifndef PYTHONFMU_ASYNCSLAVE_HPP
+#define PYTHONFMU_ASYNCSLAVE_HPP
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Takes the communication steps of another slave on a thread of its own, such that fmi2DoStep returns fmi2Pending immediately.
+ *
+ * Once a step is finished the stepFinished callback of the tool is invoked on that thread, with the status the step would have returned.
+ * The callback may start the next step or free the instance. While a step is pending only the status of the step may be queried,
+ * all other calls fail, except for terminate and reset which wait until the step is finished.
+ *
+ * Messages logged during a step are delivered on the thread of the instance, unless the logger is asynchronous.
+ */
+class AsyncSlave : public Slave
+{
+public:
+    AsyncSlave(std::unique_ptr<Slave> slave, fmi2StepFinished stepFinished, fmi2ComponentEnvironment componentEnvironment, Logger *logger);
+
+    AsyncSlave(const AsyncSlave &) = delete;
+    AsyncSlave &operator=(const AsyncSlave &) = delete;
+
+    /**
+     * @brief Wait until the pending step, if any, is finished and stop the thread before destroying the slave.
+     */
+    ~AsyncSlave() override;
+
+    /**
+     * @brief Wait until the pending step, if any, is finished, stop the thread and hand back the slave, after which this must only be destroyed.
+     */
+    std::unique_ptr<Slave> detach();
+
+    /**
+     * @brief Hand the step to the thread of the instance.
+     *
+     * @return fmi2Pending, or fmi2Error if a step is already pending
+     */
+    fmi2Status startStep(double currentTime, double stepSize);
+
+    /**
+     * @brief Returns fmi2Pending while a step is being taken, otherwise the status of the last step.
+     */
+    fmi2Status stepStatus() const;
+
+    /**
+     * @brief Cancel the pending step.
+     *
+     * Python code can not be interrupted, as such the step runs to completion, but stepFinished is not invoked for it.
+     * As required for a canceled step, the tool may afterwards only query the status, reset, terminate or free the instance.
+     *
+     * @return fmi2OK, or fmi2Error if no step is pending
+     */
+    fmi2Status cancelStep();
+
+    /**
+     * @brief Describes the pending step, for fmi2GetStringStatus, valid until the next call.
+     */
+    const char *pendingStatus() const;
+
+    void setupExperiment(double startTime) override;
+
+    void enterInitializationMode() override;
+
+    void exitInitializationMode() override;
+
+    /**
+     * @brief Take a step synchronously, on the calling thread.
+     */
+    bool doStep(double currentTime, double stepSize) override;
+
+    std::size_t doSteps(double currentTime, const fmi2Real *stepSizes, std::size_t nSteps,
+                        const fmi2ValueReference *inputVrs, std::size_t nInputs, const fmi2Real *inputs,
+                        const fmi2ValueReference *outputVrs, std::size_t nOutputs, fmi2Real *outputs) override;
+
+    double lastSuccessfulTime() const override;
+
+    void reset() override;
+
+    void terminate() override;
+
+    void getInteger(const fmi2ValueReference *vr, std::size_t nvr, fmi2Integer *value) const override;
+
+    void getReal(const fmi2ValueReference *vr, std::size_t nvr, fmi2Real *value) const override;
+
+    void getString(const fmi2ValueReference *vr, std::size_t nvr, fmi2String *value) const override;
+
+    void getBoolean(const fmi2ValueReference *vr, std::size_t nvr, fmi2Boolean *value) const override;
+
+    fmi2Status setDebugLogging(bool loggingOn, size_t nCategories, const char *const categories[]) const override;
+
+    void setReal(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Real *value) override;
+
+    void setInteger(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *value) override;
+
+    void setBoolean(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Boolean *value) override;
+
+    void setString(const fmi2ValueReference *vr, std::size_t nvr, const fmi2String *value) override;
+
+    fmi2FMUstate getFMUstate(fmi2FMUstate state) override;
+
+    void setFMUstate(fmi2FMUstate state) override;
+
+    void freeFMUstate(fmi2FMUstate state) override;
+
+    std::size_t serializedFMUstateSize(fmi2FMUstate state) override;
+
+    void serializeFMUstate(fmi2FMUstate state, fmi2Byte *data, std::size_t size) override;
+
+    fmi2FMUstate deSerializeFMUstate(const fmi2Byte *data, std::size_t size, fmi2FMUstate state) override;
+
+    void freeAllFMUstates() override;
+
+    void getDirectionalDerivative(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                                  const fmi2ValueReference *knowns, std::size_t nKnowns,
+                                  const fmi2Real *seed, fmi2Real *sensitivity) override;
+
+    void getJacobian(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                     const fmi2ValueReference *knowns, std::size_t nKnowns, fmi2Real *jacobian) override;
+
+    void setRealInputDerivatives(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *order, const fmi2Real *value) override;
+
+    void getRealOutputDerivatives(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *order, fmi2Real *value) override;
+
+    std::size_t ensembleSize() const override { return slave_->ensembleSize(); }
+
+    void getRealEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Real *value) const override;
+
+    void getIntegerEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Integer *value) const override;
+
+    void getBooleanEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Boolean *value) const override;
+
+    void setRealEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Real *value) override;
+
+    void setIntegerEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *value) override;
+
+    void setBooleanEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Boolean *value) override;
+
+    /**
+     * @brief Record the calls into the profile, as well as the phases of the steps taken by the wrapped slave.
+     */
+    void setProfile(Profile *profile) override;
+
+private:
+    std::unique_ptr<Slave> slave_;
+    fmi2StepFinished stepFinished_;
+    fmi2ComponentEnvironment componentEnvironment_;
+    Logger *logger_;
+
+    /**
+     * @brief Guards the members below, and lastSuccessfulTime_, which are shared with the thread.
+     */
+    mutable std::mutex mutex_;
+    std::condition_variable wake_; // a step was started or the thread is to stop
+    std::condition_variable idle_; // a step was finished
+
+    bool pending_ = false;
+    bool canceled_ = false;
+    bool stop_ = false;
+
+    double currentTime_ = 0;
+    double stepSize_ = 0;
+
+    fmi2Status status_ = fmi2OK;
+
+    mutable std::string pendingStatus_;
+
+    std::thread thread_;
+
+    /**
+     * @brief Flag on the stack of the thread, which stop sets when invoked by stepFinished on the thread.
+     */
+    bool *freed_ = nullptr;
+
+    void run();
+
+    /**
+     * @brief Wait until the pending step, if any, is finished and stop the thread.
+     *
+     * If invoked by stepFinished, the thread is detached instead and exits once the callback returns, without accessing this.
+     */
+    void stop();
+
+    /**
+     * @brief Throw if a step is pending, the slave is owned by the thread until it is finished.
+     */
+    void ensure_idle() const;
+
+    /**
+     * @brief Wait until the pending step, if any, is finished.
+     */
+    void wait_idle();
+};
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_ASYNCSLAVE_HPP
@@ -0,0 +1,105 @@
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+#include "pythonfmu/Logger.hpp"
+#include "pythonfmu/ProcessChannel.hpp"
+
+#ifndef PYTHONFMU_FORKSERVER_HPP
+#define PYTHONFMU_FORKSERVER_HPP
+
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+
+#include <sys/types.h>
+
+namespace pythonfmu
+{
+
+/**
+ * @brief File descriptor of the socket through which the fork server receives requests, inherited from the host.
+ */
+constexpr int forkServerSocket = 3;
+
+/**
+ * @brief Request sent by the host to the fork server, asking it to fork a worker serving the segment.
+ */
+struct ForkRequest
+{
+    char segment[256];
+
+    /**
+     * @brief Process id of the host, the forked worker exits once it terminates.
+     */
+    std::int32_t host;
+};
+
+/**
+ * @brief Response of the fork server, sent once it has loaded the slave and once for every request.
+ *
+ * The first response carries the process id of the fork server, the following ones the process id of the forked worker.
+ * If loading the slave or forking failed, the process id is -1 and error is set to the errno of the failure, if any.
+ */
+struct ForkResponse
+{
+    std::int32_t pid;
+    std::int32_t error;
+};
+
+/**
+ * @brief A template worker process, which has initialized an interpreter and imported the module of the slave,
+ * from which the workers of instances configured with "interpreter": "fork" are forked.
+ *
+ * Forked workers share the memory of the fork server copy-on-write, as such they neither initialize an interpreter nor import the slave.
+ * They are not children of the host, but of the fork server, which reaps them.
+ *
+ * The fork server is started by the first instance of the FMU and exits once the library is unloaded or the host terminates.
+ */
+class ForkServer
+{
+public:
+    /**
+     * @brief Returns the fork server of the FMU located at the resources folder, starting it if there is none or it has terminated.
+     *
+     * @throw runtime_error if the fork server could not be started or failed to load the slave
+     */
+    static ForkServer &acquire(const std::filesystem::path &resources, Logger *logger);
+
+    ForkServer(const ForkServer &) = delete;
+    ForkServer &operator=(const ForkServer &) = delete;
+
+    /**
+     * @brief Close the socket, upon which the fork server exits, and wait for it to do so.
+     */
+    ~ForkServer();
+
+    /**
+     * @brief Fork a worker which serves the requests sent through the segment.
+     *
+     * @return the process id of the worker
+     * @throw runtime_error if the fork server terminated or failed to fork
+     */
+    pid_t fork_worker(const std::string &segment);
+
+private:
+    ForkServer(const std::filesystem::path &resources, Logger *logger);
+
+    /**
+     * @brief Return true if the fork server is still running.
+     */
+    bool alive();
+
+    /**
+     * @brief Serializes the requests of instances instantiated concurrently.
+     */
+    std::mutex mutex_;
+
+    int socket_ = -1;
+    pid_t pid_ = -1;
+};
+
+} // namespace pythonfmu
+
+#endif // PYFMU_HAS_PROCESS_SLAVE
+
+#endif // PYTHONFMU_FORKSERVER_HPP
@@ -0,0 +1,57 @@
+#include <cstddef>
+#include <vector>
+
+#ifndef PYTHONFMU_JACOBIANCOLORING_HPP
+#define PYTHONFMU_JACOBIANCOLORING_HPP
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Partition of the columns of a sparse Jacobian into groups, such that no two columns of a group have a non-zero in the same row.
+ *
+ * The columns of a group can be perturbed at once, since every row of the resulting directional derivative depends on at most one of them.
+ * As such the Jacobian is assembled from one directional derivative per group, rather than one per column, e.g. three for a tridiagonal Jacobian.
+ *
+ * The columns are colored greedily, in order of decreasing number of non-zeros, which is not optimal but close to it for the banded
+ * and block structured patterns of most models.
+ */
+class JacobianColoring
+{
+public:
+    /**
+     * @param rows columns of the non-zeros of every row, each less than nColumns
+     */
+    JacobianColoring(std::vector<std::vector<std::size_t>> rows, std::size_t nColumns);
+
+    std::size_t nRows() const { return rows_.size(); }
+
+    std::size_t nColumns() const { return colors_.size(); }
+
+    std::size_t nColors() const { return nColors_; }
+
+    /**
+     * @brief Write the direction perturbing the columns of the group by their steps, and leaving the other columns unchanged.
+     *
+     * @param steps perturbation of every column, non-zero
+     * @param direction nColumns values
+     */
+    void direction(std::size_t color, const double *steps, double *direction) const;
+
+    /**
+     * @brief Scatter the directional derivative, or difference, of the group into the Jacobian, dividing each row by the step of its column.
+     *
+     * @param difference nRows values, the change of the rows caused by the direction of the group
+     * @param jacobian nRows by nColumns values in row-major order, whose entries outside of the pattern are left unchanged
+     */
+    void scatter(std::size_t color, const double *steps, const double *difference, double *jacobian) const;
+
+private:
+    std::vector<std::vector<std::size_t>> rows_;
+    std::vector<std::size_t> colors_;
+    std::size_t nColors_ = 0;
+};
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_JACOBIANCOLORING_HPP
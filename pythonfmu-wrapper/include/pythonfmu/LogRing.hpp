@@ -0,0 +1,101 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+
+#ifndef PYTHONFMU_LOGRING_HPP
+#define PYTHONFMU_LOGRING_HPP
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Fixed-capacity ring of log records, written by the logger of the slave and drained by the wrapper.
+ *
+ * The ring is owned by the wrapper and exposed to the slave as two memoryviews: the indices and the record area.
+ * The slave is the only producer and the wrapper the only consumer, as such the ring needs no locks,
+ * and checking whether the slave logged anything is a single load which neither acquires the GIL nor calls into Python.
+ *
+ * Records are aligned to recordAlignment and consist of a RecordHeader followed by the UTF-8 encoded payload.
+ * Categories are referred to by ids, the name of a category is sent once in a categoryDefinition record preceding its first message.
+ * A record never wraps around the end of the record area, the producer fills the remainder with a padding record instead.
+ *
+ * The layout is mirrored by Fmi2Logger in fmi2logging.py, changes must be made to both.
+ */
+class LogRing
+{
+public:
+    /**
+     * @brief Size of the record area in bytes, a power of two.
+     */
+    static constexpr std::size_t capacity = 64 * 1024;
+
+    static constexpr std::size_t recordAlignment = 16;
+
+    /**
+     * @brief Values of RecordHeader::status, other than an fmi2Status, marking records which are not messages.
+     */
+    static constexpr std::int32_t categoryDefinition = -1;
+    static constexpr std::int32_t padding = -2;
+
+    struct RecordHeader
+    {
+        std::int32_t status;
+        std::uint32_t category;
+        std::uint32_t size; // of the payload, excluding the header and the alignment
+        std::uint32_t reserved;
+    };
+
+    static_assert(sizeof(RecordHeader) == recordAlignment);
+
+    /**
+     * @brief Positions in the indices array.
+     *
+     * The write index is advanced by the producer after writing a record, the read index by the consumer after reading one.
+     * Both are free-running, the offset of a record in the area is the index modulo the capacity.
+     * The dropped counter is incremented by the producer for each message which did not fit in the ring.
+     */
+    enum Index : std::size_t
+    {
+        writeIndex,
+        readIndex,
+        droppedCount,
+        nIndices
+    };
+
+    LogRing();
+
+    LogRing(const LogRing &) = delete;
+    LogRing &operator=(const LogRing &) = delete;
+
+    std::uint32_t *indices() { return indices_.data(); }
+    std::byte *data() { return data_.data(); }
+
+    /**
+     * @brief Pass the records written since the last call to the logger, along with a warning if messages were dropped.
+     *
+     * Returns immediately if the producer wrote nothing.
+     */
+    void drain(Logger &logger);
+
+private:
+    alignas(64) std::array<std::uint32_t, nIndices> indices_{};
+    std::vector<std::byte> data_;
+
+    /**
+     * @brief Names of the categories defined by the producer, indexed by id.
+     */
+    std::vector<std::string> categories_;
+
+    /**
+     * @brief Value of the dropped counter when it was last reported.
+     */
+    std::uint32_t reportedDrops_ = 0;
+};
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_LOGRING_HPP
@@ -1,6 +1,11 @@
 
 #include "fmi/fmi2Functions.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #ifndef LOGGER_HPP
 #define LOGGER_HPP
@@ -19,11 +24,70 @@ public:
    * @param loggerCallback callback supplied when fmu was instantiated.
    * @param instanceName name of the fmu instance to which the logger is associated
    */
-  explicit Logger(fmi2ComponentEnvironment componentEnvironment, fmi2CallbackLogger loggerCallback, std::string instanceName);
+  explicit Logger(fmi2ComponentEnvironment componentEnvironment, fmi2CallbackLogger loggerCallback, std::string instanceName, bool loggingOn = true);
+
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  /**
+   * @brief Delivers the queued messages, if asynchronous, before returning.
+   */
+  ~Logger();
+
+  /**
+   * @brief What an asynchronous logger does with a message if its queue is full.
+   * 
+   * drop: the message is discarded
+   * block: the caller waits until the background thread has made room for it
+   * sample: once the queue is half full only every sampleInterval-th message is queued, except errors, and messages are discarded if it is full
+   */
+  enum class Overflow
+  {
+    drop,
+    block,
+    sample
+  };
+
+  static constexpr std::size_t sampleInterval = 10;
+
+  struct Counters
+  {
+    std::uint64_t queued;
+    std::uint64_t delivered;
+    std::uint64_t dropped;
+  };
+
+  /**
+   * @brief Deliver messages from a background thread, such that the caller does not wait for the write to stderr and the callback of the tool.
+   * 
+   * Messages are placed in a bounded queue with room for capacity messages, rounded up to a power of two.
+   * The callback is invoked on the background thread, as such this must only be used with tools which accept that.
+   * Until called, and for masters requiring it, messages are delivered synchronously on the calling thread.
+   */
+  void startAsync(std::size_t capacity, Overflow overflow);
+
+  /**
+   * @brief Wait until all messages queued before the call have been delivered, returns immediately if the logger is synchronous.
+   */
+  void flush();
+
+  /**
+   * @brief Deliver further messages to the callback of another instance, used when a pooled instance is handed out again.
+   * 
+   * Messages queued before the call are delivered to the previous callback, the categories are set as by the constructor.
+   */
+  void rebind(fmi2ComponentEnvironment componentEnvironment, fmi2CallbackLogger loggerCallback, std::string instanceName, bool loggingOn);
+
+  /**
+   * @brief Number of messages queued, delivered and dropped by the asynchronous logger, zero if the logger is synchronous.
+   */
+  Counters counters() const;
 
   /**
    * @brief Logs message from FMU instance in a specific category
    * 
+   * The message is passed on regardless of the active categories, messages of the slave are filtered before they reach the wrapper.
+   * 
    * @param status status of the fmu at the time of logging
    * @param category the category the message is published under
    * @param message the message logged that is logged
@@ -31,16 +95,86 @@ public:
   void log(fmi2Status status, std::string category,
            std::string message);
 
+  /**
+   * @brief Log messages of the wrapper itself, in the category "wrapper".
+   * 
+   * Errors are always logged, other messages only if the category "wrapper" or "logAll" is active, or the status category, e.g. "logStatusWarning".
+   */
   void ok(std::string message);
   void warning(std::string message);
   void discard(std::string message);
   void error(std::string message);
   void fatal(std::string message);
 
+  /**
+   * @brief Maximum number of distinct categories, the ids of further categories are noCategory.
+   */
+  static constexpr std::size_t maxCategories = 64;
+  static constexpr std::size_t noCategory = static_cast<std::size_t>(-1);
+
+  /**
+   * @brief Returns the id of the category, assigning the next free id to categories not seen before.
+   */
+  std::size_t intern(const std::string &category);
+
+  /**
+   * @brief Activate or deactivate the categories, or all categories if nCategories is 0, as by fmi2SetDebugLogging.
+   */
+  void setDebugLogging(bool loggingOn, std::size_t nCategories, const char *const categories[]);
+
+  bool active(std::size_t id) const
+  {
+    return id < maxCategories && (((*active_)[id / 32] >> (id % 32)) & 1) != 0;
+  }
+
+  bool anyActive() const
+  {
+    for (auto word : *active_)
+    {
+      if (word != 0)
+        return true;
+    }
+    return false;
+  }
+
+  static constexpr std::size_t nActiveWords = maxCategories / 32;
+
+  /**
+   * @brief The active categories as a bitset indexed by id, which may be exposed to the slave such that it can discard messages before building them.
+   *
+   * The bitset is shared rather than owned by the logger, such that it remains valid for a slave holding views of it beyond the lifetime of the logger.
+   */
+  std::shared_ptr<std::array<std::uint32_t, nActiveWords>> activeWords() const { return active_; }
+
 private:
+  class AsyncSink;
+
   std::string instanceName;
   fmi2CallbackLogger loggerCallback;
   fmi2ComponentEnvironment componentEnvironment;
+
+  std::vector<std::string> categories_;
+  std::shared_ptr<std::array<std::uint32_t, nActiveWords>> active_ = std::make_shared<std::array<std::uint32_t, nActiveWords>>();
+
+  std::size_t wrapperId_;
+  std::size_t logAllId_;
+  std::size_t warningId_;
+  std::size_t discardId_;
+
+  /**
+   * @brief Queue of the messages, nullptr while messages are delivered synchronously.
+   */
+  std::unique_ptr<AsyncSink> sink_;
+
+  /**
+   * @brief Returns true if a message of the wrapper with the status is to be logged.
+   */
+  bool passes(fmi2Status status) const;
+
+  /**
+   * @brief Write the message to stderr and invoke the callback of the tool.
+   */
+  void deliver(fmi2Status status, const std::string &category, const std::string &message) const;
 };
 
 #endif // LOGGER_HPP
@@ -0,0 +1,387 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <semaphore.h>
+#endif
+
+#ifndef PYTHONFMU_PROCESSCHANNEL_HPP
+#define PYTHONFMU_PROCESSCHANNEL_HPP
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Defined if slaves can be executed in a worker process, which requires POSIX shared memory and process-shared semaphores.
+ */
+#ifdef __linux__
+#define PYFMU_HAS_PROCESS_SLAVE
+#endif
+
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+
+/**
+ * @brief Operations requested by the process loading the FMU, the host, and executed by the worker process.
+ */
+enum class Operation : std::uint32_t
+{
+    instantiate,
+    setup_experiment,
+    enter_initialization_mode,
+    exit_initialization_mode,
+    do_step,
+    do_steps,
+    reset,
+    terminate,
+    get_integer,
+    get_real,
+    get_boolean,
+    get_string,
+    set_integer,
+    set_real,
+    set_boolean,
+    set_string,
+    set_debug_logging,
+    get_fmu_state,
+    set_fmu_state,
+    free_fmu_state,
+    serialized_fmu_state_size,
+    serialize_fmu_state,
+    deserialize_fmu_state,
+    free_all_fmu_states,
+    free_instance,
+    set_time,
+    set_continuous_states,
+    get_continuous_states,
+    get_nominals_of_continuous_states,
+    get_derivatives,
+    get_event_indicators,
+    enter_event_mode,
+    new_discrete_states,
+    enter_continuous_time_mode,
+    completed_integrator_step,
+    get_directional_derivative,
+    get_jacobian,
+    set_real_input_derivatives,
+    get_real_output_derivatives
+};
+
+/**
+ * @brief A request sent from the host to the worker, or the response to it.
+ *
+ * Value references, values and strings are not part of the message, they are placed in the data area of the segment.
+ * Value references are stored at the start of the data area followed by the values, see values_offset.
+ * The vectors of Model Exchange, e.g. the continuous states, are stored at the start of the data area and their length in nvr.
+ */
+struct Message
+{
+    Operation operation;
+
+    /**
+     * @brief fmi2Status of the operation, only set in responses.
+     */
+    std::int32_t status;
+
+    /**
+     * @brief True if the slave provides Model Exchange, only set in the response to instantiate.
+     */
+    std::uint32_t modelExchange;
+
+    std::uint64_t nvr;
+
+    /**
+     * @brief Scalar arguments of the operation, e.g. the current time and step size of do_step.
+     */
+    double args[2];
+
+    /**
+     * @brief Number of bytes of the data area used by the message.
+     */
+    std::uint64_t size;
+
+    /**
+     * @brief Offset and number of the log records appended to the data area by the worker, only set in responses.
+     */
+    std::uint64_t logOffset;
+    std::uint64_t nLogs;
+
+    /**
+     * @brief Handle of an FMU state in the worker, which the host passes on to the tool as is.
+     */
+    std::uint64_t fmuState;
+
+    /**
+     * @brief Offset of the chunk of a serialized FMU state placed in the data area, and the size of the entire serialized state.
+     *
+     * Serialized states larger than the data area are transferred in several chunks.
+     */
+    std::uint64_t offset;
+    std::uint64_t total;
+
+    /**
+     * @brief Number of steps and Real inputs of do_steps, the value references of the inputs precede those of the outputs.
+     *
+     * The response carries the number of steps completed by the worker.
+     *
+     * Requests of get_directional_derivative and get_jacobian carry the number of knowns in nInputs, their value references precede those of the unknowns.
+     * They are followed by the seed and the sensitivity, or by the Jacobian in row-major order.
+     */
+    std::uint64_t nSteps;
+    std::uint64_t nInputs;
+};
+
+/**
+ * @brief Header of a log record in the data area, followed by the category and the message.
+ */
+struct LogRecord
+{
+    std::int32_t status;
+    std::uint32_t categorySize;
+    std::uint32_t messageSize;
+};
+
+/**
+ * @brief Lock-free queue with a single producer and a single consumer, which may live in different processes.
+ */
+template <typename T, std::size_t N>
+struct SpscRing
+{
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "the indices of the ring must be lock-free to be shared by processes");
+
+    alignas(64) std::atomic<std::uint64_t> head{0}; // next slot read by the consumer
+    alignas(64) std::atomic<std::uint64_t> tail{0}; // next slot written by the producer
+    T slots[N];
+
+    bool push(const T &item)
+    {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N)
+            return false;
+
+        slots[t % N] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+
+        item = slots[h % N];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+/**
+ * @brief Wakes the consumer of a ring once an item is pushed.
+ *
+ * The consumer spins for a short while before blocking on a semaphore, which is only posted if the consumer announced that it is going to sleep.
+ * As such, the producer makes no system calls while the consumer is busy or spinning.
+ */
+struct Doorbell
+{
+    std::atomic<std::uint32_t> sleeping{0};
+    sem_t semaphore;
+
+    /**
+     * @brief Wake the consumer, called by the producer after pushing an item.
+     */
+    void ring();
+
+    /**
+     * @brief Wait until the ring is non-empty.
+     *
+     * @param ring the ring being consumed
+     * @param alive invoked periodically while blocking, waiting is aborted if it returns false
+     * @return true if the ring is non-empty, false if waiting was aborted
+     */
+    template <typename Ring, typename Alive>
+    bool wait(const Ring &ring, Alive alive);
+
+private:
+    /**
+     * @brief Time spent polling the ring before blocking, unless the machine has a single core.
+     */
+    static constexpr std::chrono::microseconds spinDuration{50};
+    static bool spinning();
+
+    bool timed_wait();
+};
+
+/**
+ * @brief Layout of the shared memory segment, which is followed by the data area.
+ */
+struct SegmentHeader
+{
+    static constexpr std::uint32_t currentVersion = 9;
+    static constexpr std::size_t ringSize = 8;
+
+    std::uint32_t version;
+    std::uint64_t dataCapacity;
+    char resources[4096];
+    char instanceName[256];
+
+    Doorbell toWorker;
+    Doorbell toHost;
+    SpscRing<Message, ringSize> requests;
+    SpscRing<Message, ringSize> responses;
+};
+
+/**
+ * @brief A shared memory segment used to communicate with a worker process.
+ */
+class SharedSegment
+{
+public:
+    /**
+     * @brief Create and map a new segment, which is removed once the host and worker have unmapped it.
+     *
+     * @param dataCapacity size of the data area in bytes
+     * @throw runtime_error if the segment could not be created
+     */
+    static SharedSegment create(std::size_t dataCapacity);
+
+    /**
+     * @brief Map an existing segment, created by the host.
+     *
+     * @throw runtime_error if the segment could not be opened or has an incompatible version
+     */
+    static SharedSegment open(const std::string &name);
+
+    SharedSegment(SharedSegment &&other);
+    SharedSegment(const SharedSegment &) = delete;
+    SharedSegment &operator=(const SharedSegment &) = delete;
+    ~SharedSegment();
+
+    /**
+     * @brief Remove the name of the segment, such that no other process can open it.
+     */
+    void unlink();
+
+    const std::string &name() const { return name_; }
+    SegmentHeader *header() const { return header_; }
+    std::byte *data() const;
+
+private:
+    SharedSegment(std::string name, void *address, std::size_t size, bool owner);
+
+    std::string name_;
+    SegmentHeader *header_;
+    std::size_t size_;
+    bool owner_;
+    bool linked_;
+};
+
+/**
+ * @brief Round an offset in the data area up to the alignment of the values.
+ */
+constexpr std::size_t align_offset(std::size_t offset)
+{
+    return (offset + 7) & ~std::size_t(7);
+}
+
+/**
+ * @brief Offset in the data area of the values, following the value references of a request.
+ */
+constexpr std::size_t values_offset(std::size_t nvr)
+{
+    return align_offset(nvr * sizeof(std::uint32_t));
+}
+
+/**
+ * @brief Offset in the data area of the values of a set_real_input_derivatives or get_real_output_derivatives request,
+ * which follow the value references and the orders of the derivatives.
+ */
+constexpr std::size_t derivatives_offset(std::size_t nvr)
+{
+    return align_offset(values_offset(nvr) + nvr * sizeof(std::int32_t));
+}
+
+/**
+ * @brief Offsets in the data area of the arrays of a do_steps request, following the value references of the inputs and outputs.
+ */
+struct StepsLayout
+{
+    std::size_t stepSizes;
+    std::size_t inputs;
+    std::size_t outputs;
+    std::size_t size;
+
+    constexpr StepsLayout(std::size_t nSteps, std::size_t nInputs, std::size_t nOutputs)
+        : stepSizes(values_offset(nInputs + nOutputs)),
+          inputs(stepSizes + nSteps * sizeof(double)),
+          outputs(inputs + nSteps * nInputs * sizeof(double)),
+          size(outputs + nSteps * nOutputs * sizeof(double))
+    {
+    }
+};
+
+/**
+ * @brief Copy NUL-terminated strings into the data area.
+ *
+ * @return the number of bytes written
+ * @throw runtime_error if the strings do not fit in the remaining capacity
+ */
+std::size_t pack_strings(std::byte *dst, std::size_t capacity, const char *const *strings, std::size_t n);
+
+/**
+ * @brief Read n strings packed by pack_strings.
+ */
+std::vector<std::string> unpack_strings(const std::byte *src, std::size_t n);
+
+template <typename Ring, typename Alive>
+bool Doorbell::wait(const Ring &ring, Alive alive)
+{
+    if (!ring.empty())
+        return true;
+
+    if (spinning())
+    {
+        auto deadline = std::chrono::steady_clock::now() + spinDuration;
+        do
+        {
+            for (int i = 0; i < 64; ++i)
+            {
+                if (!ring.empty())
+                    return true;
+            }
+        } while (std::chrono::steady_clock::now() < deadline);
+    }
+
+    while (true)
+    {
+        sleeping.store(1);
+
+        if (!ring.empty() || !timed_wait())
+        {
+            // the producer either cleared the flag and posts the semaphore, which must be consumed, or the flag is still set
+            if (sleeping.exchange(0) == 0)
+                while (sem_wait(&semaphore) != 0)
+                    ;
+        }
+
+        if (!ring.empty())
+            return true;
+
+        if (!alive())
+            return false;
+    }
+}
+
+#endif // PYFMU_HAS_PROCESS_SLAVE
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_PROCESSCHANNEL_HPP
@@ -0,0 +1,220 @@
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "pythonfmu/Logger.hpp"
+#include "pythonfmu/ProcessChannel.hpp"
+#include "pythonfmu/Slave.hpp"
+#include "pythonfmu/StringArena.hpp"
+
+#ifndef PYTHONFMU_PROCESSSLAVE_HPP
+#define PYTHONFMU_PROCESSSLAVE_HPP
+
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+
+#include <sys/types.h>
+
+namespace pythonfmu
+{
+
+class ForkServer;
+
+/**
+ * @brief Returns the path of the worker executable, located in the same directory as the library, restoring its executable bit if needed.
+ */
+std::filesystem::path worker_path();
+
+/**
+ * @brief A slave executed by a worker process, to which calls are forwarded through shared memory.
+ *
+ * The worker has an interpreter of its own, such that it neither competes for the GIL of the host nor takes down the host if the interpreter crashes.
+ * The worker executable, pyfmu_worker, must be located next to the wrapper library.
+ *
+ * Requests and responses are exchanged through a pair of lock-free rings, while value references, values and strings are placed in the data area of the segment.
+ * Calls reading or writing more values than fit in the data area are split into several requests.
+ */
+class ProcessSlave : public Slave
+{
+public:
+    /**
+     * @brief Spawn a worker process, or fork it from the fork server if one is given, and instantiate the slave in it.
+     *
+     * @throw runtime_error if the worker could not be started or failed to instantiate the slave
+     */
+    ProcessSlave(const std::filesystem::path &resources, const std::string &instanceName, Logger *logger, ForkServer *forkServer = nullptr);
+
+    ProcessSlave(const ProcessSlave &) = delete;
+    ProcessSlave &operator=(const ProcessSlave &) = delete;
+
+    /**
+     * @brief Free the slave and wait for the worker to exit, killing it if it does not.
+     */
+    ~ProcessSlave() override;
+
+    void setupExperiment(double startTime) override;
+
+    void enterInitializationMode() override;
+
+    void exitInitializationMode() override;
+
+    bool doStep(double currentTime, double stepSize) override;
+
+    /**
+     * @brief Advance the steps in as few requests as the data area permits.
+     */
+    std::size_t doSteps(double currentTime, const fmi2Real *stepSizes, std::size_t nSteps,
+                        const fmi2ValueReference *inputVrs, std::size_t nInputs, const fmi2Real *inputs,
+                        const fmi2ValueReference *outputVrs, std::size_t nOutputs, fmi2Real *outputs) override;
+
+    void reset() override;
+
+    void terminate() override;
+
+    void getInteger(const fmi2ValueReference *vr, std::size_t nvr, fmi2Integer *value) const override;
+
+    void getReal(const fmi2ValueReference *vr, std::size_t nvr, fmi2Real *value) const override;
+
+    void getString(const fmi2ValueReference *vr, std::size_t nvr, fmi2String *value) const override;
+
+    void getBoolean(const fmi2ValueReference *vr, std::size_t nvr, fmi2Boolean *value) const override;
+
+    fmi2Status setDebugLogging(bool loggingOn, size_t nCategories, const char *const categories[]) const override;
+
+    void setReal(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Real *value) override;
+
+    void setInteger(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *value) override;
+
+    void setBoolean(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Boolean *value) override;
+
+    void setString(const fmi2ValueReference *vr, std::size_t nvr, const fmi2String *value) override;
+
+    fmi2FMUstate getFMUstate(fmi2FMUstate state) override;
+
+    void setFMUstate(fmi2FMUstate state) override;
+
+    void freeFMUstate(fmi2FMUstate state) override;
+
+    std::size_t serializedFMUstateSize(fmi2FMUstate state) override;
+
+    void serializeFMUstate(fmi2FMUstate state, fmi2Byte *data, std::size_t size) override;
+
+    fmi2FMUstate deSerializeFMUstate(const fmi2Byte *data, std::size_t size, fmi2FMUstate state) override;
+
+    void freeAllFMUstates() override;
+
+    bool providesModelExchange() const override { return modelExchange_; }
+
+    void setTime(double time) override;
+
+    void setContinuousStates(const fmi2Real *states, std::size_t nx) override;
+
+    void getContinuousStates(fmi2Real *states, std::size_t nx) override;
+
+    void getNominalsOfContinuousStates(fmi2Real *nominals, std::size_t nx) override;
+
+    void getDerivatives(fmi2Real *derivatives, std::size_t nx) override;
+
+    void getEventIndicators(fmi2Real *indicators, std::size_t ni) override;
+
+    void enterEventMode() override;
+
+    void newDiscreteStates(fmi2EventInfo *eventInfo) override;
+
+    void enterContinuousTimeMode() override;
+
+    bool completedIntegratorStep(bool noSetFMUStatePriorToCurrentPoint, bool *terminateSimulation) override;
+
+    void getDirectionalDerivative(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                                  const fmi2ValueReference *knowns, std::size_t nKnowns,
+                                  const fmi2Real *seed, fmi2Real *sensitivity) override;
+
+    void getJacobian(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                     const fmi2ValueReference *knowns, std::size_t nKnowns, fmi2Real *jacobian) override;
+
+    void setRealInputDerivatives(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *order, const fmi2Real *value) override;
+
+    void getRealOutputDerivatives(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *order, fmi2Real *value) override;
+
+    /**
+     * @brief Size of the data area of the segment, which is only backed by memory once it is used.
+     */
+    static constexpr std::size_t dataCapacity = 4 * 1024 * 1024;
+
+private:
+    SharedSegment segment_;
+    Logger *logger_;
+
+    /**
+     * @brief Process id of the worker, reset once it has been reaped.
+     */
+    mutable pid_t pid_ = -1;
+
+    /**
+     * @brief Set once the worker has terminated, after which all calls fail.
+     */
+    mutable bool dead_ = false;
+
+    /**
+     * @brief True if the worker was forked by the fork server, in which case it is not a child of this process and can not be waited for.
+     */
+    bool forked_;
+
+    /**
+     * @brief Set once the worker has acknowledged freeing the slave, after which it is expected to exit.
+     */
+    bool freed_ = false;
+
+    /**
+     * @brief True if the slave instantiated by the worker provides Model Exchange.
+     */
+    bool modelExchange_ = false;
+
+    /**
+     * @brief Owns the strings returned by getString, which remain valid until its next call.
+     */
+    mutable StringArena strings_;
+
+    /**
+     * @brief Send a request to the worker and wait for the response, forwarding any log messages of the worker to the logger.
+     *
+     * @throw runtime_error if the worker terminated
+     */
+    Message transact(Message request) const;
+
+    /**
+     * @brief Send a request and throw if the worker reports an error.
+     */
+    Message invoke(Operation operation, double arg0 = 0, double arg1 = 0, fmi2FMUstate state = nullptr) const;
+
+    /**
+     * @brief Send a vector of Model Exchange to the worker, or receive one from it, in a single request.
+     *
+     * @param in values sent to the worker, or nullptr
+     * @param out values returned by the worker, or nullptr
+     * @throw runtime_error if the vector does not fit in the data area or the worker reports an error
+     */
+    void exchange(Operation operation, const fmi2Real *in, fmi2Real *out, std::size_t n) const;
+
+    template <typename T>
+    void get(Operation operation, const fmi2ValueReference *vr, std::size_t nvr, T *values) const;
+
+    template <typename T>
+    void set(Operation operation, const fmi2ValueReference *vr, std::size_t nvr, const T *values);
+
+    /**
+     * @brief Return true if the worker is still running.
+     */
+    bool alive() const;
+
+    /**
+     * @brief Wait for the worker to exit, killing it if it does not within a few seconds.
+     */
+    void stop_worker() const;
+};
+
+} // namespace pythonfmu
+
+#endif // PYFMU_HAS_PROCESS_SLAVE
+
+#endif // PYTHONFMU_PROCESSSLAVE_HPP
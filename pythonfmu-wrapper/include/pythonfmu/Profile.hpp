@@ -0,0 +1,249 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifndef PYTHONFMU_PROFILE_HPP
+#define PYTHONFMU_PROFILE_HPP
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Histogram of latencies in nanoseconds, whose buckets have a width proportional to their lower bound.
+ *
+ * As in HDR histograms, every power of two is divided into subBuckets buckets, such that the value of a bucket
+ * is within 1/subBuckets of the latencies counted by it, from nanoseconds to hours.
+ *
+ * The histogram has a single writer at a time, such that the counters are updated without read-modify-write instructions,
+ * but it may be read concurrently, in which case the counters are consistent individually but not with each other.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr std::size_t subBucketBits = 3;
+    static constexpr std::size_t subBuckets = std::size_t(1) << subBucketBits;
+
+    /**
+     * @brief Latencies of 2^maxExponent nanoseconds, about 39 hours, or more are counted by the last bucket.
+     */
+    static constexpr std::size_t maxExponent = 47;
+    static constexpr std::size_t nBuckets = (maxExponent - subBucketBits + 1) * subBuckets;
+
+    void record(std::uint64_t ns);
+
+    void clear();
+
+    std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+    std::uint64_t total() const { return total_.load(std::memory_order_relaxed); }
+
+    std::uint64_t min() const { return count() == 0 ? 0 : min_.load(std::memory_order_relaxed); }
+
+    std::uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    std::uint64_t bucket_count(std::size_t bucket) const { return counts_[bucket].load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns the latency below which the fraction p of the recorded latencies lie, to within the width of a bucket.
+     */
+    std::uint64_t percentile(double p) const;
+
+    static std::size_t bucket_of(std::uint64_t ns);
+
+    /**
+     * @brief Returns the smallest latency counted by the bucket.
+     */
+    static std::uint64_t lower_bound(std::size_t bucket);
+
+private:
+    /**
+     * @brief Increment by the single writer, a plain load and store rather than a locked instruction.
+     */
+    static void add(std::atomic<std::uint64_t> &counter, std::uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, nBuckets> counts_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> total_{0};
+    std::atomic<std::uint64_t> min_{UINT64_MAX};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+/**
+ * @brief Counters and latency histograms of the FMI functions called on an instance, and of the phases of the calls into Python.
+ *
+ * Created for instances whose configuration enables profiling, see ProfilingConfiguration, and read by the tool through pyfmuGetProfile.
+ * The calls of an instance are made by one thread at a time, as required by the standard, which makes it the single writer of the histograms.
+ * With asynchronous stepping, a step started by the stepFinished callback may be counted while the previous fmi2DoStep is returning,
+ * in which case one of the two calls may be lost.
+ *
+ * Profiling is compiled in unless the library is built with PYFMU_PROFILING=OFF. Instances without a profile pay for a test of a null pointer per call,
+ * without PYFMU_PROFILING the timers compile to nothing.
+ */
+class Profile
+{
+public:
+    /**
+     * @brief FMI functions whose calls are timed, from entry to return, including the checks and conversions of the wrapper.
+     */
+    enum class Function : std::size_t
+    {
+        instantiate,
+        setDebugLogging,
+        setupExperiment,
+        enterInitializationMode,
+        exitInitializationMode,
+        terminate,
+        reset,
+        getReal,
+        getInteger,
+        getBoolean,
+        getString,
+        setReal,
+        setInteger,
+        setBoolean,
+        setString,
+        getFMUstate,
+        setFMUstate,
+        freeFMUstate,
+        serializedFMUstateSize,
+        serializeFMUstate,
+        deSerializeFMUstate,
+        doStep,
+        doSteps,
+        setTime,
+        setContinuousStates,
+        getContinuousStates,
+        getNominalsOfContinuousStates,
+        getDerivatives,
+        getEventIndicators,
+        enterEventMode,
+        newDiscreteStates,
+        enterContinuousTimeMode,
+        completedIntegratorStep,
+        getDirectionalDerivative,
+        getJacobian,
+        setRealInputDerivatives,
+        getRealOutputDerivatives,
+        getRealEnsemble,
+        getIntegerEnsemble,
+        getBooleanEnsemble,
+        setRealEnsemble,
+        setIntegerEnsemble,
+        setBooleanEnsemble,
+        n_functions
+    };
+
+    /**
+     * @brief Phases of the calls into slaves executed in the process of the tool.
+     *
+     * gil_wait: acquiring the GIL, or entering the sub-interpreter of the instance
+     * marshal: converting the arguments of the FMI function to Python objects
+     * python_call: executing the method of the slave
+     * unmarshal: converting the values returned by the slave
+     * log_drain: delivering the messages logged by the slave, which includes the Python calls polling them for slaves without a log ring
+     */
+    enum class Phase : std::size_t
+    {
+        gil_wait,
+        marshal,
+        python_call,
+        unmarshal,
+        log_drain,
+        n_phases
+    };
+
+    /**
+     * @param dumpOnTerminate if true, fmi2Terminate logs a summary of the profile
+     */
+    explicit Profile(bool dumpOnTerminate = false) : dumpOnTerminate_(dumpOnTerminate) {}
+
+    Profile(const Profile &) = delete;
+    Profile &operator=(const Profile &) = delete;
+
+    void record(Function function, std::uint64_t ns) { functions_[static_cast<std::size_t>(function)].record(ns); }
+
+    void record(Phase phase, std::uint64_t ns) { phases_[static_cast<std::size_t>(phase)].record(ns); }
+
+    const LatencyHistogram &histogram(Function function) const { return functions_[static_cast<std::size_t>(function)]; }
+
+    const LatencyHistogram &histogram(Phase phase) const { return phases_[static_cast<std::size_t>(phase)]; }
+
+    bool dumpOnTerminate() const { return dumpOnTerminate_; }
+
+    void clear();
+
+    /**
+     * @brief Returns the counters, percentiles and non-empty buckets of the functions and phases which have been called, as JSON.
+     */
+    std::string to_json() const;
+
+    /**
+     * @brief Returns a table of the counters and percentiles of the functions and phases which have been called, one per line.
+     */
+    std::string summary() const;
+
+    static const char *name(Function function);
+
+    static const char *name(Phase phase);
+
+    /**
+     * @brief Records the time from its construction to its destruction, or to the call of stop, if the profile is not nullptr.
+     */
+    template <typename Key>
+    class Timer
+    {
+    public:
+#ifdef PYFMU_PROFILING
+        Timer(Profile *profile, Key key) : profile_(profile), key_(key)
+        {
+            if (profile_ != nullptr)
+                start_ = std::chrono::steady_clock::now();
+        }
+
+        ~Timer() { stop(); }
+
+        /**
+         * @brief Record the time elapsed so far, such that consecutive phases are timed without nesting scopes.
+         */
+        void stop()
+        {
+            if (profile_ != nullptr)
+                profile_->record(key_, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+
+            profile_ = nullptr;
+        }
+
+    private:
+        Profile *profile_;
+        Key key_;
+        std::chrono::steady_clock::time_point start_;
+#else
+        Timer(Profile *, Key) {}
+
+        void stop() {}
+#endif
+
+    public:
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+    };
+
+    using FunctionTimer = Timer<Function>;
+    using PhaseTimer = Timer<Phase>;
+
+private:
+    bool dumpOnTerminate_;
+
+    std::array<LatencyHistogram, static_cast<std::size_t>(Function::n_functions)> functions_;
+    std::array<LatencyHistogram, static_cast<std::size_t>(Phase::n_phases)> phases_;
+};
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_PROFILE_HPP
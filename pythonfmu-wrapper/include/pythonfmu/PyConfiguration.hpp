@@ -12,10 +12,98 @@
 
 namespace pyconfiguration
 {
+/**
+ * @brief Delivery of log messages to the tool, read from the optional "logging" object of the configuration.
+ */
+struct LoggingConfiguration
+{
+    /**
+     * @brief sync: messages are delivered on the thread calling the FMI function (default)
+     * async: messages are queued and delivered by a background thread, which requires a tool accepting callbacks from other threads
+     */
+    std::string mode = "sync";
+
+    /**
+     * @brief Number of messages the queue of an asynchronous logger holds.
+     */
+    std::size_t capacity = 4096;
+
+    /**
+     * @brief What happens to messages when the queue is full: drop, block or sample, see Logger::Overflow.
+     */
+    std::string overflow = "drop";
+};
+
+/**
+ * @brief Reuse of freed instances, read from the optional "pool" object of the configuration.
+ * 
+ * Freed instances are kept alive and handed out by the next fmi2Instantiate of the same FMU after being reset,
+ * which saves starting the interpreter and loading the slave.
+ */
+struct PoolConfiguration
+{
+    /**
+     * @brief Number of freed instances kept per FMU, 0 disables pooling (default).
+     */
+    std::size_t size = 0;
+
+    /**
+     * @brief Seconds after which an unused instance may be destroyed, 0 keeps them for the lifetime of the process (default).
+     * 
+     * Eviction is lazy, idle instances are only destroyed by the next fmi2Instantiate or fmi2FreeInstance of any pooled FMU.
+     * Pooled instances are never destroyed when the FMU is unloaded.
+     */
+    double max_idle = 0;
+};
+
+/**
+ * @brief Collection of latency histograms of the FMI functions, read from the optional "profiling" object of the configuration.
+ * 
+ * The histograms of an instance are read by the tool through pyfmuGetProfile, see pythonfmu::Profile.
+ */
+struct ProfilingConfiguration
+{
+    /**
+     * @brief Record the calls of every instance, false disables profiling (default).
+     */
+    bool enabled = false;
+
+    /**
+     * @brief Log a summary of the histograms in the category "profile" when the instance is terminated, false by default.
+     */
+    bool dump_on_terminate = false;
+};
+
 struct PyConfiguration
 {
     std::string main_class;
     std::string main_script;
+
+    /**
+     * @brief Interpreter in which instances of the slave are created, optional.
+     * 
+     * shared: all instances in the process share the main interpreter (default)
+     * isolated: every instance gets a sub-interpreter of its own, which can not import single-phase extensions such as numpy when built with PYFMU_OWN_GIL
+     * process: every instance is executed by a worker process with an interpreter of its own, only supported on Linux
+     * fork: like process, but the workers are forked from a template process which has already initialized the interpreter and imported the slave,
+     * which saves most of the startup time and shares the memory of the interpreter and modules copy-on-write, only supported on Linux
+     */
+    std::string interpreter = "shared";
+
+    /**
+     * @brief How fmi2DoStep executes steps, optional.
+     * 
+     * sync: the step is taken before fmi2DoStep returns (default)
+     * async: the step is taken by a thread of the instance, fmi2DoStep returns fmi2Pending and the tool is notified through stepFinished,
+     * tools which do not provide stepFinished get synchronous steps
+     */
+    std::string stepping = "sync";
+
+    LoggingConfiguration logging;
+
+    PoolConfiguration pool;
+
+    ProfilingConfiguration profiling;
 };
 
 void to_json(nlohmann::json &j, const pyconfiguration::PyConfiguration &p);
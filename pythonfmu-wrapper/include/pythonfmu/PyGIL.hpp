@@ -1,5 +1,8 @@
 #include "Python.h"
 
+#include "pythonfmu/Profile.hpp"
+#include "pythonfmu/PySubInterpreter.hpp"
+
 #pragma once
 
 /**
@@ -8,6 +11,9 @@
  * This is necessary to ensure safe operation if the process calling the FMU also uses Python.
  * The lock MUST be taken before any calls to the Python c-api.
  * 
+ * If a sub-interpreter is specified, it is made current and its GIL is taken instead of that of the main interpreter.
+ * If a profile is specified, the time spent waiting for the GIL is recorded into it.
+ * 
  * @note
  * See CPythons c-api documentation for details:
  * https://docs.python.org/3/c-api/init.html#thread-state-and-the-global-interpreter-lock
@@ -21,17 +27,26 @@ class PyGIL
 
     public:
 
-    explicit PyGIL(): state(PyGILState_Ensure()) 
+    explicit PyGIL(pythonfmu::PySubInterpreter *interpreter = nullptr, pythonfmu::Profile *profile = nullptr) : interpreter(interpreter)
     {
-        
+        pythonfmu::Profile::PhaseTimer wait(profile, pythonfmu::Profile::Phase::gil_wait);
+
+        if (interpreter != nullptr)
+            interpreter->enter();
+        else
+            state = PyGILState_Ensure();
     }
 
     ~PyGIL()
     {
-        PyGILState_Release(this->state);
+        if (interpreter != nullptr)
+            interpreter->exit();
+        else
+            PyGILState_Release(this->state);
     }
     
     private:
     
+    pythonfmu::PySubInterpreter *interpreter;
     PyGILState_STATE state;
-};
\ No newline at end of file
+};
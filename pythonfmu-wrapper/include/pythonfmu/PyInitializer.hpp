@@ -1,57 +1,40 @@
 #ifndef PYTHONFMU_PYTHONSTATE_HPP
 #define PYTHONFMU_PYTHONSTATE_HPP
 
-#include <iostream>
-#include <stdlib.h>
+#include <memory>
+#include <string>
 
 #include <Python.h>
 
-#include "utility/utils.hpp"
-
-
+#include "pythonfmu/Logger.hpp"
 
 namespace pythonfmu
 {
 
+/**
+ * @brief Manages the lifetime of the Python interpreter, which is shared by all instances of FMUs loaded in the process.
+ * 
+ * The interpreter is initialized when the first instance acquires it and kept alive until the process exits.
+ * Python requires the interpreter to be finalized by the thread which initialized it, which need not be the thread freeing the last instance.
+ * If the interpreter was initialized by the process itself, for instance when the FMU is loaded from Python, it is not initialized by the wrapper.
+ */
 class PyInitializer
 {
 public:
-    PyInitializer(Logger *log, std::wstring module_path = L"")
-    {
-        log->ok("Setting up module path\n");
-
-        if (!module_path.empty())
-        {
-            log->ok("Using explicitly defined module path\n");
-            Py_SetPath(module_path.c_str());
-        }
-
-
-        log->ok("initializing Python interpreter\n");
-        Py_Initialize();
-
-
-        const wchar_t *home = Py_GetPythonHome() ? Py_GetPythonHome() : L"";
-        const wchar_t *path = Py_GetPath() ? Py_GetPath() : L"";
-
-        std::string home_str = ws2s(std::wstring(home));
-        std::string path_str = ws2s(std::wstring(path));
-
-        log->ok(fmt::format("Python home is: {} and path is {}", home_str, path_str));
-
-        if (!Py_IsInitialized())
-        {
-            log->ok("Failed to initialize Python Interpreter");
-            throw std::runtime_error("Failed to initialize Python interpreter");
-        }
-
-        log->ok("Python interpreter initialized");
-    }
-
-    ~PyInitializer()
-    {
-        Py_Finalize();
-    }
+    /**
+     * @brief Acquire a reference to the shared interpreter, initializing it if it has not been initialized yet.
+     * 
+     * @param log logger used to report the progress of initializing the interpreter
+     * @param module_path explicitly defined module search path, only used when initializing the interpreter
+     * @throw runtime_error if the interpreter could not be initialized
+     */
+    static std::shared_ptr<PyInitializer> acquire(Logger *log, std::wstring module_path = L"");
+
+    PyInitializer(const PyInitializer &) = delete;
+    PyInitializer &operator=(const PyInitializer &) = delete;
+
+private:
+    explicit PyInitializer(Logger *log, std::wstring module_path);
 };
 
 } // namespace pythonfmu
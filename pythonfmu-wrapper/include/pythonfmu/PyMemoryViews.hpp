@@ -0,0 +1,202 @@
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include <Python.h>
+
+#include "fmi/fmi2TypesPlatform.h"
+
+#ifndef PYTHONFMU_PYMEMORYVIEWS_HPP
+#define PYTHONFMU_PYMEMORYVIEWS_HPP
+
+class Logger;
+
+namespace pythonfmu
+{
+
+/**
+ * @brief View of memory owned by the wrapper, which the slave holds across calls, see PyMemoryViews::shared.
+ */
+struct SharedView
+{
+    /**
+     * @brief The view passed to the slave.
+     */
+    PyObject *view = nullptr;
+
+    /**
+     * @brief Private view of the memory, which is exported for as long as the slave holds view or any view derived from it.
+     *
+     * nullptr where the exports can not be tracked, see PyMemoryViews::shared.
+     */
+    PyObject *exporter = nullptr;
+};
+
+/**
+ * @brief Exposes arrays owned by the caller of the FMI functions to Python as typed memoryviews, without copying them.
+ *
+ * Views of const arrays are read-only, all other views are writable.
+ * A view must be released using release() before the memory is handed back to the caller,
+ * after which any access from Python raises a ValueError rather than touching the caller's memory.
+ *
+ * All methods must be called while holding the GIL.
+ */
+class PyMemoryViews
+{
+public:
+    /**
+     * @brief Resolves the methods of the built-in memoryview type.
+     *
+     * @throw runtime_error if the methods could not be resolved
+     */
+    PyMemoryViews();
+
+    PyMemoryViews(const PyMemoryViews &) = delete;
+
+    PyMemoryViews &operator=(const PyMemoryViews &) = delete;
+
+    ~PyMemoryViews();
+
+    /**
+     * @brief Create a memoryview of the array.
+     *
+     * @param data array of value references, integers/booleans or reals
+     * @param n number of elements in the array
+     * @return new reference to the view or nullptr if an exception was raised
+     */
+    template <typename T>
+    PyObject *view(T *data, std::size_t n) const
+    {
+        using value_type = std::remove_const_t<T>;
+        static_assert(std::is_same_v<value_type, fmi2ValueReference> || std::is_same_v<value_type, fmi2Integer> || std::is_same_v<value_type, fmi2Real>,
+                      "only arrays of value references, integers, booleans and reals can be viewed");
+
+        return view(const_cast<value_type *>(data), n * sizeof(value_type), format<value_type>(), !std::is_const_v<T>);
+    }
+
+    /**
+     * @brief Create a read-only memoryview of raw bytes.
+     *
+     * @return new reference to the view or nullptr if an exception was raised
+     */
+    PyObject *bytes(const void *data, std::size_t size) const
+    {
+        return view(const_cast<void *>(data), size, nullptr, false);
+    }
+
+    /**
+     * @brief Create a writable memoryview of raw bytes.
+     *
+     * @return new reference to the view or nullptr if an exception was raised
+     */
+    PyObject *bytes(void *data, std::size_t size) const
+    {
+        return view(data, size, nullptr, true);
+    }
+
+    /**
+     * @brief Create a memoryview of an array owned by the wrapper, which the slave may hold and derive views from across calls.
+     *
+     * Views derived from the view, such as casts, slices and NumPy arrays, share its buffer rather than exporting it,
+     * such that releasing the view does not tell whether they survive. Instead, the view is created from a private view,
+     * which remains exported until the view and every view derived from it are gone, see release(SharedView &).
+     *
+     * The exports can only be tracked from Python 3.8, before which the shared view is an ordinary view without an exporter.
+     *
+     * @param data array of value references, integers/booleans or reals
+     * @param n number of elements in the array
+     * @return the view, whose view is nullptr if an exception was raised
+     */
+    template <typename T>
+    SharedView shared(T *data, std::size_t n) const
+    {
+        using value_type = std::remove_const_t<T>;
+        static_assert(std::is_same_v<value_type, fmi2ValueReference> || std::is_same_v<value_type, fmi2Integer> || std::is_same_v<value_type, fmi2Real>,
+                      "only arrays of value references, integers, booleans and reals can be viewed");
+
+        return shared(const_cast<value_type *>(data), n * sizeof(value_type), format<value_type>(), !std::is_const_v<T>);
+    }
+
+    /**
+     * @brief Create a shared, writable memoryview of raw bytes.
+     */
+    SharedView sharedBytes(void *data, std::size_t size) const
+    {
+        return shared(data, size, nullptr, true);
+    }
+
+    /**
+     * @brief Release the view and drop the reference to it.
+     *
+     * If an exception is set when the method is invoked, it is preserved.
+     *
+     * @return false if the view could not be released, for instance if Python code still holds an export of the buffer.
+     */
+    bool release(PyObject *view) const;
+
+    /**
+     * @brief Release the views passed to a method of the slave, logging an error if the slave retained a reference to any of them.
+     *
+     * Null views, left where creating a view failed, are skipped.
+     *
+     * @param method name of the method, used in the error message
+     */
+    void release(std::span<PyObject *const> views, const char *method, Logger *logger) const;
+
+    /**
+     * @brief Release a shared view and drop the references to it, after which the slave can no longer access the memory through it.
+     *
+     * A view without an exporter is released like a view created by view(), which only tells whether the slave exported it directly.
+     *
+     * @return false if the slave still holds views derived from it, in which case the memory must be kept alive rather than freed.
+     */
+    bool release(SharedView &view) const;
+
+    /**
+     * @brief Release the shared views, keeping the owner of their memory alive for as long as the slave holds views derived from any of them.
+     *
+     * The owner is referenced by a weakref.finalize of every view which survives its release, such that it is destroyed along with the last of them.
+     * If it can not be kept alive this way, the owner is leaked rather than destroyed while the slave may still access the memory.
+     *
+     * @param owner object owning the memory, such as a capsule, or nullptr to release the views only
+     * @return false if the slave still holds views derived from any of the views
+     */
+    bool release(std::span<SharedView> views, PyObject *owner, Logger *logger) const;
+
+private:
+    PyObject *pCast_;
+    PyObject *pRelease_;
+
+    // type re-exporting the buffer of a view, resolved by the first call of shared, nullptr where it is not available
+    mutable PyObject *pPickleBuffer_ = nullptr;
+    mutable bool pickleBufferResolved_ = false;
+    PyObject *pFormatValueReference_;
+    PyObject *pFormatInteger_;
+    PyObject *pFormatReal_;
+
+    // a null format creates a view of unsigned bytes
+    PyObject *view(void *data, std::size_t size, PyObject *format, bool writable) const;
+
+    SharedView shared(void *data, std::size_t size, PyObject *format, bool writable) const;
+
+    // steals the reference to the view of unsigned bytes, a null format returns it as is
+    PyObject *cast(PyObject *bytes, PyObject *format) const;
+
+    // keeps a reference to the owner until the object is destroyed
+    void keep_alive(PyObject *object, PyObject *owner, Logger *logger) const;
+
+    template <typename T>
+    PyObject *format() const
+    {
+        if constexpr (std::is_same_v<T, fmi2ValueReference>)
+            return pFormatValueReference_;
+        else if constexpr (std::is_same_v<T, fmi2Integer>)
+            return pFormatInteger_;
+        else
+            return pFormatReal_;
+    }
+};
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_PYMEMORYVIEWS_HPP
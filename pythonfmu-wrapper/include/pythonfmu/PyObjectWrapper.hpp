@@ -1,14 +1,29 @@
 
 
+#include <array>
+#include <functional>
+#include <initializer_list>
 #include <string>
 #include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
 #include <filesystem>
 
 #include <Python.h>
 
 #include "Logger.hpp"
 #include "fmi/fmi2TypesPlatform.h"
+#include "pythonfmu/JacobianColoring.hpp"
+#include "pythonfmu/LogRing.hpp"
+#include "pythonfmu/PyConfiguration.hpp"
 #include "pythonfmu/PyGIL.hpp"
+#include "pythonfmu/PyMemoryViews.hpp"
+#include "pythonfmu/PySubInterpreter.hpp"
+#include "pythonfmu/Slave.hpp"
+#include "pythonfmu/StringArena.hpp"
+#include "pythonfmu/ValueReferenceTable.hpp"
+#include "pythonfmu/VariableStore.hpp"
 
 #ifndef PYTHONFMU_PYOBJECTWRAPPER_HPP
 #define PYTHONFMU_PYOBJECTWRAPPER_HPP
@@ -16,53 +31,476 @@
 namespace pythonfmu
 {
 
-class PyObjectWrapper
+class PyObjectWrapper : public Slave
 {
 
 public:
     explicit PyObjectWrapper(const std::filesystem::path resources, Logger *logger);
 
-    explicit PyObjectWrapper(PyObjectWrapper &&other);
+    /**
+     * @brief Instantiate the slave using a configuration which has already been read from the resources.
+     * 
+     * The main script and the pyfmu library are imported from the bytecode archive generated by the exporter,
+     * if it was compiled by a matching interpreter, otherwise from source.
+     *
+     * @param members number of members of the ensemble simulated by the slave, more than one requires the slave to declare __ensemble__ = True
+     */
+    PyObjectWrapper(const std::filesystem::path resources, const pyconfiguration::PyConfiguration &config, Logger *logger, std::size_t members = 1);
+
+    /**
+     * @brief Import the module of the slave located in the resources into the main interpreter, without instantiating the slave.
+     * 
+     * Used by the fork server, such that the workers forked from it find the module in sys.modules.
+     * 
+     * @throw runtime_error if the configuration could not be read or the module could not be imported
+     */
+    static void preload(const std::filesystem::path &resources, Logger *logger);
+
+    /**
+     * @brief Instances own references to the slave and its methods, and are shared through pointers rather than copied or moved.
+     */
+    PyObjectWrapper(const PyObjectWrapper &) = delete;
+    PyObjectWrapper(PyObjectWrapper &&) = delete;
+
+    void setupExperiment(double startTime) override;
+
+    void enterInitializationMode() override;
+
+    void exitInitializationMode() override;
+
+    bool doStep(double currentTime, double stepSize) override;
+
+    /**
+     * @brief Advance several steps in a single call to the do_steps method of the slave, passing the arrays as memoryviews.
+     * 
+     * Falls back on taking the steps one at a time if the slave does not override do_steps.
+     */
+    std::size_t doSteps(double currentTime, const fmi2Real *stepSizes, std::size_t nSteps,
+                        const fmi2ValueReference *inputVrs, std::size_t nInputs, const fmi2Real *inputs,
+                        const fmi2ValueReference *outputVrs, std::size_t nOutputs, fmi2Real *outputs) override;
+
+    /**
+     * @brief Restore the state captured after the slave was constructed, then call the reset method of the slave.
+     */
+    void reset() override;
+
+    void terminate() override;
+
+    void getInteger(const fmi2ValueReference *vr, std::size_t nvr, fmi2Integer *value) const override;
+
+    void getReal(const fmi2ValueReference *vr, std::size_t nvr, fmi2Real *value) const override;
+
+    void getString(const fmi2ValueReference *vr, std::size_t nvr, fmi2String *value) const override;
+
+    void getBoolean(const fmi2ValueReference *vr, std::size_t nvr, fmi2Boolean *value) const override;
+
+    fmi2Status setDebugLogging(bool loggingOn, size_t nCategories, const char* const categories[]) const override;
+
+    void setReal(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Real *value) override;
+
+    void setInteger(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *value) override;
+
+    void setBoolean(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Boolean *value) override;
+
+    void setString(const fmi2ValueReference *vr, std::size_t nvr, const fmi2String *value) override;
+
+    fmi2FMUstate getFMUstate(fmi2FMUstate state) override;
+
+    void setFMUstate(fmi2FMUstate state) override;
+
+    void freeFMUstate(fmi2FMUstate state) override;
+
+    std::size_t serializedFMUstateSize(fmi2FMUstate state) override;
+
+    void serializeFMUstate(fmi2FMUstate state, fmi2Byte *data, std::size_t size) override;
+
+    fmi2FMUstate deSerializeFMUstate(const fmi2Byte *data, std::size_t size, fmi2FMUstate state) override;
+
+    void freeAllFMUstates() override;
 
-    void setupExperiment(double startTime);
+    bool providesModelExchange() const override { return modelExchange_; }
 
-    void enterInitializationMode();
+    /**
+     * @brief Store the time, which is passed to the slave along with its next call.
+     */
+    void setTime(double time) override;
 
-    void exitInitializationMode();
+    /**
+     * @brief Copy the states, which are passed to the slave along with its next call.
+     */
+    void setContinuousStates(const fmi2Real *states, std::size_t nx) override;
 
-    bool doStep(double currentTime, double stepSize);
+    /**
+     * @brief Returns the states set by the tool without calling into the slave, if they have not been passed to it yet.
+     */
+    void getContinuousStates(fmi2Real *states, std::size_t nx) override;
 
-    void reset();
+    void getNominalsOfContinuousStates(fmi2Real *nominals, std::size_t nx) override;
 
-    void terminate();
+    /**
+     * @brief Get the derivatives in a single call to the slave, which adopts the time and states set since its last call.
+     */
+    void getDerivatives(fmi2Real *derivatives, std::size_t nx) override;
 
-    void getInteger(const fmi2ValueReference *vr, std::size_t nvr, fmi2Integer *value) const;
+    /**
+     * @brief Get the event indicators in a single call to the slave, which adopts the time and states set since its last call.
+     */
+    void getEventIndicators(fmi2Real *indicators, std::size_t ni) override;
 
-    void getReal(const fmi2ValueReference *vr, std::size_t nvr, fmi2Real *value) const;
+    void enterEventMode() override;
 
-    void getString(const fmi2ValueReference *vr, std::size_t nvr, fmi2String *value) const;
+    void newDiscreteStates(fmi2EventInfo *eventInfo) override;
 
-    void getBoolean(const fmi2ValueReference *vr, std::size_t nvr, fmi2Boolean *value) const;
+    void enterContinuousTimeMode() override;
 
-    fmi2Status setDebugLogging(bool loggingOn, size_t nCategories, const char* const categories[]) const;
+    bool completedIntegratorStep(bool noSetFMUStatePriorToCurrentPoint, bool *terminateSimulation) override;
 
-    void setReal(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Real *value);
+    /**
+     * @brief Call the get_directional_derivative method of the slave if it overrides it, otherwise approximate the derivative by a forward difference.
+     */
+    void getDirectionalDerivative(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                                  const fmi2ValueReference *knowns, std::size_t nKnowns,
+                                  const fmi2Real *seed, fmi2Real *sensitivity) override;
 
-    void setInteger(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *value);
+    /**
+     * @brief Assemble the Jacobian from one directional derivative per group of columns, grouped by the dependencies declared by the slave.
+     * 
+     * The derivatives are those of get_directional_derivative if the slave overrides it, otherwise forward differences of a snapshot of the slave,
+     * whose knowns are perturbed and which is restored afterwards.
+     */
+    void getJacobian(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                     const fmi2ValueReference *knowns, std::size_t nKnowns, fmi2Real *jacobian) override;
 
-    void setBoolean(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Boolean *value);
+    /**
+     * @brief Store the derivatives of the inputs, which are passed to the slave along with the next step, see Fmi2Slave.input_at.
+     * 
+     * @throw runtime_error unless the slave sets __interpolates_inputs__, or if a value reference is not that of a Real input or an order is less than 1
+     */
+    void setRealInputDerivatives(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *order, const fmi2Real *value) override;
 
-    void setString(const fmi2ValueReference *vr, std::size_t nvr, const fmi2String *value);
+    /**
+     * @brief Call the get_real_output_derivatives method of the slave if it overrides it, otherwise estimate the derivatives from the history of the outputs.
+     * 
+     * The values of an output at the last communication points at which its derivatives were requested are interpolated by a polynomial,
+     * whose derivatives at the end of the last step are returned. Derivatives of orders beyond those of the history are 0,
+     * as such the derivatives of the first call, or of the first call following reset or setFMUstate, are 0.
+     * 
+     * @throw runtime_error if an order is less than 1 or greater than the __max_output_derivative_order__ of the slave
+     */
+    void getRealOutputDerivatives(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *order, fmi2Real *value) override;
+
+    std::size_t ensembleSize() const override { return members_; }
+
+    /**
+     * @brief Copy the values of the members from the store, which holds every variable that may be accessed per member.
+     *
+     * @throw runtime_error if a value reference is not that of a natively stored variable of the data type
+     */
+    void getRealEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Real *value) const override;
+
+    void getIntegerEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Integer *value) const override;
+
+    void getBooleanEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Boolean *value) const override;
+
+    void setRealEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Real *value) override;
+
+    void setIntegerEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *value) override;
 
-    ~PyObjectWrapper();
+    void setBooleanEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Boolean *value) override;
 
-    PyObjectWrapper &operator=(PyObjectWrapper &&rhs);
+    ~PyObjectWrapper() override;
+
+    PyObjectWrapper &operator=(const PyObjectWrapper &) = delete;
+    PyObjectWrapper &operator=(PyObjectWrapper &&) = delete;
 
 private:
+    /**
+     * @brief Methods of the slave invoked by the wrapper.
+     * 
+     * The bound methods are resolved once when the slave is instantiated, rather than being looked up by name on every call.
+     */
+    enum class SlaveMethod : std::size_t
+    {
+        setup_experiment,
+        enter_initialization_mode,
+        exit_initialization_mode,
+        do_step,
+        reset,
+        terminate,
+        get_integer,
+        get_real,
+        get_boolean,
+        get_string,
+        set_integer,
+        set_real,
+        set_boolean,
+        set_string,
+        set_debug_logging,
+        get_log_size,
+        pop_log_messages,
+        get_state,
+        set_state,
+        serialize_state,
+        deserialize_state,
+        set_time,
+        set_continuous_states,
+        get_continuous_states,
+        get_nominals_of_continuous_states,
+        get_derivatives,
+        get_event_indicators,
+        evaluate_derivatives,
+        evaluate_event_indicators,
+        enter_event_mode,
+        new_discrete_states,
+        enter_continuous_time_mode,
+        completed_integrator_step,
+        evaluate_outputs,
+        n_methods
+    };
+
+    /**
+     * @brief The methods from get_state on are optional. Slaves of older versions of pyfmu lack those managing the FMU state,
+     * whose functions then fail, see require.
+     */
+    static constexpr SlaveMethod firstOptionalMethod = SlaveMethod::get_state;
+
+    /**
+     * @brief The methods from set_time on implement Model Exchange, which are only required of slaves providing it,
+     * and evaluate_outputs is only called if the slave overrides it.
+     */
+    static constexpr SlaveMethod firstModelExchangeMethod = SlaveMethod::set_time;
+
+    /**
+     * @brief State of the slave captured by getFMUstate, the handles returned to the tool point to instances of it.
+     */
+    struct FMUState
+    {
+        /**
+         * @brief Snapshot returned by the get_state method of the slave.
+         */
+        PyObject *pState = nullptr;
+
+        /**
+         * @brief Copies of the values of the natively stored variables, which are not part of the snapshot.
+         */
+        std::vector<fmi2Real> reals;
+        std::vector<fmi2Integer> integers;
+        std::vector<fmi2Boolean> booleans;
+
+        /**
+         * @brief Time reached by the instance when the state was captured, which fmi2SetFMUstate rolls back to.
+         */
+        double lastSuccessfulTime = 0;
+
+        /**
+         * @brief Snapshot serialized by the serialize_state method of the slave, nullptr until the state is first serialized.
+         * 
+         * Kept such that the snapshot is serialized once, even though the tool queries the size before serializing the state.
+         */
+        PyObject *pSerialized = nullptr;
+    };
+
+    /**
+     * @brief Sub-interpreter owning the Python objects of the instance, nullptr if they live in the main interpreter.
+     * 
+     * Declared before every member holding Python objects, such that it is destroyed after all of them.
+     */
+    std::unique_ptr<PySubInterpreter> subInterpreter_;
+
+    /**
+     * @brief States which have not yet been freed, they are released along with the slave.
+     */
+    std::vector<std::unique_ptr<FMUState>> states_;
+
+    /**
+     * @brief State captured once the slave was constructed, which reset restores, nullptr if the slave could not capture its state.
+     */
+    std::unique_ptr<FMUState> initialState_;
+
     PyObject *pModule_;
     PyObject *pClass_;
     PyObject *pInstance_;
 
+    std::array<PyObject *, static_cast<std::size_t>(SlaveMethod::n_methods)> pMethods_{};
+
+    /**
+     * @brief The do_steps method of the slave, nullptr unless the slave overrides the one defined by Fmi2Slave.
+     * 
+     * Steps of slaves which do not override it are taken one at a time by the wrapper, rather than by the default implementation in Python.
+     */
+    PyObject *pDoSteps_ = nullptr;
+
+    /**
+     * @brief The get_directional_derivative method of the slave, nullptr unless the slave overrides the one defined by Fmi2Slave.
+     */
+    PyObject *pDirectionalDerivative_ = nullptr;
+
+    /**
+     * @brief Whether the slave overrides evaluate_outputs, without which the outputs of a slave are only computed by its steps.
+     */
+    bool evaluatesOutputs_ = false;
+
+    /**
+     * @brief Value references of the inputs and states on which an output or a derivative depends, for those whose dependencies the slave declared.
+     */
+    std::unordered_map<fmi2ValueReference, std::vector<fmi2ValueReference>> dependencies_;
+
+    /**
+     * @brief Positions of the continuous states in the vector of states, by value reference, empty for slaves created using older versions of pyfmu.
+     */
+    std::unordered_map<fmi2ValueReference, std::size_t> stateIndices_;
+
+    /**
+     * @brief Unknowns and knowns of the Jacobian assembled last and the coloring of its columns, reused while the tool assembles the same Jacobian.
+     */
+    std::vector<fmi2ValueReference> jacobianUnknowns_;
+    std::vector<fmi2ValueReference> jacobianKnowns_;
+    std::unique_ptr<JacobianColoring> jacobianColoring_;
+
+    /**
+     * @brief Snapshot of the slave taken before perturbing its knowns, which is restored once the differences have been evaluated.
+     */
+    std::unique_ptr<FMUState> unperturbedState_;
+
+    /**
+     * @brief Derivatives of the Real inputs set by the tool for the next step, in increasing order, with an entry for every input the slave interpolates.
+     */
+    std::unordered_map<fmi2ValueReference, std::vector<fmi2Real>> inputDerivatives_;
+
+    /**
+     * @brief True if the tool set derivatives which have not been passed to the slave.
+     */
+    bool inputDerivativesPending_ = false;
+
+    /**
+     * @brief True if the slave holds the derivatives passed for the previous step, which are cleared before the next step unless the tool set new ones.
+     */
+    bool inputDerivativesPassed_ = false;
+
+    /**
+     * @brief The get_real_output_derivatives method of the slave, nullptr unless the slave overrides the one defined by Fmi2Slave.
+     */
+    PyObject *pOutputDerivatives_ = nullptr;
+
+    int maxOutputDerivativeOrder_ = 0;
+
+    /**
+     * @brief Value references of the Real outputs, in increasing order, whose values are recorded after every completed step unless the slave provides their derivatives.
+     */
+    std::vector<fmi2ValueReference> realOutputs_;
+
+    /**
+     * @brief Values of an output at the last maxOutputDerivativeOrder_ + 1 communication points, oldest first.
+     *
+     * The outputs are recorded after every completed step, and when the tool gets their derivatives, for instance after setting inputs with direct feedthrough.
+     */
+    struct OutputHistory
+    {
+        std::vector<fmi2Real> times;
+        std::vector<fmi2Real> values;
+    };
+
+    std::unordered_map<fmi2ValueReference, OutputHistory> outputHistory_;
+
+    /**
+     * @brief True if the slave accepts memoryviews of the callers arrays in place of lists, when getting and setting Integer, Boolean and Real values.
+     * 
+     * Slaves opt in by defining the attribute __buffer_exchange__ = True, as done by Fmi2Slave.
+     */
+    bool bufferExchange_ = false;
+    std::unique_ptr<PyMemoryViews> views_;
+
+    /**
+     * @brief Number of values below which boxing the values into lists is cheaper than creating and releasing the memoryviews.
+     */
+    static constexpr std::size_t minViewValues = 64;
+
+    /**
+     * @brief Data types of the value references registered by the slave, nullptr if the slave does not report them.
+     */
+    std::unique_ptr<ValueReferenceTable> vrTable_;
+
+    /**
+     * @brief Values of variables registered as native by the slave, nullptr if the slave has none.
+     */
+    std::unique_ptr<VariableStore> store_;
+
+    /**
+     * @brief Number of members of the ensemble, each of which has its own copy of the variables in the store.
+     */
+    std::size_t members_ = 1;
+
+    /**
+     * @brief Views of the Real, Integer and Boolean arrays of the store, held by the slave.
+     */
+    std::array<SharedView, 3> storeViews_{};
+
+    /**
+     * @brief Ring into which the logger of the slave writes its messages, nullptr if the slave does not support it.
+     */
+    std::unique_ptr<LogRing> logRing_;
+
+    /**
+     * @brief Views of the indices and the record area of the log ring, held by the logger of the slave.
+     */
+    std::array<SharedView, 2> logViews_{};
+
+    /**
+     * @brief Active categories of the logger, shared with it, and the view of them held by the logger of the slave.
+     */
+    std::shared_ptr<std::array<std::uint32_t, Logger::nActiveWords>> activeWords_;
+    SharedView filterView_;
+
+    /**
+     * @brief Owns the strings returned by getString, which remain valid until its next call.
+     */
+    mutable StringArena strings_;
+
+    /**
+     * @brief True if the slave registered continuous states or event indicators, see __model_exchange__ of Fmi2Slave.
+     */
+    bool modelExchange_ = false;
+    std::size_t nStates_ = 0;
+    std::size_t nEventIndicators_ = 0;
+
+    /**
+     * @brief Time and continuous states set by the tool, which are passed to the slave along with its next call rather than one call each.
+     * 
+     * Integrators set the time and the states before every evaluation of the derivatives, which the slave is then given by a single call of evaluate_derivatives.
+     * Any other call into the slave is preceded by calls of set_time and set_continuous_states, see apply_pending_states.
+     */
+    double time_ = 0;
+    std::vector<fmi2Real> continuousStates_;
+    mutable bool timePending_ = false;
+    mutable bool statesPending_ = false;
+
+    /**
+     * @brief Read-only view of continuousStates_, which is allocated once and passed to the slave on every call adopting the states.
+     */
+    SharedView statesView_;
+
+    /**
+     * @brief Release the shared views of the memory, which is deleted once neither the wrapper nor any view derived from the views by the slave refers to it.
+     *
+     * Views derived by the slave, such as the NumPy arrays of array variables, may outlive the wrapper, in which case the memory is handed over to a capsule
+     * which is destroyed along with the last of them, see PyMemoryViews::release.
+     */
+    template <typename T>
+    void release_shared(std::span<SharedView> views, std::unique_ptr<T> memory) const;
+
+    bool use_views(std::size_t nvr) const
+    {
+        return bufferExchange_ && nvr >= minViewValues;
+    }
+
+    /**
+     * @brief True if the time or the states set by the tool have not been passed to the slave, in which case the native store may be out of date.
+     */
+    bool states_pending() const
+    {
+        return timePending_ || statesPending_;
+    }
+
     Logger *logger;
 
     /**
@@ -80,12 +518,251 @@ private:
      */
     void instantiate_main_class(std::string module_name, std::string main_class);
 
+    /**
+     * @brief Resolve and store strong references to the bound methods of the slave instance.
+     * 
+     * @throw runtime_error if the instance does not define one of the methods
+     */
+    void resolve_slave_methods();
+
+    /**
+     * @brief Read the value references registered by the slave, which getters and setters validate before calling into the slave.
+     * 
+     * Slaves created using versions of pyfmu without support for it are left unchanged, the slave validates the references itself.
+     * 
+     * @throw runtime_error if the slave reported invalid value references
+     */
+    void attach_value_reference_table();
+
+    /**
+     * @brief Throw if one of the value references does not refer to a variable of the type.
+     */
+    void validate_value_references(ValueReferenceTable::Type type, const fmi2ValueReference *vr, std::size_t nvr) const;
+
+    /**
+     * @brief Allocate the store for variables registered as native and attach it to the slave.
+     * 
+     * Slaves without native variables, or those created using versions of pyfmu without support for them, are left unchanged.
+     * The store of an ensemble holds the variables of every member, which requires the slave to declare __ensemble__ = True.
+     * 
+     * @throw runtime_error if the store could not be attached, or the slave does not support ensembles of more than one member
+     */
+    void attach_native_store();
+
+    /**
+     * @brief Log and throw the error of accessing the members of an ensemble through a variable which is not in the store.
+     */
+    void not_stored_natively() const;
+
+    /**
+     * @brief Allocate the log ring and attach it to the logger of the slave.
+     * 
+     * Slaves created using versions of pyfmu without support for it are left unchanged, their messages are polled instead.
+     * 
+     * @throw runtime_error if the ring could not be attached
+     */
+    void attach_log_ring();
+
+    /**
+     * @brief Expose the active categories of the logger to the logger of the slave, assigning ids to the categories registered by the slave.
+     * 
+     * Slaves created using versions of pyfmu without support for it are left unchanged, fmi2SetDebugLogging is forwarded to them instead.
+     * 
+     * @throw runtime_error if the categories could not be attached
+     */
+    void attach_log_filter();
+
+    /**
+     * @brief Read the continuous states and event indicators registered by the slave and allocate the vector of the states.
+     * 
+     * Slaves which registered neither, or were created using versions of pyfmu without support for Model Exchange, are left unchanged.
+     * 
+     * @throw runtime_error if the slave reported invalid states or lacks one of the Model Exchange methods
+     */
+    void attach_model_exchange();
+
+    /**
+     * @brief Resolve the get_directional_derivative method of the slave, if it overrides it, and read the dependencies it declared.
+     * 
+     * Slaves created using versions of pyfmu without support for it are left unchanged, their derivatives are approximated assuming dense dependencies.
+     * 
+     * @throw runtime_error if the slave reported invalid dependencies
+     */
+    void attach_directional_derivatives();
+
+    /**
+     * @brief Read which inputs the slave interpolates and how it provides the derivatives of its outputs.
+     * 
+     * Slaves created using versions of pyfmu without support for it neither interpolate inputs nor provide derivatives of their outputs.
+     * 
+     * @throw runtime_error if the slave reported invalid value references or orders
+     */
+    void attach_interpolation();
+
+    /**
+     * @brief Pass the derivatives of the inputs set by the tool to the slave for the step starting at currentTime, which replace those of the previous step.
+     * 
+     * Called with the GIL held.
+     */
+    void pass_input_derivatives(double currentTime);
+
+    /**
+     * @brief Call the get_real_output_derivatives method of the slave, passing the arrays as memoryviews.
+     */
+    void call_output_derivatives(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *order, fmi2Real *value);
+
+    /**
+     * @brief Append the value of the output at the time to its history, replacing the value recorded at the same time, if any.
+     */
+    void record_output(fmi2ValueReference vr, double time, fmi2Real value);
+
+    /**
+     * @brief Record the values of the Real outputs at the last successful time, from which their derivatives are estimated.
+     */
+    void record_outputs();
+
+    /**
+     * @brief Returns the coloring of the Jacobian of the unknowns with respect to the knowns, reusing that of the last Jacobian if they match.
+     */
+    const JacobianColoring &jacobian_coloring(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                                              const fmi2ValueReference *knowns, std::size_t nKnowns);
+
+    /**
+     * @brief Call the get_directional_derivative method of the slave, passing the arrays as memoryviews.
+     */
+    void call_directional_derivative(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                                     const fmi2ValueReference *knowns, std::size_t nKnowns,
+                                     const fmi2Real *seed, fmi2Real *sensitivity);
+
+    /**
+     * @brief Evaluate the changes of the unknowns caused by perturbing the knowns in each of nDirections directions, starting from their values x0.
+     * 
+     * The slave is captured before and restored after perturbing it. Slaves providing Model Exchange evaluate their derivatives,
+     * and slaves overriding evaluate_outputs their outputs, before the unknowns are read, such that the unknowns reflect the perturbed knowns.
+     * Knowns which are continuous states are perturbed by setting the states, which the slave adopts through evaluate_derivatives.
+     * Throws if the slave does neither, since its unknowns would not change.
+     * 
+     * @param direction writes the perturbation of the knowns in the given direction
+     * @param difference receives the change of the unknowns in the given direction
+     */
+    void forward_differences(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                             const fmi2ValueReference *knowns, std::size_t nKnowns, const fmi2Real *x0, std::size_t nDirections,
+                             const std::function<void(std::size_t, fmi2Real *)> &direction,
+                             const std::function<void(std::size_t, const fmi2Real *)> &difference);
+
+    /**
+     * @brief Read the unknowns, evaluating the derivatives first if the slave provides Model Exchange, and the outputs if it overrides evaluate_outputs.
+     *
+     * @param states continuous states set before evaluating the derivatives, or nullptr to evaluate them at the states of the slave
+     */
+    void evaluate_unknowns(const fmi2ValueReference *unknowns, std::size_t nUnknowns, const fmi2Real *states, fmi2Real *values);
+
+    /**
+     * @brief Throw unless the slave can evaluate its unknowns without taking a step, which approximating its directional derivatives requires.
+     */
+    void require_evaluable_unknowns() const;
+
+    /**
+     * @brief Throw unless the slave provides Model Exchange and n matches the expected number of states or event indicators.
+     */
+    void require_model_exchange(std::size_t n, std::size_t expected, const char *what) const;
+
+    /**
+     * @brief Pass the time and the states set by the tool to set_time and set_continuous_states, if they have not been passed to the slave yet.
+     * 
+     * Must be called while holding the GIL.
+     * 
+     * @return false if the slave raised an exception
+     */
+    bool apply_pending_states() const;
+
+    /**
+     * @brief Get the derivatives or the event indicators, using the evaluate method if the time or the states are pending and the get method otherwise.
+     */
+    void evaluate(SlaveMethod evaluate, SlaveMethod get, fmi2Real *values, std::size_t n);
+
+    /**
+     * @brief Invoke a method of the slave passing a memoryview of the array, which is released once the method returns.
+     * 
+     * Must be called while holding the GIL.
+     * 
+     * @return new reference to the value returned by the method or nullptr if an exception was raised
+     */
+    PyObject *call_with_view(SlaveMethod method, fmi2Real *values, std::size_t n) const;
+
+    /**
+     * @brief Throw if the slave does not define the optional method, such that the FMI function calling it fails rather than the instance.
+     *
+     * @throw runtime_error if the method is not defined
+     */
+    void require(SlaveMethod method) const;
+
+    /**
+     * @brief Invoke a method of the slave using the pre-resolved bound method.
+     * 
+     * The time and states set by the tool which are still pending are passed to the slave first.
+     * Must be called while holding the GIL.
+     * 
+     * @param method the method to invoke
+     * @param args borrowed references to the positional arguments
+     * @return new reference to the value returned by the method or nullptr if an exception was raised
+     */
+    PyObject *call(SlaveMethod method, std::initializer_list<PyObject *> args = {}) const;
+
+    /**
+     * @brief Invoke a get or set method of the slave, passing the value references and values as memoryviews of the callers arrays.
+     * 
+     * The views are released before returning, such that the slave can not access the arrays after the call.
+     * Must be called while holding the GIL.
+     * 
+     * @return new reference to the value returned by the method or nullptr if an exception was raised
+     */
+    template <typename T>
+    PyObject *call_with_views(SlaveMethod method, const fmi2ValueReference *vr, std::size_t nvr, T *values) const;
+
     /**
     * @brief Pass log messages generated by the Python code to the FMI interface using the log callback function.
     * 
-    * @details Two methods are __get_log_size__ and __get_log_messages__ are defined in the FMI2Slave classes.
+    * @details Messages are drained from the log ring, which requires neither the GIL nor any calls into Python.
+    * For slaves without a log ring, the messages are fetched using the methods __get_log_size__ and __pop_log_messages__ defined by Fmi2Slave.
     */
     void propagate_python_log_messages() const;
+
+    /**
+     * @brief Returns the state referred to by the handle.
+     * 
+     * @throw runtime_error if the handle was not returned by getFMUstate of this slave or has been freed
+     */
+    FMUState *find_state(fmi2FMUstate state) const;
+
+    /**
+     * @brief Returns a borrowed reference to the serialized snapshot of the state, serializing it if needed.
+     * 
+     * Must be called while holding the GIL.
+     * 
+     * @throw runtime_error if the slave failed to serialize the snapshot
+     */
+    PyObject *serialized_snapshot(FMUState *state) const;
+
+    /**
+     * @brief Release the Python objects held by the state, must be called while holding the GIL.
+     */
+    static void clear_state(FMUState *state);
+
+    /**
+     * @brief Capture the snapshot of the slave and the values of the native store into the state, must be called while holding the GIL.
+     */
+    void capture_state(FMUState *state);
+
+    /**
+     * @brief Apply a captured state to the slave, must be called while holding the GIL.
+     */
+    void restore_state(const FMUState *state);
+
+    /**
+     * @brief Capture initialState_, a slave whose state can not be captured is reset by its reset method alone.
+     */
+    void capture_initial_state();
 };
 
 } // namespace pythonfmu
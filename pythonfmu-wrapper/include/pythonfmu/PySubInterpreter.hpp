@@ -0,0 +1,73 @@
+#ifndef PYTHONFMU_PYSUBINTERPRETER_HPP
+#define PYTHONFMU_PYSUBINTERPRETER_HPP
+
+#include <cstddef>
+
+#include <Python.h>
+
+#include "pythonfmu/Logger.hpp"
+
+/**
+ * @brief Defined if every sub-interpreter is created with a GIL of its own, allowing instances to run in parallel.
+ * 
+ * Requires Python 3.12 and building against the full rather than the limited API, see the PYFMU_OWN_GIL option of the build.
+ * Otherwise sub-interpreters share the GIL of the main interpreter, isolating the instances from each other without running them in parallel.
+ * 
+ * A sub-interpreter with its own GIL only imports extension modules which support multi-phase initialization and declare support for sub-interpreters.
+ * Other extensions, including numpy, fail to import with an ImportError, slaves depending on them must be built without PYFMU_OWN_GIL.
+ */
+#if defined(PYFMU_OWN_GIL) && (defined(Py_LIMITED_API) || PY_VERSION_HEX < 0x030C0000)
+#error "A GIL per sub-interpreter requires Python 3.12 or later and building without Py_LIMITED_API"
+#endif
+
+namespace pythonfmu
+{
+
+/**
+ * @brief A Python sub-interpreter owned by a single instance of an FMU.
+ * 
+ * The sub-interpreter has its own modules, including sys, such that instances can not interfere with each other.
+ * The main interpreter must be initialized before creating sub-interpreters and finalized after all of them are destroyed.
+ * 
+ * Like the component it belongs to, the sub-interpreter may be used from any thread, but not from several threads at the same time.
+ */
+class PySubInterpreter
+{
+public:
+    /**
+     * @brief Create a new sub-interpreter, the calling thread must not hold the GIL.
+     * 
+     * @throw runtime_error if the sub-interpreter could not be created
+     */
+    explicit PySubInterpreter(Logger *logger);
+
+    ~PySubInterpreter();
+
+    PySubInterpreter(const PySubInterpreter &) = delete;
+    PySubInterpreter &operator=(const PySubInterpreter &) = delete;
+
+    /**
+     * @brief Make the sub-interpreter current for the calling thread and take its GIL.
+     * 
+     * Calls may be nested, the GIL is released once every call to enter is matched by a call to exit.
+     */
+    void enter();
+
+    /**
+     * @brief Release the GIL taken by the matching call to enter.
+     */
+    void exit();
+
+private:
+    /**
+     * @brief Thread state created along with the sub-interpreter.
+     * 
+     * The limited API provides no way of creating additional thread states for a sub-interpreter, so the thread state is shared by the threads using the instance.
+     */
+    PyThreadState *tstate_ = nullptr;
+    std::size_t depth_ = 0;
+};
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_PYSUBINTERPRETER_HPP
@@ -0,0 +1,230 @@
+#include <cstddef>
+
+#include "fmi/fmi2FunctionTypes.h"
+#include "pythonfmu/Profile.hpp"
+
+#ifndef PYTHONFMU_SLAVE_HPP
+#define PYTHONFMU_SLAVE_HPP
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Interface of an instance of a Python slave, the FMI functions forward their calls to it.
+ * 
+ * The slave may live in the process loading the FMU, see PyObjectWrapper, or in a worker process, see ProcessSlave.
+ * Failures are reported by throwing exceptions, which the FMI functions translate to fmi2Error.
+ */
+class Slave
+{
+public:
+    virtual ~Slave() = default;
+
+    virtual void setupExperiment(double startTime) = 0;
+
+    virtual void enterInitializationMode() = 0;
+
+    virtual void exitInitializationMode() = 0;
+
+    /**
+     * @brief Advance a single communication step.
+     * 
+     * @return false if the slave discarded the step, in which case lastSuccessfulTime reports how far it got
+     */
+    virtual bool doStep(double currentTime, double stepSize) = 0;
+
+    /**
+     * @brief Advance several contiguous communication steps, setting Real inputs before and getting Real outputs after each step.
+     * 
+     * The default implementation calls setReal, doStep and getReal for every step, slaves override it to avoid paying for the calls of each step.
+     * 
+     * @param currentTime time at the start of the first step
+     * @param stepSizes sizes of the nSteps steps
+     * @param inputs nSteps rows of nInputs values, the row of a step is set before it is taken, may be nullptr if nInputs is 0
+     * @param outputs nSteps rows of nOutputs values, the row of a step is written after it is taken, may be nullptr if nOutputs is 0
+     * @return the number of steps completed, less than nSteps if a step was discarded, a step which failed throws instead
+     */
+    virtual std::size_t doSteps(double currentTime, const fmi2Real *stepSizes, std::size_t nSteps,
+                                const fmi2ValueReference *inputVrs, std::size_t nInputs, const fmi2Real *inputs,
+                                const fmi2ValueReference *outputVrs, std::size_t nOutputs, fmi2Real *outputs);
+
+    /**
+     * @brief Returns the end of the last step completed by the slave, or the start time if no step has been taken.
+     */
+    virtual double lastSuccessfulTime() const { return lastSuccessfulTime_; }
+
+    /**
+     * @brief Return the slave to the state it had once instantiated, such that it may be simulated again.
+     */
+    virtual void reset() = 0;
+
+    virtual void terminate() = 0;
+
+    virtual void getInteger(const fmi2ValueReference *vr, std::size_t nvr, fmi2Integer *value) const = 0;
+
+    virtual void getReal(const fmi2ValueReference *vr, std::size_t nvr, fmi2Real *value) const = 0;
+
+    virtual void getString(const fmi2ValueReference *vr, std::size_t nvr, fmi2String *value) const = 0;
+
+    virtual void getBoolean(const fmi2ValueReference *vr, std::size_t nvr, fmi2Boolean *value) const = 0;
+
+    virtual fmi2Status setDebugLogging(bool loggingOn, size_t nCategories, const char *const categories[]) const = 0;
+
+    virtual void setReal(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Real *value) = 0;
+
+    virtual void setInteger(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *value) = 0;
+
+    virtual void setBoolean(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Boolean *value) = 0;
+
+    virtual void setString(const fmi2ValueReference *vr, std::size_t nvr, const fmi2String *value) = 0;
+
+    /**
+     * @brief Capture the state of the slave.
+     * 
+     * @param state handle returned by an earlier call, which is overwritten, or nullptr to allocate a new handle
+     * @return the handle holding the state, which remains valid until it is freed or the slave is destroyed
+     */
+    virtual fmi2FMUstate getFMUstate(fmi2FMUstate state) = 0;
+
+    /**
+     * @brief Restore a state captured by getFMUstate, the handle remains valid and may be restored again.
+     */
+    virtual void setFMUstate(fmi2FMUstate state) = 0;
+
+    virtual void freeFMUstate(fmi2FMUstate state) = 0;
+
+    /**
+     * @brief Returns the number of bytes required to serialize the state.
+     */
+    virtual std::size_t serializedFMUstateSize(fmi2FMUstate state) = 0;
+
+    /**
+     * @brief Serialize the state into the buffer, which must be at least serializedFMUstateSize bytes.
+     */
+    virtual void serializeFMUstate(fmi2FMUstate state, fmi2Byte *data, std::size_t size) = 0;
+
+    /**
+     * @brief Restore a state serialized by serializeFMUstate into a handle, without applying it to the slave.
+     * 
+     * @param state handle to overwrite, or nullptr to allocate a new handle
+     * @return the handle holding the state
+     */
+    virtual fmi2FMUstate deSerializeFMUstate(const fmi2Byte *data, std::size_t size, fmi2FMUstate state) = 0;
+
+    /**
+     * @brief Free the states which the tool has not freed, as done when the slave is destroyed, before the slave is handed out again.
+     */
+    virtual void freeAllFMUstates() = 0;
+
+    /**
+     * @brief Returns true if the slave can be simulated using Model Exchange, which the functions below require.
+     */
+    virtual bool providesModelExchange() const { return false; }
+
+    /**
+     * @brief Set the independent variable time of a slave simulated using Model Exchange.
+     * 
+     * The default implementations of the Model Exchange functions throw, as required for slaves which do not provide Model Exchange.
+     */
+    virtual void setTime(double time);
+
+    /**
+     * @brief Set the nx continuous states, which must match the number of states of the slave.
+     */
+    virtual void setContinuousStates(const fmi2Real *states, std::size_t nx);
+
+    virtual void getContinuousStates(fmi2Real *states, std::size_t nx);
+
+    virtual void getNominalsOfContinuousStates(fmi2Real *nominals, std::size_t nx);
+
+    /**
+     * @brief Write the derivatives of the continuous states with respect to time, at the time and states set last.
+     */
+    virtual void getDerivatives(fmi2Real *derivatives, std::size_t nx);
+
+    virtual void getEventIndicators(fmi2Real *indicators, std::size_t ni);
+
+    virtual void enterEventMode();
+
+    virtual void newDiscreteStates(fmi2EventInfo *eventInfo);
+
+    virtual void enterContinuousTimeMode();
+
+    /**
+     * @return true if the slave requests to enter event mode, terminateSimulation is set if it requests to terminate the simulation
+     */
+    virtual bool completedIntegratorStep(bool noSetFMUStatePriorToCurrentPoint, bool *terminateSimulation);
+
+    /**
+     * @brief Write the partial derivatives of the Real unknowns with respect to the Real knowns, multiplied by the seed, as fmi2GetDirectionalDerivative.
+     * 
+     * The default implementations of getDirectionalDerivative and getJacobian throw, slaves which do not override them do not provide derivatives.
+     * 
+     * @param seed nKnowns values
+     * @param sensitivity nUnknowns values
+     */
+    virtual void getDirectionalDerivative(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                                          const fmi2ValueReference *knowns, std::size_t nKnowns,
+                                          const fmi2Real *seed, fmi2Real *sensitivity);
+
+    /**
+     * @brief Write the partial derivatives of the Real unknowns with respect to the Real knowns, as pyfmuGetJacobian.
+     * 
+     * @param jacobian nUnknowns by nKnowns values in row-major order
+     */
+    virtual void getJacobian(const fmi2ValueReference *unknowns, std::size_t nUnknowns,
+                             const fmi2ValueReference *knowns, std::size_t nKnowns, fmi2Real *jacobian);
+
+    /**
+     * @brief Set the order[i]-th derivative of the Real input vr[i] for the next step, as fmi2SetRealInputDerivatives.
+     * 
+     * The default implementations of setRealInputDerivatives and getRealOutputDerivatives throw, slaves which do not override them do not interpolate.
+     */
+    virtual void setRealInputDerivatives(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *order, const fmi2Real *value);
+
+    /**
+     * @brief Write the order[i]-th derivative of the Real output vr[i] at the end of the last step, as fmi2GetRealOutputDerivatives.
+     */
+    virtual void getRealOutputDerivatives(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *order, fmi2Real *value);
+
+    /**
+     * @brief Returns the number of members of the ensemble simulated by the slave, 1 unless it was instantiated by pyfmuInstantiateEnsemble.
+     */
+    virtual std::size_t ensembleSize() const { return 1; }
+
+    /**
+     * @brief Write the values of the variables of every member, as ensembleSize() rows of nvr values, as pyfmuGetRealEnsemble.
+     */
+    virtual void getRealEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Real *value) const;
+    virtual void getIntegerEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Integer *value) const;
+    virtual void getBooleanEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Boolean *value) const;
+
+    /**
+     * @brief Set the values of the variables of every member from ensembleSize() rows of nvr values, as pyfmuSetRealEnsemble.
+     */
+    virtual void setRealEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Real *value);
+    virtual void setIntegerEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *value);
+    virtual void setBooleanEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Boolean *value);
+
+    /**
+     * @brief Returns the profile into which the calls of the instance are recorded, nullptr unless profiling is enabled.
+     */
+    Profile *profile() const { return profile_; }
+
+    /**
+     * @brief Record the calls into the profile, which must outlive the slave, or stop recording them if it is nullptr.
+     */
+    virtual void setProfile(Profile *profile) { profile_ = profile; }
+
+protected:
+    Profile *profile_ = nullptr;
+
+    /**
+     * @brief Updated by implementations in setupExperiment and after each completed step.
+     */
+    double lastSuccessfulTime_ = 0;
+};
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_SLAVE_HPP
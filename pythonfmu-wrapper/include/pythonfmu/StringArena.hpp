@@ -0,0 +1,63 @@
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+
+#include <Python.h>
+
+#ifndef PYTHONFMU_STRINGARENA_HPP
+#define PYTHONFMU_STRINGARENA_HPP
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Owns the strings returned by fmi2GetString of a single component.
+ *
+ * The FMI standard only requires returned strings to remain valid until the next call to the component,
+ * as such the buffers of the previous call are overwritten rather than freed, and a component which
+ * repeatedly gets strings of similar lengths stops allocating once the buffers have grown to fit them.
+ */
+class StringArena
+{
+public:
+    StringArena() = default;
+
+    StringArena(const StringArena &) = delete;
+    StringArena &operator=(const StringArena &) = delete;
+
+    /**
+     * @brief Invalidate the strings stored since the last reset, their buffers are reused by the following stores.
+     */
+    void reset() { used_ = 0; }
+
+    /**
+     * @brief Copy a string into the arena.
+     *
+     * @return NUL-terminated copy, valid until the next reset
+     */
+    const char *store(std::string_view str);
+
+    /**
+     * @brief Encode a str object as UTF-8 into the arena.
+     *
+     * @return NUL-terminated UTF-8, valid until the next reset, or nullptr if the object could not be encoded, in which case a Python exception is set
+     */
+    const char *store(PyObject *unicode);
+
+    /**
+     * @brief Number of strings stored since the last reset.
+     */
+    std::size_t size() const { return used_; }
+
+private:
+    std::string &next();
+
+    // a deque never relocates its elements, which would move short strings stored inline
+    std::deque<std::string> buffers_;
+    std::size_t used_ = 0;
+};
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_STRINGARENA_HPP
@@ -0,0 +1,61 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fmi/fmi2TypesPlatform.h"
+
+#ifndef PYTHONFMU_VALUEREFERENCETABLE_HPP
+#define PYTHONFMU_VALUEREFERENCETABLE_HPP
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Data type of the variable referred to by each value reference registered by the slave.
+ *
+ * The table is indexed directly by value reference, such that the references passed to a getter or setter are validated
+ * by a single lookup each, without acquiring the GIL or calling into the slave.
+ */
+class ValueReferenceTable
+{
+public:
+    enum class Type : std::uint8_t
+    {
+        none,
+        real,
+        integer,
+        boolean,
+        string
+    };
+
+    /**
+     * @param vrs value references of the Real, Integer, Boolean and String variables
+     */
+    explicit ValueReferenceTable(const std::array<std::vector<fmi2ValueReference>, 4> &vrs);
+
+    /**
+     * @brief Returns the index of the first value reference which does not refer to a variable of the type, or nvr if all do.
+     */
+    std::size_t find_mismatch(Type type, const fmi2ValueReference *vr, std::size_t nvr) const
+    {
+        for (std::size_t i = 0; i < nvr; ++i)
+        {
+            if (vr[i] >= types_.size() || types_[vr[i]] != type)
+                return i;
+        }
+        return nvr;
+    }
+
+private:
+    std::vector<Type> types_;
+};
+
+/**
+ * @brief Name of the data type as used by the FMI standard, for messages.
+ */
+const char *type_name(ValueReferenceTable::Type type);
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_VALUEREFERENCETABLE_HPP
@@ -0,0 +1,125 @@
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "fmi/fmi2TypesPlatform.h"
+
+#ifndef PYTHONFMU_VARIABLESTORE_HPP
+#define PYTHONFMU_VARIABLESTORE_HPP
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Values of the variables registered as native by the slave, stored in one contiguous array per data type.
+ *
+ * The arrays are owned by the wrapper and exposed to the slave as memoryviews, which allows the values
+ * to be read and written without acquiring the GIL or calling into Python.
+ * The arrays are allocated once and never resized, such that the views remain valid for the lifetime of the store.
+ * Calls whose value references are consecutive and stored in consecutive positions, such as the elements of an array variable, are copied as a block.
+ *
+ * The store of an ensemble holds the values of every member, one row after another, the first of which is that of member 0.
+ * The functions without Ensemble in their name access member 0 only.
+ */
+class VariableStore
+{
+public:
+    /**
+     * @brief Allocates the arrays of the store.
+     *
+     * @param realVrs value references of the Real variables, ordered by their position in the store
+     * @param integerVrs value references of the Integer variables, ordered by their position in the store
+     * @param booleanVrs value references of the Boolean variables, ordered by their position in the store
+     * @param members number of members of the ensemble, each of which has its own copy of the variables
+     */
+    VariableStore(const std::vector<fmi2ValueReference> &realVrs,
+                  const std::vector<fmi2ValueReference> &integerVrs,
+                  const std::vector<fmi2ValueReference> &booleanVrs,
+                  std::size_t members = 1);
+
+    std::size_t members() const { return members_; }
+
+    /**
+     * @brief Copy the values of the variables into the values array.
+     *
+     * @return false if not all value references refer to variables in the store, in which case the call must be forwarded to the slave.
+     */
+    bool getReal(const fmi2ValueReference *vr, std::size_t nvr, fmi2Real *values) const;
+    bool getInteger(const fmi2ValueReference *vr, std::size_t nvr, fmi2Integer *values) const;
+    bool getBoolean(const fmi2ValueReference *vr, std::size_t nvr, fmi2Boolean *values) const;
+
+    /**
+     * @brief Copy the values into the store.
+     *
+     * @return false if not all value references refer to variables in the store, in which case the call must be forwarded to the slave.
+     */
+    bool setReal(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Real *values);
+    bool setInteger(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *values);
+    bool setBoolean(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Boolean *values);
+
+    /**
+     * @brief Copy the values of the variables of every member into the values array, as members() rows of nvr values.
+     *
+     * @return false if not all value references refer to variables in the store.
+     */
+    bool getRealEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Real *values) const;
+    bool getIntegerEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Integer *values) const;
+    bool getBooleanEnsemble(const fmi2ValueReference *vr, std::size_t nvr, fmi2Boolean *values) const;
+
+    /**
+     * @brief Copy members() rows of nvr values into the variables of every member.
+     *
+     * @return false if not all value references refer to variables in the store, in which case the store is unchanged.
+     */
+    bool setRealEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Real *values);
+    bool setIntegerEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Integer *values);
+    bool setBooleanEnsemble(const fmi2ValueReference *vr, std::size_t nvr, const fmi2Boolean *values);
+
+    std::vector<fmi2Real> &reals() { return reals_.values; }
+    std::vector<fmi2Integer> &integers() { return integers_.values; }
+    std::vector<fmi2Boolean> &booleans() { return booleans_.values; }
+
+private:
+    static constexpr std::size_t noSlot = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * @brief Values of a single data type along with a lookup table from value reference to position in the values array.
+     */
+    template <typename T>
+    struct Table
+    {
+        // the values of the members one after another, each being stride values
+        std::vector<T> values;
+        std::size_t stride;
+
+        // indexed directly by value reference, which register_variable keeps below a bound
+        std::vector<std::size_t> slots;
+
+        // number of consecutive value references stored in consecutive slots, starting from each value reference
+        std::vector<std::size_t> runs;
+
+        Table(const std::vector<fmi2ValueReference> &vrs, std::size_t members);
+
+        /**
+         * @brief Returns true if the value references are consecutive and stored in consecutive slots, such as the elements of an array variable,
+         * in which case they are copied at once rather than looked up one at a time.
+         */
+        bool is_block(const fmi2ValueReference *vr, std::size_t nvr) const;
+
+        bool gather(const fmi2ValueReference *vr, std::size_t nvr, T *out, std::size_t member = 0) const;
+        bool scatter(const fmi2ValueReference *vr, std::size_t nvr, const T *in, std::size_t member = 0);
+
+        bool gather_members(const fmi2ValueReference *vr, std::size_t nvr, T *out, std::size_t members) const;
+        bool scatter_members(const fmi2ValueReference *vr, std::size_t nvr, const T *in, std::size_t members);
+    };
+
+    Table<fmi2Real> reals_;
+    Table<fmi2Integer> integers_;
+    Table<fmi2Boolean> booleans_;
+
+    std::size_t members_;
+};
+
+} // namespace pythonfmu
+
+#endif // PYTHONFMU_VARIABLESTORE_HPP
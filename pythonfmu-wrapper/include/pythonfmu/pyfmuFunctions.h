@@ -0,0 +1,131 @@
+#ifndef pyfmuFunctions_h
+#define pyfmuFunctions_h
+
+/* Extensions of the FMI 2.0 API exported by the pyfmu wrapper.
+
+   The functions are not part of the standard, as such tools must look them up by name
+   in the binary of the FMU, for instance using dlsym or GetProcAddress, and fall back on
+   the standard functions if they are missing. They are never prefixed by FMI2_FUNCTION_PREFIX.
+*/
+
+#include <stddef.h>
+
+#include "fmi/fmi2Functions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Advance nSteps contiguous communication steps of a co-simulation slave in a single call,
+   which is equivalent to the following sequence of calls for every step k:
+
+     fmi2SetReal(c, inputs, nInputs, &inputValues[k * nInputs])
+     fmi2DoStep(c, t_k, communicationStepSizes[k], fmi2True)
+     fmi2GetReal(c, outputs, nOutputs, &outputValues[k * nOutputs])
+
+   where t_0 is currentCommunicationPoint and t_k+1 = t_k + communicationStepSizes[k].
+   inputValues and outputValues hold nSteps rows of nInputs and nOutputs values respectively,
+   either may be NULL if the number of inputs or outputs is 0.
+
+   Returns fmi2OK if all steps were completed and fmi2Discard if a step was discarded, in which case
+   the outputs of the steps completed before it are written. The number of completed steps is stored
+   in nCompletedSteps, unless it is NULL. Returns fmi2Error if a step failed, in which case the outputs
+   are undefined and nCompletedSteps is set to 0.
+*/
+typedef fmi2Status pyfmuDoStepsTYPE(fmi2Component c,
+                                    fmi2Real currentCommunicationPoint,
+                                    const fmi2Real communicationStepSizes[], size_t nSteps,
+                                    const fmi2ValueReference inputs[], size_t nInputs, const fmi2Real inputValues[],
+                                    const fmi2ValueReference outputs[], size_t nOutputs, fmi2Real outputValues[],
+                                    size_t *nCompletedSteps);
+
+FMI2_Export pyfmuDoStepsTYPE pyfmuDoSteps;
+
+/* Write the Jacobian of the real unknowns with respect to the real knowns, as nUnknowns rows of nKnowns values,
+   which is equivalent to the following calls for every column j, where e_j is the j-th unit vector:
+
+     fmi2GetDirectionalDerivative(c, unknowns, nUnknowns, knowns, nKnowns, e_j, column j of jacobian)
+
+   Columns which share no dependency, as declared by the dependencies of the ModelStructure, are evaluated
+   by a single directional derivative, such that a banded Jacobian costs as many evaluations as its bandwidth.
+   Entries outside of the declared dependencies are 0.
+
+   Returns fmi2Error if the derivatives could not be evaluated, in which case the contents of jacobian are undefined.
+*/
+typedef fmi2Status pyfmuGetJacobianTYPE(fmi2Component c,
+                                        const fmi2ValueReference unknowns[], size_t nUnknowns,
+                                        const fmi2ValueReference knowns[], size_t nKnowns,
+                                        fmi2Real jacobian[]);
+
+FMI2_Export pyfmuGetJacobianTYPE pyfmuGetJacobian;
+
+/* Instantiate a co-simulation slave simulating an ensemble of nMembers copies of the model in lockstep, such as the
+   samples of a Monte-Carlo or sensitivity study, in place of nMembers instances which are stepped one after another.
+
+   Every member has its own copy of the variables stored natively by the slave, and fmi2DoStep advances all members
+   in a single call of the do_step method of the slave, which sees each of them as an array with one element per member.
+   The slave must declare that its do_step does so by setting __ensemble__ = True. The other functions of the instance,
+   such as fmi2SetReal and fmi2GetReal, access member 0 and the variables which are not stored natively, which are
+   shared by all members. The variables of all members are accessed by the functions below.
+
+   The arguments are those of fmi2Instantiate, which is equivalent to pyfmuInstantiateEnsemble with nMembers = 1.
+   Returns NULL if the slave does not support ensembles, or if it is configured to execute in a worker process.
+*/
+typedef fmi2Component pyfmuInstantiateEnsembleTYPE(fmi2String instanceName, fmi2Type fmuType,
+                                                   fmi2String fmuGUID, fmi2String fmuResourceLocation,
+                                                   const fmi2CallbackFunctions *functions,
+                                                   fmi2Boolean visible, fmi2Boolean loggingOn,
+                                                   size_t nMembers);
+
+FMI2_Export pyfmuInstantiateEnsembleTYPE pyfmuInstantiateEnsemble;
+
+/* Get or set the natively stored variables of every member of an ensemble, as nMembers rows of nvr values,
+   such that value[m * nvr + i] is the value of the variable vr[i] of member m.
+
+   Returns fmi2Error if a variable is not stored natively, in which case nothing is set.
+*/
+typedef fmi2Status pyfmuGetRealEnsembleTYPE(fmi2Component c, const fmi2ValueReference vr[], size_t nvr, fmi2Real value[]);
+typedef fmi2Status pyfmuGetIntegerEnsembleTYPE(fmi2Component c, const fmi2ValueReference vr[], size_t nvr, fmi2Integer value[]);
+typedef fmi2Status pyfmuGetBooleanEnsembleTYPE(fmi2Component c, const fmi2ValueReference vr[], size_t nvr, fmi2Boolean value[]);
+typedef fmi2Status pyfmuSetRealEnsembleTYPE(fmi2Component c, const fmi2ValueReference vr[], size_t nvr, const fmi2Real value[]);
+typedef fmi2Status pyfmuSetIntegerEnsembleTYPE(fmi2Component c, const fmi2ValueReference vr[], size_t nvr, const fmi2Integer value[]);
+typedef fmi2Status pyfmuSetBooleanEnsembleTYPE(fmi2Component c, const fmi2ValueReference vr[], size_t nvr, const fmi2Boolean value[]);
+
+FMI2_Export pyfmuGetRealEnsembleTYPE pyfmuGetRealEnsemble;
+FMI2_Export pyfmuGetIntegerEnsembleTYPE pyfmuGetIntegerEnsemble;
+FMI2_Export pyfmuGetBooleanEnsembleTYPE pyfmuGetBooleanEnsemble;
+FMI2_Export pyfmuSetRealEnsembleTYPE pyfmuSetRealEnsemble;
+FMI2_Export pyfmuSetIntegerEnsembleTYPE pyfmuSetIntegerEnsemble;
+FMI2_Export pyfmuSetBooleanEnsembleTYPE pyfmuSetBooleanEnsemble;
+
+/* Return the counters and latency histograms of the FMI functions called on the instance, and of the phases
+   of its calls into Python, as a JSON document of the form:
+
+     {"functions": {"fmi2DoStep": {"count": 1000, "total_ns": ..., "mean_ns": ..., "min_ns": ..., "p50_ns": ...,
+                                   "p90_ns": ..., "p99_ns": ..., "p999_ns": ..., "max_ns": ...,
+                                   "buckets": [[lower bound in ns, count], ...]}, ...},
+      "phases": {"gil_wait": {...}, "marshal": {...}, "python_call": {...}, "unmarshal": {...}, "log_drain": {...}}}
+
+   Functions and phases which have not been called are omitted. The string remains valid until the next call
+   of pyfmuGetProfile or until the instance is freed.
+
+   Returns fmi2Error if profiling is not enabled by the "profiling" object of the slave configuration.
+*/
+typedef fmi2Status pyfmuGetProfileTYPE(fmi2Component c, fmi2String *profile);
+
+FMI2_Export pyfmuGetProfileTYPE pyfmuGetProfile;
+
+/* Clear the histograms of the instance, such that a following pyfmuGetProfile only describes the calls made since.
+   Like the FMI functions, it must not be called while another function of the instance is executing.
+
+   Returns fmi2Error if profiling is not enabled by the "profiling" object of the slave configuration.
+*/
+typedef fmi2Status pyfmuResetProfileTYPE(fmi2Component c);
+
+FMI2_Export pyfmuResetProfileTYPE pyfmuResetProfile;
+
+#ifdef __cplusplus
+} /* end of extern "C" { */
+#endif
+
+#endif /* pyfmuFunctions_h */
@@ -12,11 +12,61 @@
 
 #include <Python.h>
 
+#include <string>
+
 #include "utility/utils.hpp"
 
+/**
+ * @brief Defined if PyObject_Vectorcall is part of the API being compiled against.
+ * 
+ * Vectorcall is public since Python 3.9, but only part of the stable API from 3.12.
+ */
+#if (!defined(Py_LIMITED_API) && PY_VERSION_HEX >= 0x03090000) || (defined(Py_LIMITED_API) && Py_LIMITED_API + 0 >= 0x030C0000)
+#define PYCOMPAT_HAS_VECTORCALL
+#endif
+
+/**
+ * @brief Flags accepted by PyMemoryView_FromMemory, these are part of the stable ABI but only defined by the limited API headers from 3.11.
+ */
+#ifndef PyBUF_READ
+#define PyBUF_READ 0x100
+#define PyBUF_WRITE 0x200
+#endif
+
+// the full API defines PyRun_SimpleString as a macro, which would rename the function declared below
+#ifdef PyRun_SimpleString
+#undef PyRun_SimpleString
+#endif
+
 namespace PyCompat
 {
     int PyRun_SimpleString(const char* command);
 
-    const char* PyUnicode_AsUTF8(PyObject* object);
-}
\ No newline at end of file
+    /**
+     * @brief Encode a str object as UTF-8 into an existing string, reusing its storage.
+     * 
+     * Reads the UTF-8 representation cached by the object where the API permits, otherwise encodes into a temporary bytes object.
+     * 
+     * @param object the str being encoded
+     * @param utf8 replaced by the encoded string
+     * @return false if the object could not be encoded, in which case a Python exception is set
+     */
+    bool PyUnicode_AsUTF8(PyObject* object, std::string& utf8);
+
+    /**
+     * @brief Encode a str object as UTF-8, returning an empty string and setting a Python exception on failure.
+     */
+    std::string PyUnicode_AsUTF8(PyObject* object);
+
+    /**
+     * @brief Call a callable object with positional arguments, without building an argument tuple from a format string.
+     * 
+     * Uses vectorcall if available, otherwise falls back on PyObject_CallFunctionObjArgs.
+     * 
+     * @param callable the object being called, typically a bound method
+     * @param args borrowed references to the positional arguments
+     * @param nargs number of positional arguments
+     * @return new reference to the result or nullptr if an exception was raised
+     */
+    PyObject* PyObject_Vectorcall(PyObject* callable, PyObject* const* args, size_t nargs);
+}
@@ -0,0 +1,418 @@
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include "fmt/format.h"
+
+#include "pythonfmu/AsyncSlave.hpp"
+
+using namespace fmt;
+using namespace std;
+
+namespace pythonfmu
+{
+
+AsyncSlave::AsyncSlave(unique_ptr<Slave> slave, fmi2StepFinished stepFinished, fmi2ComponentEnvironment componentEnvironment, Logger *logger)
+    : slave_(move(slave)), stepFinished_(stepFinished), componentEnvironment_(componentEnvironment), logger_(logger)
+{
+  lastSuccessfulTime_ = slave_->lastSuccessfulTime();
+  thread_ = thread(&AsyncSlave::run, this);
+}
+
+AsyncSlave::~AsyncSlave()
+{
+  stop();
+}
+
+unique_ptr<Slave> AsyncSlave::detach()
+{
+  stop();
+  return move(slave_);
+}
+
+void AsyncSlave::stop()
+{
+  if (!thread_.joinable())
+    return;
+
+  // the tool freed the instance from within stepFinished, the thread can not join itself, instead it exits once the callback returns
+  if (this_thread::get_id() == thread_.get_id())
+  {
+    *freed_ = true;
+    thread_.detach();
+    return;
+  }
+
+  {
+    unique_lock<mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return !pending_; });
+    stop_ = true;
+  }
+
+  wake_.notify_one();
+  thread_.join();
+}
+
+void AsyncSlave::run()
+{
+  // set by stop if the instance is freed by stepFinished, after which this must no longer be accessed
+  bool freed = false;
+  freed_ = &freed;
+
+  unique_lock<mutex> lock(mutex_);
+
+  while (true)
+  {
+    wake_.wait(lock, [this]() { return pending_ || stop_; });
+
+    if (stop_)
+      return;
+
+    double currentTime = currentTime_;
+    double stepSize = stepSize_;
+
+    // the slave is owned by this thread while the step is pending, the tool may meanwhile query the status
+    lock.unlock();
+
+    fmi2Status status;
+    try
+    {
+      status = slave_->doStep(currentTime, stepSize) ? fmi2OK : fmi2Discard;
+    }
+    catch (const exception &)
+    {
+      status = fmi2Error;
+    }
+
+    lock.lock();
+
+    status_ = status;
+    lastSuccessfulTime_ = slave_->lastSuccessfulTime();
+    pending_ = false;
+    bool notify = !canceled_;
+
+    idle_.notify_all();
+
+    // invoked without holding the lock, such that the callback may start the next step
+    if (notify)
+    {
+      lock.unlock();
+      stepFinished_(componentEnvironment_, status);
+
+      if (freed)
+        return;
+
+      lock.lock();
+    }
+  }
+}
+
+fmi2Status AsyncSlave::startStep(double currentTime, double stepSize)
+{
+  // messages are logged without holding the lock, the callback of the tool may call into the instance
+  {
+    unique_lock<mutex> lock(mutex_);
+
+    if (pending_)
+    {
+      lock.unlock();
+      logger_->error("A step can not be started while the previous step is pending\n");
+      return fmi2Error;
+    }
+
+    currentTime_ = currentTime;
+    stepSize_ = stepSize;
+    pending_ = true;
+    canceled_ = false;
+  }
+
+  wake_.notify_one();
+  return fmi2Pending;
+}
+
+fmi2Status AsyncSlave::stepStatus() const
+{
+  lock_guard<mutex> lock(mutex_);
+  return pending_ ? fmi2Pending : status_;
+}
+
+fmi2Status AsyncSlave::cancelStep()
+{
+  unique_lock<mutex> lock(mutex_);
+
+  if (!pending_)
+  {
+    lock.unlock();
+    logger_->error("No step is pending, which could be canceled\n");
+    return fmi2Error;
+  }
+
+  canceled_ = true;
+  return fmi2OK;
+}
+
+const char *AsyncSlave::pendingStatus() const
+{
+  lock_guard<mutex> lock(mutex_);
+
+  if (!pending_)
+    pendingStatus_ = "No step is pending";
+  else if (canceled_)
+    pendingStatus_ = format("Canceling the step from {} to {}, waiting for the slave to return", currentTime_, currentTime_ + stepSize_);
+  else
+    pendingStatus_ = format("Taking the step from {} to {}", currentTime_, currentTime_ + stepSize_);
+
+  return pendingStatus_.c_str();
+}
+
+void AsyncSlave::ensure_idle() const
+{
+  unique_lock<mutex> lock(mutex_);
+
+  if (pending_)
+  {
+    lock.unlock();
+    logger_->error("The slave can not be accessed while a step is pending\n");
+    throw runtime_error("A step is pending");
+  }
+}
+
+void AsyncSlave::wait_idle()
+{
+  unique_lock<mutex> lock(mutex_);
+  idle_.wait(lock, [this]() { return !pending_; });
+}
+
+void AsyncSlave::setupExperiment(double startTime)
+{
+  ensure_idle();
+  slave_->setupExperiment(startTime);
+
+  lock_guard<mutex> lock(mutex_);
+  lastSuccessfulTime_ = slave_->lastSuccessfulTime();
+}
+
+void AsyncSlave::enterInitializationMode()
+{
+  ensure_idle();
+  slave_->enterInitializationMode();
+}
+
+void AsyncSlave::exitInitializationMode()
+{
+  ensure_idle();
+  slave_->exitInitializationMode();
+}
+
+bool AsyncSlave::doStep(double currentTime, double stepSize)
+{
+  ensure_idle();
+  bool completed = slave_->doStep(currentTime, stepSize);
+
+  lock_guard<mutex> lock(mutex_);
+  lastSuccessfulTime_ = slave_->lastSuccessfulTime();
+  return completed;
+}
+
+size_t AsyncSlave::doSteps(double currentTime, const fmi2Real *stepSizes, size_t nSteps,
+                           const fmi2ValueReference *inputVrs, size_t nInputs, const fmi2Real *inputs,
+                           const fmi2ValueReference *outputVrs, size_t nOutputs, fmi2Real *outputs)
+{
+  ensure_idle();
+  size_t completed = slave_->doSteps(currentTime, stepSizes, nSteps, inputVrs, nInputs, inputs, outputVrs, nOutputs, outputs);
+
+  lock_guard<mutex> lock(mutex_);
+  lastSuccessfulTime_ = slave_->lastSuccessfulTime();
+  return completed;
+}
+
+double AsyncSlave::lastSuccessfulTime() const
+{
+  lock_guard<mutex> lock(mutex_);
+  return lastSuccessfulTime_;
+}
+
+void AsyncSlave::reset()
+{
+  wait_idle();
+  slave_->reset();
+
+  lock_guard<mutex> lock(mutex_);
+  lastSuccessfulTime_ = slave_->lastSuccessfulTime();
+}
+
+void AsyncSlave::terminate()
+{
+  wait_idle();
+  slave_->terminate();
+}
+
+void AsyncSlave::getInteger(const fmi2ValueReference *vr, size_t nvr, fmi2Integer *value) const
+{
+  ensure_idle();
+  slave_->getInteger(vr, nvr, value);
+}
+
+void AsyncSlave::getReal(const fmi2ValueReference *vr, size_t nvr, fmi2Real *value) const
+{
+  ensure_idle();
+  slave_->getReal(vr, nvr, value);
+}
+
+void AsyncSlave::getString(const fmi2ValueReference *vr, size_t nvr, fmi2String *value) const
+{
+  ensure_idle();
+  slave_->getString(vr, nvr, value);
+}
+
+void AsyncSlave::getBoolean(const fmi2ValueReference *vr, size_t nvr, fmi2Boolean *value) const
+{
+  ensure_idle();
+  slave_->getBoolean(vr, nvr, value);
+}
+
+fmi2Status AsyncSlave::setDebugLogging(bool loggingOn, size_t nCategories, const char *const categories[]) const
+{
+  ensure_idle();
+  return slave_->setDebugLogging(loggingOn, nCategories, categories);
+}
+
+void AsyncSlave::setReal(const fmi2ValueReference *vr, size_t nvr, const fmi2Real *value)
+{
+  ensure_idle();
+  slave_->setReal(vr, nvr, value);
+}
+
+void AsyncSlave::setInteger(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *value)
+{
+  ensure_idle();
+  slave_->setInteger(vr, nvr, value);
+}
+
+void AsyncSlave::setBoolean(const fmi2ValueReference *vr, size_t nvr, const fmi2Boolean *value)
+{
+  ensure_idle();
+  slave_->setBoolean(vr, nvr, value);
+}
+
+void AsyncSlave::setString(const fmi2ValueReference *vr, size_t nvr, const fmi2String *value)
+{
+  ensure_idle();
+  slave_->setString(vr, nvr, value);
+}
+
+fmi2FMUstate AsyncSlave::getFMUstate(fmi2FMUstate state)
+{
+  ensure_idle();
+  return slave_->getFMUstate(state);
+}
+
+void AsyncSlave::setFMUstate(fmi2FMUstate state)
+{
+  ensure_idle();
+  slave_->setFMUstate(state);
+
+  lock_guard<mutex> lock(mutex_);
+  lastSuccessfulTime_ = slave_->lastSuccessfulTime();
+}
+
+void AsyncSlave::freeFMUstate(fmi2FMUstate state)
+{
+  ensure_idle();
+  slave_->freeFMUstate(state);
+}
+
+size_t AsyncSlave::serializedFMUstateSize(fmi2FMUstate state)
+{
+  ensure_idle();
+  return slave_->serializedFMUstateSize(state);
+}
+
+void AsyncSlave::serializeFMUstate(fmi2FMUstate state, fmi2Byte *data, size_t size)
+{
+  ensure_idle();
+  slave_->serializeFMUstate(state, data, size);
+}
+
+fmi2FMUstate AsyncSlave::deSerializeFMUstate(const fmi2Byte *data, size_t size, fmi2FMUstate state)
+{
+  ensure_idle();
+  return slave_->deSerializeFMUstate(data, size, state);
+}
+
+void AsyncSlave::freeAllFMUstates()
+{
+  ensure_idle();
+  slave_->freeAllFMUstates();
+}
+
+void AsyncSlave::getDirectionalDerivative(const fmi2ValueReference *unknowns, size_t nUnknowns,
+                                          const fmi2ValueReference *knowns, size_t nKnowns,
+                                          const fmi2Real *seed, fmi2Real *sensitivity)
+{
+  ensure_idle();
+  slave_->getDirectionalDerivative(unknowns, nUnknowns, knowns, nKnowns, seed, sensitivity);
+}
+
+void AsyncSlave::getJacobian(const fmi2ValueReference *unknowns, size_t nUnknowns,
+                             const fmi2ValueReference *knowns, size_t nKnowns, fmi2Real *jacobian)
+{
+  ensure_idle();
+  slave_->getJacobian(unknowns, nUnknowns, knowns, nKnowns, jacobian);
+}
+
+void AsyncSlave::setRealInputDerivatives(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *order, const fmi2Real *value)
+{
+  ensure_idle();
+  slave_->setRealInputDerivatives(vr, nvr, order, value);
+}
+
+void AsyncSlave::getRealOutputDerivatives(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *order, fmi2Real *value)
+{
+  ensure_idle();
+  slave_->getRealOutputDerivatives(vr, nvr, order, value);
+}
+
+void AsyncSlave::getRealEnsemble(const fmi2ValueReference *vr, size_t nvr, fmi2Real *value) const
+{
+  ensure_idle();
+  slave_->getRealEnsemble(vr, nvr, value);
+}
+
+void AsyncSlave::getIntegerEnsemble(const fmi2ValueReference *vr, size_t nvr, fmi2Integer *value) const
+{
+  ensure_idle();
+  slave_->getIntegerEnsemble(vr, nvr, value);
+}
+
+void AsyncSlave::getBooleanEnsemble(const fmi2ValueReference *vr, size_t nvr, fmi2Boolean *value) const
+{
+  ensure_idle();
+  slave_->getBooleanEnsemble(vr, nvr, value);
+}
+
+void AsyncSlave::setRealEnsemble(const fmi2ValueReference *vr, size_t nvr, const fmi2Real *value)
+{
+  ensure_idle();
+  slave_->setRealEnsemble(vr, nvr, value);
+}
+
+void AsyncSlave::setIntegerEnsemble(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *value)
+{
+  ensure_idle();
+  slave_->setIntegerEnsemble(vr, nvr, value);
+}
+
+void AsyncSlave::setBooleanEnsemble(const fmi2ValueReference *vr, size_t nvr, const fmi2Boolean *value)
+{
+  ensure_idle();
+  slave_->setBooleanEnsemble(vr, nvr, value);
+}
+
+void AsyncSlave::setProfile(Profile *profile)
+{
+  profile_ = profile;
+  slave_->setProfile(profile);
+}
+
+} // namespace pythonfmu
@@ -0,0 +1,143 @@
+#include "pythonfmu/ForkServer.hpp"
+
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fmt/format.h"
+
+#include "pythonfmu/ProcessSlave.hpp"
+
+extern char **environ;
+
+using namespace std;
+using namespace fmt;
+using namespace filesystem;
+
+namespace pythonfmu
+{
+
+ForkServer &ForkServer::acquire(const path &resources, Logger *logger)
+{
+  // destroyed when the library is unloaded, which stops the fork servers
+  static mutex serversMutex;
+  static map<string, unique_ptr<ForkServer>> servers;
+
+  lock_guard<mutex> lock(serversMutex);
+
+  auto &server = servers[resources.string()];
+
+  if (server != nullptr && !server->alive())
+  {
+    logger->warning("The fork server has terminated, starting a new one\n");
+    server.reset();
+  }
+
+  if (server == nullptr)
+    server.reset(new ForkServer(resources, logger));
+
+  return *server;
+}
+
+ForkServer::ForkServer(const path &resources, Logger *logger)
+{
+  int sockets[2];
+
+  // messages are delivered as a whole, the socket of the host is not inherited by the workers it spawns
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) != 0)
+  {
+    auto msg = format("Failed to create the socket of the fork server: {}\n", strerror(errno));
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  socket_ = sockets[0];
+
+  string worker_str = worker_path().string();
+  string resources_str = resources.string();
+  char flag[] = "--fork-server";
+  char *argv[] = {worker_str.data(), flag, resources_str.data(), nullptr};
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, sockets[1], forkServerSocket);
+
+  logger->ok(format("Starting fork server {}\n", worker_str));
+
+  int err = posix_spawn(&pid_, worker_str.c_str(), &actions, nullptr, argv, environ);
+
+  posix_spawn_file_actions_destroy(&actions);
+  close(sockets[1]);
+
+  if (err != 0)
+  {
+    pid_ = -1;
+    close(socket_);
+    auto msg = format("Failed to start fork server {}: {}\n", worker_str, strerror(err));
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  // the fork server responds once it has initialized the interpreter and imported the slave
+  ForkResponse ready{};
+
+  if (recv(socket_, &ready, sizeof(ready), 0) != sizeof(ready) || ready.pid < 0)
+  {
+    close(socket_);
+    waitpid(pid_, nullptr, 0);
+    auto msg = string("The fork server failed to load the slave, its messages were written to the standard error stream\n");
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  logger->ok(format("Fork server {} loaded the slave\n", pid_));
+}
+
+ForkServer::~ForkServer()
+{
+  close(socket_);
+  waitpid(pid_, nullptr, 0);
+}
+
+bool ForkServer::alive()
+{
+  int status;
+  return waitpid(pid_, &status, WNOHANG) == 0;
+}
+
+pid_t ForkServer::fork_worker(const string &segment)
+{
+  ForkRequest request{};
+
+  if (segment.size() >= sizeof(request.segment))
+    throw runtime_error("The name of the segment is too long");
+
+  memcpy(request.segment, segment.c_str(), segment.size() + 1);
+  request.host = getpid();
+
+  ForkResponse response{};
+
+  lock_guard<mutex> lock(mutex_);
+
+  if (send(socket_, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request) ||
+      recv(socket_, &response, sizeof(response), 0) != sizeof(response))
+    throw runtime_error("The fork server terminated");
+
+  if (response.pid < 0)
+    throw runtime_error(format("The fork server failed to fork: {}", strerror(response.error)));
+
+  return response.pid;
+}
+
+} // namespace pythonfmu
+
+#endif // PYFMU_HAS_PROCESS_SLAVE
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+
+#include "pythonfmu/JacobianColoring.hpp"
+
+using namespace std;
+
+namespace pythonfmu
+{
+
+JacobianColoring::JacobianColoring(vector<vector<size_t>> rows, size_t nColumns)
+    : rows_(move(rows)), colors_(nColumns)
+{
+  vector<vector<size_t>> columns(nColumns);
+
+  for (size_t row = 0; row < rows_.size(); ++row)
+  {
+    for (size_t column : rows_[row])
+    {
+      if (column >= nColumns)
+        throw invalid_argument("The pattern of the Jacobian refers to a column beyond its last");
+
+      columns[column].push_back(row);
+    }
+  }
+
+  vector<size_t> order(nColumns);
+  iota(order.begin(), order.end(), 0);
+  stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return columns[a].size() > columns[b].size(); });
+
+  // colors of the columns sharing a row with the column being colored are marked by the column, such that the marks need no clearing
+  constexpr size_t uncolored = SIZE_MAX;
+  fill(colors_.begin(), colors_.end(), uncolored);
+  vector<size_t> forbidden;
+
+  for (size_t column : order)
+  {
+    for (size_t row : columns[column])
+    {
+      for (size_t neighbour : rows_[row])
+      {
+        if (colors_[neighbour] != uncolored)
+          forbidden[colors_[neighbour]] = column;
+      }
+    }
+
+    size_t color = 0;
+    while (color < nColors_ && forbidden[color] == column)
+      ++color;
+
+    if (color == nColors_)
+    {
+      ++nColors_;
+      forbidden.push_back(uncolored);
+    }
+
+    colors_[column] = color;
+  }
+}
+
+void JacobianColoring::direction(size_t color, const double *steps, double *direction) const
+{
+  for (size_t column = 0; column < colors_.size(); ++column)
+    direction[column] = (colors_[column] == color) ? steps[column] : 0.0;
+}
+
+void JacobianColoring::scatter(size_t color, const double *steps, const double *difference, double *jacobian) const
+{
+  size_t n = colors_.size();
+
+  for (size_t row = 0; row < rows_.size(); ++row)
+  {
+    for (size_t column : rows_[row])
+    {
+      if (colors_[column] == color)
+        jacobian[row * n + column] = difference[row] / steps[column];
+    }
+  }
+}
+
+} // namespace pythonfmu
@@ -0,0 +1,79 @@
+#include <atomic>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+#include "fmt/format.h"
+
+#include "pythonfmu/LogRing.hpp"
+
+using namespace fmt;
+using namespace std;
+
+namespace pythonfmu
+{
+
+static_assert((LogRing::capacity & (LogRing::capacity - 1)) == 0, "the capacity must be a power of two");
+
+static size_t record_size(size_t payload)
+{
+  return (sizeof(LogRing::RecordHeader) + payload + LogRing::recordAlignment - 1) & ~(LogRing::recordAlignment - 1);
+}
+
+LogRing::LogRing() : data_(capacity)
+{
+}
+
+void LogRing::drain(Logger &logger)
+{
+  // pairs with the store of the producer, such that the records preceding the index are visible
+  uint32_t write = atomic_ref(indices_[writeIndex]).load(memory_order_acquire);
+  uint32_t read = indices_[readIndex];
+  uint32_t dropped = atomic_ref(indices_[droppedCount]).load(memory_order_relaxed);
+
+  if (read == write && dropped == reportedDrops_)
+    return;
+
+  while (read != write)
+  {
+    size_t offset = read & (capacity - 1);
+    RecordHeader header;
+    memcpy(&header, data_.data() + offset, sizeof(header));
+
+    size_t size = record_size(header.size);
+
+    // a corrupted ring is discarded rather than read beyond the record area
+    if (offset + size > capacity || size > static_cast<uint32_t>(write - read))
+    {
+      logger.error("Discarded the log messages of the slave, the log ring is corrupted\n");
+      read = write;
+      break;
+    }
+
+    std::string_view payload(reinterpret_cast<const char *>(data_.data() + offset + sizeof(header)), header.size);
+
+    if (header.status == categoryDefinition)
+    {
+      if (header.category >= categories_.size())
+        categories_.resize(header.category + 1);
+      categories_[header.category] = payload;
+    }
+    else if (header.status != padding)
+    {
+      string category = (header.category < categories_.size()) ? categories_[header.category] : "";
+      logger.log(static_cast<fmi2Status>(header.status), move(category), string(payload));
+    }
+
+    read += size;
+  }
+
+  atomic_ref(indices_[readIndex]).store(read, memory_order_release);
+
+  if (dropped != reportedDrops_)
+  {
+    logger.warning(format("Dropped {} log messages of the slave, which did not fit in the log ring\n", dropped - reportedDrops_));
+    reportedDrops_ = dropped;
+  }
+}
+
+} // namespace pythonfmu
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
+#include <utility>
 
 #include <fmt/format.h>
 
@@ -8,15 +13,298 @@
 using namespace std;
 using namespace fmt;
 
-Logger::Logger(fmi2ComponentEnvironment componentEnvironment, fmi2CallbackLogger loggerCallback, std::string instanceName)
+/**
+ * @brief Bounded queue of messages with any number of producers, consumed by a background thread which delivers them.
+ *
+ * Enqueuing is lock-free, each slot carries a sequence number telling producers and the consumer whose turn it is to use it.
+ * The consumer sleeps on an atomic counter which producers bump after enqueuing, such that no mutex is needed to wake it.
+ */
+class Logger::AsyncSink
+{
+public:
+  AsyncSink(Logger &logger, size_t capacity, Overflow overflow)
+      : logger_(logger), slots_(bit_ceil(max<size_t>(capacity, 2))), mask_(slots_.size() - 1), overflow_(overflow)
+  {
+    for (size_t i = 0; i < slots_.size(); ++i)
+      slots_[i].sequence.store(i, memory_order_relaxed);
+
+    thread_ = thread([this]() { run(); });
+  }
+
+  ~AsyncSink()
+  {
+    stop_.store(true, memory_order_release);
+    signal();
+    thread_.join();
+  }
+
+  void push(fmi2Status status, string category, string message)
+  {
+    if (overflow_ == Overflow::sample && status < fmi2Error && tail_.load(memory_order_relaxed) - head_.load(memory_order_relaxed) > mask_ / 2)
+    {
+      if (sampled_.fetch_add(1, memory_order_relaxed) % sampleInterval != 0)
+      {
+        dropped_.fetch_add(1, memory_order_relaxed);
+        return;
+      }
+    }
+
+    Entry entry{status, move(category), move(message)};
+
+    while (!try_push(entry))
+    {
+      if (overflow_ != Overflow::block)
+      {
+        dropped_.fetch_add(1, memory_order_relaxed);
+        return;
+      }
+
+      // wait until the consumer delivers a message, unless it already did so since the attempt
+      auto delivered = delivered_.load(memory_order_acquire);
+      if (!try_push(entry))
+        delivered_.wait(delivered, memory_order_acquire);
+      else
+        break;
+    }
+
+    queued_.fetch_add(1, memory_order_release);
+    signal();
+  }
+
+  void flush()
+  {
+    auto queued = queued_.load(memory_order_acquire);
+
+    for (auto delivered = delivered_.load(memory_order_acquire); delivered < queued; delivered = delivered_.load(memory_order_acquire))
+      delivered_.wait(delivered, memory_order_acquire);
+  }
+
+  Counters counters() const
+  {
+    return {queued_.load(), delivered_.load(), dropped_.load()};
+  }
+
+private:
+  struct Entry
+  {
+    fmi2Status status;
+    string category;
+    string message;
+  };
+
+  struct Slot
+  {
+    atomic<uint64_t> sequence;
+    Entry entry;
+  };
+
+  Logger &logger_;
+  vector<Slot> slots_;
+  const size_t mask_;
+  const Overflow overflow_;
+
+  alignas(64) atomic<uint64_t> tail_{0}; // next slot claimed by a producer
+  alignas(64) atomic<uint64_t> head_{0}; // next slot read by the consumer
+
+  alignas(64) atomic<uint64_t> queued_{0};
+  atomic<uint64_t> delivered_{0};
+  atomic<uint64_t> dropped_{0};
+  atomic<uint64_t> sampled_{0};
+
+  // bumped whenever the consumer has work, it sleeps until the value changes
+  alignas(64) atomic<uint32_t> signal_{0};
+  atomic<bool> stop_{false};
+
+  thread thread_;
+
+  void signal()
+  {
+    signal_.fetch_add(1, memory_order_release);
+    signal_.notify_one();
+  }
+
+  bool try_push(Entry &entry)
+  {
+    auto pos = tail_.load(memory_order_relaxed);
+
+    while (true)
+    {
+      auto &slot = slots_[pos & mask_];
+      auto sequence = slot.sequence.load(memory_order_acquire);
+      auto diff = static_cast<int64_t>(sequence - pos);
+
+      if (diff == 0)
+      {
+        if (tail_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+        {
+          slot.entry = move(entry);
+          slot.sequence.store(pos + 1, memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0)
+        return false;
+      else
+        pos = tail_.load(memory_order_relaxed);
+    }
+  }
+
+  bool try_pop(Entry &entry)
+  {
+    auto pos = head_.load(memory_order_relaxed);
+    auto &slot = slots_[pos & mask_];
+
+    if (slot.sequence.load(memory_order_acquire) != pos + 1)
+      return false;
+
+    entry = move(slot.entry);
+    slot.sequence.store(pos + mask_ + 1, memory_order_release);
+    head_.store(pos + 1, memory_order_relaxed);
+    return true;
+  }
+
+  void run()
+  {
+    Entry entry;
+    uint64_t reportedDrops = 0;
+
+    while (true)
+    {
+      auto signal = signal_.load(memory_order_acquire);
+
+      while (try_pop(entry))
+      {
+        logger_.deliver(entry.status, entry.category, entry.message);
+
+        // report drops before the last message is marked as delivered, such that flush waits for the report
+        auto dropped = dropped_.load(memory_order_relaxed);
+        if (dropped != reportedDrops && head_.load(memory_order_relaxed) == tail_.load(memory_order_relaxed))
+        {
+          logger_.deliver(fmi2Warning, "wrapper", format("Dropped {} log messages which did not fit in the queue of the logger\n", dropped - reportedDrops));
+          reportedDrops = dropped;
+        }
+
+        delivered_.fetch_add(1, memory_order_release);
+        delivered_.notify_all();
+      }
+
+      if (stop_.load(memory_order_acquire) && head_.load(memory_order_relaxed) == tail_.load(memory_order_relaxed))
+        break;
+
+      signal_.wait(signal, memory_order_acquire);
+    }
+  }
+};
+
+Logger::Logger(fmi2ComponentEnvironment componentEnvironment, fmi2CallbackLogger loggerCallback, std::string instanceName, bool loggingOn)
     : instanceName(instanceName), loggerCallback(loggerCallback),
       componentEnvironment(componentEnvironment)
 {
   if (loggerCallback == NULL)
     throw invalid_argument("loggerCallback");
+
+  wrapperId_ = intern("wrapper");
+  logAllId_ = intern("logAll");
+  warningId_ = intern("logStatusWarning");
+  discardId_ = intern("logStatusDiscard");
+
+  setDebugLogging(loggingOn, 0, nullptr);
+}
+
+Logger::~Logger()
+{
+  // joins the background thread once the queue is empty
+  sink_.reset();
+}
+
+void Logger::startAsync(size_t capacity, Overflow overflow)
+{
+  if (sink_ == nullptr)
+    sink_ = make_unique<AsyncSink>(*this, capacity, overflow);
+}
+
+void Logger::flush()
+{
+  if (sink_ != nullptr)
+    sink_->flush();
+}
+
+void Logger::rebind(fmi2ComponentEnvironment componentEnvironment, fmi2CallbackLogger loggerCallback, std::string instanceName, bool loggingOn)
+{
+  if (loggerCallback == NULL)
+    throw invalid_argument("loggerCallback");
+
+  // the background thread only reads the callback while delivering, which it is done with once flushed
+  flush();
+
+  this->instanceName = move(instanceName);
+  this->loggerCallback = loggerCallback;
+  this->componentEnvironment = componentEnvironment;
+
+  setDebugLogging(loggingOn, 0, nullptr);
+}
+
+Logger::Counters Logger::counters() const
+{
+  return (sink_ != nullptr) ? sink_->counters() : Counters{0, 0, 0};
+}
+
+size_t Logger::intern(const std::string &category)
+{
+  auto it = find(categories_.begin(), categories_.end(), category);
+
+  if (it != categories_.end())
+    return it - categories_.begin();
+
+  if (categories_.size() == maxCategories)
+    return noCategory;
+
+  categories_.push_back(category);
+  return categories_.size() - 1;
+}
+
+void Logger::setDebugLogging(bool loggingOn, size_t nCategories, const char *const categories[])
+{
+  if (nCategories == 0)
+  {
+    active_->fill(loggingOn ? ~uint32_t(0) : 0);
+    return;
+  }
+
+  for (size_t i = 0; i < nCategories; ++i)
+  {
+    size_t id = intern(categories[i]);
+
+    if (id == noCategory)
+    {
+      warning(format("The category {} was ignored, no more than {} categories are supported\n", categories[i], maxCategories));
+      continue;
+    }
+
+    uint32_t bit = uint32_t(1) << (id % 32);
+    (*active_)[id / 32] = loggingOn ? ((*active_)[id / 32] | bit) : ((*active_)[id / 32] & ~bit);
+  }
+}
+
+bool Logger::passes(fmi2Status status) const
+{
+  if (status >= fmi2Error)
+    return true;
+
+  return active(wrapperId_) || active(logAllId_) ||
+         (status == fmi2Warning && active(warningId_)) ||
+         (status == fmi2Discard && active(discardId_));
 }
 
 void Logger::log(fmi2Status status, std::string category, std::string message)
+{
+  if (sink_ != nullptr)
+    sink_->push(status, move(category), move(message));
+  else
+    deliver(status, category, message);
+}
+
+void Logger::deliver(fmi2Status status, const std::string &category, const std::string &message) const
 {
   std::string msg = format("{}:{}:{}:{}\n",instanceName,status,category,message);
   cerr << msg;
@@ -27,15 +315,18 @@ void Logger::log(fmi2Status status, std::string category, std::string message)
 
 void Logger::ok(std::string message)
 {
-  log(fmi2Status::fmi2OK, "wrapper", message);
+  if (passes(fmi2Status::fmi2OK))
+    log(fmi2Status::fmi2OK, "wrapper", message);
 }
 void Logger::warning(std::string message)
 {
-  log(fmi2Status::fmi2Warning, "wrapper", message);
+  if (passes(fmi2Status::fmi2Warning))
+    log(fmi2Status::fmi2Warning, "wrapper", message);
 }
 void Logger::discard(std::string message)
 {
-  log(fmi2Status::fmi2Discard, "wrapper", message);
+  if (passes(fmi2Status::fmi2Discard))
+    log(fmi2Status::fmi2Discard, "wrapper", message);
 }
 void Logger::error(std::string message)
 {
@@ -0,0 +1,198 @@
+#include "pythonfmu/ProcessChannel.hpp"
+
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fmt/format.h"
+
+using namespace std;
+using namespace fmt;
+
+namespace pythonfmu
+{
+
+void Doorbell::ring()
+{
+  if (sleeping.exchange(0) == 1)
+    sem_post(&semaphore);
+}
+
+bool Doorbell::spinning()
+{
+  static const bool multicore = thread::hardware_concurrency() > 1;
+  return multicore;
+}
+
+bool Doorbell::timed_wait()
+{
+  // wake up periodically, allowing the caller to check if the other process is still alive
+  timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += 100 * 1000 * 1000;
+  if (deadline.tv_nsec >= 1000 * 1000 * 1000)
+  {
+    deadline.tv_sec += 1;
+    deadline.tv_nsec -= 1000 * 1000 * 1000;
+  }
+
+  while (sem_timedwait(&semaphore, &deadline) != 0)
+  {
+    if (errno != EINTR)
+      return false;
+  }
+  return true;
+}
+
+static size_t header_size()
+{
+  return (sizeof(SegmentHeader) + 63) & ~size_t(63);
+}
+
+SharedSegment SharedSegment::create(size_t dataCapacity)
+{
+  static atomic<unsigned> counter{0};
+  string name = format("/pyfmu-{}-{}", getpid(), counter++);
+
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd == -1)
+    throw runtime_error(format("Failed to create shared memory segment {}: {}", name, strerror(errno)));
+
+  size_t size = header_size() + dataCapacity;
+
+  if (ftruncate(fd, size) != 0)
+  {
+    auto err = errno;
+    close(fd);
+    shm_unlink(name.c_str());
+    throw runtime_error(format("Failed to resize shared memory segment {}: {}", name, strerror(err)));
+  }
+
+  void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (address == MAP_FAILED)
+  {
+    shm_unlink(name.c_str());
+    throw runtime_error(format("Failed to map shared memory segment {}: {}", name, strerror(errno)));
+  }
+
+  auto header = new (address) SegmentHeader();
+  header->version = SegmentHeader::currentVersion;
+  header->dataCapacity = dataCapacity;
+  sem_init(&header->toWorker.semaphore, 1, 0);
+  sem_init(&header->toHost.semaphore, 1, 0);
+
+  return SharedSegment(name, address, size, true);
+}
+
+SharedSegment SharedSegment::open(const string &name)
+{
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd == -1)
+    throw runtime_error(format("Failed to open shared memory segment {}: {}", name, strerror(errno)));
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < header_size())
+  {
+    close(fd);
+    throw runtime_error(format("Shared memory segment {} is too small", name));
+  }
+
+  void *address = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (address == MAP_FAILED)
+    throw runtime_error(format("Failed to map shared memory segment {}: {}", name, strerror(errno)));
+
+  SharedSegment segment(name, address, st.st_size, false);
+
+  if (segment.header()->version != SegmentHeader::currentVersion)
+    throw runtime_error(format("Shared memory segment has version {}, expected {}", segment.header()->version, SegmentHeader::currentVersion));
+
+  return segment;
+}
+
+SharedSegment::SharedSegment(string name, void *address, size_t size, bool owner)
+    : name_(move(name)), header_(static_cast<SegmentHeader *>(address)), size_(size), owner_(owner), linked_(owner)
+{
+}
+
+SharedSegment::SharedSegment(SharedSegment &&other)
+    : name_(move(other.name_)), header_(exchange(other.header_, nullptr)), size_(other.size_), owner_(other.owner_), linked_(exchange(other.linked_, false))
+{
+}
+
+SharedSegment::~SharedSegment()
+{
+  if (header_ == nullptr)
+    return;
+
+  if (owner_)
+  {
+    sem_destroy(&header_->toWorker.semaphore);
+    sem_destroy(&header_->toHost.semaphore);
+  }
+
+  unlink();
+  munmap(header_, size_);
+}
+
+void SharedSegment::unlink()
+{
+  if (linked_)
+    shm_unlink(name_.c_str());
+  linked_ = false;
+}
+
+size_t pack_strings(byte *dst, size_t capacity, const char *const *strings, size_t n)
+{
+  size_t offset = 0;
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    size_t size = strlen(strings[i]) + 1;
+
+    if (offset + size > capacity)
+      throw runtime_error(format("The strings exceed the capacity of the shared memory segment of {} bytes", capacity));
+
+    memcpy(dst + offset, strings[i], size);
+    offset += size;
+  }
+
+  return offset;
+}
+
+vector<string> unpack_strings(const byte *src, size_t n)
+{
+  vector<string> strings(n);
+  auto str = reinterpret_cast<const char *>(src);
+
+  for (auto &s : strings)
+  {
+    s = str;
+    str += s.size() + 1;
+  }
+
+  return strings;
+}
+
+byte *SharedSegment::data() const
+{
+  return reinterpret_cast<byte *>(header_) + header_size();
+}
+
+} // namespace pythonfmu
+
+#endif // PYFMU_HAS_PROCESS_SLAVE
@@ -0,0 +1,752 @@
+#include "pythonfmu/ProcessSlave.hpp"
+
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <dlfcn.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fmt/format.h"
+
+#include "pythonfmu/ForkServer.hpp"
+
+extern char **environ;
+
+using namespace std;
+using namespace fmt;
+using namespace filesystem;
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Bytes of the data area left for the log messages of the worker, when splitting calls into several requests.
+ */
+static constexpr size_t logCapacity = 64 * 1024;
+
+path worker_path()
+{
+  Dl_info info;
+
+  if (dladdr(reinterpret_cast<void *>(&worker_path), &info) == 0 || info.dli_fname == nullptr)
+    throw runtime_error("Failed to locate the wrapper library, which is needed to find the worker executable");
+
+  auto worker = path(info.dli_fname).parent_path() / "pyfmu_worker";
+
+  // the executable bit may be lost when the FMU is extracted
+  if (access(worker.c_str(), X_OK) != 0)
+    chmod(worker.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
+
+  return worker;
+}
+
+/**
+ * @brief Copy a string into a fixed size field of the segment header.
+ */
+template <size_t N>
+static void copy_to_field(char (&field)[N], const string &str, const char *description)
+{
+  if (str.size() >= N)
+    throw runtime_error(format("The {} is too long, at most {} characters are supported", description, N - 1));
+
+  memcpy(field, str.c_str(), str.size() + 1);
+}
+
+ProcessSlave::ProcessSlave(const path &resources, const string &instanceName, Logger *logger, ForkServer *forkServer)
+    : segment_(SharedSegment::create(dataCapacity)), logger_(logger), forked_(forkServer != nullptr)
+{
+  auto header = segment_.header();
+  copy_to_field(header->resources, resources.string(), "path of the resources directory");
+  copy_to_field(header->instanceName, instanceName, "instance name");
+
+  if (forked_)
+  {
+    try
+    {
+      pid_ = forkServer->fork_worker(segment_.name());
+    }
+    catch (const exception &e)
+    {
+      logger_->fatal(format("Failed to fork a worker process: {}\n", e.what()));
+      throw;
+    }
+
+    logger_->ok(format("Forked worker process {} from the fork server\n", pid_));
+  }
+  else
+  {
+    auto worker = worker_path();
+    string worker_str = worker.string();
+    string parent = to_string(getpid());
+    char *argv[] = {worker_str.data(), const_cast<char *>(segment_.name().c_str()), parent.data(), nullptr};
+
+    logger_->ok(format("Starting worker process {}\n", worker_str));
+
+    int err = posix_spawn(&pid_, worker_str.c_str(), nullptr, nullptr, argv, environ);
+    if (err != 0)
+    {
+      pid_ = -1;
+      auto msg = format("Failed to start worker process {}: {}\n", worker_str, strerror(err));
+      logger_->fatal(msg);
+      throw runtime_error(msg);
+    }
+  }
+
+  try
+  {
+    // the worker logs only if logging was enabled when instantiating, until the categories are set
+    modelExchange_ = invoke(Operation::instantiate, logger_->anyActive()).modelExchange != 0;
+  }
+  catch (const exception &e)
+  {
+    logger_->fatal(format("Failed to instantiate the slave in the worker process: {}\n", e.what()));
+    stop_worker();
+    throw;
+  }
+
+  // the worker has mapped the segment, no other process needs to open it
+  segment_.unlink();
+
+  logger_->ok(format("Instantiated slave in worker process {}\n", pid_));
+}
+
+ProcessSlave::~ProcessSlave()
+{
+  if (!dead_)
+  {
+    try
+    {
+      invoke(Operation::free_instance);
+      freed_ = true;
+    }
+    catch (const exception &)
+    {
+    }
+  }
+
+  stop_worker();
+}
+
+void ProcessSlave::stop_worker() const
+{
+  for (int i = 0; i < 500 && alive(); ++i)
+    this_thread::sleep_for(chrono::milliseconds(10));
+
+  if (pid_ != -1)
+  {
+    logger_->warning(format("Worker process {} did not exit, killing it\n", pid_));
+    kill(pid_, SIGKILL);
+
+    // forked workers are reaped by the fork server
+    if (!forked_)
+      waitpid(pid_, nullptr, 0);
+
+    pid_ = -1;
+  }
+}
+
+bool ProcessSlave::alive() const
+{
+  if (pid_ == -1)
+    return false;
+
+  if (forked_)
+  {
+    // the exit status of a forked worker is only available to the fork server
+    if (kill(pid_, 0) == 0 || errno == EPERM)
+      return true;
+
+    if (!freed_)
+      logger_->error(format("Worker process {} terminated\n", pid_));
+
+    pid_ = -1;
+    dead_ = true;
+    return false;
+  }
+
+  int status;
+  if (waitpid(pid_, &status, WNOHANG) != pid_)
+    return true;
+
+  if (WIFSIGNALED(status))
+    logger_->error(format("Worker process {} was terminated by signal {}\n", pid_, WTERMSIG(status)));
+  else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+    logger_->error(format("Worker process {} exited with code {}\n", pid_, WEXITSTATUS(status)));
+
+  pid_ = -1;
+  dead_ = true;
+  return false;
+}
+
+Message ProcessSlave::transact(Message request) const
+{
+  if (dead_)
+    throw runtime_error("The worker process has terminated");
+
+  auto header = segment_.header();
+
+  // calls are synchronous, as such the ring always has room for the request
+  header->requests.push(request);
+  header->toWorker.ring();
+
+  if (!header->toHost.wait(header->responses, [this]() { return alive(); }))
+  {
+    logger_->fatal("The worker process terminated before responding\n");
+    throw runtime_error("The worker process terminated before responding");
+  }
+
+  Message response;
+  header->responses.pop(response);
+
+  auto data = segment_.data();
+  size_t offset = response.logOffset;
+
+  for (size_t i = 0; i < response.nLogs; ++i)
+  {
+    LogRecord record;
+    memcpy(&record, data + offset, sizeof(record));
+    offset += sizeof(record);
+
+    string category(reinterpret_cast<const char *>(data + offset), record.categorySize);
+    offset += record.categorySize;
+    string message(reinterpret_cast<const char *>(data + offset), record.messageSize);
+    offset = align_offset(offset + record.messageSize);
+
+    logger_->log(static_cast<fmi2Status>(record.status), category, message);
+  }
+
+  return response;
+}
+
+Message ProcessSlave::invoke(Operation operation, double arg0, double arg1, fmi2FMUstate state) const
+{
+  Message request{};
+  request.operation = operation;
+  request.args[0] = arg0;
+  request.args[1] = arg1;
+  request.fmuState = reinterpret_cast<uint64_t>(state);
+
+  auto response = transact(request);
+
+  if (response.status >= fmi2Error)
+    throw runtime_error("The slave failed to execute the call");
+
+  return response;
+}
+
+void ProcessSlave::exchange(Operation operation, const fmi2Real *in, fmi2Real *out, size_t n) const
+{
+  auto data = segment_.data();
+
+  if (n * sizeof(fmi2Real) > dataCapacity - logCapacity)
+    throw runtime_error("The vector does not fit in the data area of the segment");
+
+  if (in != nullptr)
+    memcpy(data, in, n * sizeof(fmi2Real));
+
+  Message request{};
+  request.operation = operation;
+  request.nvr = n;
+  request.size = n * sizeof(fmi2Real);
+
+  if (transact(request).status >= fmi2Error)
+    throw runtime_error("The slave failed to execute the call");
+
+  if (out != nullptr)
+    memcpy(out, data, n * sizeof(fmi2Real));
+}
+
+template <typename T>
+void ProcessSlave::get(Operation operation, const fmi2ValueReference *vr, size_t nvr, T *values) const
+{
+  auto data = segment_.data();
+  size_t chunk = (dataCapacity - logCapacity) / (sizeof(fmi2ValueReference) + sizeof(T));
+
+  for (size_t offset = 0; offset < nvr; offset += chunk)
+  {
+    size_t n = min(chunk, nvr - offset);
+    memcpy(data, vr + offset, n * sizeof(fmi2ValueReference));
+
+    Message request{};
+    request.operation = operation;
+    request.nvr = n;
+    request.size = values_offset(n) + n * sizeof(T);
+
+    if (transact(request).status >= fmi2Error)
+      throw runtime_error("The slave failed to get the values");
+
+    memcpy(values + offset, data + values_offset(n), n * sizeof(T));
+  }
+}
+
+template <typename T>
+void ProcessSlave::set(Operation operation, const fmi2ValueReference *vr, size_t nvr, const T *values)
+{
+  auto data = segment_.data();
+  size_t chunk = (dataCapacity - logCapacity) / (sizeof(fmi2ValueReference) + sizeof(T));
+
+  for (size_t offset = 0; offset < nvr; offset += chunk)
+  {
+    size_t n = min(chunk, nvr - offset);
+    memcpy(data, vr + offset, n * sizeof(fmi2ValueReference));
+    memcpy(data + values_offset(n), values + offset, n * sizeof(T));
+
+    Message request{};
+    request.operation = operation;
+    request.nvr = n;
+    request.size = values_offset(n) + n * sizeof(T);
+
+    if (transact(request).status >= fmi2Error)
+      throw runtime_error("The slave failed to set the values");
+  }
+}
+
+void ProcessSlave::setupExperiment(double startTime)
+{
+  invoke(Operation::setup_experiment, startTime);
+  lastSuccessfulTime_ = startTime;
+}
+
+void ProcessSlave::enterInitializationMode()
+{
+  invoke(Operation::enter_initialization_mode);
+}
+
+void ProcessSlave::exitInitializationMode()
+{
+  invoke(Operation::exit_initialization_mode);
+}
+
+bool ProcessSlave::doStep(double currentTime, double stepSize)
+{
+  if (invoke(Operation::do_step, currentTime, stepSize).status == fmi2Discard)
+    return false;
+
+  lastSuccessfulTime_ = currentTime + stepSize;
+  return true;
+}
+
+size_t ProcessSlave::doSteps(double currentTime, const fmi2Real *stepSizes, size_t nSteps,
+                             const fmi2ValueReference *inputVrs, size_t nInputs, const fmi2Real *inputs,
+                             const fmi2ValueReference *outputVrs, size_t nOutputs, fmi2Real *outputs)
+{
+  auto data = segment_.data();
+  size_t capacity = dataCapacity - logCapacity;
+  size_t perStep = (1 + nInputs + nOutputs) * sizeof(fmi2Real);
+
+  if (StepsLayout(0, nInputs, nOutputs).size + perStep > capacity)
+    throw runtime_error("Too many inputs and outputs to take steps in a single call");
+
+  size_t chunk = (capacity - StepsLayout(0, nInputs, nOutputs).size) / perStep;
+
+  // the arrays of a side without values may be null, which memcpy does not accept even when copying nothing
+  if (nInputs > 0)
+    memcpy(data, inputVrs, nInputs * sizeof(fmi2ValueReference));
+  if (nOutputs > 0)
+    memcpy(data + nInputs * sizeof(fmi2ValueReference), outputVrs, nOutputs * sizeof(fmi2ValueReference));
+
+  for (size_t first = 0; first < nSteps; first += chunk)
+  {
+    size_t n = min(chunk, nSteps - first);
+    StepsLayout layout(n, nInputs, nOutputs);
+
+    memcpy(data + layout.stepSizes, stepSizes + first, n * sizeof(fmi2Real));
+    if (nInputs > 0)
+      memcpy(data + layout.inputs, inputs + first * nInputs, n * nInputs * sizeof(fmi2Real));
+
+    Message request{};
+    request.operation = Operation::do_steps;
+    request.nvr = nInputs + nOutputs;
+    request.args[0] = currentTime;
+    request.size = layout.size;
+    request.nSteps = n;
+    request.nInputs = nInputs;
+
+    auto response = transact(request);
+
+    if (response.status >= fmi2Error)
+      throw runtime_error("The slave failed to take the steps");
+
+    size_t completed = min<size_t>(response.nSteps, n);
+
+    if (nOutputs > 0)
+      memcpy(outputs + first * nOutputs, data + layout.outputs, completed * nOutputs * sizeof(fmi2Real));
+
+    for (size_t k = first; k < first + completed; ++k)
+      currentTime += stepSizes[k];
+
+    if (completed > 0)
+      lastSuccessfulTime_ = currentTime;
+
+    if (completed < n)
+      return first + completed;
+  }
+
+  return nSteps;
+}
+
+void ProcessSlave::reset()
+{
+  invoke(Operation::reset);
+  lastSuccessfulTime_ = 0;
+}
+
+void ProcessSlave::terminate()
+{
+  invoke(Operation::terminate);
+}
+
+void ProcessSlave::getInteger(const fmi2ValueReference *vr, size_t nvr, fmi2Integer *values) const
+{
+  get(Operation::get_integer, vr, nvr, values);
+}
+
+void ProcessSlave::getReal(const fmi2ValueReference *vr, size_t nvr, fmi2Real *values) const
+{
+  get(Operation::get_real, vr, nvr, values);
+}
+
+void ProcessSlave::getBoolean(const fmi2ValueReference *vr, size_t nvr, fmi2Boolean *values) const
+{
+  get(Operation::get_boolean, vr, nvr, values);
+}
+
+void ProcessSlave::getString(const fmi2ValueReference *vr, size_t nvr, fmi2String *values) const
+{
+  auto data = segment_.data();
+
+  if (values_offset(nvr) > dataCapacity - logCapacity)
+    throw runtime_error("Too many value references to get in a single call");
+
+  memcpy(data, vr, nvr * sizeof(fmi2ValueReference));
+
+  Message request{};
+  request.operation = Operation::get_string;
+  request.nvr = nvr;
+  request.size = values_offset(nvr);
+
+  if (transact(request).status >= fmi2Error)
+    throw runtime_error("The slave failed to get the values");
+
+  // the strings are packed by pack_strings, they are copied since the data area is overwritten by the next request
+  strings_.reset();
+  auto str = reinterpret_cast<const char *>(data + values_offset(nvr));
+
+  for (size_t i = 0; i < nvr; ++i)
+  {
+    std::string_view packed(str);
+    values[i] = strings_.store(packed);
+    str += packed.size() + 1;
+  }
+}
+
+fmi2Status ProcessSlave::setDebugLogging(bool loggingOn, size_t nCategories, const char *const categories[]) const
+{
+  logger_->setDebugLogging(loggingOn, nCategories, categories);
+
+  Message request{};
+  request.operation = Operation::set_debug_logging;
+  request.nvr = nCategories;
+  request.args[0] = loggingOn;
+  request.size = pack_strings(segment_.data(), dataCapacity - logCapacity, categories, nCategories);
+
+  return static_cast<fmi2Status>(transact(request).status);
+}
+
+void ProcessSlave::setReal(const fmi2ValueReference *vr, size_t nvr, const fmi2Real *values)
+{
+  set(Operation::set_real, vr, nvr, values);
+}
+
+void ProcessSlave::setInteger(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *values)
+{
+  set(Operation::set_integer, vr, nvr, values);
+}
+
+void ProcessSlave::setBoolean(const fmi2ValueReference *vr, size_t nvr, const fmi2Boolean *values)
+{
+  set(Operation::set_boolean, vr, nvr, values);
+}
+
+void ProcessSlave::setString(const fmi2ValueReference *vr, size_t nvr, const fmi2String *values)
+{
+  auto data = segment_.data();
+
+  if (values_offset(nvr) > dataCapacity - logCapacity)
+    throw runtime_error("Too many value references to set in a single call");
+
+  memcpy(data, vr, nvr * sizeof(fmi2ValueReference));
+
+  Message request{};
+  request.operation = Operation::set_string;
+  request.nvr = nvr;
+  request.size = values_offset(nvr) + pack_strings(data + values_offset(nvr), dataCapacity - logCapacity - values_offset(nvr), values, nvr);
+
+  if (transact(request).status >= fmi2Error)
+    throw runtime_error("The slave failed to set the values");
+}
+
+fmi2FMUstate ProcessSlave::getFMUstate(fmi2FMUstate state)
+{
+  // the state is kept by the worker, the handle is only meaningful to it
+  return reinterpret_cast<fmi2FMUstate>(invoke(Operation::get_fmu_state, 0, 0, state).fmuState);
+}
+
+void ProcessSlave::setFMUstate(fmi2FMUstate state)
+{
+  // the worker responds with the time restored along with the state
+  lastSuccessfulTime_ = invoke(Operation::set_fmu_state, 0, 0, state).args[0];
+}
+
+void ProcessSlave::freeFMUstate(fmi2FMUstate state)
+{
+  invoke(Operation::free_fmu_state, 0, 0, state);
+}
+
+size_t ProcessSlave::serializedFMUstateSize(fmi2FMUstate state)
+{
+  return invoke(Operation::serialized_fmu_state_size, 0, 0, state).total;
+}
+
+void ProcessSlave::serializeFMUstate(fmi2FMUstate state, fmi2Byte *data, size_t size)
+{
+  auto chunk = dataCapacity - logCapacity;
+  size_t offset = 0;
+
+  // the worker serializes the state when the first chunk is requested
+  do
+  {
+    size_t n = min(chunk, size - offset);
+
+    Message request{};
+    request.operation = Operation::serialize_fmu_state;
+    request.fmuState = reinterpret_cast<uint64_t>(state);
+    request.offset = offset;
+    request.total = size;
+    request.size = n;
+
+    if (transact(request).status >= fmi2Error)
+      throw runtime_error("The slave failed to serialize the FMU state");
+
+    memcpy(data + offset, segment_.data(), n);
+    offset += n;
+  } while (offset < size);
+}
+
+fmi2FMUstate ProcessSlave::deSerializeFMUstate(const fmi2Byte *data, size_t size, fmi2FMUstate state)
+{
+  auto chunk = dataCapacity - logCapacity;
+  size_t offset = 0;
+  Message response;
+
+  // the worker deserializes the state once the last chunk is received
+  do
+  {
+    size_t n = min(chunk, size - offset);
+    memcpy(segment_.data(), data + offset, n);
+
+    Message request{};
+    request.operation = Operation::deserialize_fmu_state;
+    request.fmuState = reinterpret_cast<uint64_t>(state);
+    request.offset = offset;
+    request.total = size;
+    request.size = n;
+
+    response = transact(request);
+
+    if (response.status >= fmi2Error)
+      throw runtime_error("The slave failed to deserialize the FMU state");
+
+    offset += n;
+  } while (offset < size);
+
+  return reinterpret_cast<fmi2FMUstate>(response.fmuState);
+}
+
+void ProcessSlave::freeAllFMUstates()
+{
+  invoke(Operation::free_all_fmu_states);
+}
+
+void ProcessSlave::setTime(double time)
+{
+  invoke(Operation::set_time, time);
+}
+
+void ProcessSlave::setContinuousStates(const fmi2Real *states, size_t nx)
+{
+  exchange(Operation::set_continuous_states, states, nullptr, nx);
+}
+
+void ProcessSlave::getContinuousStates(fmi2Real *states, size_t nx)
+{
+  exchange(Operation::get_continuous_states, nullptr, states, nx);
+}
+
+void ProcessSlave::getNominalsOfContinuousStates(fmi2Real *nominals, size_t nx)
+{
+  exchange(Operation::get_nominals_of_continuous_states, nullptr, nominals, nx);
+}
+
+void ProcessSlave::getDerivatives(fmi2Real *derivatives, size_t nx)
+{
+  exchange(Operation::get_derivatives, nullptr, derivatives, nx);
+}
+
+void ProcessSlave::getEventIndicators(fmi2Real *indicators, size_t ni)
+{
+  exchange(Operation::get_event_indicators, nullptr, indicators, ni);
+}
+
+void ProcessSlave::enterEventMode()
+{
+  invoke(Operation::enter_event_mode);
+}
+
+void ProcessSlave::newDiscreteStates(fmi2EventInfo *eventInfo)
+{
+  Message request{};
+  request.operation = Operation::new_discrete_states;
+  request.size = sizeof(fmi2EventInfo);
+
+  if (transact(request).status >= fmi2Error)
+    throw runtime_error("The slave failed to execute the call");
+
+  memcpy(eventInfo, segment_.data(), sizeof(fmi2EventInfo));
+}
+
+void ProcessSlave::enterContinuousTimeMode()
+{
+  invoke(Operation::enter_continuous_time_mode);
+}
+
+bool ProcessSlave::completedIntegratorStep(bool noSetFMUStatePriorToCurrentPoint, bool *terminateSimulation)
+{
+  auto response = invoke(Operation::completed_integrator_step, noSetFMUStatePriorToCurrentPoint);
+  *terminateSimulation = response.args[1] != 0;
+  return response.args[0] != 0;
+}
+
+void ProcessSlave::getDirectionalDerivative(const fmi2ValueReference *unknowns, size_t nUnknowns,
+                                            const fmi2ValueReference *knowns, size_t nKnowns,
+                                            const fmi2Real *seed, fmi2Real *sensitivity)
+{
+  auto data = segment_.data();
+  size_t offset = values_offset(nKnowns + nUnknowns);
+  size_t size = offset + (nKnowns + nUnknowns) * sizeof(fmi2Real);
+
+  if (size > dataCapacity - logCapacity)
+    throw runtime_error("Too many unknowns and knowns to get the directional derivative in a single call");
+
+  if (nKnowns > 0)
+  {
+    memcpy(data, knowns, nKnowns * sizeof(fmi2ValueReference));
+    memcpy(data + offset, seed, nKnowns * sizeof(fmi2Real));
+  }
+  if (nUnknowns > 0)
+    memcpy(data + nKnowns * sizeof(fmi2ValueReference), unknowns, nUnknowns * sizeof(fmi2ValueReference));
+
+  Message request{};
+  request.operation = Operation::get_directional_derivative;
+  request.nvr = nKnowns + nUnknowns;
+  request.nInputs = nKnowns;
+  request.size = size;
+
+  if (transact(request).status >= fmi2Error)
+    throw runtime_error("The slave failed to get the directional derivative");
+
+  if (nUnknowns > 0)
+    memcpy(sensitivity, data + offset + nKnowns * sizeof(fmi2Real), nUnknowns * sizeof(fmi2Real));
+}
+
+void ProcessSlave::getJacobian(const fmi2ValueReference *unknowns, size_t nUnknowns,
+                               const fmi2ValueReference *knowns, size_t nKnowns, fmi2Real *jacobian)
+{
+  auto data = segment_.data();
+  size_t offset = values_offset(nKnowns + nUnknowns);
+  size_t size = offset + nUnknowns * nKnowns * sizeof(fmi2Real);
+
+  if (size > dataCapacity - logCapacity)
+    throw runtime_error("Too many unknowns and knowns to get the Jacobian in a single call");
+
+  if (nKnowns > 0)
+    memcpy(data, knowns, nKnowns * sizeof(fmi2ValueReference));
+  if (nUnknowns > 0)
+    memcpy(data + nKnowns * sizeof(fmi2ValueReference), unknowns, nUnknowns * sizeof(fmi2ValueReference));
+
+  Message request{};
+  request.operation = Operation::get_jacobian;
+  request.nvr = nKnowns + nUnknowns;
+  request.nInputs = nKnowns;
+  request.size = size;
+
+  if (transact(request).status >= fmi2Error)
+    throw runtime_error("The slave failed to get the Jacobian");
+
+  if (nUnknowns * nKnowns > 0)
+    memcpy(jacobian, data + offset, nUnknowns * nKnowns * sizeof(fmi2Real));
+}
+
+void ProcessSlave::setRealInputDerivatives(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *order, const fmi2Real *value)
+{
+  auto data = segment_.data();
+  size_t size = derivatives_offset(nvr) + nvr * sizeof(fmi2Real);
+
+  if (size > dataCapacity - logCapacity)
+    throw runtime_error("Too many value references to set in a single call");
+
+  if (nvr > 0)
+  {
+    memcpy(data, vr, nvr * sizeof(fmi2ValueReference));
+    memcpy(data + values_offset(nvr), order, nvr * sizeof(fmi2Integer));
+    memcpy(data + derivatives_offset(nvr), value, nvr * sizeof(fmi2Real));
+  }
+
+  Message request{};
+  request.operation = Operation::set_real_input_derivatives;
+  request.nvr = nvr;
+  request.size = size;
+
+  if (transact(request).status >= fmi2Error)
+    throw runtime_error("The slave failed to set the derivatives of the inputs");
+}
+
+void ProcessSlave::getRealOutputDerivatives(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *order, fmi2Real *value)
+{
+  auto data = segment_.data();
+  size_t size = derivatives_offset(nvr) + nvr * sizeof(fmi2Real);
+
+  if (size > dataCapacity - logCapacity)
+    throw runtime_error("Too many value references to get in a single call");
+
+  if (nvr > 0)
+  {
+    memcpy(data, vr, nvr * sizeof(fmi2ValueReference));
+    memcpy(data + values_offset(nvr), order, nvr * sizeof(fmi2Integer));
+  }
+
+  Message request{};
+  request.operation = Operation::get_real_output_derivatives;
+  request.nvr = nvr;
+  request.size = size;
+
+  if (transact(request).status >= fmi2Error)
+    throw runtime_error("The slave failed to get the derivatives of the outputs");
+
+  if (nvr > 0)
+    memcpy(value, data + derivatives_offset(nvr), nvr * sizeof(fmi2Real));
+}
+
+} // namespace pythonfmu
+
+#endif // PYFMU_HAS_PROCESS_SLAVE
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include "fmt/format.h"
+#include "nlohmann/json.hpp"
+
+#include "pythonfmu/Profile.hpp"
+
+using namespace fmt;
+using namespace std;
+using json = nlohmann::json;
+
+namespace pythonfmu
+{
+
+namespace
+{
+
+const char *function_names[] = {
+    "fmi2Instantiate",
+    "fmi2SetDebugLogging",
+    "fmi2SetupExperiment",
+    "fmi2EnterInitializationMode",
+    "fmi2ExitInitializationMode",
+    "fmi2Terminate",
+    "fmi2Reset",
+    "fmi2GetReal",
+    "fmi2GetInteger",
+    "fmi2GetBoolean",
+    "fmi2GetString",
+    "fmi2SetReal",
+    "fmi2SetInteger",
+    "fmi2SetBoolean",
+    "fmi2SetString",
+    "fmi2GetFMUstate",
+    "fmi2SetFMUstate",
+    "fmi2FreeFMUstate",
+    "fmi2SerializedFMUstateSize",
+    "fmi2SerializeFMUstate",
+    "fmi2DeSerializeFMUstate",
+    "fmi2DoStep",
+    "pyfmuDoSteps",
+    "fmi2SetTime",
+    "fmi2SetContinuousStates",
+    "fmi2GetContinuousStates",
+    "fmi2GetNominalsOfContinuousStates",
+    "fmi2GetDerivatives",
+    "fmi2GetEventIndicators",
+    "fmi2EnterEventMode",
+    "fmi2NewDiscreteStates",
+    "fmi2EnterContinuousTimeMode",
+    "fmi2CompletedIntegratorStep",
+    "fmi2GetDirectionalDerivative",
+    "pyfmuGetJacobian",
+    "fmi2SetRealInputDerivatives",
+    "fmi2GetRealOutputDerivatives",
+    "pyfmuGetRealEnsemble",
+    "pyfmuGetIntegerEnsemble",
+    "pyfmuGetBooleanEnsemble",
+    "pyfmuSetRealEnsemble",
+    "pyfmuSetIntegerEnsemble",
+    "pyfmuSetBooleanEnsemble",
+};
+
+static_assert(size(function_names) == static_cast<size_t>(Profile::Function::n_functions));
+
+const char *phase_names[] = {
+    "gil_wait",
+    "marshal",
+    "python_call",
+    "unmarshal",
+    "log_drain",
+};
+
+static_assert(size(phase_names) == static_cast<size_t>(Profile::Phase::n_phases));
+
+json histogram_to_json(const LatencyHistogram &h)
+{
+  json buckets = json::array();
+
+  for (size_t i = 0; i < LatencyHistogram::nBuckets; ++i)
+  {
+    if (auto n = h.bucket_count(i); n > 0)
+      buckets.push_back({LatencyHistogram::lower_bound(i), n});
+  }
+
+  uint64_t count = h.count();
+
+  return {{"count", count},
+          {"total_ns", h.total()},
+          {"mean_ns", count == 0 ? 0.0 : double(h.total()) / count},
+          {"min_ns", h.min()},
+          {"p50_ns", h.percentile(0.5)},
+          {"p90_ns", h.percentile(0.9)},
+          {"p99_ns", h.percentile(0.99)},
+          {"p999_ns", h.percentile(0.999)},
+          {"max_ns", h.max()},
+          {"buckets", move(buckets)}};
+}
+
+string histogram_summary(const char *name, const LatencyHistogram &h)
+{
+  uint64_t count = h.count();
+
+  return format("{:<28} {:>10} {:>12.1f} {:>12.1f} {:>12.1f} {:>12.1f} {:>14.0f}\n",
+                name, count, h.total() / 1e3 / count, h.percentile(0.5) / 1e3, h.percentile(0.99) / 1e3, h.max() / 1e3, h.total() / 1e3);
+}
+
+} // namespace
+
+void LatencyHistogram::record(uint64_t ns)
+{
+  add(counts_[bucket_of(ns)], 1);
+  add(count_, 1);
+  add(total_, ns);
+
+  if (ns < min_.load(memory_order_relaxed))
+    min_.store(ns, memory_order_relaxed);
+  if (ns > max_.load(memory_order_relaxed))
+    max_.store(ns, memory_order_relaxed);
+}
+
+void LatencyHistogram::clear()
+{
+  for (auto &c : counts_)
+    c.store(0, memory_order_relaxed);
+
+  count_.store(0, memory_order_relaxed);
+  total_.store(0, memory_order_relaxed);
+  min_.store(UINT64_MAX, memory_order_relaxed);
+  max_.store(0, memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucket_of(uint64_t ns)
+{
+  if (ns < subBuckets)
+    return ns;
+
+  size_t exponent = bit_width(ns) - 1;
+
+  if (exponent >= maxExponent)
+    return nBuckets - 1;
+
+  size_t sub = (ns >> (exponent - subBucketBits)) & (subBuckets - 1);
+  return (exponent - subBucketBits + 1) * subBuckets + sub;
+}
+
+uint64_t LatencyHistogram::lower_bound(size_t bucket)
+{
+  if (bucket < subBuckets)
+    return bucket;
+
+  size_t exponent = bucket / subBuckets + subBucketBits - 1;
+  size_t sub = bucket % subBuckets;
+  return uint64_t(subBuckets + sub) << (exponent - subBucketBits);
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+  uint64_t count = this->count();
+
+  if (count == 0)
+    return 0;
+
+  auto rank = std::max<uint64_t>(uint64_t(ceil(p * count)), 1);
+  uint64_t seen = 0;
+
+  for (size_t i = 0; i < nBuckets; ++i)
+  {
+    seen += bucket_count(i);
+
+    // the upper bound of the bucket, the largest latency it may have counted
+    if (seen >= rank)
+      return (i + 1 < nBuckets) ? std::min(lower_bound(i + 1) - 1, max()) : max();
+  }
+
+  return max();
+}
+
+void Profile::clear()
+{
+  for (auto &h : functions_)
+    h.clear();
+
+  for (auto &h : phases_)
+    h.clear();
+}
+
+string Profile::to_json() const
+{
+  json functions = json::object();
+  json phases = json::object();
+
+  for (size_t i = 0; i < functions_.size(); ++i)
+  {
+    if (functions_[i].count() > 0)
+      functions[function_names[i]] = histogram_to_json(functions_[i]);
+  }
+
+  for (size_t i = 0; i < phases_.size(); ++i)
+  {
+    if (phases_[i].count() > 0)
+      phases[phase_names[i]] = histogram_to_json(phases_[i]);
+  }
+
+  return json{{"functions", move(functions)}, {"phases", move(phases)}}.dump();
+}
+
+string Profile::summary() const
+{
+  string header = format("{:<28} {:>10} {:>12} {:>12} {:>12} {:>12} {:>14}\n", "", "calls", "mean [us]", "p50 [us]", "p99 [us]", "max [us]", "total [us]");
+  string s = "Profile of the instance\n" + header;
+
+  for (size_t i = 0; i < functions_.size(); ++i)
+  {
+    if (functions_[i].count() > 0)
+      s += histogram_summary(function_names[i], functions_[i]);
+  }
+
+  s += "Phases of the calls into Python\n" + header;
+
+  for (size_t i = 0; i < phases_.size(); ++i)
+  {
+    if (phases_[i].count() > 0)
+      s += histogram_summary(phase_names[i], phases_[i]);
+  }
+
+  return s;
+}
+
+const char *Profile::name(Function function)
+{
+  return function_names[static_cast<size_t>(function)];
+}
+
+const char *Profile::name(Phase phase)
+{
+  return phase_names[static_cast<size_t>(phase)];
+}
+
+} // namespace pythonfmu
@@ -1,5 +1,6 @@
 #include <fstream>
 #include <exception>
+#include <stdexcept>
 #include <filesystem>
 
 #include <fmt/format.h>
@@ -18,13 +19,50 @@ namespace pyconfiguration
 
 void to_json(json &j, const PyConfiguration &p)
 {
-    j = nlohmann::json{{"main_class", p.main_class}, {"main_script", p.main_script}};
+    j = nlohmann::json{{"main_class", p.main_class}, {"main_script", p.main_script}, {"interpreter", p.interpreter}, {"stepping", p.stepping},
+                       {"logging", {{"mode", p.logging.mode}, {"capacity", p.logging.capacity}, {"overflow", p.logging.overflow}}},
+                       {"pool", {{"size", p.pool.size}, {"max_idle", p.pool.max_idle}}},
+                       {"profiling", {{"enabled", p.profiling.enabled}, {"dump_on_terminate", p.profiling.dump_on_terminate}}}};
 }
 
 void from_json(const json &j, PyConfiguration &p)
 {
     j.at("main_class").get_to(p.main_class);
     j.at("main_script").get_to(p.main_script);
+    p.interpreter = j.value("interpreter", "shared");
+
+    if (p.interpreter != "shared" && p.interpreter != "isolated" && p.interpreter != "process" && p.interpreter != "fork")
+        throw invalid_argument(format("interpreter must be one of 'shared', 'isolated', 'process' or 'fork', the value was: {}", p.interpreter));
+
+    p.stepping = j.value("stepping", "sync");
+
+    if (p.stepping != "sync" && p.stepping != "async")
+        throw invalid_argument(format("stepping must be one of 'sync' or 'async', the value was: {}", p.stepping));
+
+    auto logging = j.value("logging", json::object());
+    p.logging.mode = logging.value("mode", "sync");
+    p.logging.capacity = logging.value("capacity", p.logging.capacity);
+    p.logging.overflow = logging.value("overflow", "drop");
+
+    if (p.logging.mode != "sync" && p.logging.mode != "async")
+        throw invalid_argument(format("logging.mode must be one of 'sync' or 'async', the value was: {}", p.logging.mode));
+
+    if (p.logging.overflow != "drop" && p.logging.overflow != "block" && p.logging.overflow != "sample")
+        throw invalid_argument(format("logging.overflow must be one of 'drop', 'block' or 'sample', the value was: {}", p.logging.overflow));
+
+    if (p.logging.capacity == 0)
+        throw invalid_argument("logging.capacity must be positive");
+
+    auto pool = j.value("pool", json::object());
+    p.pool.size = pool.value("size", p.pool.size);
+    p.pool.max_idle = pool.value("max_idle", p.pool.max_idle);
+
+    if (p.pool.max_idle < 0)
+        throw invalid_argument("pool.max_idle must not be negative");
+
+    auto profiling = j.value("profiling", json::object());
+    p.profiling.enabled = profiling.value("enabled", p.profiling.enabled);
+    p.profiling.dump_on_terminate = profiling.value("dump_on_terminate", p.profiling.dump_on_terminate);
 }
 }
 
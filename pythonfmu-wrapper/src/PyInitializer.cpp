@@ -0,0 +1,73 @@
+#include <mutex>
+#include <stdexcept>
+
+#include "fmt/format.h"
+
+#include "pythonfmu/PyInitializer.hpp"
+#include "utility/utils.hpp"
+
+using namespace std;
+using namespace fmt;
+
+namespace pythonfmu
+{
+
+/**
+ * @brief Guards the initialization of the interpreter, such that concurrently instantiated FMUs initialize it once.
+ */
+static mutex interpreterMutex;
+static PyInitializer *interpreter = nullptr;
+
+shared_ptr<PyInitializer> PyInitializer::acquire(Logger *log, wstring module_path)
+{
+  lock_guard<mutex> lock(interpreterMutex);
+
+  if (interpreter == nullptr)
+    interpreter = new PyInitializer(log, module_path);
+  else
+    log->ok("Using the Python interpreter shared by the instances in the process\n");
+
+  // never deleted, the interpreter is kept alive until the process exits
+  return shared_ptr<PyInitializer>(interpreter, [](PyInitializer *) {});
+}
+
+PyInitializer::PyInitializer(Logger *log, wstring module_path)
+{
+  if (Py_IsInitialized())
+  {
+    log->ok("Python interpreter was initialized by the process, using it\n");
+    return;
+  }
+
+  log->ok("Setting up module path\n");
+
+  if (!module_path.empty())
+  {
+    log->ok("Using explicitly defined module path\n");
+    Py_SetPath(module_path.c_str());
+  }
+
+  log->ok("initializing Python interpreter\n");
+  Py_Initialize();
+
+  if (!Py_IsInitialized())
+  {
+    log->fatal("Failed to initialize Python Interpreter\n");
+    throw runtime_error("Failed to initialize Python interpreter");
+  }
+
+  const wchar_t *home = Py_GetPythonHome() ? Py_GetPythonHome() : L"";
+  const wchar_t *path = Py_GetPath() ? Py_GetPath() : L"";
+
+  string home_str = ws2s(wstring(home));
+  string path_str = ws2s(wstring(path));
+
+  log->ok(format("Python home is: {} and path is {}\n", home_str, path_str));
+
+  // the GIL is taken by the thread initializing the interpreter, release it so that instances may be used from any thread
+  PyEval_SaveThread();
+
+  log->ok("Python interpreter initialized\n");
+}
+
+} // namespace pythonfmu
@@ -0,0 +1,207 @@
+#include <stdexcept>
+
+#include "fmt/format.h"
+
+#include "pythonfmu/Logger.hpp"
+#include "pythonfmu/PyException.hpp"
+#include "pythonfmu/PyMemoryViews.hpp"
+#include "utility/py_compatability.hpp"
+
+using namespace std;
+
+namespace pythonfmu
+{
+
+PyMemoryViews::PyMemoryViews()
+{
+  // borrowed reference
+  PyObject *memoryview = PyDict_GetItemString(PyEval_GetBuiltins(), "memoryview");
+
+  if (memoryview == nullptr)
+    throw runtime_error("Failed to resolve the built-in memoryview type");
+
+  pCast_ = PyObject_GetAttrString(memoryview, "cast");
+  pRelease_ = PyObject_GetAttrString(memoryview, "release");
+
+  pFormatValueReference_ = PyUnicode_FromString("I");
+  pFormatInteger_ = PyUnicode_FromString("i");
+  pFormatReal_ = PyUnicode_FromString("d");
+
+  if (pCast_ == nullptr || pRelease_ == nullptr)
+    throw runtime_error(get_py_exception());
+}
+
+PyMemoryViews::~PyMemoryViews()
+{
+  Py_XDECREF(pCast_);
+  Py_XDECREF(pRelease_);
+  Py_XDECREF(pFormatValueReference_);
+  Py_XDECREF(pFormatInteger_);
+  Py_XDECREF(pFormatReal_);
+  Py_XDECREF(pPickleBuffer_);
+}
+
+PyObject *PyMemoryViews::view(void *data, size_t size, PyObject *format, bool writable) const
+{
+  // PyMemoryView_FromMemory rejects null pointers, which masters may pass when nvr is 0
+  static char empty;
+  char *memory = (size == 0) ? &empty : static_cast<char *>(data);
+
+  PyObject *bytes = PyMemoryView_FromMemory(memory, size, writable ? PyBUF_WRITE : PyBUF_READ);
+
+  return cast(bytes, format);
+}
+
+SharedView PyMemoryViews::shared(void *data, size_t size, PyObject *format, bool writable) const
+{
+  if (!pickleBufferResolved_)
+  {
+    pickleBufferResolved_ = true;
+
+    // pickle.PickleBuffer is defined by _pickle, importing which spares the modules imported by pickle
+    PyObject *pPickle = PyImport_ImportModule("_pickle");
+    pPickleBuffer_ = (pPickle != nullptr) ? PyObject_GetAttrString(pPickle, "PickleBuffer") : nullptr;
+    Py_XDECREF(pPickle);
+
+    if (pPickleBuffer_ == nullptr)
+      PyErr_Clear();
+  }
+
+  if (pPickleBuffer_ == nullptr)
+    return {view(data, size, format, writable), nullptr};
+
+  SharedView shared;
+  shared.exporter = view(data, size, nullptr, writable);
+
+  if (shared.exporter == nullptr)
+    return shared;
+
+  // a PickleBuffer passes on the buffer of the view it wraps, views of it hold an export of the private view rather than sharing its buffer
+  PyObject *pBuffer = PyCompat::PyObject_Vectorcall(pPickleBuffer_, &shared.exporter, 1);
+  PyObject *bytes = (pBuffer != nullptr) ? PyMemoryView_FromObject(pBuffer) : nullptr;
+  Py_XDECREF(pBuffer);
+
+  shared.view = cast(bytes, format);
+
+  return shared;
+}
+
+PyObject *PyMemoryViews::cast(PyObject *bytes, PyObject *format) const
+{
+  if (bytes == nullptr || format == nullptr)
+    return bytes;
+
+  PyObject *args[] = {bytes, format};
+  PyObject *typed = PyCompat::PyObject_Vectorcall(pCast_, args, 2);
+
+  // the typed view holds its own reference to the underlying buffer, only it is exposed to Python
+  Py_DECREF(bytes);
+
+  return typed;
+}
+
+bool PyMemoryViews::release(PyObject *view) const
+{
+  PyObject *pExcType, *pExcValue, *pExcTraceback;
+  PyErr_Fetch(&pExcType, &pExcValue, &pExcTraceback);
+
+  PyObject *result = PyCompat::PyObject_Vectorcall(pRelease_, &view, 1);
+  bool released = (result != nullptr);
+
+  Py_XDECREF(result);
+  Py_DECREF(view);
+
+  if (!released)
+    PyErr_Clear();
+
+  PyErr_Restore(pExcType, pExcValue, pExcTraceback);
+
+  return released;
+}
+
+void PyMemoryViews::release(span<PyObject *const> views, const char *method, Logger *logger) const
+{
+  bool released = true;
+
+  for (auto view : views)
+  {
+    if (view != nullptr)
+      released = release(view) && released;
+  }
+
+  if (!released)
+    logger->error(fmt::format("The slave retained a reference to the arrays passed to {}. The arrays are no longer valid once the call returns, copy the values instead.\n", method));
+}
+
+bool PyMemoryViews::release(SharedView &view) const
+{
+  bool released = true;
+
+  if (view.view != nullptr)
+    released = release(view.view);
+
+  // the private view can only be released once neither the view nor any view derived from it holds an export of it
+  if (view.exporter != nullptr)
+    released = release(view.exporter) && released;
+
+  view = {};
+
+  return released;
+}
+
+bool PyMemoryViews::release(span<SharedView> views, PyObject *owner, Logger *logger) const
+{
+  bool released = true;
+
+  for (auto &view : views)
+  {
+    // views derived from the view keep its exporter exported, or without an exporter the view itself alive
+    PyObject *pSurvivor = (view.exporter != nullptr) ? view.exporter : view.view;
+    Py_XINCREF(pSurvivor);
+
+    if (!release(view))
+    {
+      released = false;
+
+      if (owner != nullptr)
+        keep_alive(pSurvivor, owner, logger);
+    }
+
+    Py_XDECREF(pSurvivor);
+  }
+
+  return released;
+}
+
+void PyMemoryViews::keep_alive(PyObject *object, PyObject *owner, Logger *logger) const
+{
+  // the finalizer holds the callback, and with it the owner, until it is called once the object is destroyed
+  static PyMethodDef release_owner = {"release_owner", [](PyObject *, PyObject *) -> PyObject * {
+                                        Py_INCREF(Py_None);
+                                        return Py_None;
+                                      },
+                                      METH_NOARGS, nullptr};
+
+  PyObject *pWeakref = PyImport_ImportModule("weakref");
+  PyObject *pFinalize = (pWeakref != nullptr) ? PyObject_GetAttrString(pWeakref, "finalize") : nullptr;
+  PyObject *pCallback = (pFinalize != nullptr) ? PyCFunction_New(&release_owner, owner) : nullptr;
+  PyObject *pFinalizer = (pCallback != nullptr) ? PyObject_CallFunctionObjArgs(pFinalize, object, pCallback, nullptr) : nullptr;
+
+  Py_XDECREF(pWeakref);
+  Py_XDECREF(pFinalize);
+  Py_XDECREF(pCallback);
+
+  if (pFinalizer != nullptr)
+  {
+    Py_DECREF(pFinalizer);
+    return;
+  }
+
+  PyErr_Clear();
+
+  // leaked, the slave may access the memory for as long as it lives
+  Py_INCREF(owner);
+  logger->warning("The slave holds views of memory of the wrapper beyond the lifetime of the instance, which is leaked as it could not be kept alive along with them\n");
+}
+
+} // namespace pythonfmu
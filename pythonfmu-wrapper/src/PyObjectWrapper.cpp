@@ -1,6 +1,12 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <numeric>
 #include <sstream>
 #include <stdexcept>
 #include <utility>
@@ -22,27 +28,239 @@ namespace pythonfmu
 {
 
 /**
- * @brief Appends path of resources folder to the Python interpreter path. This
- * allows the interpreter to locate and load the main script.
+ * @brief Names of the slave's methods, indexed by PyObjectWrapper::SlaveMethod.
+ */
+static constexpr const char *slave_method_names[] = {
+    "setup_experiment",
+    "enter_initialization_mode",
+    "exit_initialization_mode",
+    "do_step",
+    "reset",
+    "terminate",
+    "__get_integer__",
+    "__get_real__",
+    "__get_boolean__",
+    "__get_string__",
+    "__set_integer__",
+    "__set_real__",
+    "__set_boolean__",
+    "__set_string__",
+    "__set_debug_logging__",
+    "__get_log_size__",
+    "__pop_log_messages__",
+    "get_state",
+    "set_state",
+    "serialize_state",
+    "deserialize_state",
+    "set_time",
+    "set_continuous_states",
+    "get_continuous_states",
+    "get_nominals_of_continuous_states",
+    "get_derivatives",
+    "get_event_indicators",
+    "evaluate_derivatives",
+    "evaluate_event_indicators",
+    "enter_event_mode",
+    "new_discrete_states",
+    "enter_continuous_time_mode",
+    "completed_integrator_step",
+    "evaluate_outputs",
+};
+
+/**
+ * @brief Header of a serialized FMU state.
+ * 
+ * The header holds the time reached by the instance, and is followed by the values of the natively stored Real, Integer and Boolean variables, written as raw arrays,
+ * and by the snapshot of the slave as serialized by its serialize_state method.
+ * Values are written in the byte order of the machine, which is recorded such that states are never restored on a machine with a different byte order.
+ */
+struct SerializedStateHeader
+{
+  static constexpr uint32_t currentVersion = 2;
+  static constexpr uint32_t byteOrderMark = 0x01020304;
+
+  char tag[4];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t reserved;
+  uint64_t nReals;
+  uint64_t nIntegers;
+  uint64_t nBooleans;
+  uint64_t snapshotSize;
+  double lastSuccessfulTime;
+};
+
+static constexpr char serializedStateTag[4] = {'P', 'Y', 'F', 'S'};
+
+/**
+ * @brief Appends an entry, a folder or a zip archive, to the module search path of the current interpreter.
+ *
+ * Instances of the same FMU share the resources folder, as such entries already on the path are not added again.
+ */
+static void append_to_python_path(const path &entry)
+{
+  PyObject *pPath = PySys_GetObject("path"); // borrowed
+  PyObject *pEntry = PyUnicode_DecodeFSDefault(entry.string().c_str());
+
+  int contained = (pPath != nullptr && pEntry != nullptr) ? PySequence_Contains(pPath, pEntry) : -1;
+  bool failed = (contained < 0) || (contained == 0 && PyList_Append(pPath, pEntry) != 0);
+
+  Py_XDECREF(pEntry);
+
+  if (failed)
+  {
+    PyErr_Clear();
+    throw runtime_error(format("Failed to append {} to the Python path\n", entry.string()));
+  }
+}
+
+/**
+ * @brief Returns the bytecode archive written by the exporter for the current interpreter, or an empty path if there is none.
  *
- * @param resource_path path to the resources dir supplied when FMU is
- * initialized
+ * The archive is named after the cache tag of the interpreter which compiled it, the bytecode of other versions is not loadable.
+ */
+static path find_bytecode_archive(const path &resource_path)
+{
+  PyObject *pImplementation = PySys_GetObject("implementation"); // borrowed
+  PyObject *pTag = (pImplementation != nullptr) ? PyObject_GetAttrString(pImplementation, "cache_tag") : nullptr;
+
+  string tag;
+  bool found = (pTag != nullptr && pTag != Py_None && PyCompat::PyUnicode_AsUTF8(pTag, tag));
+
+  Py_XDECREF(pTag);
+  PyErr_Clear();
+
+  if (!found)
+    return {};
+
+  path archive = resource_path / "__pycache__" / format("bytecode.{}.zip", tag);
+  return is_regular_file(archive) ? archive : path();
+}
+
+/**
+ * @brief Read the configuration of the slave located in the resources folder.
+ */
+static PyConfiguration read_slave_configuration(const path &resource_path, Logger *logger)
+{
+  auto config_path = resource_path / "slave_configuration.json";
+
+  logger->ok(format("Reading configuration file located at: {}\n", config_path.string()));
+
+  try
+  {
+    auto config = read_configuration(config_path, logger);
+
+    logger->ok(format("successfully read configuration file, specifying the following: main "
+                      "script is: {}, main class is: {} and interpreter is: {}\n",
+                      config.main_script, config.main_class, config.interpreter));
+
+    return config;
+  }
+  catch (const exception &e)
+  {
+    logger->error(format("Failed to read configuration file, an expection was thrown:\n{}", e.what()));
+    throw;
+  }
+}
+
+/**
+ * @brief Make the modules in the resources folder importable, preferring the precompiled bytecode if there is any for the current interpreter.
  */
-void append_resources_folder_to_python_path(path &resource_path)
+static void extend_python_path(const path &resource_path, Logger *logger)
 {
+  // precedes the resources folder, such that the sources are only compiled if the bytecode does not match the interpreter
+  path bytecode = find_bytecode_archive(resource_path);
+
+  if (!bytecode.empty())
+  {
+    logger->ok(format("importing precompiled bytecode from: {}\n", bytecode.string()));
+    append_to_python_path(bytecode);
+  }
+
+  logger->ok(format("appending path of resource folder to Python "
+                    "Interpreter, the specified path is: {}\n",
+                    resource_path.string()));
+
+  append_to_python_path(resource_path);
+
+  logger->ok(format("Successfully appended resources directory to Python path\n"));
+}
+
+/**
+ * @brief Returns the qualified name of the module defined by the main script of the slave, creating the package it is imported into.
+ * 
+ * FMUs often name their main scripts alike, so each script is imported into a package of its own rather than as a top-level module,
+ * such that the modules of FMUs sharing an interpreter do not replace each other in sys.modules.
+ * The package is named after the contents of the script, which keeps snapshots pickled by an instance loadable by instances of the same FMU extracted elsewhere.
+ * Other modules imported by the script are still resolved through the Python path, and as such shared by the FMUs.
+ */
+static string module_name(const path &resource_path, const PyConfiguration &config)
+{
+  path script = path(config.main_script).filename();
+
+  ifstream source(resource_path / script, ios::binary);
+  string contents = source ? string(istreambuf_iterator<char>(source), {}) : resource_path.string();
 
-  ostringstream oss;
-  oss << "import sys\n";
-  oss << "sys.path.append(r'" << resource_path.string() << "')\n";
+  // FNV-1a, which unlike std::hash is the same in every process loading the FMU, including the workers
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : contents)
+    hash = (hash ^ c) * 1099511628211ull;
 
-  string str = oss.str();
-  const char *cstr = str.c_str();
+  string package = format("pyfmu_slave_{:016x}", hash);
+  string name = format("{}.{}", package, script.replace_extension("").string());
 
-  int err = PyCompat::PyRun_SimpleString(cstr);
+  PyObject *pModules = PyImport_GetModuleDict(); // borrowed
 
+  if (PyDict_GetItemString(pModules, package.c_str()) != nullptr)
+    return name;
 
-  if (err != 0)
-    throw runtime_error("Failed to append folder to python path\n");
+  // the package only serves as a namespace, its path points at the same folders as those appended to the Python path
+  path bytecode = find_bytecode_archive(resource_path);
+  PyObject *pPackage = PyModule_New(package.c_str());
+  PyObject *pPath = (pPackage != nullptr) ? PyList_New(0) : nullptr;
+
+  bool failed = (pPath == nullptr);
+
+  for (const path &entry : {bytecode, resource_path})
+  {
+    if (failed || entry.empty())
+      continue;
+
+    PyObject *pEntry = PyUnicode_DecodeFSDefault(entry.string().c_str());
+    failed = (pEntry == nullptr || PyList_Append(pPath, pEntry) != 0);
+    Py_XDECREF(pEntry);
+  }
+
+  failed = failed || PyObject_SetAttrString(pPackage, "__path__", pPath) != 0 || PyDict_SetItemString(pModules, package.c_str(), pPackage) != 0;
+
+  Py_XDECREF(pPath);
+  Py_XDECREF(pPackage);
+
+  if (failed)
+    throw runtime_error(format("Failed to create the package {} for the main script of the slave, Python error was:\n{}", package, get_py_exception()));
+
+  return name;
+}
+
+/**
+ * @brief Returns true if the bound method is the do_steps method defined by Fmi2Slave, rather than an override.
+ */
+static bool is_default_do_steps(PyObject *pMethod)
+{
+  PyObject *pFunction = PyObject_GetAttrString(pMethod, "__func__");
+  PyObject *pModule = PyImport_ImportModule("pyfmu.fmi2slave");
+  PyObject *pBase = (pModule != nullptr) ? PyObject_GetAttrString(pModule, "Fmi2Slave") : nullptr;
+  PyObject *pDefault = (pBase != nullptr) ? PyObject_GetAttrString(pBase, "do_steps") : nullptr;
+
+  bool isDefault = (pFunction != nullptr && pFunction == pDefault);
+
+  Py_XDECREF(pDefault);
+  Py_XDECREF(pBase);
+  Py_XDECREF(pModule);
+  Py_XDECREF(pFunction);
+  PyErr_Clear();
+
+  return isDefault;
 }
 
 void PyObjectWrapper::instantiate_main_class(string module_name,
@@ -96,133 +314,2238 @@ void PyObjectWrapper::instantiate_main_class(string module_name,
     throw runtime_error(msg);
   }
 
+  resolve_slave_methods();
+  attach_value_reference_table();
+
+  pDoSteps_ = PyObject_GetAttrString(pInstance_, "do_steps");
+
+  // the default implementation calls do_step for each step from Python, which is slower than doing so natively
+  if (pDoSteps_ == nullptr || is_default_do_steps(pDoSteps_))
+    Py_CLEAR(pDoSteps_);
+
+  PyErr_Clear();
+
+  PyObject *pBufferExchange = PyObject_GetAttrString(pInstance_, "__buffer_exchange__");
+
+  if (pBufferExchange == nullptr)
+    PyErr_Clear();
+  else
+  {
+    bufferExchange_ = (PyObject_IsTrue(pBufferExchange) == 1);
+    Py_DECREF(pBufferExchange);
+  }
+
+  views_ = make_unique<PyMemoryViews>();
+
+  if (bufferExchange_)
+    logger->ok("slave supports exchanging values through memoryviews\n");
+
+  attach_native_store();
+  attach_log_ring();
+  attach_log_filter();
+  attach_model_exchange();
+  attach_directional_derivatives();
+  attach_interpolation();
+
+  capture_initial_state();
+
   propagate_python_log_messages();
   this->logger->ok(format("Sucessfully created an instance of class: {} defined in module: {}\n", main_class, module_name));
 }
 
-PyObjectWrapper::PyObjectWrapper(path resource_path, Logger *logger) : logger(logger)
+void PyObjectWrapper::capture_initial_state()
 {
+  if (pMethods_[static_cast<size_t>(SlaveMethod::get_state)] == nullptr || pMethods_[static_cast<size_t>(SlaveMethod::set_state)] == nullptr)
+  {
+    logger->warning("The slave does not define get_state and set_state, fmi2Reset only calls the reset method of the slave and fmi2GetFMUstate fails\n");
+    return;
+  }
 
-  PyGIL g;
+  auto state = make_unique<FMUState>();
 
-  if (!Py_IsInitialized())
+  try
   {
-    throw runtime_error(
-        "The Python object cannot be instantiated due to the python intrepeter "
-        "not being instantiated. Ensure that Py_Initialize() is invoked "
-        "successfully prior to the invoking the constructor.");
+    capture_state(state.get());
+    initialState_ = move(state);
   }
+  catch (const exception &)
+  {
+    logger->warning("The state of the slave could not be captured after it was constructed, fmi2Reset only calls the reset method of the slave\n");
+  }
+}
 
-  logger->ok(format("appending path of resource folder to Python "
-                    "Interpreter, the specified path is: {}\n",
-                    resource_path.string()));
+void PyObjectWrapper::resolve_slave_methods()
+{
+  static_assert(size(slave_method_names) == static_cast<size_t>(SlaveMethod::n_methods));
+
+  for (size_t i = 0; i < pMethods_.size(); ++i)
+  {
+    pMethods_[i] = PyObject_GetAttrString(pInstance_, slave_method_names[i]);
 
-  append_resources_folder_to_python_path(resource_path);
+    // slaves created using older versions of pyfmu lack the optional methods, which are checked by their callers
+    if (pMethods_[i] == nullptr && i >= static_cast<size_t>(firstOptionalMethod))
+    {
+      PyErr_Clear();
+      continue;
+    }
 
-  logger->ok(format("Successfully appended resources directory to Python path\n"));
+    if (pMethods_[i] == nullptr)
+    {
+      auto pyErr = get_py_exception();
+      auto msg = format("The instance does not define the method: {}, ensure that the main class inherits from Fmi2Slave. Python error was:\n{}\n", slave_method_names[i], pyErr);
+      logger->fatal(msg);
+      throw runtime_error(msg);
+    }
+  }
+}
 
-  auto config_path = resource_path / "slave_configuration.json";
+void PyObjectWrapper::require(SlaveMethod method) const
+{
+  if (pMethods_[static_cast<size_t>(method)] != nullptr)
+    return;
 
-  logger->ok(format("Reading configuration file located at: {}\n", config_path.string()));
+  auto msg = format("The slave does not define the method: {}, which slaves created using older versions of pyfmu lack\n", slave_method_names[static_cast<size_t>(method)]);
+  logger->error(msg);
+  throw runtime_error(msg);
+}
 
-  try
+PyObject *PyObjectWrapper::call(SlaveMethod method, initializer_list<PyObject *> args) const
+{
+  if (states_pending() && !apply_pending_states())
+    return nullptr;
+
+  Profile::PhaseTimer t(profile_, Profile::Phase::python_call);
+  return PyCompat::PyObject_Vectorcall(pMethods_[static_cast<size_t>(method)], args.begin(), args.size());
+}
+
+/**
+ * @brief Read a sequence of value references returned by the slave.
+ */
+static vector<fmi2ValueReference> read_value_references(PyObject *sequence)
+{
+  Py_ssize_t n = PySequence_Size(sequence);
+
+  if (n < 0)
+    throw runtime_error(get_py_exception());
+
+  vector<fmi2ValueReference> vrs(n);
+
+  for (Py_ssize_t i = 0; i < n; ++i)
   {
-    auto config = read_configuration(config_path, logger);
+    PyObject *item = PySequence_GetItem(sequence, i);
+    vrs[i] = (item != nullptr) ? PyLong_AsUnsignedLong(item) : 0;
+    Py_XDECREF(item);
 
-    logger->ok(format("successfully read configuration file, specifying the following: main "
-                      "script is: {} and main class is: {}\n",
-                      config.main_script, config.main_class));
+    if (PyErr_Occurred())
+      throw runtime_error(get_py_exception());
+  }
+
+  return vrs;
+}
+
+void PyObjectWrapper::attach_value_reference_table()
+{
+  PyObject *pVrs = PyObject_CallMethod(pInstance_, "__value_references__", nullptr);
+
+  if (pVrs == nullptr)
+  {
+    PyErr_Clear();
+    return;
+  }
+
+  array<vector<fmi2ValueReference>, 4> vrs;
 
-    string module_name =
-        (path(config.main_script).filename().replace_extension("")).string();
+  try
+  {
+    for (size_t i = 0; i < vrs.size(); ++i)
+    {
+      PyObject *pTypeVrs = PySequence_GetItem(pVrs, i);
+
+      if (pTypeVrs == nullptr)
+        throw runtime_error(get_py_exception());
+
+      try
+      {
+        vrs[i] = read_value_references(pTypeVrs);
+      }
+      catch (...)
+      {
+        Py_DECREF(pTypeVrs);
+        throw;
+      }
+      Py_DECREF(pTypeVrs);
+    }
 
-    instantiate_main_class(module_name, config.main_class);
+    vrTable_ = make_unique<ValueReferenceTable>(vrs);
   }
   catch (const exception &e)
   {
-    logger->error(format("Failed to read configuration file, an expection was thrown:\n{}", e.what()));
-    throw;
+    Py_DECREF(pVrs);
+    auto msg = format("Failed to read the value references of the slave, __value_references__ returned an invalid value:\n{}\n", e.what());
+    logger->fatal(msg);
+    throw runtime_error(msg);
   }
+  Py_DECREF(pVrs);
 }
 
-PyObjectWrapper::PyObjectWrapper(PyObjectWrapper &&other) : pModule_(other.pModule_), pClass_(other.pClass_), pInstance_(other.pInstance_), logger(std::move(other.logger))
+void PyObjectWrapper::validate_value_references(ValueReferenceTable::Type type, const fmi2ValueReference *vr, size_t nvr) const
 {
+  if (vrTable_ == nullptr)
+    return;
+
+  size_t i = vrTable_->find_mismatch(type, vr, nvr);
+
+  if (i == nvr)
+    return;
+
+  auto msg = format("Variable with valueReference={} is not of type {}!\n", vr[i], type_name(type));
+  logger->error(msg);
+  throw runtime_error(msg);
 }
 
-void PyObjectWrapper::setupExperiment(double startTime)
+void PyObjectWrapper::attach_native_store()
 {
-  PyGIL g;
-  auto f =
-      PyObject_CallMethod(pInstance_, "setup_experiment", "(d)", startTime);
-      propagate_python_log_messages();
+  if (members_ > 1)
+  {
+    PyObject *pEnsemble = PyObject_GetAttrString(pInstance_, "__ensemble__");
+    bool ensemble = (pEnsemble != nullptr && PyObject_IsTrue(pEnsemble) == 1);
+    Py_XDECREF(pEnsemble);
+    PyErr_Clear();
+
+    if (!ensemble)
+    {
+      auto msg = format("The slave can not simulate an ensemble of {} members, its do_step must advance all members at once, which it declares by setting __ensemble__ = True\n", members_);
+      logger->fatal(msg);
+      throw runtime_error(msg);
+    }
+  }
+
+  PyObject *pLayout = PyObject_CallMethod(pInstance_, "__native_variables__", nullptr);
+
+  if (pLayout == nullptr)
+  {
+    PyErr_Clear();
+    return;
+  }
+
+  array<vector<fmi2ValueReference>, 3> vrs;
+
+  try
+  {
+    for (size_t i = 0; i < vrs.size(); ++i)
+    {
+      PyObject *pVrs = PySequence_GetItem(pLayout, i);
+
+      if (pVrs == nullptr)
+        throw runtime_error(get_py_exception());
+
+      try
+      {
+        vrs[i] = read_value_references(pVrs);
+      }
+      catch (...)
+      {
+        Py_DECREF(pVrs);
+        throw;
+      }
+      Py_DECREF(pVrs);
+    }
+  }
+  catch (const exception &e)
+  {
+    Py_DECREF(pLayout);
+    auto msg = format("Failed to read the layout of the natively stored variables, __native_variables__ returned an invalid value:\n{}\n", e.what());
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+  Py_DECREF(pLayout);
+
+  size_t n_variables = vrs[0].size() + vrs[1].size() + vrs[2].size();
+
+  if (n_variables == 0 && members_ > 1)
+  {
+    string msg = "The slave can not simulate an ensemble, the variables of its members must be stored natively\n";
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  if (n_variables == 0)
+    return;
+
+  store_ = make_unique<VariableStore>(vrs[0], vrs[1], vrs[2], members_);
+
+  storeViews_[0] = views_->shared(store_->reals().data(), store_->reals().size());
+  storeViews_[1] = views_->shared(store_->integers().data(), store_->integers().size());
+  storeViews_[2] = views_->shared(store_->booleans().data(), store_->booleans().size());
+
+  PyObject *f = nullptr;
+
+  // the number of members is only passed to slaves simulating an ensemble, such that those of older versions of pyfmu are called as before
+  if (storeViews_[0].view != nullptr && storeViews_[1].view != nullptr && storeViews_[2].view != nullptr)
+  {
+    if (members_ > 1)
+      f = PyObject_CallMethod(pInstance_, "__attach_native_store__", "(OOOn)", storeViews_[0].view, storeViews_[1].view, storeViews_[2].view, Py_ssize_t(members_));
+    else
+      f = PyObject_CallMethod(pInstance_, "__attach_native_store__", "(OOO)", storeViews_[0].view, storeViews_[1].view, storeViews_[2].view);
+  }
+
   if (f == nullptr)
   {
-    handle_py_exception();
+    auto pyErr = get_py_exception();
+    auto msg = format("Failed to attach the store of natively stored variables to the slave. Python error was:\n{}\n", pyErr);
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+  Py_DECREF(f);
+
+  if (members_ > 1)
+    logger->ok(format("{} variables are stored natively for each of the {} members of the ensemble\n", n_variables, members_));
+  else
+    logger->ok(format("{} variables are stored natively\n", n_variables));
+}
+
+void PyObjectWrapper::attach_log_ring()
+{
+  PyObject *pAttach = PyObject_GetAttrString(pInstance_, "__attach_log_ring__");
+
+  if (pAttach == nullptr)
+  {
+    PyErr_Clear();
+    return;
+  }
+
+  auto ring = make_unique<LogRing>();
+
+  logViews_[0] = views_->shared(ring->indices(), LogRing::nIndices);
+  logViews_[1] = views_->sharedBytes(ring->data(), LogRing::capacity);
+
+  PyObject *f = nullptr;
+
+  if (logViews_[0].view != nullptr && logViews_[1].view != nullptr)
+  {
+    PyObject *args[] = {logViews_[0].view, logViews_[1].view};
+    f = PyCompat::PyObject_Vectorcall(pAttach, args, 2);
+  }
+
+  Py_DECREF(pAttach);
+
+  if (f == nullptr)
+  {
+    auto pyErr = get_py_exception();
+    auto msg = format("Failed to attach the log ring to the slave. Python error was:\n{}\n", pyErr);
+    logger->fatal(msg);
+    throw runtime_error(msg);
   }
   Py_DECREF(f);
+
+  logRing_ = move(ring);
 }
 
-void PyObjectWrapper::enterInitializationMode()
-{
+void PyObjectWrapper::attach_log_filter()
+{
+  PyObject *pCategories = PyObject_CallMethod(pInstance_, "__log_categories__", nullptr);
+
+  if (pCategories == nullptr)
+  {
+    PyErr_Clear();
+    return;
+  }
+
+  PyObject *pIds = nullptr;
+  Py_ssize_t n = PySequence_Size(pCategories);
+
+  if (n >= 0)
+    pIds = PyList_New(n);
+
+  for (Py_ssize_t i = 0; pIds != nullptr && i < n; ++i)
+  {
+    PyObject *pName = PySequence_GetItem(pCategories, i);
+    PyObject *pUtf8 = (pName != nullptr) ? PyUnicode_AsUTF8String(pName) : nullptr;
+    Py_XDECREF(pName);
+
+    if (pUtf8 == nullptr)
+    {
+      Py_CLEAR(pIds);
+      break;
+    }
+
+    string name = PyBytes_AsString(pUtf8);
+    Py_DECREF(pUtf8);
+
+    size_t id = logger->intern(name);
+
+    // categories without an id are never active
+    if (id == Logger::noCategory)
+    {
+      logger->warning(format("The log category {} can not be activated, no more than {} categories are supported\n", name, Logger::maxCategories));
+      Py_INCREF(Py_None);
+      PyList_SetItem(pIds, i, Py_None);
+    }
+    else
+      PyList_SetItem(pIds, i, PyLong_FromSize_t(id));
+  }
+  Py_DECREF(pCategories);
+
+  PyObject *f = nullptr;
+
+  if (pIds != nullptr)
+  {
+    activeWords_ = logger->activeWords();
+    filterView_ = views_->shared(activeWords_->data(), Logger::nActiveWords);
+
+    if (filterView_.view != nullptr)
+      f = PyObject_CallMethod(pInstance_, "__attach_log_filter__", "(OO)", filterView_.view, pIds);
+
+    Py_DECREF(pIds);
+  }
+
+  if (f == nullptr)
+  {
+    auto pyErr = get_py_exception();
+    auto msg = format("Failed to attach the active log categories to the slave. Python error was:\n{}\n", pyErr);
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+  Py_DECREF(f);
+}
+
+template <typename T>
+PyObject *PyObjectWrapper::call_with_views(SlaveMethod method, const fmi2ValueReference *vr, size_t nvr, T *values) const
+{
+  PyObject *vrs = views_->view(vr, nvr);
+  PyObject *refs = views_->view(values, nvr);
+
+  if (vrs == nullptr || refs == nullptr)
+  {
+    Py_XDECREF(vrs);
+    Py_XDECREF(refs);
+    return nullptr;
+  }
+
+  auto f = call(method, {vrs, refs});
+
+  PyObject *views[] = {vrs, refs};
+  views_->release(views, slave_method_names[static_cast<size_t>(method)], logger);
+
+  return f;
+}
+
+void PyObjectWrapper::attach_model_exchange()
+{
+  PyObject *pModelExchange = PyObject_CallMethod(pInstance_, "__model_exchange__", nullptr);
+
+  if (pModelExchange == nullptr)
+  {
+    PyErr_Clear();
+    return;
+  }
+
+  if (pModelExchange == Py_None)
+  {
+    Py_DECREF(pModelExchange);
+    return;
+  }
+
+  // (states, number of event indicators)
+  PyObject *pStates = PySequence_GetItem(pModelExchange, 0);
+  PyObject *pIndicators = (pStates != nullptr) ? PySequence_GetItem(pModelExchange, 1) : nullptr;
+  Py_ssize_t nStates = (pIndicators != nullptr) ? PySequence_Size(pStates) : -1;
+  size_t nEventIndicators = (nStates >= 0) ? PyLong_AsSize_t(pIndicators) : 0;
+
+  Py_XDECREF(pIndicators);
+  Py_XDECREF(pStates);
+  Py_DECREF(pModelExchange);
+
+  if (PyErr_Occurred())
+  {
+    auto pyErr = get_py_exception();
+    auto msg = format("The slave reported invalid continuous states or event indicators. Python error was:\n{}\n", pyErr);
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  for (size_t i = static_cast<size_t>(firstModelExchangeMethod); i < static_cast<size_t>(SlaveMethod::evaluate_outputs); ++i)
+  {
+    if (pMethods_[i] == nullptr)
+    {
+      auto msg = format("The slave registered continuous states or event indicators, but does not define the method: {}\n", slave_method_names[i]);
+      logger->fatal(msg);
+      throw runtime_error(msg);
+    }
+  }
+
+  nStates_ = nStates;
+  nEventIndicators_ = nEventIndicators;
+  continuousStates_.resize(nStates_);
+
+  statesView_ = views_->shared(static_cast<const fmi2Real *>(continuousStates_.data()), nStates_);
+
+  if (statesView_.view == nullptr)
+  {
+    auto msg = format("Failed to create the view of the continuous states. Python error was:\n{}\n", get_py_exception());
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  modelExchange_ = true;
+  logger->ok(format("slave provides Model Exchange with {} continuous states and {} event indicators\n", nStates_, nEventIndicators_));
+
+  // slaves created using older versions of pyfmu do not report the value references of their states
+  PyObject *pStateVrs = PyObject_CallMethod(pInstance_, "__state_value_references__", nullptr);
+
+  if (pStateVrs == nullptr)
+  {
+    PyErr_Clear();
+    return;
+  }
+
+  vector<fmi2ValueReference> stateVrs;
+
+  try
+  {
+    stateVrs = read_value_references(pStateVrs);
+    Py_DECREF(pStateVrs);
+  }
+  catch (const exception &e)
+  {
+    Py_DECREF(pStateVrs);
+    auto msg = format("The slave reported invalid value references of its continuous states. Python error was:\n{}\n", e.what());
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  if (stateVrs.size() != nStates_)
+  {
+    auto msg = format("The slave reported the value references of {} continuous states, but has {} states\n", stateVrs.size(), nStates_);
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  for (size_t i = 0; i < nStates_; ++i)
+    stateIndices_.emplace(stateVrs[i], i);
+}
+
+void PyObjectWrapper::attach_directional_derivatives()
+{
+  PyObject *pDirectional = PyObject_CallMethod(pInstance_, "__directional_derivatives__", nullptr);
+
+  if (pDirectional == nullptr)
+  {
+    PyErr_Clear();
+    return;
+  }
+
+  // (overrides get_directional_derivative, {unknown: [knowns]}, overrides evaluate_outputs), of which older versions of pyfmu return the first two
+  PyObject *pAnalytic = PySequence_GetItem(pDirectional, 0);
+  PyObject *pDependencies = (pAnalytic != nullptr) ? PySequence_GetItem(pDirectional, 1) : nullptr;
+  PyObject *pItems = (pDependencies != nullptr) ? PyMapping_Items(pDependencies) : nullptr;
+  bool analytic = (pItems != nullptr) && PyObject_IsTrue(pAnalytic) == 1;
+
+  if (pItems != nullptr && PySequence_Size(pDirectional) > 2)
+  {
+    PyObject *pEvaluates = PySequence_GetItem(pDirectional, 2);
+    evaluatesOutputs_ = (pEvaluates != nullptr) && PyObject_IsTrue(pEvaluates) == 1;
+    Py_XDECREF(pEvaluates);
+  }
+
+  for (Py_ssize_t i = 0; pItems != nullptr && i < PyList_Size(pItems) && !PyErr_Occurred(); ++i)
+  {
+    PyObject *pItem = PyList_GetItem(pItems, i);
+    PyObject *pUnknown = PyTuple_GetItem(pItem, 0);
+    PyObject *pKnowns = PyTuple_GetItem(pItem, 1);
+
+    auto &knowns = dependencies_[PyLong_AsUnsignedLong(pUnknown)];
+    Py_ssize_t n = PySequence_Size(pKnowns);
+
+    for (Py_ssize_t j = 0; j < n && !PyErr_Occurred(); ++j)
+    {
+      PyObject *pKnown = PySequence_GetItem(pKnowns, j);
+      if (pKnown != nullptr)
+        knowns.push_back(PyLong_AsUnsignedLong(pKnown));
+      Py_XDECREF(pKnown);
+    }
+  }
+
+  Py_XDECREF(pItems);
+  Py_XDECREF(pDependencies);
+  Py_XDECREF(pAnalytic);
+  Py_DECREF(pDirectional);
+
+  if (PyErr_Occurred())
+  {
+    auto msg = format("The slave reported invalid dependencies. Python error was:\n{}\n", get_py_exception());
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  if (analytic)
+  {
+    pDirectionalDerivative_ = PyObject_GetAttrString(pInstance_, "get_directional_derivative");
+
+    if (pDirectionalDerivative_ == nullptr)
+    {
+      auto msg = format("Failed to resolve get_directional_derivative. Python error was:\n{}\n", get_py_exception());
+      logger->fatal(msg);
+      throw runtime_error(msg);
+    }
+  }
+
+  if (analytic || evaluatesOutputs_ || modelExchange_)
+    logger->ok(format("slave provides {} directional derivatives, the dependencies of {} unknowns are declared\n",
+                      analytic ? "analytic" : "approximated", dependencies_.size()));
+  else
+    logger->ok("slave does not provide directional derivatives, it overrides neither get_directional_derivative nor evaluate_outputs\n");
+}
+
+void PyObjectWrapper::attach_interpolation()
+{
+  PyObject *pInterpolation = PyObject_CallMethod(pInstance_, "__interpolation__", nullptr);
+
+  if (pInterpolation == nullptr)
+  {
+    PyErr_Clear();
+    return;
+  }
+
+  // (inputs, overrides get_real_output_derivatives, max order, outputs), of which older versions of pyfmu return the first three
+  PyObject *pInputs = PySequence_GetItem(pInterpolation, 0);
+  PyObject *pProvided = (pInputs != nullptr) ? PySequence_GetItem(pInterpolation, 1) : nullptr;
+  PyObject *pOrder = (pProvided != nullptr) ? PySequence_GetItem(pInterpolation, 2) : nullptr;
+  PyObject *pOutputs = (pOrder != nullptr && PySequence_Size(pInterpolation) > 3) ? PySequence_GetItem(pInterpolation, 3) : nullptr;
+
+  vector<fmi2ValueReference> inputs;
+  bool provided = false;
+
+  try
+  {
+    if (pOrder == nullptr)
+      throw runtime_error(get_py_exception());
+
+    inputs = read_value_references(pInputs);
+    provided = PyObject_IsTrue(pProvided) == 1;
+    maxOutputDerivativeOrder_ = PyLong_AsLong(pOrder);
+
+    if (PyErr_Occurred())
+      throw runtime_error(get_py_exception());
+
+    // the history is only needed to estimate the derivatives
+    if (pOutputs != nullptr && !provided && maxOutputDerivativeOrder_ > 0)
+    {
+      realOutputs_ = read_value_references(pOutputs);
+      sort(realOutputs_.begin(), realOutputs_.end());
+    }
+  }
+  catch (const exception &e)
+  {
+    Py_XDECREF(pOutputs);
+    Py_XDECREF(pOrder);
+    Py_XDECREF(pProvided);
+    Py_XDECREF(pInputs);
+    Py_DECREF(pInterpolation);
+
+    auto msg = format("The slave reported invalid interpolation capabilities. Python error was:\n{}\n", e.what());
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  Py_XDECREF(pOutputs);
+  Py_DECREF(pOrder);
+  Py_DECREF(pProvided);
+  Py_DECREF(pInputs);
+  Py_DECREF(pInterpolation);
+
+  for (auto vr : inputs)
+    inputDerivatives_.emplace(vr, vector<fmi2Real>{});
+
+  if (provided)
+  {
+    pOutputDerivatives_ = PyObject_GetAttrString(pInstance_, "get_real_output_derivatives");
+
+    if (pOutputDerivatives_ == nullptr)
+    {
+      auto msg = format("Failed to resolve get_real_output_derivatives. Python error was:\n{}\n", get_py_exception());
+      logger->fatal(msg);
+      throw runtime_error(msg);
+    }
+  }
+
+  logger->ok(format("slave interpolates {} inputs and provides {} derivatives of its outputs up to order {}\n",
+                    inputs.size(), provided ? "analytic" : "estimated", maxOutputDerivativeOrder_));
+}
+
+void PyObjectWrapper::pass_input_derivatives(double currentTime)
+{
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+  PyObject *pDerivatives = PyDict_New();
+
+  for (auto &[vr, derivatives] : inputDerivatives_)
+  {
+    if (derivatives.empty())
+      continue;
+
+    PyObject *pVr = PyLong_FromUnsignedLong(vr);
+    PyObject *pValues = PyList_New(derivatives.size());
+
+    for (size_t i = 0; i < derivatives.size(); ++i)
+      PyList_SetItem(pValues, i, PyFloat_FromDouble(derivatives[i]));
+
+    PyDict_SetItem(pDerivatives, pVr, pValues);
+    Py_DECREF(pVr);
+    Py_DECREF(pValues);
+
+    derivatives.clear();
+  }
+
+  marshal.stop();
+
+  inputDerivativesPassed_ = inputDerivativesPending_;
+  inputDerivativesPending_ = false;
+
+  PyObject *f = nullptr;
+  {
+    Profile::PhaseTimer t(profile_, Profile::Phase::python_call);
+    f = PyObject_CallMethod(pInstance_, "__set_input_derivatives__", "(dO)", currentTime, pDerivatives);
+  }
+  Py_DECREF(pDerivatives);
+
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+}
+
+void PyObjectWrapper::call_output_derivatives(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *order, fmi2Real *value)
+{
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+  PyObject *args[] = {
+      views_->view(vr, nvr),
+      views_->view(order, nvr),
+      views_->view(value, nvr)};
+
+  marshal.stop();
+
+  PyObject *f = nullptr;
+
+  if (all_of(begin(args), end(args), [](PyObject *arg) { return arg != nullptr; }))
+  {
+    Profile::PhaseTimer t(profile_, Profile::Phase::python_call);
+    f = PyCompat::PyObject_Vectorcall(pOutputDerivatives_, args, size(args));
+  }
+
+  views_->release(args, "get_real_output_derivatives", logger);
+
+  propagate_python_log_messages();
+
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+}
+
+/**
+ * @brief Returns the order-th derivative, at the last time, of the polynomial interpolating the values at the times, 0 if there are too few values.
+ */
+static double interpolated_derivative(const vector<double> &times, const vector<double> &values, size_t order)
+{
+  size_t n = times.size();
+
+  if (n <= order)
+    return 0;
+
+  // the polynomial is expressed in x = t - times[n - 1], its Newton form is built from the newest value backwards
+  vector<double> x(n), c(values.rbegin(), values.rend());
+  for (size_t i = 0; i < n; ++i)
+    x[i] = times[n - 1 - i] - times[n - 1];
+
+  for (size_t j = 1; j < n; ++j)
+  {
+    for (size_t i = n - 1; i >= j; --i)
+      c[i] = (c[i] - c[i - 1]) / (x[i] - x[i - j]);
+  }
+
+  // expand the Newton form into the coefficients of the powers of x, the order-th of which is the derivative divided by order!
+  vector<double> monomial(n, 0.0), basis(n, 0.0);
+  basis[0] = 1;
+
+  for (size_t j = 0; j < n; ++j)
+  {
+    for (size_t k = 0; k <= j; ++k)
+      monomial[k] += c[j] * basis[k];
+
+    if (j + 1 < n)
+    {
+      for (size_t k = j + 1; k > 0; --k)
+        basis[k] = basis[k - 1] - x[j] * basis[k];
+      basis[0] *= -x[j];
+    }
+  }
+
+  double factorial = 1;
+  for (size_t k = 2; k <= order; ++k)
+    factorial *= k;
+
+  return factorial * monomial[order];
+}
+
+void PyObjectWrapper::setRealInputDerivatives(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *order, const fmi2Real *value)
+{
+  for (size_t i = 0; i < nvr; ++i)
+  {
+    auto it = inputDerivatives_.find(vr[i]);
+
+    if (it == inputDerivatives_.end())
+      throw runtime_error(format("The value reference {} is not that of an interpolated Real input, the slave must set __interpolates_inputs__ = True", vr[i]));
+
+    if (order[i] < 1)
+      throw runtime_error(format("The order of the derivative of the input {} must be at least 1, it was {}", vr[i], order[i]));
+  }
+
+  for (size_t i = 0; i < nvr; ++i)
+  {
+    auto &derivatives = inputDerivatives_[vr[i]];
+
+    // lower orders which are not set are 0
+    if (derivatives.size() < size_t(order[i]))
+      derivatives.resize(order[i], 0.0);
+
+    derivatives[order[i] - 1] = value[i];
+  }
+
+  inputDerivativesPending_ = inputDerivativesPending_ || nvr > 0;
+}
+
+void PyObjectWrapper::getRealOutputDerivatives(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *order, fmi2Real *value)
+{
+  validate_value_references(ValueReferenceTable::Type::real, vr, nvr);
+
+  for (size_t i = 0; i < nvr; ++i)
+  {
+    if (order[i] < 1 || order[i] > maxOutputDerivativeOrder_)
+      throw runtime_error(format("The derivative of order {} of the output {} is not provided, the highest order is {}", order[i], vr[i], maxOutputDerivativeOrder_));
+  }
+
+  if (pOutputDerivatives_ != nullptr)
+  {
+    call_output_derivatives(vr, nvr, order, value);
+    return;
+  }
+
+  // the outputs were recorded by the last step, but may since have changed with inputs having direct feedthrough
+  vector<fmi2Real> current(nvr);
+  getReal(vr, nvr, current.data());
+
+  for (size_t i = 0; i < nvr; ++i)
+  {
+    record_output(vr[i], lastSuccessfulTime_, current[i]);
+
+    auto &history = outputHistory_[vr[i]];
+    value[i] = interpolated_derivative(history.times, history.values, order[i]);
+  }
+}
+
+void PyObjectWrapper::record_output(fmi2ValueReference vr, double time, fmi2Real value)
+{
+  auto &history = outputHistory_[vr];
+
+  if (!history.times.empty() && history.times.back() == time)
+  {
+    history.values.back() = value;
+    return;
+  }
+
+  if (!history.times.empty() && history.times.back() > time)
+  {
+    history.times.clear();
+    history.values.clear();
+  }
+
+  history.times.push_back(time);
+  history.values.push_back(value);
+
+  if (history.times.size() > size_t(maxOutputDerivativeOrder_) + 1)
+  {
+    history.times.erase(history.times.begin());
+    history.values.erase(history.values.begin());
+  }
+}
+
+void PyObjectWrapper::record_outputs()
+{
+  if (realOutputs_.empty())
+    return;
+
+  vector<fmi2Real> values(realOutputs_.size());
+  getReal(realOutputs_.data(), realOutputs_.size(), values.data());
+
+  for (size_t i = 0; i < realOutputs_.size(); ++i)
+    record_output(realOutputs_[i], lastSuccessfulTime_, values[i]);
+}
+
+const JacobianColoring &PyObjectWrapper::jacobian_coloring(const fmi2ValueReference *unknowns, size_t nUnknowns,
+                                                           const fmi2ValueReference *knowns, size_t nKnowns)
+{
+  if (jacobianColoring_ != nullptr &&
+      equal(unknowns, unknowns + nUnknowns, jacobianUnknowns_.begin(), jacobianUnknowns_.end()) &&
+      equal(knowns, knowns + nKnowns, jacobianKnowns_.begin(), jacobianKnowns_.end()))
+    return *jacobianColoring_;
+
+  unordered_map<fmi2ValueReference, size_t> columns;
+  for (size_t j = 0; j < nKnowns; ++j)
+    columns.emplace(knowns[j], j);
+
+  vector<vector<size_t>> rows(nUnknowns);
+
+  for (size_t i = 0; i < nUnknowns; ++i)
+  {
+    auto it = dependencies_.find(unknowns[i]);
+
+    // an unknown without declared dependencies may depend on every known
+    if (it == dependencies_.end())
+    {
+      rows[i].resize(nKnowns);
+      iota(rows[i].begin(), rows[i].end(), 0);
+      continue;
+    }
+
+    for (auto known : it->second)
+    {
+      if (auto column = columns.find(known); column != columns.end())
+        rows[i].push_back(column->second);
+    }
+  }
+
+  jacobianColoring_ = make_unique<JacobianColoring>(move(rows), nKnowns);
+  jacobianUnknowns_.assign(unknowns, unknowns + nUnknowns);
+  jacobianKnowns_.assign(knowns, knowns + nKnowns);
+
+  logger->ok(format("The Jacobian of {} unknowns with respect to {} knowns is assembled from {} directional derivatives\n",
+                    nUnknowns, nKnowns, jacobianColoring_->nColors()));
+
+  return *jacobianColoring_;
+}
+
+void PyObjectWrapper::call_directional_derivative(const fmi2ValueReference *unknowns, size_t nUnknowns,
+                                                  const fmi2ValueReference *knowns, size_t nKnowns,
+                                                  const fmi2Real *seed, fmi2Real *sensitivity)
+{
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  if (states_pending() && !apply_pending_states())
+    handle_py_exception();
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+  PyObject *args[] = {
+      views_->view(unknowns, nUnknowns),
+      views_->view(knowns, nKnowns),
+      views_->view(seed, nKnowns),
+      views_->view(sensitivity, nUnknowns)};
+
+  marshal.stop();
+
+  PyObject *f = nullptr;
+
+  if (all_of(begin(args), end(args), [](PyObject *arg) { return arg != nullptr; }))
+  {
+    Profile::PhaseTimer t(profile_, Profile::Phase::python_call);
+    f = PyCompat::PyObject_Vectorcall(pDirectionalDerivative_, args, size(args));
+  }
+
+  views_->release(args, "get_directional_derivative", logger);
+
+  propagate_python_log_messages();
+
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+}
+
+void PyObjectWrapper::evaluate_unknowns(const fmi2ValueReference *unknowns, size_t nUnknowns, const fmi2Real *states, fmi2Real *values)
+{
+  if (modelExchange_ && nStates_ > 0)
+  {
+    // the states are pending, as such the slave evaluates the derivatives using evaluate_derivatives
+    if (states != nullptr)
+      setContinuousStates(states, nStates_);
+
+    vector<fmi2Real> derivatives(nStates_);
+    getDerivatives(derivatives.data(), nStates_);
+  }
+
+  if (evaluatesOutputs_)
+  {
+    PyGIL g(subInterpreter_.get(), profile_);
+
+    auto f = call(SlaveMethod::evaluate_outputs);
+    propagate_python_log_messages();
+
+    if (f == nullptr)
+    {
+      handle_py_exception();
+    }
+    Py_DECREF(f);
+  }
+
+  getReal(unknowns, nUnknowns, values);
+}
+
+void PyObjectWrapper::require_evaluable_unknowns() const
+{
+  // the outputs of other slaves are only computed by their steps, as such perturbing the inputs would not change them
+  if (!modelExchange_ && !evaluatesOutputs_)
+  {
+    string msg = "The slave can not approximate directional derivatives, as its outputs are only computed by do_step. Override get_directional_derivative or evaluate_outputs\n";
+    logger->error(msg);
+    throw runtime_error(msg);
+  }
+}
+
+void PyObjectWrapper::forward_differences(const fmi2ValueReference *unknowns, size_t nUnknowns,
+                                          const fmi2ValueReference *knowns, size_t nKnowns, const fmi2Real *x0, size_t nDirections,
+                                          const function<void(size_t, fmi2Real *)> &direction,
+                                          const function<void(size_t, const fmi2Real *)> &difference)
+{
+  if (unperturbedState_ == nullptr)
+    unperturbedState_ = make_unique<FMUState>();
+
+  {
+    PyGIL g(subInterpreter_.get(), profile_);
+    capture_state(unperturbedState_.get());
+  }
+
+  auto restore = [this]() {
+    PyGIL g(subInterpreter_.get(), profile_);
+    restore_state(unperturbedState_.get());
+    clear_state(unperturbedState_.get());
+  };
+
+  vector<fmi2Real> x(nKnowns), y0(nUnknowns), y(nUnknowns);
+
+  // knowns which are continuous states are perturbed in the vector of states, the others are set as variables
+  vector<size_t> inputs;
+  vector<pair<size_t, size_t>> perturbedStates;
+
+  for (size_t j = 0; j < nKnowns; ++j)
+  {
+    if (auto it = stateIndices_.find(knowns[j]); it != stateIndices_.end())
+      perturbedStates.emplace_back(j, it->second);
+    else
+      inputs.push_back(j);
+  }
+
+  vector<fmi2ValueReference> inputVrs(inputs.size());
+  vector<fmi2Real> inputValues(inputs.size());
+
+  for (size_t n = 0; n < inputs.size(); ++n)
+    inputVrs[n] = knowns[inputs[n]];
+
+  // the unperturbed unknowns are evaluated the same way, such that they only differ by the perturbation
+  bool setsStates = modelExchange_ && nStates_ > 0 && !stateIndices_.empty();
+  vector<fmi2Real> states;
+
+  try
+  {
+    if (setsStates)
+    {
+      states.resize(nStates_);
+      getContinuousStates(states.data(), nStates_);
+    }
+
+    evaluate_unknowns(unknowns, nUnknowns, setsStates ? states.data() : nullptr, y0.data());
+
+    for (size_t k = 0; k < nDirections; ++k)
+    {
+      direction(k, x.data());
+      for (size_t j = 0; j < nKnowns; ++j)
+        x[j] += x0[j];
+
+      for (size_t n = 0; n < inputs.size(); ++n)
+        inputValues[n] = x[inputs[n]];
+
+      // set first, setting variables passes pending states to the slave
+      if (!inputs.empty())
+        setReal(inputVrs.data(), inputVrs.size(), inputValues.data());
+
+      for (auto [j, i] : perturbedStates)
+        states[i] = x[j];
+
+      evaluate_unknowns(unknowns, nUnknowns, setsStates ? states.data() : nullptr, y.data());
+
+      for (size_t i = 0; i < nUnknowns; ++i)
+        y[i] -= y0[i];
+
+      difference(k, y.data());
+    }
+  }
+  catch (const exception &)
+  {
+    restore();
+    throw;
+  }
+
+  restore();
+}
+
+void PyObjectWrapper::getDirectionalDerivative(const fmi2ValueReference *unknowns, size_t nUnknowns,
+                                               const fmi2ValueReference *knowns, size_t nKnowns,
+                                               const fmi2Real *seed, fmi2Real *sensitivity)
+{
+  validate_value_references(ValueReferenceTable::Type::real, unknowns, nUnknowns);
+  validate_value_references(ValueReferenceTable::Type::real, knowns, nKnowns);
+
+  if (pDirectionalDerivative_ != nullptr)
+  {
+    call_directional_derivative(unknowns, nUnknowns, knowns, nKnowns, seed, sensitivity);
+    return;
+  }
+
+  require_evaluable_unknowns();
+
+  vector<fmi2Real> x0(nKnowns);
+  getReal(knowns, nKnowns, x0.data());
+
+  double norm = 0;
+  double scale = 1;
+  for (size_t j = 0; j < nKnowns; ++j)
+  {
+    norm = std::max(norm, abs(seed[j]));
+    scale = std::max(scale, abs(x0[j]));
+  }
+
+  if (norm == 0)
+  {
+    fill(sensitivity, sensitivity + nUnknowns, 0.0);
+    return;
+  }
+
+  // the step balances the truncation error of the difference against the rounding error of the unknowns
+  double h = sqrt(numeric_limits<double>::epsilon()) * scale / norm;
+
+  forward_differences(
+      unknowns, nUnknowns, knowns, nKnowns, x0.data(), 1,
+      [&](size_t, fmi2Real *dx) {
+        for (size_t j = 0; j < nKnowns; ++j)
+          dx[j] = h * seed[j];
+      },
+      [&](size_t, const fmi2Real *dy) {
+        for (size_t i = 0; i < nUnknowns; ++i)
+          sensitivity[i] = dy[i] / h;
+      });
+}
+
+void PyObjectWrapper::getJacobian(const fmi2ValueReference *unknowns, size_t nUnknowns,
+                                  const fmi2ValueReference *knowns, size_t nKnowns, fmi2Real *jacobian)
+{
+  validate_value_references(ValueReferenceTable::Type::real, unknowns, nUnknowns);
+  validate_value_references(ValueReferenceTable::Type::real, knowns, nKnowns);
+
+  auto &coloring = jacobian_coloring(unknowns, nUnknowns, knowns, nKnowns);
+  fill(jacobian, jacobian + nUnknowns * nKnowns, 0.0);
+
+  vector<fmi2Real> steps(nKnowns, 1.0);
+  vector<fmi2Real> seed(nKnowns), sensitivity(nUnknowns);
+
+  if (pDirectionalDerivative_ != nullptr)
+  {
+    for (size_t color = 0; color < coloring.nColors(); ++color)
+    {
+      coloring.direction(color, steps.data(), seed.data());
+      call_directional_derivative(unknowns, nUnknowns, knowns, nKnowns, seed.data(), sensitivity.data());
+      coloring.scatter(color, steps.data(), sensitivity.data(), jacobian);
+    }
+    return;
+  }
+
+  require_evaluable_unknowns();
+
+  vector<fmi2Real> x0(nKnowns);
+  getReal(knowns, nKnowns, x0.data());
+
+  for (size_t j = 0; j < nKnowns; ++j)
+    steps[j] = sqrt(numeric_limits<double>::epsilon()) * std::max(abs(x0[j]), 1.0);
+
+  forward_differences(
+      unknowns, nUnknowns, knowns, nKnowns, x0.data(), coloring.nColors(),
+      [&](size_t color, fmi2Real *dx) { coloring.direction(color, steps.data(), dx); },
+      [&](size_t color, const fmi2Real *dy) { coloring.scatter(color, steps.data(), dy, jacobian); });
+}
+
+void PyObjectWrapper::require_model_exchange(size_t n, size_t expected, const char *what) const
+{
+  if (!modelExchange_)
+    throw runtime_error("The slave does not provide Model Exchange");
+
+  if (n != expected)
+  {
+    auto msg = format("The slave has {} {}, but {} were passed\n", expected, what, n);
+    logger->error(msg);
+    throw runtime_error(msg);
+  }
+}
+
+bool PyObjectWrapper::apply_pending_states() const
+{
+  // cleared first, since the calls below are made through call as well
+  bool time = timePending_;
+  bool states = statesPending_;
+  timePending_ = statesPending_ = false;
+
+  if (time)
+  {
+    PyObject *pTime = PyFloat_FromDouble(time_);
+    PyObject *f = (pTime != nullptr) ? call(SlaveMethod::set_time, {pTime}) : nullptr;
+    Py_XDECREF(pTime);
+
+    if (f == nullptr)
+      return false;
+    Py_DECREF(f);
+  }
+
+  if (states)
+  {
+    PyObject *f = call(SlaveMethod::set_continuous_states, {statesView_.view});
+
+    if (f == nullptr)
+      return false;
+    Py_DECREF(f);
+  }
+
+  return true;
+}
+
+PyObject *PyObjectWrapper::call_with_view(SlaveMethod method, fmi2Real *values, size_t n) const
+{
+  PyObject *pValues = views_->view(values, n);
+
+  if (pValues == nullptr)
+    return nullptr;
+
+  auto f = call(method, {pValues});
+
+  views_->release({&pValues, 1}, slave_method_names[static_cast<size_t>(method)], logger);
+
+  return f;
+}
+
+PyObjectWrapper::PyObjectWrapper(path resource_path, Logger *logger)
+    : PyObjectWrapper(resource_path, read_slave_configuration(resource_path, logger), logger)
+{
+}
+
+PyObjectWrapper::PyObjectWrapper(path resource_path, const PyConfiguration &config, Logger *logger, size_t members) : members_(members), logger(logger)
+{
+
+  if (!Py_IsInitialized())
+  {
+    throw runtime_error(
+        "The Python object cannot be instantiated due to the python intrepeter "
+        "not being instantiated. Ensure that Py_Initialize() is invoked "
+        "successfully prior to the invoking the constructor.");
+  }
+
+  if (config.interpreter == "isolated")
+    subInterpreter_ = make_unique<PySubInterpreter>(logger);
+
+  PyGIL g(subInterpreter_.get());
+
+  extend_python_path(resource_path, logger);
+
+  instantiate_main_class(module_name(resource_path, config), config.main_class);
+}
+
+void PyObjectWrapper::preload(const path &resource_path, Logger *logger)
+{
+  auto config = read_slave_configuration(resource_path, logger);
+
+  PyGIL g;
+
+  extend_python_path(resource_path, logger);
+
+  auto name = module_name(resource_path, config);
+  logger->ok(format("preloading Python module: {}\n", name));
+
+  // the modules are kept alive by sys.modules
+  PyObject *pModule = PyImport_ImportModule(name.c_str());
+  PyObject *pBase = (pModule != nullptr) ? PyImport_ImportModule("pyfmu.fmi2slave") : nullptr;
+
+  if (pBase == nullptr)
+  {
+    Py_XDECREF(pModule);
+    auto msg = format("module {} could not be imported. Error from python was:\n{}", name, get_py_exception());
+    logger->fatal(msg);
+    throw runtime_error(msg);
+  }
+
+  Py_DECREF(pBase);
+  Py_DECREF(pModule);
+}
+
+void PyObjectWrapper::setupExperiment(double startTime)
+{
+  PyGIL g(subInterpreter_.get(), profile_);
+  PyObject *pStartTime = PyFloat_FromDouble(startTime);
+  auto f = call(SlaveMethod::setup_experiment, {pStartTime});
+  Py_DECREF(pStartTime);
+  propagate_python_log_messages();
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+  lastSuccessfulTime_ = startTime;
+}
+
+void PyObjectWrapper::enterInitializationMode()
+{
+
+  PyGIL g(subInterpreter_.get(), profile_);
+  auto f = call(SlaveMethod::enter_initialization_mode);
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+}
+
+void PyObjectWrapper::exitInitializationMode()
+{
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  auto f = call(SlaveMethod::exit_initialization_mode);
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+
+  // the outputs at the start time
+  record_outputs();
+}
+
+bool PyObjectWrapper::doStep(double currentTime, double stepSize)
+{
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  if (inputDerivativesPending_ || inputDerivativesPassed_)
+    pass_input_derivatives(currentTime);
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+  PyObject *pCurrentTime = PyFloat_FromDouble(currentTime);
+  PyObject *pStepSize = PyFloat_FromDouble(stepSize);
+  marshal.stop();
+
+  auto f = call(SlaveMethod::do_step, {pCurrentTime, pStepSize});
+  Py_DECREF(pCurrentTime);
+  Py_DECREF(pStepSize);
+
+  if (f == nullptr)
+  {
+    std::string err = get_py_exception();
+    logger->error(format("FMI2 do step failed due to Python error:\n{}",err));
+    propagate_python_log_messages();
+    throw runtime_error("do_step raised an exception");
+  }
+
+  propagate_python_log_messages();
+
+  // only an explicit False discards the step, slaves commonly return None or a status
+  bool completed = (f != Py_False);
+  Py_DECREF(f);
+
+  if (completed)
+  {
+    lastSuccessfulTime_ = currentTime + stepSize;
+    record_outputs();
+  }
+
+  return completed;
+}
+
+size_t PyObjectWrapper::doSteps(double currentTime, const fmi2Real *stepSizes, size_t nSteps,
+                                const fmi2ValueReference *inputVrs, size_t nInputs, const fmi2Real *inputs,
+                                const fmi2ValueReference *outputVrs, size_t nOutputs, fmi2Real *outputs)
+{
+  // derivatives of the inputs apply to the first step only, which do_steps of the slave can not tell apart
+  // the inputs and outputs of an ensemble are those of member 0, whose variables the slave only sees as elements of arrays
+  if (pDoSteps_ == nullptr || inputDerivativesPending_ || inputDerivativesPassed_ || members_ > 1)
+    return Slave::doSteps(currentTime, stepSizes, nSteps, inputVrs, nInputs, inputs, outputVrs, nOutputs, outputs);
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+  PyObject *args[] = {
+      PyFloat_FromDouble(currentTime),
+      views_->view(stepSizes, nSteps),
+      views_->view(inputVrs, nInputs),
+      views_->view(inputs, nSteps * nInputs),
+      views_->view(outputVrs, nOutputs),
+      views_->view(outputs, nSteps * nOutputs)};
+
+  marshal.stop();
+
+  PyObject *f = nullptr;
+
+  if (all_of(begin(args), end(args), [](PyObject *arg) { return arg != nullptr; }))
+  {
+    Profile::PhaseTimer t(profile_, Profile::Phase::python_call);
+    f = PyCompat::PyObject_Vectorcall(pDoSteps_, args, size(args));
+  }
+
+  Py_XDECREF(args[0]);
+
+  views_->release(span(args).subspan(1), "do_steps", logger);
+
+  if (f == nullptr)
+  {
+    std::string err = get_py_exception();
+    logger->error(format("FMI2 do steps failed due to Python error:\n{}", err));
+    propagate_python_log_messages();
+    throw runtime_error("do_steps raised an exception");
+  }
+
+  size_t completed = PyLong_AsSize_t(f);
+  Py_DECREF(f);
+
+  if (PyErr_Occurred())
+  {
+    std::string err = get_py_exception();
+    logger->error(format("do_steps must return the number of completed steps, Python error was:\n{}", err));
+    propagate_python_log_messages();
+    throw runtime_error("do_steps did not return the number of completed steps");
+  }
+
+  propagate_python_log_messages();
+
+  // a step which failed raises an exception, as such fewer steps mean that one was discarded
+  completed = min(completed, nSteps);
+
+  if (completed > 0)
+  {
+    // the outputs of the tool are those at the end of each step, the others are only known at the end of the last step
+    double time = currentTime;
+    for (size_t k = 0; k + 1 < completed; ++k)
+    {
+      time += stepSizes[k];
+
+      for (size_t j = 0; j < nOutputs; ++j)
+      {
+        if (binary_search(realOutputs_.begin(), realOutputs_.end(), outputVrs[j]))
+          record_output(outputVrs[j], time, outputs[k * nOutputs + j]);
+      }
+    }
+
+    lastSuccessfulTime_ = accumulate(stepSizes, stepSizes + completed, currentTime);
+    record_outputs();
+  }
+
+  return completed;
+}
+
+void PyObjectWrapper::reset()
+{
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  if (initialState_ != nullptr)
+    restore_state(initialState_.get());
+
+  lastSuccessfulTime_ = 0;
+
+  for (auto &[vr, derivatives] : inputDerivatives_)
+    derivatives.clear();
+  inputDerivativesPending_ = false;
+  outputHistory_.clear();
+
+  auto f = call(SlaveMethod::reset);
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+}
+
+void PyObjectWrapper::terminate()
+{
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  auto f = call(SlaveMethod::terminate);
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+}
+
+void PyObjectWrapper::getInteger(const fmi2ValueReference *vr, std::size_t nvr,
+                                 fmi2Integer *values) const
+{
+  validate_value_references(ValueReferenceTable::Type::integer, vr, nvr);
+
+  if (store_ != nullptr && !states_pending() && store_->getInteger(vr, nvr, values))
+    return;
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  if (use_views(nvr))
+  {
+    auto f = call_with_views(SlaveMethod::get_integer, vr, nvr, values);
+    if (f == nullptr)
+    {
+      handle_py_exception();
+    }
+    Py_DECREF(f);
+    return;
+  }
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+
+  PyObject *vrs = PyList_New(nvr);
+  PyObject *refs = PyList_New(nvr);
+  for (int i = 0; i < nvr; i++)
+  {
+    PyList_SetItem(vrs, i, PyLong_FromUnsignedLong(vr[i]));
+    PyList_SetItem(refs, i, PyLong_FromLong(0));
+  }
+  marshal.stop();
+
+  auto f = call(SlaveMethod::get_integer, {vrs, refs});
+  Py_DECREF(vrs);
+  if (f == nullptr)
+  {
+    Py_DECREF(refs);
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+
+  Profile::PhaseTimer unmarshal(profile_, Profile::Phase::unmarshal);
+
+  for (int i = 0; i < nvr; i++)
+  {
+    PyObject *value = PyList_GetItem(refs, i);
+    values[i] = static_cast<int>(PyLong_AsLong(value));
+  }
+
+  Py_DECREF(refs);
+}
+
+void PyObjectWrapper::getReal(const fmi2ValueReference *vr, std::size_t nvr,
+                              fmi2Real *values) const
+{
+  validate_value_references(ValueReferenceTable::Type::real, vr, nvr);
+
+  if (store_ != nullptr && !states_pending() && store_->getReal(vr, nvr, values))
+    return;
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  if (use_views(nvr))
+  {
+    auto f = call_with_views(SlaveMethod::get_real, vr, nvr, values);
+    propagate_python_log_messages();
+
+    if (f == nullptr)
+    {
+      handle_py_exception();
+    }
+    Py_DECREF(f);
+    return;
+  }
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+
+  PyObject *vrs = PyList_New(nvr);
+  PyObject *refs = PyList_New(nvr);
+  for (int i = 0; i < nvr; i++)
+  {
+    PyList_SetItem(vrs, i, PyLong_FromUnsignedLong(vr[i]));
+    PyList_SetItem(refs, i, PyFloat_FromDouble(0.0));
+  }
+  marshal.stop();
+
+  auto f = call(SlaveMethod::get_real, {vrs, refs});
+  Py_DECREF(vrs);
+  propagate_python_log_messages();
+
+  if (f == nullptr)
+  {
+    Py_DECREF(refs);
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+
+  Profile::PhaseTimer unmarshal(profile_, Profile::Phase::unmarshal);
+
+  for (int i = 0; i < nvr; i++)
+  {
+    PyObject *value = PyList_GetItem(refs, i);
+    values[i] = PyFloat_AsDouble(value);
+  }
+
+  Py_DECREF(refs);
+}
+
+void PyObjectWrapper::getBoolean(const fmi2ValueReference *vr, std::size_t nvr,
+                                 fmi2Boolean *values) const
+{
+  validate_value_references(ValueReferenceTable::Type::boolean, vr, nvr);
+
+  if (store_ != nullptr && !states_pending() && store_->getBoolean(vr, nvr, values))
+    return;
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  if (use_views(nvr))
+  {
+    auto f = call_with_views(SlaveMethod::get_boolean, vr, nvr, values);
+    if (f == nullptr)
+    {
+      handle_py_exception();
+    }
+    Py_DECREF(f);
+    return;
+  }
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+
+  PyObject *vrs = PyList_New(nvr);
+  PyObject *refs = PyList_New(nvr);
+  for (int i = 0; i < nvr; i++)
+  {
+    PyList_SetItem(vrs, i, PyLong_FromUnsignedLong(vr[i]));
+    PyList_SetItem(refs, i, PyLong_FromLong(0));
+  }
+  marshal.stop();
+
+  auto f = call(SlaveMethod::get_boolean, {vrs, refs});
+  Py_DECREF(vrs);
+  if (f == nullptr)
+  {
+    Py_DECREF(refs);
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+
+  Profile::PhaseTimer unmarshal(profile_, Profile::Phase::unmarshal);
+
+  for (int i = 0; i < nvr; i++)
+  {
+    PyObject *value = PyList_GetItem(refs, i);
+    values[i] = PyObject_IsTrue(value);
+  }
+
+  Py_DECREF(refs);
+}
+
+void PyObjectWrapper::getString(const fmi2ValueReference *vr, std::size_t nvr,
+                                fmi2String *values) const
+{
+  validate_value_references(ValueReferenceTable::Type::string, vr, nvr);
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+
+  PyObject *vrs = PyList_New(nvr);
+  PyObject *refs = PyList_New(nvr);
+  for (int i = 0; i < nvr; i++)
+  {
+    PyList_SetItem(vrs, i, PyLong_FromUnsignedLong(vr[i]));
+    PyList_SetItem(refs, i, Py_BuildValue("s", ""));
+  }
+  marshal.stop();
+
+  auto f = call(SlaveMethod::get_string, {vrs, refs});
+  Py_DECREF(vrs);
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+
+  Profile::PhaseTimer unmarshal(profile_, Profile::Phase::unmarshal);
+
+  strings_.reset();
+
+  for (int i = 0; i < nvr; i++)
+  {
+    values[i] = strings_.store(PyList_GetItem(refs, i));
+
+    if (values[i] == nullptr)
+    {
+      Py_DECREF(refs);
+      handle_py_exception();
+    }
+  }
+
+  Py_DECREF(refs);
+}
+
+fmi2Status PyObjectWrapper::setDebugLogging(bool loggingOn, size_t nCategories, const char* const categories[]) const
+{
+  logger->setDebugLogging(loggingOn, nCategories, categories);
+
+  // the slave reads the active categories from the logger
+  if (filterView_.view != nullptr)
+    return fmi2OK;
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  auto py_categories = PyList_New(nCategories);
+
+  for(int i = 0; i < nCategories; ++i)
+  {
+    PyList_SetItem(py_categories,i,Py_BuildValue("s", categories[i]));
+  }
+
+  PyObject *py_logging_on = PyBool_FromLong(loggingOn);
+  auto f = call(SlaveMethod::set_debug_logging, {py_logging_on, py_categories});
+  Py_DECREF(py_logging_on);
+  Py_DECREF(py_categories);
+  
+  if(f == nullptr)
+  {
+    auto msg = get_py_exception();
+    logger->error(format("Failed to set debug logging categories, due to python error:\n{}",msg));
+    return fmi2Error;
+  }
+  propagate_python_log_messages();
+
+  Py_DECREF(f);
+
+  return fmi2OK;
+}
+
+void PyObjectWrapper::setInteger(const fmi2ValueReference *vr, std::size_t nvr,
+                                 const fmi2Integer *values)
+{
+  validate_value_references(ValueReferenceTable::Type::integer, vr, nvr);
+
+  if (store_ != nullptr && !states_pending() && store_->setInteger(vr, nvr, values))
+    return;
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  if (use_views(nvr))
+  {
+    auto f = call_with_views(SlaveMethod::set_integer, vr, nvr, values);
+    if (f == nullptr)
+    {
+      handle_py_exception();
+    }
+    Py_DECREF(f);
+    return;
+  }
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+
+  PyObject *vrs = PyList_New(nvr);
+  PyObject *refs = PyList_New(nvr);
+  for (int i = 0; i < nvr; i++)
+  {
+    PyList_SetItem(vrs, i, PyLong_FromUnsignedLong(vr[i]));
+    PyList_SetItem(refs, i, PyLong_FromLong(values[i]));
+  }
+  marshal.stop();
+
+  auto f = call(SlaveMethod::set_integer, {vrs, refs});
+  Py_DECREF(vrs);
+  Py_DECREF(refs);
+
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+
+  Py_DECREF(f);
+}
+
+void PyObjectWrapper::setReal(const fmi2ValueReference *vr, std::size_t nvr,
+                              const fmi2Real *values)
+{
+  validate_value_references(ValueReferenceTable::Type::real, vr, nvr);
+
+  if (store_ != nullptr && !states_pending() && store_->setReal(vr, nvr, values))
+    return;
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  PyObject *f = nullptr;
+
+  if (use_views(nvr))
+  {
+    f = call_with_views(SlaveMethod::set_real, vr, nvr, values);
+  }
+  else
+  {
+    Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+    PyObject *vrs = PyList_New(nvr);
+    PyObject *refs = PyList_New(nvr);
+    for (int i = 0; i < nvr; i++)
+    {
+      PyList_SetItem(vrs, i, PyLong_FromUnsignedLong(vr[i]));
+      PyList_SetItem(refs, i, PyFloat_FromDouble(values[i]));
+    }
+    marshal.stop();
+
+    f = call(SlaveMethod::set_real, {vrs, refs});
+    Py_DECREF(vrs);
+    Py_DECREF(refs);
+  }
+
+  if (f == nullptr)
+  {
+    auto err = get_py_exception();
+    ostringstream oss;
+    oss << "Failed to set real values of the python instance. Ensure that the "
+           "script implements the '__set__real__' method correctly, for "
+           "example by inheriting from 'FMI2Slave'.\n"
+        << "Python error is:\n"
+        << err;
+    throw runtime_error(oss.str());
+  }
+
+  Py_DECREF(f);
+}
+
+void PyObjectWrapper::setBoolean(const fmi2ValueReference *vr, std::size_t nvr,
+                                 const fmi2Boolean *values)
+{
+  validate_value_references(ValueReferenceTable::Type::boolean, vr, nvr);
+
+  if (store_ != nullptr && !states_pending() && store_->setBoolean(vr, nvr, values))
+    return;
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  if (use_views(nvr))
+  {
+    auto f = call_with_views(SlaveMethod::set_boolean, vr, nvr, values);
+    if (f == nullptr)
+    {
+      handle_py_exception();
+    }
+    Py_DECREF(f);
+    return;
+  }
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+
+  PyObject *vrs = PyList_New(nvr);
+  PyObject *refs = PyList_New(nvr);
+  for (int i = 0; i < nvr; i++)
+  {
+    PyList_SetItem(vrs, i, PyLong_FromUnsignedLong(vr[i]));
+    PyList_SetItem(refs, i, PyBool_FromLong(values[i]));
+  }
+  marshal.stop();
+
+  auto f = call(SlaveMethod::set_boolean, {vrs, refs});
+  Py_DECREF(vrs);
+  Py_DECREF(refs);
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+}
+
+void PyObjectWrapper::getRealEnsemble(const fmi2ValueReference *vr, size_t nvr, fmi2Real *values) const
+{
+  validate_value_references(ValueReferenceTable::Type::real, vr, nvr);
+
+  if (store_ == nullptr || !store_->getRealEnsemble(vr, nvr, values))
+    not_stored_natively();
+}
+
+void PyObjectWrapper::getIntegerEnsemble(const fmi2ValueReference *vr, size_t nvr, fmi2Integer *values) const
+{
+  validate_value_references(ValueReferenceTable::Type::integer, vr, nvr);
+
+  if (store_ == nullptr || !store_->getIntegerEnsemble(vr, nvr, values))
+    not_stored_natively();
+}
+
+void PyObjectWrapper::getBooleanEnsemble(const fmi2ValueReference *vr, size_t nvr, fmi2Boolean *values) const
+{
+  validate_value_references(ValueReferenceTable::Type::boolean, vr, nvr);
+
+  if (store_ == nullptr || !store_->getBooleanEnsemble(vr, nvr, values))
+    not_stored_natively();
+}
+
+void PyObjectWrapper::setRealEnsemble(const fmi2ValueReference *vr, size_t nvr, const fmi2Real *values)
+{
+  validate_value_references(ValueReferenceTable::Type::real, vr, nvr);
+
+  if (store_ == nullptr || !store_->setRealEnsemble(vr, nvr, values))
+    not_stored_natively();
+}
+
+void PyObjectWrapper::setIntegerEnsemble(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *values)
+{
+  validate_value_references(ValueReferenceTable::Type::integer, vr, nvr);
+
+  if (store_ == nullptr || !store_->setIntegerEnsemble(vr, nvr, values))
+    not_stored_natively();
+}
+
+void PyObjectWrapper::setBooleanEnsemble(const fmi2ValueReference *vr, size_t nvr, const fmi2Boolean *values)
+{
+  validate_value_references(ValueReferenceTable::Type::boolean, vr, nvr);
+
+  if (store_ == nullptr || !store_->setBooleanEnsemble(vr, nvr, values))
+    not_stored_natively();
+}
+
+void PyObjectWrapper::not_stored_natively() const
+{
+  string msg = "The values of the members of an ensemble can only be accessed for natively stored variables, which are registered using native=True or register_array\n";
+  logger->error(msg);
+  throw runtime_error(msg);
+}
+
+void PyObjectWrapper::setString(const fmi2ValueReference *vr, std::size_t nvr,
+                                const fmi2String *value)
+{
+  validate_value_references(ValueReferenceTable::Type::string, vr, nvr);
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+
+  PyObject *vrs = PyList_New(nvr);
+  PyObject *refs = PyList_New(nvr);
+  for (int i = 0; i < nvr; i++)
+  {
+    PyList_SetItem(vrs, i, PyLong_FromUnsignedLong(vr[i]));
+    PyList_SetItem(refs, i, Py_BuildValue("s", value[i]));
+  }
+  marshal.stop();
+
+  auto f = call(SlaveMethod::set_string, {vrs, refs});
+  Py_DECREF(vrs);
+  Py_DECREF(refs);
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+}
+
+PyObjectWrapper::FMUState *PyObjectWrapper::find_state(fmi2FMUstate state) const
+{
+  auto it = find_if(states_.begin(), states_.end(), [state](auto &s) { return s.get() == state; });
+
+  if (it == states_.end())
+    throw runtime_error("The FMU state was not captured by this instance or has already been freed");
+
+  return it->get();
+}
+
+fmi2FMUstate PyObjectWrapper::getFMUstate(fmi2FMUstate state)
+{
+  FMUState *s = (state == nullptr) ? nullptr : find_state(state);
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  if (s != nullptr)
+  {
+    capture_state(s);
+    return s;
+  }
+
+  // the state is only registered once it was captured, such that a failed capture leaves no state behind
+  auto captured = make_unique<FMUState>();
+  capture_state(captured.get());
+  states_.push_back(move(captured));
+
+  return states_.back().get();
+}
+
+void PyObjectWrapper::capture_state(FMUState *state)
+{
+  require(SlaveMethod::get_state);
+
+  auto f = call(SlaveMethod::get_state);
+  propagate_python_log_messages();
+
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+
+  clear_state(state);
+  state->pState = f;
+  state->lastSuccessfulTime = lastSuccessfulTime_;
+
+  if (store_ != nullptr)
+  {
+    state->reals = store_->reals();
+    state->integers = store_->integers();
+    state->booleans = store_->booleans();
+  }
+}
+
+void PyObjectWrapper::setFMUstate(fmi2FMUstate state)
+{
+  FMUState *s = find_state(state);
+
+  // the outputs are those of another point in time
+  outputHistory_.clear();
+
+  PyGIL g(subInterpreter_.get(), profile_);
+  restore_state(s);
+}
+
+void PyObjectWrapper::restore_state(const FMUState *state)
+{
+  require(SlaveMethod::set_state);
+
+  // the time and states set by the tool are superseded by those of the state
+  timePending_ = statesPending_ = false;
+
+  auto f = call(SlaveMethod::set_state, {state->pState});
+  propagate_python_log_messages();
+
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+  Py_DECREF(f);
+
+  lastSuccessfulTime_ = state->lastSuccessfulTime;
+
+  // the store is never resized, as such the copies always match it in size
+  if (store_ != nullptr)
+  {
+    copy(state->reals.begin(), state->reals.end(), store_->reals().begin());
+    copy(state->integers.begin(), state->integers.end(), store_->integers().begin());
+    copy(state->booleans.begin(), state->booleans.end(), store_->booleans().begin());
+  }
+}
+
+void PyObjectWrapper::freeFMUstate(fmi2FMUstate state)
+{
+  FMUState *s = find_state(state);
+
+  {
+    PyGIL g(subInterpreter_.get(), profile_);
+    clear_state(s);
+  }
+
+  states_.erase(find_if(states_.begin(), states_.end(), [s](auto &p) { return p.get() == s; }));
+}
+
+void PyObjectWrapper::freeAllFMUstates()
+{
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  for (auto &state : states_)
+    clear_state(state.get());
+  states_.clear();
+}
+
+void PyObjectWrapper::clear_state(FMUState *state)
+{
+  Py_XDECREF(state->pState);
+  Py_XDECREF(state->pSerialized);
+  state->pState = nullptr;
+  state->pSerialized = nullptr;
+}
+
+PyObject *PyObjectWrapper::serialized_snapshot(FMUState *state) const
+{
+  if (state->pSerialized != nullptr)
+    return state->pSerialized;
+
+  require(SlaveMethod::serialize_state);
+
+  auto f = call(SlaveMethod::serialize_state, {state->pState});
+  propagate_python_log_messages();
+
+  if (f == nullptr)
+  {
+    handle_py_exception();
+  }
+
+  if (!PyBytes_Check(f))
+  {
+    Py_DECREF(f);
+    throw runtime_error("The slave failed to serialize the FMU state, serialize_state must return bytes");
+  }
+
+  state->pSerialized = f;
+  return f;
+}
+
+/**
+ * @brief Returns the number of bytes of the serialized state, excluding the snapshot.
+ */
+static size_t serialized_values_size(const SerializedStateHeader &header)
+{
+  return sizeof(SerializedStateHeader) + header.nReals * sizeof(fmi2Real) + header.nIntegers * sizeof(fmi2Integer) + header.nBooleans * sizeof(fmi2Boolean);
+}
+
+size_t PyObjectWrapper::serializedFMUstateSize(fmi2FMUstate state)
+{
+  FMUState *s = find_state(state);
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  return sizeof(SerializedStateHeader) + s->reals.size() * sizeof(fmi2Real) + s->integers.size() * sizeof(fmi2Integer) + s->booleans.size() * sizeof(fmi2Boolean) + PyBytes_Size(serialized_snapshot(s));
+}
+
+void PyObjectWrapper::serializeFMUstate(fmi2FMUstate state, fmi2Byte *data, size_t size)
+{
+  FMUState *s = find_state(state);
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  char *snapshot;
+  Py_ssize_t snapshotSize;
+
+  if (PyBytes_AsStringAndSize(serialized_snapshot(s), &snapshot, &snapshotSize) != 0)
+    handle_py_exception();
+
+  SerializedStateHeader header{};
+  copy(begin(serializedStateTag), end(serializedStateTag), header.tag);
+  header.version = SerializedStateHeader::currentVersion;
+  header.byteOrder = SerializedStateHeader::byteOrderMark;
+  header.nReals = s->reals.size();
+  header.nIntegers = s->integers.size();
+  header.nBooleans = s->booleans.size();
+  header.snapshotSize = snapshotSize;
+  header.lastSuccessfulTime = s->lastSuccessfulTime;
+
+  if (size < serialized_values_size(header) + snapshotSize)
+    throw runtime_error(format("The buffer of {} bytes is too small to hold the serialized FMU state", size));
+
+  auto write = [&data](const void *src, size_t n) {
+    memcpy(data, src, n);
+    data += n;
+  };
+
+  write(&header, sizeof(header));
+  write(s->reals.data(), s->reals.size() * sizeof(fmi2Real));
+  write(s->integers.data(), s->integers.size() * sizeof(fmi2Integer));
+  write(s->booleans.data(), s->booleans.size() * sizeof(fmi2Boolean));
+  write(snapshot, snapshotSize);
+}
+
+fmi2FMUstate PyObjectWrapper::deSerializeFMUstate(const fmi2Byte *data, size_t size, fmi2FMUstate state)
+{
+  FMUState *s = (state == nullptr) ? nullptr : find_state(state);
+
+  SerializedStateHeader header;
+
+  if (size < sizeof(header))
+    throw runtime_error("The serialized FMU state is truncated");
+
+  memcpy(&header, data, sizeof(header));
+
+  if (!equal(begin(serializedStateTag), end(serializedStateTag), header.tag))
+    throw runtime_error("The data is not a serialized FMU state");
+
+  if (header.version != SerializedStateHeader::currentVersion)
+    throw runtime_error(format("The FMU state was serialized using version {} of the format, only version {} is supported", header.version, SerializedStateHeader::currentVersion));
+
+  if (header.byteOrder != SerializedStateHeader::byteOrderMark)
+    throw runtime_error("The FMU state was serialized on a machine with a different byte order");
+
+  size_t nReals = store_ ? store_->reals().size() : 0;
+  size_t nIntegers = store_ ? store_->integers().size() : 0;
+  size_t nBooleans = store_ ? store_->booleans().size() : 0;
+
+  if (header.nReals != nReals || header.nIntegers != nIntegers || header.nBooleans != nBooleans)
+    throw runtime_error("The natively stored variables of the serialized FMU state do not match those of the slave");
+
+  size_t offset = serialized_values_size(header);
+
+  if (size < offset || size - offset < header.snapshotSize)
+    throw runtime_error("The serialized FMU state is truncated");
+
+  require(SlaveMethod::deserialize_state);
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  // the slave reads the snapshot directly from the buffer of the tool
+  PyObject *view = views_->bytes(data + offset, header.snapshotSize);
+
+  if (view == nullptr)
+    handle_py_exception();
+
+  auto f = call(SlaveMethod::deserialize_state, {view});
+
+  if (!views_->release(view))
+    logger->warning("The slave retained a reference to the serialized FMU state passed to deserialize_state, which is no longer valid once the call returns\n");
+
+  propagate_python_log_messages();
 
-  PyGIL g;
-  auto f =
-      PyObject_CallMethod(pInstance_, "enter_initialization_mode", nullptr);
   if (f == nullptr)
   {
     handle_py_exception();
   }
-  Py_DECREF(f);
-}
 
-void PyObjectWrapper::exitInitializationMode()
-{
-  PyGIL g;
-
-  auto f = PyObject_CallMethod(pInstance_, "exit_initialization_mode", nullptr);
-  if (f == nullptr)
+  if (s == nullptr)
   {
-    handle_py_exception();
+    states_.push_back(make_unique<FMUState>());
+    s = states_.back().get();
   }
-  Py_DECREF(f);
+
+  clear_state(s);
+  s->pState = f;
+  s->lastSuccessfulTime = header.lastSuccessfulTime;
+
+  auto read = [&data](auto &values, size_t n) {
+    values.resize(n);
+    memcpy(values.data(), data, n * sizeof(values[0]));
+    data += n * sizeof(values[0]);
+  };
+
+  data += sizeof(header);
+  read(s->reals, nReals);
+  read(s->integers, nIntegers);
+  read(s->booleans, nBooleans);
+
+  return s;
 }
 
-bool PyObjectWrapper::doStep(double currentTime, double stepSize)
+void PyObjectWrapper::setTime(double time)
 {
-  PyGIL g;
-
-  auto f = PyObject_CallMethod(pInstance_, "do_step", "(dd)", currentTime, stepSize);
+  require_model_exchange(0, 0, "");
 
-  if (f == nullptr)
-  {
-    std::string err = get_py_exception();
-    logger->error(format("FMI2 do step failed due to Python error:\n{}",err));
-  }
+  time_ = time;
+  timePending_ = true;
+}
 
-  propagate_python_log_messages();
+void PyObjectWrapper::setContinuousStates(const fmi2Real *states, size_t nx)
+{
+  require_model_exchange(nx, nStates_, "continuous states");
 
-  bool status = static_cast<bool>(PyObject_IsTrue(f));
-  Py_DECREF(f);
-  return status;
+  copy(states, states + nx, continuousStates_.begin());
+  statesPending_ = true;
 }
 
-void PyObjectWrapper::reset()
+void PyObjectWrapper::getContinuousStates(fmi2Real *states, size_t nx)
 {
-  PyGIL g;
+  require_model_exchange(nx, nStates_, "continuous states");
 
-  auto f = PyObject_CallMethod(pInstance_, "reset", nullptr);
-  if (f == nullptr)
+  // the slave has not seen the states yet, as such they are the ones set by the tool
+  if (statesPending_)
   {
-    handle_py_exception();
+    copy(continuousStates_.begin(), continuousStates_.end(), states);
+    return;
   }
-  Py_DECREF(f);
-}
 
-void PyObjectWrapper::terminate()
-{
-  PyGIL g;
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  auto f = call_with_view(SlaveMethod::get_continuous_states, states, nx);
+  propagate_python_log_messages();
 
-  auto f = PyObject_CallMethod(pInstance_, "terminate", nullptr);
   if (f == nullptr)
   {
     handle_py_exception();
@@ -230,288 +2553,282 @@ void PyObjectWrapper::terminate()
   Py_DECREF(f);
 }
 
-void PyObjectWrapper::getInteger(const fmi2ValueReference *vr, std::size_t nvr,
-                                 fmi2Integer *values) const
+void PyObjectWrapper::getNominalsOfContinuousStates(fmi2Real *nominals, size_t nx)
 {
-  PyGIL g;
+  require_model_exchange(nx, nStates_, "continuous states");
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  auto f = call_with_view(SlaveMethod::get_nominals_of_continuous_states, nominals, nx);
+  propagate_python_log_messages();
 
-  PyObject *vrs = PyList_New(nvr);
-  PyObject *refs = PyList_New(nvr);
-  for (int i = 0; i < nvr; i++)
-  {
-    PyList_SetItem(vrs, i, Py_BuildValue("i", vr[i]));
-    PyList_SetItem(refs, i, Py_BuildValue("i", 0));
-  }
-  auto f =
-      PyObject_CallMethod(pInstance_, "__get_integer__", "(OO)", vrs, refs);
-  Py_DECREF(vrs);
   if (f == nullptr)
   {
     handle_py_exception();
   }
   Py_DECREF(f);
-
-  for (int i = 0; i < nvr; i++)
-  {
-    PyObject *value = PyList_GetItem(refs, i);
-    values[i] = static_cast<int>(PyLong_AsLong(value));
-  }
-
-  Py_DECREF(refs);
 }
 
-void PyObjectWrapper::getReal(const fmi2ValueReference *vr, std::size_t nvr,
-                              fmi2Real *values) const
+void PyObjectWrapper::evaluate(SlaveMethod evaluate, SlaveMethod get, fmi2Real *values, size_t n)
 {
-  PyGIL g;
+  PyGIL g(subInterpreter_.get(), profile_);
 
-  PyObject *vrs = PyList_New(nvr);
-  PyObject *refs = PyList_New(nvr);
-  for (int i = 0; i < nvr; i++)
+  PyObject *f = nullptr;
+
+  if (statesPending_)
   {
-    PyList_SetItem(vrs, i, Py_BuildValue("i", vr[i]));
-    PyList_SetItem(refs, i, Py_BuildValue("d", 0.0));
-  }
+    Profile::PhaseTimer marshal(profile_, Profile::Phase::marshal);
+    PyObject *pTime = PyFloat_FromDouble(time_);
+    PyObject *pValues = views_->view(values, n);
+    marshal.stop();
 
-  auto f = PyObject_CallMethod(pInstance_, "__get_real__", "(OO)", vrs, refs);
-  Py_DECREF(vrs);
-  propagate_python_log_messages();
-  
-  bool call_failed = (f == nullptr);
+    // the slave adopts the time and the states along with the evaluation
+    timePending_ = statesPending_ = false;
 
-  
+    if (pTime != nullptr && pValues != nullptr)
+      f = call(evaluate, {pTime, statesView_.view, pValues});
 
-  if (!call_failed)
-  {
-      Py_DECREF(f);
+    Py_XDECREF(pTime);
 
-    for (int i = 0; i < nvr; i++)
-    {
-      PyObject *value = PyList_GetItem(refs, i);
-      values[i] = PyFloat_AsDouble(value);
-    }
+    views_->release({&pValues, 1}, slave_method_names[static_cast<size_t>(evaluate)], logger);
   }
   else
   {
-    std::string py_err_msg = get_py_exception();
-    logger->error(py_err_msg);
+    f = call_with_view(get, values, n);
   }
 
-  Py_DECREF(refs);
-}
-
-void PyObjectWrapper::getBoolean(const fmi2ValueReference *vr, std::size_t nvr,
-                                 fmi2Boolean *values) const
-{
-  PyGIL g;
+  propagate_python_log_messages();
 
-  PyObject *vrs = PyList_New(nvr);
-  PyObject *refs = PyList_New(nvr);
-  for (int i = 0; i < nvr; i++)
-  {
-    PyList_SetItem(vrs, i, Py_BuildValue("i", vr[i]));
-    PyList_SetItem(refs, i, Py_BuildValue("i", 0));
-  }
-  auto f =
-      PyObject_CallMethod(pInstance_, "__get_boolean__", "(OO)", vrs, refs);
-  Py_DECREF(vrs);
   if (f == nullptr)
   {
     handle_py_exception();
   }
   Py_DECREF(f);
+}
 
-  for (int i = 0; i < nvr; i++)
-  {
-    PyObject *value = PyList_GetItem(refs, i);
-    values[i] = PyObject_IsTrue(value);
-  }
+void PyObjectWrapper::getDerivatives(fmi2Real *derivatives, size_t nx)
+{
+  require_model_exchange(nx, nStates_, "continuous states");
+  evaluate(SlaveMethod::evaluate_derivatives, SlaveMethod::get_derivatives, derivatives, nx);
+}
 
-  Py_DECREF(refs);
+void PyObjectWrapper::getEventIndicators(fmi2Real *indicators, size_t ni)
+{
+  require_model_exchange(ni, nEventIndicators_, "event indicators");
+  evaluate(SlaveMethod::evaluate_event_indicators, SlaveMethod::get_event_indicators, indicators, ni);
 }
 
-void PyObjectWrapper::getString(const fmi2ValueReference *vr, std::size_t nvr,
-                                fmi2String *values) const
+void PyObjectWrapper::enterEventMode()
 {
-  PyGIL g;
+  require_model_exchange(0, 0, "");
+
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  auto f = call(SlaveMethod::enter_event_mode);
+  propagate_python_log_messages();
 
-  PyObject *vrs = PyList_New(nvr);
-  PyObject *refs = PyList_New(nvr);
-  for (int i = 0; i < nvr; i++)
-  {
-    PyList_SetItem(vrs, i, Py_BuildValue("i", vr[i]));
-    PyList_SetItem(refs, i, Py_BuildValue("s", ""));
-  }
-  auto f = PyObject_CallMethod(pInstance_, "__get_string__", "(OO)", vrs, refs);
-  Py_DECREF(vrs);
   if (f == nullptr)
   {
     handle_py_exception();
   }
   Py_DECREF(f);
-
-  for (int i = 0; i < nvr; i++)
-  {
-    PyObject *value = PyList_GetItem(refs, i);
-    values[i] = PyCompat::PyUnicode_AsUTF8(value);
-  }
-
-  Py_DECREF(refs);
 }
 
-fmi2Status PyObjectWrapper::setDebugLogging(bool loggingOn, size_t nCategories, const char* const categories[]) const
+void PyObjectWrapper::newDiscreteStates(fmi2EventInfo *eventInfo)
 {
-  auto py_categories = PyList_New(nCategories);
+  require_model_exchange(0, 0, "");
 
-  for(int i = 0; i < nCategories; ++i)
+  PyGIL g(subInterpreter_.get(), profile_);
+
+  auto f = call(SlaveMethod::new_discrete_states);
+  propagate_python_log_messages();
+
+  if (f == nullptr)
   {
-    PyList_SetItem(py_categories,i,Py_BuildValue("s", categories[i]));
+    handle_py_exception();
   }
 
-  auto f = PyObject_CallMethod(pInstance_,"__set_debug_logging__","(iO)", loggingOn, py_categories);
-  Py_DECREF(py_categories);
-  
-  if(f == nullptr)
+  *eventInfo = fmi2EventInfo{};
+
+  // an Fmi2EventInfo, or None if no further iteration is needed and there is no time event
+  if (f != Py_None)
   {
-    auto msg = get_py_exception();
-    logger->error(format("Failed to set debug logging categories, due to python error:\n{}",msg));
-    return fmi2Error;
+    Profile::PhaseTimer unmarshal(profile_, Profile::Phase::unmarshal);
+
+    PyObject *fields[5] = {};
+    bool valid = (PySequence_Size(f) == 5);
+
+    for (size_t i = 0; valid && i < size(fields); ++i)
+      valid = ((fields[i] = PySequence_GetItem(f, i)) != nullptr);
+
+    if (valid)
+    {
+      eventInfo->newDiscreteStatesNeeded = PyObject_IsTrue(fields[0]) == 1;
+      eventInfo->terminateSimulation = PyObject_IsTrue(fields[1]) == 1;
+      eventInfo->nominalsOfContinuousStatesChanged = PyObject_IsTrue(fields[2]) == 1;
+      eventInfo->valuesOfContinuousStatesChanged = PyObject_IsTrue(fields[3]) == 1;
+      eventInfo->nextEventTimeDefined = (fields[4] != Py_None);
+      eventInfo->nextEventTime = eventInfo->nextEventTimeDefined ? PyFloat_AsDouble(fields[4]) : 0.0;
+    }
+
+    for (auto field : fields)
+      Py_XDECREF(field);
+
+    if (!valid || PyErr_Occurred())
+    {
+      Py_DECREF(f);
+      PyErr_Clear();
+      auto msg = string("new_discrete_states must return an Fmi2EventInfo or None\n");
+      logger->error(msg);
+      throw runtime_error(msg);
+    }
   }
-  propagate_python_log_messages();
 
   Py_DECREF(f);
-
-  return fmi2OK;
 }
 
-void PyObjectWrapper::setInteger(const fmi2ValueReference *vr, std::size_t nvr,
-                                 const fmi2Integer *values)
+void PyObjectWrapper::enterContinuousTimeMode()
 {
-  PyGIL g;
+  require_model_exchange(0, 0, "");
 
-  PyObject *vrs = PyList_New(nvr);
-  PyObject *refs = PyList_New(nvr);
-  for (int i = 0; i < nvr; i++)
-  {
-    PyList_SetItem(vrs, i, Py_BuildValue("i", vr[i]));
-    PyList_SetItem(refs, i, Py_BuildValue("i", values[i]));
-  }
+  PyGIL g(subInterpreter_.get(), profile_);
 
-  auto f =
-      PyObject_CallMethod(pInstance_, "__set_integer__", "(OO)", vrs, refs);
-  Py_DECREF(vrs);
-  Py_DECREF(refs);
+  auto f = call(SlaveMethod::enter_continuous_time_mode);
+  propagate_python_log_messages();
 
   if (f == nullptr)
   {
     handle_py_exception();
   }
-
   Py_DECREF(f);
 }
 
-void PyObjectWrapper::setReal(const fmi2ValueReference *vr, std::size_t nvr,
-                              const fmi2Real *values)
+bool PyObjectWrapper::completedIntegratorStep(bool noSetFMUStatePriorToCurrentPoint, bool *terminateSimulation)
 {
-  PyGIL g;
+  require_model_exchange(0, 0, "");
 
-  PyObject *vrs = PyList_New(nvr);
-  PyObject *refs = PyList_New(nvr);
-  for (int i = 0; i < nvr; i++)
-  {
-    PyList_SetItem(vrs, i, Py_BuildValue("i", vr[i]));
-    PyList_SetItem(refs, i, Py_BuildValue("d", values[i]));
-  }
+  PyGIL g(subInterpreter_.get(), profile_);
 
-  auto f = PyObject_CallMethod(pInstance_, "__set_real__", "(OO)", vrs, refs);
-  Py_DECREF(vrs);
-  Py_DECREF(refs);
+  auto f = call(SlaveMethod::completed_integrator_step, {noSetFMUStatePriorToCurrentPoint ? Py_True : Py_False});
+  propagate_python_log_messages();
 
   if (f == nullptr)
   {
-    auto err = get_py_exception();
-    ostringstream oss;
-    oss << "Failed to set real values of the python instance. Ensure that the "
-           "script implements the '__set__real__' method correctly, for "
-           "example by inheriting from 'FMI2Slave'.\n"
-        << "Python error is:\n"
-        << err;
-    throw runtime_error(oss.str());
+    handle_py_exception();
   }
 
-  Py_DECREF(f);
-}
-
-void PyObjectWrapper::setBoolean(const fmi2ValueReference *vr, std::size_t nvr,
-                                 const fmi2Boolean *values)
-{
-  PyGIL g;
+  // (enter event mode, terminate simulation), or None if neither is requested
+  bool enterEventMode = false;
+  *terminateSimulation = false;
 
-  PyObject *vrs = PyList_New(nvr);
-  PyObject *refs = PyList_New(nvr);
-  for (int i = 0; i < nvr; i++)
+  if (f != Py_None)
   {
-    PyList_SetItem(vrs, i, Py_BuildValue("i", vr[i]));
-    PyList_SetItem(refs, i, PyBool_FromLong(values[i]));
-  }
+    PyObject *pEnter = (PySequence_Size(f) == 2) ? PySequence_GetItem(f, 0) : nullptr;
+    PyObject *pTerminate = (pEnter != nullptr) ? PySequence_GetItem(f, 1) : nullptr;
 
-  auto f =
-      PyObject_CallMethod(pInstance_, "__set_boolean__", "(OO)", vrs, refs);
-  Py_DECREF(vrs);
-  Py_DECREF(refs);
-  if (f == nullptr)
-  {
-    handle_py_exception();
+    if (pTerminate != nullptr)
+    {
+      enterEventMode = PyObject_IsTrue(pEnter) == 1;
+      *terminateSimulation = PyObject_IsTrue(pTerminate) == 1;
+    }
+
+    Py_XDECREF(pEnter);
+    Py_XDECREF(pTerminate);
+
+    if (pTerminate == nullptr)
+    {
+      Py_DECREF(f);
+      PyErr_Clear();
+      auto msg = string("completed_integrator_step must return a pair of booleans or None\n");
+      logger->error(msg);
+      throw runtime_error(msg);
+    }
   }
+
   Py_DECREF(f);
+  return enterEventMode;
 }
 
-void PyObjectWrapper::setString(const fmi2ValueReference *vr, std::size_t nvr,
-                                const fmi2String *value)
+template <typename T>
+void PyObjectWrapper::release_shared(span<SharedView> views, unique_ptr<T> memory) const
 {
-  PyGIL g;
+  PyObject *pCapsule = nullptr;
 
-  PyObject *vrs = PyList_New(nvr);
-  PyObject *refs = PyList_New(nvr);
-  for (int i = 0; i < nvr; i++)
+  if (memory != nullptr)
   {
-    PyList_SetItem(vrs, i, Py_BuildValue("i", vr[i]));
-    PyList_SetItem(refs, i, Py_BuildValue("s", value[i]));
+    pCapsule = PyCapsule_New(memory.get(), "pythonfmu.memory", [](PyObject *capsule) {
+      delete static_cast<T *>(PyCapsule_GetPointer(capsule, "pythonfmu.memory"));
+    });
+
+    if (pCapsule != nullptr)
+      memory.release();
+    else
+      PyErr_Clear();
   }
 
-  auto f = PyObject_CallMethod(pInstance_, "__set_string__", "(OO)", vrs, refs);
-  Py_DECREF(vrs);
-  Py_DECREF(refs);
-  if (f == nullptr)
+  bool released = views_->release(views, pCapsule, logger);
+
+  // deletes the memory, unless it is kept alive by views derived by the slave
+  Py_XDECREF(pCapsule);
+
+  if (!released && memory != nullptr)
   {
-    handle_py_exception();
+    memory.release();
+    logger->warning("The slave holds views of memory of the wrapper beyond the lifetime of the instance, which is leaked as it could not be kept alive along with them\n");
   }
-  Py_DECREF(f);
 }
 
 PyObjectWrapper::~PyObjectWrapper()
 {
-  PyGIL g;
+  {
+    PyGIL g(subInterpreter_.get());
 
-  Py_XDECREF(pInstance_);
-  Py_XDECREF(pClass_);
-  Py_XDECREF(pModule_);
-}
+    for (auto &state : states_)
+      clear_state(state.get());
+    states_.clear();
 
-PyObjectWrapper &PyObjectWrapper::operator=(PyObjectWrapper &&other)
-{
-  this->pClass_ = other.pClass_;
-  this->pModule_ = other.pModule_;
-  this->pInstance_ = other.pInstance_;
-  this->logger = move(other.logger);
-  return *this;
+    if (initialState_ != nullptr)
+      clear_state(initialState_.get());
+
+    for (auto &method : pMethods_)
+      Py_XDECREF(method);
+    Py_XDECREF(pDoSteps_);
+    Py_XDECREF(pDirectionalDerivative_);
+    Py_XDECREF(pOutputDerivatives_);
+
+    if (unperturbedState_ != nullptr)
+      clear_state(unperturbedState_.get());
+
+    // the slave may outlive the wrapper, after releasing the views it can no longer access the memory through them
+    release_shared(storeViews_, move(store_));
+    release_shared(logViews_, move(logRing_));
+    release_shared(span(&filterView_, 1), make_unique<shared_ptr<array<uint32_t, Logger::nActiveWords>>>(move(activeWords_)));
+    release_shared(span(&statesView_, 1), make_unique<vector<fmi2Real>>(move(continuousStates_)));
+
+    views_.reset();
+
+    Py_XDECREF(pInstance_);
+    Py_XDECREF(pClass_);
+    Py_XDECREF(pModule_);
+  }
+
+  // ending the sub-interpreter requires that its GIL is not held
+  subInterpreter_.reset();
 }
 
 void PyObjectWrapper::propagate_python_log_messages() const
 {
-  PyGIL g;
+  Profile::PhaseTimer t(profile_, Profile::Phase::log_drain);
+
+  if (logRing_ != nullptr)
+  {
+    logRing_->drain(*logger);
+    return;
+  }
+
+  PyGIL g(subInterpreter_.get());
 
-  auto f = PyObject_CallMethod(pInstance_, "__get_log_size__", "()");
+  auto f = call(SlaveMethod::get_log_size);
 
   if (f == nullptr)
   { 
@@ -519,9 +2836,9 @@ void PyObjectWrapper::propagate_python_log_messages() const
     logger->error(format("Failed to read log messages from the Python instance. Call to __get_log_size__ failed due to:\n{}", py_err_msg));
     return;
   }
-  Py_DECREF(f);
   long n_messages = PyLong_AsLong(f);
-  
+  Py_DECREF(f);
+
 
   bool failed_to_parse = (n_messages == -1);
   if(failed_to_parse)
@@ -534,7 +2851,16 @@ void PyObjectWrapper::propagate_python_log_messages() const
   if(n_messages == 0)
     return;
   
-  f = PyObject_CallMethod(pInstance_,"__pop_log_messages__","(i)",n_messages);
+  PyObject *py_n_messages = PyLong_FromLong(n_messages);
+  f = call(SlaveMethod::pop_log_messages, {py_n_messages});
+  Py_DECREF(py_n_messages);
+
+  if (f == nullptr)
+  {
+    std::string py_err_msg = get_py_exception();
+    logger->error(format("Failed to read log messages from the Python instance. Call to __pop_log_messages__ failed due to:\n{}", py_err_msg));
+    return;
+  }
 
   for(int i = 0; i < n_messages; ++i)
   {
@@ -543,6 +2869,7 @@ void PyObjectWrapper::propagate_python_log_messages() const
     if(value == nullptr)
     {
       logger->warning("Failed to parse read log message");
+      Py_DECREF(f);
       return;
     }
 
@@ -556,15 +2883,13 @@ void PyObjectWrapper::propagate_python_log_messages() const
       logger->warning(msg);
     }
     fmi2Status status = (fmi2Status)(PyLong_AsLong(py_status));
-    const char* category = PyCompat::PyUnicode_AsUTF8(py_category);
-    const char* message = PyCompat::PyUnicode_AsUTF8(py_message);
+    string category = PyCompat::PyUnicode_AsUTF8(py_category);
+    string message = PyCompat::PyUnicode_AsUTF8(py_message);
 
-    logger->log(status,category,message);
+    logger->log(status, move(category), move(message));
   }
-   
-    
 
-  
+  Py_DECREF(f);
 }
 
 } // namespace pythonfmu
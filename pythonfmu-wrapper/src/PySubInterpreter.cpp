@@ -0,0 +1,82 @@
+#include <stdexcept>
+
+#include "pythonfmu/PySubInterpreter.hpp"
+
+using namespace std;
+
+namespace pythonfmu
+{
+
+PySubInterpreter::PySubInterpreter(Logger *logger)
+{
+  PyGILState_STATE gil = PyGILState_Ensure();
+  PyThreadState *mainTstate = PyThreadState_Get();
+
+#ifdef PYFMU_OWN_GIL
+  // extensions using single-phase initialization, such as numpy, are not safe to share between interpreters with separate GILs and fail to import
+  PyInterpreterConfig config = {
+      .use_main_obmalloc = 0,
+      .allow_fork = 0,
+      .allow_exec = 0,
+      .allow_threads = 1,
+      .allow_daemon_threads = 0,
+      .check_multi_interp_extensions = 1,
+      .gil = PyInterpreterConfig_OWN_GIL,
+  };
+
+  PyStatus status = Py_NewInterpreterFromConfig(&tstate_, &config);
+
+  if (PyStatus_Exception(status))
+    tstate_ = nullptr;
+#else
+  tstate_ = Py_NewInterpreter();
+#endif
+
+  if (tstate_ == nullptr)
+  {
+    PyThreadState_Swap(mainTstate);
+    PyGILState_Release(gil);
+    logger->fatal("Failed to create Python sub-interpreter\n");
+    throw runtime_error("Failed to create Python sub-interpreter");
+  }
+
+  // the new interpreter is current, release its GIL and restore the state of the calling thread
+  PyEval_SaveThread();
+  PyEval_RestoreThread(mainTstate);
+  PyGILState_Release(gil);
+
+#ifdef PYFMU_OWN_GIL
+  logger->ok("Created Python sub-interpreter with its own GIL\n");
+#else
+  logger->ok("Created Python sub-interpreter sharing the GIL of the main interpreter\n");
+#endif
+}
+
+PySubInterpreter::~PySubInterpreter()
+{
+#ifdef PYFMU_OWN_GIL
+  PyEval_RestoreThread(tstate_);
+  Py_EndInterpreter(tstate_);
+#else
+  // ending the interpreter leaves the shared GIL held without a current thread state, swap back to the main interpreter to release it
+  PyGILState_STATE gil = PyGILState_Ensure();
+  PyThreadState *mainTstate = PyThreadState_Swap(tstate_);
+  Py_EndInterpreter(tstate_);
+  PyThreadState_Swap(mainTstate);
+  PyGILState_Release(gil);
+#endif
+}
+
+void PySubInterpreter::enter()
+{
+  if (depth_++ == 0)
+    PyEval_RestoreThread(tstate_);
+}
+
+void PySubInterpreter::exit()
+{
+  if (--depth_ == 0)
+    PyEval_SaveThread();
+}
+
+} // namespace pythonfmu
@@ -0,0 +1,142 @@
+#include <exception>
+#include <stdexcept>
+
+#include "pythonfmu/Slave.hpp"
+
+using namespace std;
+
+namespace pythonfmu
+{
+
+size_t Slave::doSteps(double currentTime, const fmi2Real *stepSizes, size_t nSteps,
+                      const fmi2ValueReference *inputVrs, size_t nInputs, const fmi2Real *inputs,
+                      const fmi2ValueReference *outputVrs, size_t nOutputs, fmi2Real *outputs)
+{
+  for (size_t k = 0; k < nSteps; ++k)
+  {
+    if (nInputs > 0)
+      setReal(inputVrs, nInputs, inputs + k * nInputs);
+
+    if (!doStep(currentTime, stepSizes[k]))
+      return k;
+
+    if (nOutputs > 0)
+      getReal(outputVrs, nOutputs, outputs + k * nOutputs);
+
+    currentTime += stepSizes[k];
+  }
+
+  return nSteps;
+}
+
+namespace
+{
+
+[[noreturn]] void no_model_exchange()
+{
+  throw runtime_error("The slave does not provide Model Exchange");
+}
+
+} // namespace
+
+void Slave::setTime(double)
+{
+  no_model_exchange();
+}
+
+void Slave::setContinuousStates(const fmi2Real *, size_t)
+{
+  no_model_exchange();
+}
+
+void Slave::getContinuousStates(fmi2Real *, size_t)
+{
+  no_model_exchange();
+}
+
+void Slave::getNominalsOfContinuousStates(fmi2Real *, size_t)
+{
+  no_model_exchange();
+}
+
+void Slave::getDerivatives(fmi2Real *, size_t)
+{
+  no_model_exchange();
+}
+
+void Slave::getEventIndicators(fmi2Real *, size_t)
+{
+  no_model_exchange();
+}
+
+void Slave::enterEventMode()
+{
+  no_model_exchange();
+}
+
+void Slave::newDiscreteStates(fmi2EventInfo *)
+{
+  no_model_exchange();
+}
+
+void Slave::enterContinuousTimeMode()
+{
+  no_model_exchange();
+}
+
+bool Slave::completedIntegratorStep(bool, bool *)
+{
+  no_model_exchange();
+}
+
+void Slave::getDirectionalDerivative(const fmi2ValueReference *, size_t, const fmi2ValueReference *, size_t, const fmi2Real *, fmi2Real *)
+{
+  throw runtime_error("The slave does not provide directional derivatives");
+}
+
+void Slave::getJacobian(const fmi2ValueReference *, size_t, const fmi2ValueReference *, size_t, fmi2Real *)
+{
+  throw runtime_error("The slave does not provide directional derivatives");
+}
+
+void Slave::setRealInputDerivatives(const fmi2ValueReference *, size_t, const fmi2Integer *, const fmi2Real *)
+{
+  throw runtime_error("The slave does not interpolate its inputs");
+}
+
+void Slave::getRealOutputDerivatives(const fmi2ValueReference *, size_t, const fmi2Integer *, fmi2Real *)
+{
+  throw runtime_error("The slave does not provide derivatives of its outputs");
+}
+
+void Slave::getRealEnsemble(const fmi2ValueReference *, size_t, fmi2Real *) const
+{
+  throw runtime_error("The slave does not simulate an ensemble");
+}
+
+void Slave::getIntegerEnsemble(const fmi2ValueReference *, size_t, fmi2Integer *) const
+{
+  throw runtime_error("The slave does not simulate an ensemble");
+}
+
+void Slave::getBooleanEnsemble(const fmi2ValueReference *, size_t, fmi2Boolean *) const
+{
+  throw runtime_error("The slave does not simulate an ensemble");
+}
+
+void Slave::setRealEnsemble(const fmi2ValueReference *, size_t, const fmi2Real *)
+{
+  throw runtime_error("The slave does not simulate an ensemble");
+}
+
+void Slave::setIntegerEnsemble(const fmi2ValueReference *, size_t, const fmi2Integer *)
+{
+  throw runtime_error("The slave does not simulate an ensemble");
+}
+
+void Slave::setBooleanEnsemble(const fmi2ValueReference *, size_t, const fmi2Boolean *)
+{
+  throw runtime_error("The slave does not simulate an ensemble");
+}
+
+} // namespace pythonfmu
@@ -0,0 +1,37 @@
+#include "pythonfmu/StringArena.hpp"
+#include "utility/py_compatability.hpp"
+
+using namespace std;
+
+namespace pythonfmu
+{
+
+string &StringArena::next()
+{
+  if (used_ == buffers_.size())
+    buffers_.emplace_back();
+
+  return buffers_[used_++];
+}
+
+const char *StringArena::store(std::string_view str)
+{
+  auto &buffer = next();
+  buffer.assign(str);
+  return buffer.c_str();
+}
+
+const char *StringArena::store(PyObject *unicode)
+{
+  auto &buffer = next();
+
+  if (!PyCompat::PyUnicode_AsUTF8(unicode, buffer))
+  {
+    --used_;
+    return nullptr;
+  }
+
+  return buffer.c_str();
+}
+
+} // namespace pythonfmu
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "fmt/format.h"
+
+#include "pythonfmu/ValueReferenceTable.hpp"
+
+using namespace fmt;
+using namespace std;
+
+namespace pythonfmu
+{
+
+ValueReferenceTable::ValueReferenceTable(const array<vector<fmi2ValueReference>, 4> &vrs)
+{
+  fmi2ValueReference end = 0;
+
+  for (auto &typeVrs : vrs)
+  {
+    if (!typeVrs.empty())
+      end = max(end, *max_element(typeVrs.begin(), typeVrs.end()) + 1);
+  }
+
+  types_.assign(end, Type::none);
+
+  for (size_t i = 0; i < vrs.size(); ++i)
+  {
+    auto type = static_cast<Type>(i + 1);
+
+    for (auto vr : vrs[i])
+    {
+      if (types_[vr] != Type::none)
+        throw invalid_argument(format("The value reference {} is used by several variables", vr));
+
+      types_[vr] = type;
+    }
+  }
+}
+
+const char *type_name(ValueReferenceTable::Type type)
+{
+  switch (type)
+  {
+  case ValueReferenceTable::Type::real:
+    return "Real";
+  case ValueReferenceTable::Type::integer:
+    return "Integer";
+  case ValueReferenceTable::Type::boolean:
+    return "Boolean";
+  case ValueReferenceTable::Type::string:
+    return "String";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace pythonfmu
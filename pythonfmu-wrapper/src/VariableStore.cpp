@@ -0,0 +1,184 @@
+#include <algorithm>
+
+#include "pythonfmu/VariableStore.hpp"
+
+using namespace std;
+
+namespace pythonfmu
+{
+
+template <typename T>
+VariableStore::Table<T>::Table(const vector<fmi2ValueReference> &vrs, size_t members) : values(vrs.size() * members), stride(vrs.size())
+{
+  if (vrs.empty())
+    return;
+
+  slots.assign(*max_element(vrs.begin(), vrs.end()) + 1, noSlot);
+
+  for (size_t i = 0; i < vrs.size(); ++i)
+    slots[vrs[i]] = i;
+
+  // runs are counted from the end, the run of a value reference extends that of its successor if both are stored consecutively
+  runs.assign(slots.size(), 0);
+
+  for (size_t vr = slots.size(); vr-- > 0;)
+  {
+    if (slots[vr] == noSlot)
+      continue;
+
+    bool extends = vr + 1 < slots.size() && slots[vr + 1] == slots[vr] + 1;
+    runs[vr] = extends ? runs[vr + 1] + 1 : 1;
+  }
+}
+
+template <typename T>
+bool VariableStore::Table<T>::is_block(const fmi2ValueReference *vr, size_t nvr) const
+{
+  if (nvr < 2 || vr[0] >= slots.size() || runs[vr[0]] < nvr || vr[nvr - 1] != vr[0] + nvr - 1)
+    return false;
+
+  // compared without exiting early, which allows the loop to be vectorized
+  fmi2ValueReference gaps = 0;
+  for (size_t i = 1; i < nvr; ++i)
+    gaps |= (vr[i] - vr[i - 1]) ^ 1;
+
+  return gaps == 0;
+}
+
+template <typename T>
+bool VariableStore::Table<T>::gather(const fmi2ValueReference *vr, size_t nvr, T *out, size_t member) const
+{
+  auto row = values.begin() + member * stride;
+
+  if (is_block(vr, nvr))
+  {
+    copy_n(row + slots[vr[0]], nvr, out);
+    return true;
+  }
+
+  for (size_t i = 0; i < nvr; ++i)
+  {
+    if (vr[i] >= slots.size() || slots[vr[i]] == noSlot)
+      return false;
+
+    out[i] = row[slots[vr[i]]];
+  }
+  return true;
+}
+
+template <typename T>
+bool VariableStore::Table<T>::scatter(const fmi2ValueReference *vr, size_t nvr, const T *in, size_t member)
+{
+  auto row = values.begin() + member * stride;
+
+  if (is_block(vr, nvr))
+  {
+    copy_n(in, nvr, row + slots[vr[0]]);
+    return true;
+  }
+
+  // validate before writing, such that the store is unchanged if the call is forwarded to the slave
+  for (size_t i = 0; i < nvr; ++i)
+  {
+    if (vr[i] >= slots.size() || slots[vr[i]] == noSlot)
+      return false;
+  }
+
+  for (size_t i = 0; i < nvr; ++i)
+    row[slots[vr[i]]] = in[i];
+
+  return true;
+}
+
+template <typename T>
+bool VariableStore::Table<T>::gather_members(const fmi2ValueReference *vr, size_t nvr, T *out, size_t members) const
+{
+  for (size_t member = 0; member < members; ++member)
+  {
+    if (!gather(vr, nvr, out + member * nvr, member))
+      return false;
+  }
+  return true;
+}
+
+template <typename T>
+bool VariableStore::Table<T>::scatter_members(const fmi2ValueReference *vr, size_t nvr, const T *in, size_t members)
+{
+  // the value references are validated by the first member, before any value is written
+  for (size_t member = 0; member < members; ++member)
+  {
+    if (!scatter(vr, nvr, in + member * nvr, member))
+      return false;
+  }
+  return true;
+}
+
+VariableStore::VariableStore(const vector<fmi2ValueReference> &realVrs,
+                             const vector<fmi2ValueReference> &integerVrs,
+                             const vector<fmi2ValueReference> &booleanVrs,
+                             size_t members)
+    : reals_(realVrs, members), integers_(integerVrs, members), booleans_(booleanVrs, members), members_(members)
+{
+}
+
+bool VariableStore::getReal(const fmi2ValueReference *vr, size_t nvr, fmi2Real *values) const
+{
+  return reals_.gather(vr, nvr, values);
+}
+
+bool VariableStore::getInteger(const fmi2ValueReference *vr, size_t nvr, fmi2Integer *values) const
+{
+  return integers_.gather(vr, nvr, values);
+}
+
+bool VariableStore::getBoolean(const fmi2ValueReference *vr, size_t nvr, fmi2Boolean *values) const
+{
+  return booleans_.gather(vr, nvr, values);
+}
+
+bool VariableStore::setReal(const fmi2ValueReference *vr, size_t nvr, const fmi2Real *values)
+{
+  return reals_.scatter(vr, nvr, values);
+}
+
+bool VariableStore::setInteger(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *values)
+{
+  return integers_.scatter(vr, nvr, values);
+}
+
+bool VariableStore::setBoolean(const fmi2ValueReference *vr, size_t nvr, const fmi2Boolean *values)
+{
+  return booleans_.scatter(vr, nvr, values);
+}
+
+bool VariableStore::getRealEnsemble(const fmi2ValueReference *vr, size_t nvr, fmi2Real *values) const
+{
+  return reals_.gather_members(vr, nvr, values, members_);
+}
+
+bool VariableStore::getIntegerEnsemble(const fmi2ValueReference *vr, size_t nvr, fmi2Integer *values) const
+{
+  return integers_.gather_members(vr, nvr, values, members_);
+}
+
+bool VariableStore::getBooleanEnsemble(const fmi2ValueReference *vr, size_t nvr, fmi2Boolean *values) const
+{
+  return booleans_.gather_members(vr, nvr, values, members_);
+}
+
+bool VariableStore::setRealEnsemble(const fmi2ValueReference *vr, size_t nvr, const fmi2Real *values)
+{
+  return reals_.scatter_members(vr, nvr, values, members_);
+}
+
+bool VariableStore::setIntegerEnsemble(const fmi2ValueReference *vr, size_t nvr, const fmi2Integer *values)
+{
+  return integers_.scatter_members(vr, nvr, values, members_);
+}
+
+bool VariableStore::setBooleanEnsemble(const fmi2ValueReference *vr, size_t nvr, const fmi2Boolean *values)
+{
+  return booleans_.scatter_members(vr, nvr, values, members_);
+}
+
+} // namespace pythonfmu
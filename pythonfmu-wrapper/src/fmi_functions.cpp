@@ -1,7 +1,10 @@
+#include <chrono>
+#include <deque>
 #include <exception>
 #include <limits>
 #include <memory>
 #include <map>
+#include <mutex>
 #include <vector>
 #include <optional>
 
@@ -9,9 +12,15 @@
 #include "fmt/format.h"
 
 #include "fmi/fmi2Functions.h"
+#include "pythonfmu/AsyncSlave.hpp"
+#include "pythonfmu/ForkServer.hpp"
 #include "pythonfmu/Logger.hpp"
+#include "pythonfmu/ProcessSlave.hpp"
+#include "pythonfmu/Profile.hpp"
+#include "pythonfmu/PyConfiguration.hpp"
 #include "pythonfmu/PyInitializer.hpp"
 #include "pythonfmu/PyObjectWrapper.hpp"
+#include "pythonfmu/pyfmuFunctions.h"
 #include "utility/utils.hpp"
 
 using namespace fmt;
@@ -30,28 +39,275 @@ std::optional<string> validate_fmi2callbackFunctions(const fmi2CallbackFunctions
   bool hasAllocateMemory = functions->allocateMemory != nullptr;
   bool hasFreeMemory = functions->freeMemory != nullptr;
   bool hasLogger = functions->logger != nullptr;
-  bool hasStepFinished = functions->stepFinished != nullptr;
 
-  //bool isValid = hasAllocateMemory && hasFreeMemory && hasLogger && hasStepFinished;
+  // stepFinished is optional, it is only required by asynchronous stepping, which falls back to synchronous steps without it
   bool isValid = hasAllocateMemory && hasFreeMemory && hasLogger;
 
   if (isValid)
     return {};
 
-  if (!hasLogger)
+  if (!hasAllocateMemory)
     msg.append(" no allocate memory function was specified ");
   if (!hasFreeMemory)
     msg.append(" no free memory function was specified ");
-
   if (!hasLogger)
-    msg.append(" no free memory function was specified ");
-
-  if (!hasStepFinished)
-    msg.append(" no step finished function was specified");
+    msg.append(" no logger function was specified ");
 
   return msg;
 }
 
+namespace
+{
+
+/**
+ * @brief State owned by a single instance of the FMU.
+ * 
+ * The slave doubles as the component returned to the simulation environment.
+ * The members are destroyed in reverse order, such that the slave is destroyed while the interpreter is still alive.
+ * Slaves executed by a worker process do not use the interpreter of the host.
+ */
+struct Instance
+{
+  shared_ptr<pythonfmu::PyInitializer> interpreter;
+  unique_ptr<Logger> logger;
+
+  /**
+   * @brief Histograms of the calls of the instance, nullptr unless profiling is enabled, outlives the slave recording into it.
+   */
+  unique_ptr<pythonfmu::Profile> profile;
+
+  /**
+   * @brief Profile returned by the last call of pyfmuGetProfile, as JSON.
+   */
+  string profileJson;
+
+  unique_ptr<pythonfmu::Slave> slave;
+
+  /**
+   * @brief Pool the instance is returned to when freed, identified by the resources and GUID of the FMU, and its settings.
+   */
+  string poolKey;
+  pyconfiguration::PoolConfiguration pool;
+};
+
+/**
+ * @brief Instances which have been instantiated and not yet freed, by component.
+ */
+mutex instancesMutex;
+map<fmi2Component, unique_ptr<Instance>> instances;
+
+/**
+ * @brief Wait until the messages queued by the logger of the instance, if asynchronous, have been delivered.
+ */
+void flush_log(fmi2Component c)
+{
+  Logger *logger = nullptr;
+
+  {
+    lock_guard<mutex> lock(instancesMutex);
+
+    auto it = instances.find(c);
+    if (it != instances.end())
+      logger = it->second->logger.get();
+  }
+
+  // the instance can not be freed while one of its functions is executing
+  if (logger != nullptr)
+    logger->flush();
+}
+
+/**
+ * @brief Log a summary of the profile of the instance if its configuration asks for it.
+ */
+void dump_profile(fmi2Component c)
+{
+  Logger *logger = nullptr;
+  pythonfmu::Profile *profile = nullptr;
+
+  {
+    lock_guard<mutex> lock(instancesMutex);
+
+    auto it = instances.find(c);
+    if (it != instances.end())
+    {
+      logger = it->second->logger.get();
+      profile = it->second->profile.get();
+    }
+  }
+
+  if (profile != nullptr && profile->dumpOnTerminate())
+    logger->log(fmi2OK, "profile", profile->summary());
+}
+
+/**
+ * @brief Freed instance kept for reuse, along with the time it was freed at.
+ */
+struct PooledInstance
+{
+  unique_ptr<Instance> instance;
+  chrono::steady_clock::time_point freed;
+};
+
+mutex poolMutex;
+
+/**
+ * @brief Freed instances kept for reuse, by pool key, the most recently freed instance last.
+ * 
+ * Intentionally leaked, such that pooled instances are not destroyed when the library is unloaded,
+ * since finalizing the interpreter from a static destructor is not safe.
+ */
+auto &pool = *new map<string, deque<PooledInstance>>();
+
+/**
+ * @brief Move instances which have been idle for longer than allowed out of the pool, must be called holding poolMutex.
+ * 
+ * There is no thread evicting instances in the background, this runs whenever an instance is taken from or returned to the pool.
+ */
+void evict_idle(vector<unique_ptr<Instance>> &evicted)
+{
+  auto now = chrono::steady_clock::now();
+
+  for (auto &[key, instances] : pool)
+  {
+    while (!instances.empty())
+    {
+      auto &oldest = instances.front();
+      double maxIdle = oldest.instance->pool.max_idle;
+
+      if (maxIdle == 0 || now - oldest.freed < chrono::duration<double>(maxIdle))
+        break;
+
+      evicted.push_back(move(oldest.instance));
+      instances.pop_front();
+    }
+  }
+}
+
+/**
+ * @brief Take the most recently freed instance of the FMU out of the pool.
+ * 
+ * @return the instance, or nullptr if none is pooled
+ */
+unique_ptr<Instance> take_pooled(const string &key)
+{
+  vector<unique_ptr<Instance>> evicted;
+  unique_ptr<Instance> instance;
+
+  {
+    lock_guard<mutex> lock(poolMutex);
+    evict_idle(evicted);
+
+    auto it = pool.find(key);
+    if (it != pool.end() && !it->second.empty())
+    {
+      instance = move(it->second.back().instance);
+      it->second.pop_back();
+    }
+  }
+
+  // destroyed outside of the lock, destroying the last instance finalizes the interpreter
+  return instance;
+}
+
+/**
+ * @brief Return a freed instance to the pool, evicting the least recently freed instance if the pool is full.
+ */
+void return_to_pool(unique_ptr<Instance> instance)
+{
+  vector<unique_ptr<Instance>> evicted;
+
+  {
+    lock_guard<mutex> lock(poolMutex);
+    evict_idle(evicted);
+
+    auto &instances = pool[instance->poolKey];
+    if (instances.size() == instance->pool.size)
+    {
+      evicted.push_back(move(instances.front().instance));
+      instances.pop_front();
+    }
+
+    instances.push_back({move(instance), chrono::steady_clock::now()});
+  }
+}
+
+/**
+ * @brief Prepare a pooled instance for use by another instantiation, as if it was freshly instantiated.
+ * 
+ * @return false if the instance could not be reset, in which case it must be destroyed
+ */
+bool reuse_pooled(Instance &instance, fmi2String instanceName, const fmi2CallbackFunctions *functions, fmi2Boolean loggingOn)
+{
+  instance.logger->rebind(functions->componentEnvironment, functions->logger, instanceName, loggingOn);
+
+  try
+  {
+    instance.slave->reset();
+    instance.slave->setDebugLogging(loggingOn, 0, nullptr);
+  }
+  catch (const exception &e)
+  {
+    instance.logger->warning(format("Failed to reset the pooled instance, a new instance is created: {}\n", e.what()));
+    return false;
+  }
+
+  // the histograms describe the calls of the freed instance
+  if (instance.profile != nullptr)
+    instance.profile->clear();
+
+  instance.logger->ok("Reusing a pooled instance\n");
+  return true;
+}
+
+/**
+ * @brief Register an instance which is ready for use, wrapping its slave if steps are to be taken asynchronously.
+ * 
+ * The time since the instantiation started is recorded as the latency of fmi2Instantiate, if the instance is profiled.
+ * 
+ * @return the component of the instance, or nullptr if the slave does not support the requested type of FMU
+ */
+fmi2Component add_instance(unique_ptr<Instance> instance, fmi2Type fmuType, const pyconfiguration::PyConfiguration &config, const fmi2CallbackFunctions *functions,
+                           chrono::steady_clock::time_point started)
+{
+  if (fmuType == fmi2ModelExchange && !instance->slave->providesModelExchange())
+  {
+    instance->logger->fatal("The slave does not provide Model Exchange, it must register its continuous states using register_state\n");
+    return nullptr;
+  }
+
+  if (config.profiling.enabled && instance->profile == nullptr)
+  {
+#ifdef PYFMU_PROFILING
+    instance->profile = make_unique<pythonfmu::Profile>(config.profiling.dump_on_terminate);
+#else
+    instance->logger->warning("Profiling is enabled by the configuration, but the wrapper was built without support for it\n");
+#endif
+  }
+
+  // Model Exchange has no steps, the functions of the instance are called synchronously
+  if (config.stepping == "async" && fmuType == fmi2CoSimulation)
+  {
+    if (functions->stepFinished == nullptr)
+      instance->logger->warning("Asynchronous stepping requires a stepFinished callback, which was not provided, steps are taken synchronously\n");
+    else
+      instance->slave = make_unique<pythonfmu::AsyncSlave>(move(instance->slave), functions->stepFinished, functions->componentEnvironment, instance->logger.get());
+  }
+
+  instance->slave->setProfile(instance->profile.get());
+
+  if (instance->profile != nullptr)
+    instance->profile->record(pythonfmu::Profile::Function::instantiate, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count());
+
+  fmi2Component c = instance->slave.get();
+
+  lock_guard<mutex> lock(instancesMutex);
+  instances.emplace(c, move(instance));
+
+  return c;
+}
+
+} // namespace
+
 // FMI functions
 extern "C" {
 
@@ -66,18 +322,23 @@ const char *fmi2GetVersion() { return "2.0"; }
 using namespace pythonfmu;
 using namespace std;
 
-vector<PyObjectWrapper> components;
-PyObjectWrapper *component = nullptr;
-PyInitializer *pyInitializer = nullptr;
-
-bool loggingOn_ = false;
-
 fmi2Component fmi2Instantiate(fmi2String instanceName, fmi2Type fmuType,
                               fmi2String fmuGUID,
                               fmi2String fmuResourceLocation,
                               const fmi2CallbackFunctions *functions,
                               fmi2Boolean visible, fmi2Boolean loggingOn)
 {
+  return pyfmuInstantiateEnsemble(instanceName, fmuType, fmuGUID, fmuResourceLocation, functions, visible, loggingOn, 1);
+}
+
+fmi2Component pyfmuInstantiateEnsemble(fmi2String instanceName, fmi2Type fmuType,
+                                       fmi2String fmuGUID,
+                                       fmi2String fmuResourceLocation,
+                                       const fmi2CallbackFunctions *functions,
+                                       fmi2Boolean /*visible*/, fmi2Boolean loggingOn,
+                                       size_t nMembers)
+{
+  auto started = chrono::steady_clock::now();
 
   auto callbacksValid = validate_fmi2callbackFunctions(functions);
 
@@ -87,45 +348,147 @@ fmi2Component fmi2Instantiate(fmi2String instanceName, fmi2Type fmuType,
     return NULL;
   }
 
-  Logger *logger = new Logger(functions->componentEnvironment, functions->logger, instanceName);
+  auto instance = make_unique<Instance>();
+  instance->logger = make_unique<Logger>(functions->componentEnvironment, functions->logger, instanceName, loggingOn);
+  Logger *logger = instance->logger.get();
+
+  logger->ok("Instantiating FMU\n");
 
-  logger->log(fmi2Status::fmi2OK, "wrapper", "Instantiating FMU\n");
+  if (nMembers == 0 || (nMembers > 1 && fmuType != fmi2CoSimulation))
+  {
+    logger->fatal(format("An ensemble must have at least one member and is simulated using co-simulation, {} members were requested\n", nMembers));
+    return NULL;
+  }
 
-  logger->log(fmi2Status::fmi2OK, "wrapper", "Initializing Python interpreter\n");
+  filesystem::path fmuResourceLocationPath;
+  pyconfiguration::PyConfiguration config;
 
   try
   {
-    pyInitializer = new PyInitializer(logger);
+    fmuResourceLocationPath = getPathFromFileUri(fmuResourceLocation);
+    config = read_configuration(fmuResourceLocationPath / "slave_configuration.json", logger);
   }
-  catch (exception)
+  catch (const exception &e)
   {
-    logger->log(fmi2Status::fmi2Fatal, "error", "failed to initialize embedded Python interpreter\n");
+    logger->fatal(format("Failed to read the configuration of the slave: {}\n", e.what()));
     return NULL;
   }
 
-  logger->log(fmi2Status::fmi2OK, "wrapper",
-              "Successfully initialized Python interpreter\n");
+  string poolKey = format("{}\n{}\n{}", fmuResourceLocationPath.string(), (fmuGUID != nullptr) ? fmuGUID : "", nMembers);
 
-  logger->log(fmi2Status::fmi2OK, "wrapper", "Initializing Python FMU wrapper\n");
+  if (config.pool.size > 0)
+  {
+    auto pooled = take_pooled(poolKey);
 
-  auto fmuResourceLocationPath = getPathFromFileUri(fmuResourceLocation);
+    if (pooled != nullptr && reuse_pooled(*pooled, instanceName, functions, loggingOn))
+      return add_instance(move(pooled), fmuType, config, functions, started);
+  }
 
-  try
+  if (config.logging.mode == "async")
   {
-    component = new PyObjectWrapper(fmuResourceLocationPath, move(logger));
-
-    return component;
+    auto overflow = (config.logging.overflow == "block") ? Logger::Overflow::block : (config.logging.overflow == "sample") ? Logger::Overflow::sample : Logger::Overflow::drop;
+    logger->startAsync(config.logging.capacity, overflow);
   }
-  catch (exception)
+
+  if (config.interpreter == "process" || config.interpreter == "fork")
   {
-    //logger->log(fmi2Status::fmi2Fatal, "Error", "failed to load main script\n");
+    if (nMembers > 1)
+    {
+      logger->fatal("Ensembles can not be simulated in a worker process, the interpreter of the slave must be shared or isolated\n");
+      return NULL;
+    }
+
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+    try
+    {
+      ForkServer *forkServer = (config.interpreter == "fork") ? &ForkServer::acquire(fmuResourceLocationPath, logger) : nullptr;
+      instance->slave = make_unique<ProcessSlave>(fmuResourceLocationPath, instanceName, logger, forkServer);
+    }
+    catch (exception)
+    {
+      return NULL;
+    }
+#else
+    logger->fatal("Executing the slave in a worker process is not supported on this platform\n");
     return NULL;
+#endif
+  }
+  else
+  {
+    logger->ok("Initializing Python interpreter\n");
+
+    try
+    {
+      instance->interpreter = PyInitializer::acquire(logger);
+    }
+    catch (exception)
+    {
+      logger->log(fmi2Status::fmi2Fatal, "error", "failed to initialize embedded Python interpreter\n");
+      return NULL;
+    }
+
+    logger->ok("Successfully initialized Python interpreter\n");
+
+    logger->ok("Initializing Python FMU wrapper\n");
+
+    try
+    {
+      instance->slave = make_unique<PyObjectWrapper>(fmuResourceLocationPath, config, logger, nMembers);
+    }
+    catch (exception)
+    {
+      //logger->log(fmi2Status::fmi2Fatal, "Error", "failed to load main script\n");
+      return NULL;
+    }
   }
+
+  instance->poolKey = move(poolKey);
+  instance->pool = config.pool;
+
+  return add_instance(move(instance), fmuType, config, functions, started);
 }
 
 void fmi2FreeInstance(fmi2Component c)
 {
-  // TODO implement correctly
+  unique_ptr<Instance> instance;
+
+  {
+    lock_guard<mutex> lock(instancesMutex);
+
+    auto it = instances.find(c);
+    if (it == instances.end())
+      return;
+
+    instance = move(it->second);
+    instances.erase(it);
+  }
+
+  instance->logger->ok("Freeing instance\n");
+
+  if (instance->pool.size > 0)
+  {
+    // the slave is pooled without its asynchronous wrapper, which is bound to the callbacks of the freed instance
+    if (auto async = dynamic_cast<AsyncSlave *>(instance->slave.get()))
+      instance->slave = async->detach();
+
+    try
+    {
+      instance->slave->freeAllFMUstates();
+
+      // the callbacks of the freed instance must not be invoked once this returns
+      instance->logger->flush();
+      return_to_pool(move(instance));
+      return;
+    }
+    catch (const exception &e)
+    {
+      instance->logger->warning(format("Failed to return the instance to the pool, it is destroyed: {}\n", e.what()));
+    }
+  }
+
+  // destroyed outside of the lock, releasing the last instance finalizes the interpreter
+  // the logger delivers its queued messages when destroyed, after the slave
+  instance.reset();
 }
 
 fmi2Status fmi2SetDebugLogging(fmi2Component c, fmi2Boolean loggingOn,
@@ -133,13 +496,14 @@ fmi2Status fmi2SetDebugLogging(fmi2Component c, fmi2Boolean loggingOn,
                                const fmi2String categories[])
 {
   
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setDebugLogging);
 
   fmi2Status status = fmi2OK;
 
   try
   {
-    status = cc->setDebugLogging(true,nCategories,categories);
+    status = cc->setDebugLogging(loggingOn, nCategories, categories);
   }
   catch (const exception)
   {
@@ -154,7 +518,8 @@ fmi2Status fmi2SetupExperiment(fmi2Component c, fmi2Boolean toleranceDefined,
                                fmi2Boolean stopTimeDefined, fmi2Real stopTime)
 {
 
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setupExperiment);
 
   try
   {
@@ -171,7 +536,8 @@ fmi2Status fmi2SetupExperiment(fmi2Component c, fmi2Boolean toleranceDefined,
 fmi2Status fmi2EnterInitializationMode(fmi2Component c)
 {
 
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::enterInitializationMode);
 
   try
   {
@@ -188,7 +554,8 @@ fmi2Status fmi2EnterInitializationMode(fmi2Component c)
 fmi2Status fmi2ExitInitializationMode(fmi2Component c)
 {
 
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::exitInitializationMode);
 
   try
   {
@@ -205,7 +572,10 @@ fmi2Status fmi2ExitInitializationMode(fmi2Component c)
 fmi2Status fmi2Terminate(fmi2Component c)
 {
 
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::terminate);
+
+  fmi2Status status = fmi2OK;
 
   try
   {
@@ -213,16 +583,23 @@ fmi2Status fmi2Terminate(fmi2Component c)
   }
   catch (const exception)
   {
-    return fmi2Error;
+    status = fmi2Error;
   }
 
-  return fmi2OK;
+  // the summary includes this call, but not the time spent logging it
+  t.stop();
+  dump_profile(c);
+
+  flush_log(c);
+
+  return status;
 }
 
 fmi2Status fmi2Reset(fmi2Component c)
 {
 
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::reset);
 
   try
   {
@@ -240,7 +617,8 @@ fmi2Status fmi2GetReal(fmi2Component c, const fmi2ValueReference vr[],
                        size_t nvr, fmi2Real value[])
 {
 
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getReal);
 
   try
   {
@@ -257,7 +635,8 @@ fmi2Status fmi2GetReal(fmi2Component c, const fmi2ValueReference vr[],
 fmi2Status fmi2GetInteger(fmi2Component c, const fmi2ValueReference vr[],
                           size_t nvr, fmi2Integer value[])
 {
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getInteger);
 
   try
   {
@@ -274,7 +653,8 @@ fmi2Status fmi2GetInteger(fmi2Component c, const fmi2ValueReference vr[],
 fmi2Status fmi2GetBoolean(fmi2Component c, const fmi2ValueReference vr[],
                           size_t nvr, fmi2Boolean value[])
 {
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getBoolean);
 
   try
   {
@@ -291,7 +671,8 @@ fmi2Status fmi2GetBoolean(fmi2Component c, const fmi2ValueReference vr[],
 fmi2Status fmi2GetString(fmi2Component c, const fmi2ValueReference vr[],
                          size_t nvr, fmi2String value[])
 {
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getString);
 
   try
   {
@@ -309,7 +690,8 @@ fmi2Status fmi2SetReal(fmi2Component c, const fmi2ValueReference vr[],
                        size_t nvr, const fmi2Real value[])
 {
 
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setReal);
 
   try
   {
@@ -326,7 +708,8 @@ fmi2Status fmi2SetReal(fmi2Component c, const fmi2ValueReference vr[],
 fmi2Status fmi2SetInteger(fmi2Component c, const fmi2ValueReference vr[],
                           size_t nvr, const fmi2Integer value[])
 {
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setInteger);
 
   try
   {
@@ -343,7 +726,8 @@ fmi2Status fmi2SetInteger(fmi2Component c, const fmi2ValueReference vr[],
 fmi2Status fmi2SetBoolean(fmi2Component c, const fmi2ValueReference vr[],
                           size_t nvr, const fmi2Boolean value[])
 {
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setBoolean);
 
   try
   {
@@ -360,7 +744,8 @@ fmi2Status fmi2SetBoolean(fmi2Component c, const fmi2ValueReference vr[],
 fmi2Status fmi2SetString(fmi2Component c, const fmi2ValueReference vr[],
                          size_t nvr, const fmi2String value[])
 {
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setString);
 
   try
   {
@@ -374,66 +759,406 @@ fmi2Status fmi2SetString(fmi2Component c, const fmi2ValueReference vr[],
   return fmi2OK;
 }
 
-fmi2Status fmi2GetFMUstate(fmi2Component c, fmi2FMUstate *)
+fmi2Status fmi2GetFMUstate(fmi2Component c, fmi2FMUstate *state)
 {
-  return fmi2Error;
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getFMUstate);
+
+  try
+  {
+    *state = cc->getFMUstate(*state);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
 }
 
-fmi2Status fmi2SetFMUstate(fmi2Component c, fmi2FMUstate) { return fmi2Error; }
+fmi2Status fmi2SetFMUstate(fmi2Component c, fmi2FMUstate state)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setFMUstate);
+
+  try
+  {
+    cc->setFMUstate(state);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
 
-fmi2Status fmi2FreeFMUstate(fmi2Component c, fmi2FMUstate *)
+fmi2Status fmi2FreeFMUstate(fmi2Component c, fmi2FMUstate *state)
 {
-  return fmi2Error;
+  if (*state == nullptr)
+    return fmi2OK;
+
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::freeFMUstate);
+
+  try
+  {
+    cc->freeFMUstate(*state);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  *state = nullptr;
+  return fmi2OK;
 }
 
-fmi2Status fmi2SerializedFMUstateSize(fmi2Component c, fmi2FMUstate, size_t *)
+fmi2Status fmi2SerializedFMUstateSize(fmi2Component c, fmi2FMUstate state, size_t *size)
 {
-  return fmi2Error;
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::serializedFMUstateSize);
+
+  try
+  {
+    *size = cc->serializedFMUstateSize(state);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
 }
 
-fmi2Status fmi2SerializeFMUstate(fmi2Component c, fmi2FMUstate, fmi2Byte[],
-                                 size_t)
+fmi2Status fmi2SerializeFMUstate(fmi2Component c, fmi2FMUstate state, fmi2Byte serializedState[],
+                                 size_t size)
 {
-  return fmi2Error;
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::serializeFMUstate);
+
+  try
+  {
+    cc->serializeFMUstate(state, serializedState, size);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
 }
 
-fmi2Status fmi2DeSerializeFMUstate(fmi2Component c, const fmi2Byte[], size_t,
-                                   fmi2FMUstate *)
+fmi2Status fmi2DeSerializeFMUstate(fmi2Component c, const fmi2Byte serializedState[], size_t size,
+                                   fmi2FMUstate *state)
 {
-  return fmi2Error;
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::deSerializeFMUstate);
+
+  try
+  {
+    *state = cc->deSerializeFMUstate(serializedState, size, *state);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
 }
 
 fmi2Status fmi2GetDirectionalDerivative(fmi2Component c,
-                                        const fmi2ValueReference[], size_t,
-                                        const fmi2ValueReference[], size_t,
-                                        const fmi2Real[], fmi2Real[])
+                                        const fmi2ValueReference vUnknown_ref[], size_t nUnknown,
+                                        const fmi2ValueReference vKnown_ref[], size_t nKnown,
+                                        const fmi2Real dvKnown[], fmi2Real dvUnknown[])
 {
-  return fmi2Error;
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getDirectionalDerivative);
+
+  try
+  {
+    cc->getDirectionalDerivative(vUnknown_ref, nUnknown, vKnown_ref, nKnown, dvKnown, dvUnknown);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
 }
 
 fmi2Status fmi2SetRealInputDerivatives(fmi2Component c,
-                                       const fmi2ValueReference[], size_t,
-                                       const fmi2Integer[], const fmi2Real[])
+                                       const fmi2ValueReference vr[], size_t nvr,
+                                       const fmi2Integer order[], const fmi2Real value[])
 {
-  return fmi2Error;
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setRealInputDerivatives);
+
+  try
+  {
+    cc->setRealInputDerivatives(vr, nvr, order, value);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
 }
 
 fmi2Status fmi2GetRealOutputDerivatives(fmi2Component c,
-                                        const fmi2ValueReference[], size_t,
-                                        const fmi2Integer[], fmi2Real[])
+                                        const fmi2ValueReference vr[], size_t nvr,
+                                        const fmi2Integer order[], fmi2Real value[])
 {
-  return fmi2Error;
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getRealOutputDerivatives);
+
+  try
+  {
+    cc->getRealOutputDerivatives(vr, nvr, order, value);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status fmi2SetTime(fmi2Component c, fmi2Real time)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setTime);
+
+  try
+  {
+    cc->setTime(time);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status fmi2SetContinuousStates(fmi2Component c, const fmi2Real x[], size_t nx)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setContinuousStates);
+
+  try
+  {
+    cc->setContinuousStates(x, nx);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status fmi2GetContinuousStates(fmi2Component c, fmi2Real x[], size_t nx)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getContinuousStates);
+
+  try
+  {
+    cc->getContinuousStates(x, nx);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status fmi2GetNominalsOfContinuousStates(fmi2Component c, fmi2Real x_nominal[], size_t nx)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getNominalsOfContinuousStates);
+
+  try
+  {
+    cc->getNominalsOfContinuousStates(x_nominal, nx);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status fmi2GetDerivatives(fmi2Component c, fmi2Real derivatives[], size_t nx)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getDerivatives);
+
+  try
+  {
+    cc->getDerivatives(derivatives, nx);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status fmi2GetEventIndicators(fmi2Component c, fmi2Real eventIndicators[], size_t ni)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getEventIndicators);
+
+  try
+  {
+    cc->getEventIndicators(eventIndicators, ni);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status fmi2EnterEventMode(fmi2Component c)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::enterEventMode);
+
+  try
+  {
+    cc->enterEventMode();
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status fmi2NewDiscreteStates(fmi2Component c, fmi2EventInfo *eventInfo)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::newDiscreteStates);
+
+  try
+  {
+    cc->newDiscreteStates(eventInfo);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status fmi2EnterContinuousTimeMode(fmi2Component c)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::enterContinuousTimeMode);
+
+  try
+  {
+    cc->enterContinuousTimeMode();
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status fmi2CompletedIntegratorStep(fmi2Component c, fmi2Boolean noSetFMUStatePriorToCurrentPoint,
+                                       fmi2Boolean *enterEventMode, fmi2Boolean *terminateSimulation)
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::completedIntegratorStep);
+
+  try
+  {
+    bool terminate = false;
+    *enterEventMode = cc->completedIntegratorStep(noSetFMUStatePriorToCurrentPoint, &terminate) ? fmi2True : fmi2False;
+    *terminateSimulation = terminate ? fmi2True : fmi2False;
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
 }
 
 fmi2Status fmi2DoStep(fmi2Component c, fmi2Real currentCommunicationPoint,
                       fmi2Real communicationStepSize, fmi2Boolean)
 {
 
-  auto cc = reinterpret_cast<PyObjectWrapper *>(c);
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::doStep);
+
+  if (auto async = dynamic_cast<AsyncSlave *>(cc))
+    return async->startStep(currentCommunicationPoint, communicationStepSize);
+
+  try
+  {
+    return cc->doStep(currentCommunicationPoint, communicationStepSize) ? fmi2OK : fmi2Discard;
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+}
+
+fmi2Status pyfmuDoSteps(fmi2Component c, fmi2Real currentCommunicationPoint,
+                        const fmi2Real communicationStepSizes[], size_t nSteps,
+                        const fmi2ValueReference inputs[], size_t nInputs, const fmi2Real inputValues[],
+                        const fmi2ValueReference outputs[], size_t nOutputs, fmi2Real outputValues[],
+                        size_t *nCompletedSteps)
+{
+
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::doSteps);
+  size_t completed = 0;
 
   try
   {
-    cc->doStep(currentCommunicationPoint, communicationStepSize);
+    completed = cc->doSteps(currentCommunicationPoint, communicationStepSizes, nSteps,
+                            inputs, nInputs, inputValues, outputs, nOutputs, outputValues);
+  }
+  catch (exception)
+  {
+    if (nCompletedSteps != nullptr)
+      *nCompletedSteps = 0;
+
+    return fmi2Error;
+  }
+
+  if (nCompletedSteps != nullptr)
+    *nCompletedSteps = completed;
+
+  return (completed == nSteps) ? fmi2OK : fmi2Discard;
+}
+
+fmi2Status pyfmuGetJacobian(fmi2Component c,
+                            const fmi2ValueReference unknowns[], size_t nUnknowns,
+                            const fmi2ValueReference knowns[], size_t nKnowns,
+                            fmi2Real jacobian[])
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getJacobian);
+
+  try
+  {
+    cc->getJacobian(unknowns, nUnknowns, knowns, nKnowns, jacobian);
   }
   catch (exception)
   {
@@ -443,18 +1168,170 @@ fmi2Status fmi2DoStep(fmi2Component c, fmi2Real currentCommunicationPoint,
   return fmi2OK;
 }
 
-fmi2Status fmi2CancelStep(fmi2Component c) { return fmi2Error; }
+fmi2Status pyfmuGetRealEnsemble(fmi2Component c, const fmi2ValueReference vr[],
+                                size_t nvr, fmi2Real value[])
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getRealEnsemble);
+
+  try
+  {
+    cc->getRealEnsemble(vr, nvr, value);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
 
-fmi2Status fmi2GetStatus(fmi2Component c, const fmi2StatusKind, fmi2Status *)
+fmi2Status pyfmuGetIntegerEnsemble(fmi2Component c, const fmi2ValueReference vr[],
+                                   size_t nvr, fmi2Integer value[])
 {
-  return fmi2Error;
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getIntegerEnsemble);
+
+  try
+  {
+    cc->getIntegerEnsemble(vr, nvr, value);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status pyfmuGetBooleanEnsemble(fmi2Component c, const fmi2ValueReference vr[],
+                                   size_t nvr, fmi2Boolean value[])
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::getBooleanEnsemble);
+
+  try
+  {
+    cc->getBooleanEnsemble(vr, nvr, value);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status pyfmuSetRealEnsemble(fmi2Component c, const fmi2ValueReference vr[],
+                                size_t nvr, const fmi2Real value[])
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setRealEnsemble);
+
+  try
+  {
+    cc->setRealEnsemble(vr, nvr, value);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status pyfmuSetIntegerEnsemble(fmi2Component c, const fmi2ValueReference vr[],
+                                   size_t nvr, const fmi2Integer value[])
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setIntegerEnsemble);
+
+  try
+  {
+    cc->setIntegerEnsemble(vr, nvr, value);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status pyfmuSetBooleanEnsemble(fmi2Component c, const fmi2ValueReference vr[],
+                                   size_t nvr, const fmi2Boolean value[])
+{
+  auto cc = reinterpret_cast<Slave *>(c);
+  Profile::FunctionTimer t(cc->profile(), Profile::Function::setBooleanEnsemble);
+
+  try
+  {
+    cc->setBooleanEnsemble(vr, nvr, value);
+  }
+  catch (exception)
+  {
+    return fmi2Error;
+  }
+
+  return fmi2OK;
+}
+
+fmi2Status pyfmuGetProfile(fmi2Component c, fmi2String *profile)
+{
+  lock_guard<mutex> lock(instancesMutex);
+
+  auto it = instances.find(c);
+  if (it == instances.end() || it->second->profile == nullptr)
+    return fmi2Error;
+
+  auto &instance = *it->second;
+  instance.profileJson = instance.profile->to_json();
+  *profile = instance.profileJson.c_str();
+
+  return fmi2OK;
+}
+
+fmi2Status pyfmuResetProfile(fmi2Component c)
+{
+  lock_guard<mutex> lock(instancesMutex);
+
+  auto it = instances.find(c);
+  if (it == instances.end() || it->second->profile == nullptr)
+    return fmi2Error;
+
+  it->second->profile->clear();
+  return fmi2OK;
+}
+
+fmi2Status fmi2CancelStep(fmi2Component c)
+{
+  auto async = dynamic_cast<AsyncSlave *>(reinterpret_cast<Slave *>(c));
+
+  if (async == nullptr)
+    return fmi2Error;
+
+  return async->cancelStep();
+}
+
+fmi2Status fmi2GetStatus(fmi2Component c, const fmi2StatusKind s, fmi2Status *value)
+{
+  auto async = dynamic_cast<AsyncSlave *>(reinterpret_cast<Slave *>(c));
+
+  if (async == nullptr || s != fmi2DoStepStatus)
+    return fmi2Error;
+
+  *value = async->stepStatus();
+  return fmi2OK;
 }
 
 fmi2Status fmi2GetRealStatus(fmi2Component c, const fmi2StatusKind s,
                              fmi2Real *value)
 {
-  return fmi2Error;
-}
+  if (s != fmi2LastSuccessfulTime)
+    return fmi2Error;
+
+  *value = reinterpret_cast<Slave *>(c)->lastSuccessfulTime();
+  return fmi2OK;
 }
 
 fmi2Status fmi2GetIntegerStatus(fmi2Component c, const fmi2StatusKind,
@@ -469,8 +1346,15 @@ fmi2Status fmi2GetBooleanStatus(fmi2Component c, const fmi2StatusKind,
   return fmi2Error;
 }
 
-fmi2Status fmi2GetStringStatus(fmi2Component c, const fmi2StatusKind,
-                               fmi2String *)
+fmi2Status fmi2GetStringStatus(fmi2Component c, const fmi2StatusKind s,
+                               fmi2String *value)
 {
-  return fmi2Error;
+  auto async = dynamic_cast<AsyncSlave *>(reinterpret_cast<Slave *>(c));
+
+  if (async == nullptr || s != fmi2PendingStatus)
+    return fmi2Error;
+
+  *value = async->pendingStatus();
+  return fmi2OK;
+}
 }
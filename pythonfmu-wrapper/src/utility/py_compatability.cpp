@@ -25,16 +25,73 @@ int PyCompat::PyRun_SimpleString(const char* command)
     }
 }
 
-const char* PyCompat::PyUnicode_AsUTF8(PyObject* object)
+bool PyCompat::PyUnicode_AsUTF8(PyObject* object, std::string& utf8)
 {
-    wchar_t *wchar_str = PyUnicode_AsWideCharString(object, nullptr);
-    std::string str = ws2s(wchar_str);
-    PyMem_Free(wchar_str);
+#if !defined(Py_LIMITED_API) || Py_LIMITED_API + 0 >= 0x030A0000
+    Py_ssize_t size;
+    const char* data = PyUnicode_AsUTF8AndSize(object, &size);
+    if (data == nullptr)
+        return false;
 
-    char* cstr = new char[str.length()+1];
-    str.copy(cstr,str.length()+1);
+    utf8.assign(data, size);
+    return true;
+#else
+    PyObject* bytes = PyUnicode_AsUTF8String(object);
+    if (bytes == nullptr)
+        return false;
 
-    std::string test(cstr);
+    char* data;
+    Py_ssize_t size;
+    if (PyBytes_AsStringAndSize(bytes, &data, &size) != 0)
+    {
+        Py_DECREF(bytes);
+        return false;
+    }
+
+    utf8.assign(data, size);
+    Py_DECREF(bytes);
+    return true;
+#endif
+}
+
+std::string PyCompat::PyUnicode_AsUTF8(PyObject* object)
+{
+    std::string utf8;
+    PyUnicode_AsUTF8(object, utf8);
+    return utf8;
+}
 
-    return cstr;
-}
\ No newline at end of file
+PyObject* PyCompat::PyObject_Vectorcall(PyObject* callable, PyObject* const* args, size_t nargs)
+{
+#ifdef PYCOMPAT_HAS_VECTORCALL
+    return ::PyObject_Vectorcall(callable, args, nargs, nullptr);
+#else
+    switch (nargs)
+    {
+    case 0:
+        return PyObject_CallFunctionObjArgs(callable, nullptr);
+    case 1:
+        return PyObject_CallFunctionObjArgs(callable, args[0], nullptr);
+    case 2:
+        return PyObject_CallFunctionObjArgs(callable, args[0], args[1], nullptr);
+    case 3:
+        return PyObject_CallFunctionObjArgs(callable, args[0], args[1], args[2], nullptr);
+    default:
+    {
+        PyObject* tuple = PyTuple_New(nargs);
+        if (tuple == nullptr)
+            return nullptr;
+
+        for (size_t i = 0; i < nargs; ++i)
+        {
+            Py_INCREF(args[i]);
+            PyTuple_SetItem(tuple, i, args[i]);
+        }
+
+        PyObject* result = PyObject_CallObject(callable, tuple);
+        Py_DECREF(tuple);
+        return result;
+    }
+    }
+#endif
+}
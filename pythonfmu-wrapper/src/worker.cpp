@@ -0,0 +1,455 @@
+/**
+ * @brief Worker process executing a single slave on behalf of the process which loaded the FMU.
+ *
+ * Started by ProcessSlave with the name of the shared memory segment and the id of the parent process as arguments.
+ * The worker exits once the slave is freed or the parent process terminates.
+ *
+ * Started with --fork-server and the resources folder as arguments, the process becomes a fork server instead, see ForkServer,
+ * which forks a worker for every request received through the socket inherited from the parent and exits once the socket is closed.
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "fmt/format.h"
+
+#include "pythonfmu/ForkServer.hpp"
+#include "pythonfmu/Logger.hpp"
+#include "pythonfmu/ProcessChannel.hpp"
+#include "pythonfmu/PyInitializer.hpp"
+#include "pythonfmu/PyObjectWrapper.hpp"
+
+using namespace fmt;
+using namespace pythonfmu;
+using namespace std;
+
+namespace
+{
+
+struct LogEntry
+{
+  fmi2Status status;
+  string category;
+  string message;
+};
+
+/**
+ * @brief Logger callback collecting the messages, which are returned to the host with the response to the current request.
+ */
+void collect_log(fmi2ComponentEnvironment environment, fmi2String, fmi2Status status, fmi2String category, fmi2String message, ...)
+{
+  auto entries = static_cast<vector<LogEntry> *>(environment);
+  entries->push_back({status, category, message});
+}
+
+/**
+ * @brief Append the collected log messages to the data area following the payload of the response.
+ *
+ * Messages which do not fit are dropped and reported on the standard error stream instead.
+ */
+void write_log(Message &response, vector<LogEntry> &entries, byte *data, size_t capacity)
+{
+  size_t offset = align_offset(response.size);
+  response.logOffset = offset;
+  response.nLogs = 0;
+
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    auto &entry = entries[i];
+    size_t size = sizeof(LogRecord) + entry.category.size() + entry.message.size();
+
+    if (offset + size > capacity)
+    {
+      cerr << format("Dropped {} log messages which did not fit in the shared memory segment\n", entries.size() - i);
+      break;
+    }
+
+    LogRecord record{entry.status, static_cast<uint32_t>(entry.category.size()), static_cast<uint32_t>(entry.message.size())};
+    memcpy(data + offset, &record, sizeof(record));
+    offset += sizeof(record);
+    memcpy(data + offset, entry.category.data(), entry.category.size());
+    offset += entry.category.size();
+    memcpy(data + offset, entry.message.data(), entry.message.size());
+    offset = align_offset(offset + entry.message.size());
+
+    ++response.nLogs;
+  }
+
+  entries.clear();
+}
+
+template <typename T>
+T *values(const Message &request, byte *data)
+{
+  return reinterpret_cast<T *>(data + values_offset(request.nvr));
+}
+
+/**
+ * @brief Execute a request, other than instantiate, on the slave.
+ */
+fmi2Status execute(PyObjectWrapper &slave, Message &request, byte *data, size_t capacity, vector<fmi2Byte> &serialized)
+{
+  auto vr = reinterpret_cast<const fmi2ValueReference *>(data);
+  size_t nvr = request.nvr;
+
+  switch (request.operation)
+  {
+  case Operation::setup_experiment:
+    slave.setupExperiment(request.args[0]);
+    break;
+  case Operation::enter_initialization_mode:
+    slave.enterInitializationMode();
+    break;
+  case Operation::exit_initialization_mode:
+    slave.exitInitializationMode();
+    break;
+  case Operation::do_step:
+    return slave.doStep(request.args[0], request.args[1]) ? fmi2OK : fmi2Discard;
+  case Operation::do_steps:
+  {
+    size_t nSteps = request.nSteps;
+    size_t nInputs = request.nInputs;
+    StepsLayout layout(nSteps, nInputs, nvr - nInputs);
+    request.nSteps = slave.doSteps(request.args[0], reinterpret_cast<const fmi2Real *>(data + layout.stepSizes), nSteps,
+                                   vr, nInputs, reinterpret_cast<const fmi2Real *>(data + layout.inputs),
+                                   vr + nInputs, nvr - nInputs, reinterpret_cast<fmi2Real *>(data + layout.outputs));
+    return (request.nSteps < nSteps) ? fmi2Discard : fmi2OK;
+  }
+  case Operation::reset:
+    slave.reset();
+    break;
+  case Operation::terminate:
+    slave.terminate();
+    break;
+  case Operation::get_integer:
+    slave.getInteger(vr, nvr, values<fmi2Integer>(request, data));
+    break;
+  case Operation::get_real:
+    slave.getReal(vr, nvr, values<fmi2Real>(request, data));
+    break;
+  case Operation::get_boolean:
+    slave.getBoolean(vr, nvr, values<fmi2Boolean>(request, data));
+    break;
+  case Operation::get_string:
+  {
+    vector<fmi2String> strings(nvr);
+    slave.getString(vr, nvr, strings.data());
+    size_t offset = values_offset(nvr);
+    request.size = offset + pack_strings(data + offset, capacity - offset, strings.data(), nvr);
+    break;
+  }
+  case Operation::set_integer:
+    slave.setInteger(vr, nvr, values<fmi2Integer>(request, data));
+    break;
+  case Operation::set_real:
+    slave.setReal(vr, nvr, values<fmi2Real>(request, data));
+    break;
+  case Operation::set_boolean:
+    slave.setBoolean(vr, nvr, values<fmi2Boolean>(request, data));
+    break;
+  case Operation::set_string:
+  {
+    auto strings = unpack_strings(data + values_offset(nvr), nvr);
+    vector<fmi2String> pointers(nvr);
+    for (size_t i = 0; i < nvr; ++i)
+      pointers[i] = strings[i].c_str();
+    slave.setString(vr, nvr, pointers.data());
+    break;
+  }
+  case Operation::set_debug_logging:
+  {
+    auto categories = unpack_strings(data, nvr);
+    vector<const char *> pointers(nvr);
+    for (size_t i = 0; i < nvr; ++i)
+      pointers[i] = categories[i].c_str();
+    return slave.setDebugLogging(request.args[0] != 0, nvr, pointers.data());
+  }
+  case Operation::get_fmu_state:
+    request.fmuState = reinterpret_cast<uint64_t>(slave.getFMUstate(reinterpret_cast<fmi2FMUstate>(request.fmuState)));
+    break;
+  case Operation::set_fmu_state:
+    slave.setFMUstate(reinterpret_cast<fmi2FMUstate>(request.fmuState));
+    request.args[0] = slave.lastSuccessfulTime();
+    break;
+  case Operation::free_fmu_state:
+    slave.freeFMUstate(reinterpret_cast<fmi2FMUstate>(request.fmuState));
+    break;
+  case Operation::serialized_fmu_state_size:
+    request.total = slave.serializedFMUstateSize(reinterpret_cast<fmi2FMUstate>(request.fmuState));
+    break;
+  case Operation::serialize_fmu_state:
+    if (request.offset == 0)
+    {
+      serialized.resize(request.total);
+      slave.serializeFMUstate(reinterpret_cast<fmi2FMUstate>(request.fmuState), serialized.data(), serialized.size());
+    }
+    if (request.offset + request.size > serialized.size())
+      throw runtime_error("Requested a chunk beyond the end of the serialized FMU state");
+    memcpy(data, serialized.data() + request.offset, request.size);
+    break;
+  case Operation::deserialize_fmu_state:
+    if (request.offset == 0)
+      serialized.resize(request.total);
+    if (request.offset + request.size > serialized.size())
+      throw runtime_error("Received a chunk beyond the end of the serialized FMU state");
+    memcpy(serialized.data() + request.offset, data, request.size);
+    if (request.offset + request.size == serialized.size())
+      request.fmuState = reinterpret_cast<uint64_t>(slave.deSerializeFMUstate(serialized.data(), serialized.size(), reinterpret_cast<fmi2FMUstate>(request.fmuState)));
+    break;
+  case Operation::free_all_fmu_states:
+    slave.freeAllFMUstates();
+    break;
+  case Operation::set_time:
+    slave.setTime(request.args[0]);
+    break;
+  case Operation::set_continuous_states:
+    slave.setContinuousStates(reinterpret_cast<const fmi2Real *>(data), nvr);
+    break;
+  case Operation::get_continuous_states:
+    slave.getContinuousStates(reinterpret_cast<fmi2Real *>(data), nvr);
+    break;
+  case Operation::get_nominals_of_continuous_states:
+    slave.getNominalsOfContinuousStates(reinterpret_cast<fmi2Real *>(data), nvr);
+    break;
+  case Operation::get_derivatives:
+    slave.getDerivatives(reinterpret_cast<fmi2Real *>(data), nvr);
+    break;
+  case Operation::get_event_indicators:
+    slave.getEventIndicators(reinterpret_cast<fmi2Real *>(data), nvr);
+    break;
+  case Operation::enter_event_mode:
+    slave.enterEventMode();
+    break;
+  case Operation::new_discrete_states:
+  {
+    fmi2EventInfo eventInfo;
+    slave.newDiscreteStates(&eventInfo);
+    memcpy(data, &eventInfo, sizeof(eventInfo));
+    request.size = sizeof(eventInfo);
+    break;
+  }
+  case Operation::enter_continuous_time_mode:
+    slave.enterContinuousTimeMode();
+    break;
+  case Operation::completed_integrator_step:
+  {
+    bool terminate = false;
+    request.args[0] = slave.completedIntegratorStep(request.args[0] != 0, &terminate);
+    request.args[1] = terminate;
+    break;
+  }
+  case Operation::get_directional_derivative:
+  {
+    size_t nKnowns = request.nInputs;
+    auto seed = values<fmi2Real>(request, data);
+    slave.getDirectionalDerivative(vr + nKnowns, nvr - nKnowns, vr, nKnowns, seed, seed + nKnowns);
+    break;
+  }
+  case Operation::get_jacobian:
+  {
+    size_t nKnowns = request.nInputs;
+    slave.getJacobian(vr + nKnowns, nvr - nKnowns, vr, nKnowns, values<fmi2Real>(request, data));
+    break;
+  }
+  case Operation::set_real_input_derivatives:
+    slave.setRealInputDerivatives(vr, nvr, values<fmi2Integer>(request, data), reinterpret_cast<const fmi2Real *>(data + derivatives_offset(nvr)));
+    break;
+  case Operation::get_real_output_derivatives:
+    slave.getRealOutputDerivatives(vr, nvr, values<fmi2Integer>(request, data), reinterpret_cast<fmi2Real *>(data + derivatives_offset(nvr)));
+    break;
+  default:
+    throw runtime_error(format("Unexpected operation: {}", static_cast<uint32_t>(request.operation)));
+  }
+
+  return fmi2OK;
+}
+
+/**
+ * @brief Serve the requests sent through the segment until the slave is freed or the host terminates.
+ *
+ * @return the exit code of the worker
+ */
+int serve(const char *segmentName, const function<bool()> &hostAlive)
+{
+  unique_ptr<SharedSegment> segment;
+  try
+  {
+    segment = make_unique<SharedSegment>(SharedSegment::open(segmentName));
+  }
+  catch (const exception &e)
+  {
+    cerr << format("Failed to open the shared memory segment: {}\n", e.what());
+    return 1;
+  }
+
+  auto header = segment->header();
+  auto data = segment->data();
+  size_t capacity = header->dataCapacity;
+
+  vector<LogEntry> entries;
+  Logger logger(&entries, collect_log, header->instanceName);
+
+  shared_ptr<PyInitializer> interpreter;
+  unique_ptr<PyObjectWrapper> slave;
+
+  // serialized FMU state being transferred in chunks
+  vector<fmi2Byte> serialized;
+
+  bool running = true;
+  while (running)
+  {
+    if (!header->toWorker.wait(header->requests, hostAlive))
+      break;
+
+    Message request{};
+    header->requests.pop(request);
+
+    // the response reuses the request, such that sizes and arguments carry over
+    Message response = request;
+    response.status = fmi2OK;
+
+    try
+    {
+      switch (request.operation)
+      {
+      case Operation::instantiate:
+        logger.setDebugLogging(request.args[0] != 0, 0, nullptr);
+        interpreter = PyInitializer::acquire(&logger);
+        slave = make_unique<PyObjectWrapper>(header->resources, &logger);
+        response.modelExchange = slave->providesModelExchange();
+        break;
+      case Operation::free_instance:
+        slave.reset();
+        running = false;
+        break;
+      default:
+        if (slave == nullptr)
+          throw runtime_error("The slave has not been instantiated");
+        response.status = execute(*slave, response, data, capacity, serialized);
+        break;
+      }
+    }
+    catch (const exception &e)
+    {
+      logger.error(format("Worker failed to execute the request: {}\n", e.what()));
+      response.status = fmi2Error;
+
+      if (request.operation == Operation::instantiate)
+        running = false;
+    }
+
+    write_log(response, entries, data, capacity);
+
+    header->responses.push(response);
+    header->toHost.ring();
+  }
+
+  slave.reset();
+  interpreter.reset();
+
+  return 0;
+}
+
+/**
+ * @brief Logger callback of the fork server, which has no host to deliver messages to until it has loaded the slave.
+ */
+void print_log(fmi2ComponentEnvironment, fmi2String instanceName, fmi2Status, fmi2String category, fmi2String message, ...)
+{
+  cerr << format("{}:{}:{}", instanceName, category, message);
+}
+
+/**
+ * @brief Load the slave, then fork a worker for every request until the socket is closed by the host.
+ *
+ * The workers share the interpreter and the imported modules copy-on-write.
+ */
+int fork_server(const char *resources)
+{
+  Logger logger(nullptr, print_log, "fork server", false);
+
+  shared_ptr<PyInitializer> interpreter;
+  ForkResponse ready{static_cast<int32_t>(getpid()), 0};
+
+  try
+  {
+    interpreter = PyInitializer::acquire(&logger);
+    PyObjectWrapper::preload(resources, &logger);
+  }
+  catch (const exception &e)
+  {
+    cerr << format("Fork server failed to load the slave: {}\n", e.what());
+    ready.pid = -1;
+  }
+
+  if (send(forkServerSocket, &ready, sizeof(ready), MSG_NOSIGNAL) != sizeof(ready) || ready.pid < 0)
+    return 1;
+
+  // the workers are reaped by the kernel once they exit
+  signal(SIGCHLD, SIG_IGN);
+
+  ForkRequest request;
+  while (recv(forkServerSocket, &request, sizeof(request), 0) == sizeof(request))
+  {
+    request.segment[sizeof(request.segment) - 1] = '\0';
+
+    // the interpreter is forked in a consistent state, as done by os.fork
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyOS_BeforeFork();
+
+    pid_t pid = fork();
+    int error = errno;
+
+    if (pid == 0)
+    {
+      PyOS_AfterFork_Child();
+      PyGILState_Release(gil);
+
+      close(forkServerSocket);
+      signal(SIGCHLD, SIG_DFL);
+
+      // the host is not the parent of the worker, which is why it is polled by its process id
+      pid_t host = request.host;
+      int code = serve(request.segment, [host]() { return kill(host, 0) == 0 || errno == EPERM; });
+
+      // neither returns into the loop of the fork server nor runs its exit handlers
+      _exit(code);
+    }
+
+    PyOS_AfterFork_Parent();
+    PyGILState_Release(gil);
+
+    ForkResponse response{static_cast<int32_t>(pid), (pid < 0) ? error : 0};
+    if (send(forkServerSocket, &response, sizeof(response), MSG_NOSIGNAL) != sizeof(response))
+      break;
+  }
+
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc == 3 && string(argv[1]) == "--fork-server")
+    return fork_server(argv[2]);
+
+  if (argc != 3)
+  {
+    cerr << "usage: pyfmu_worker <segment> <parent pid>\n       pyfmu_worker --fork-server <resources>\n";
+    return 2;
+  }
+
+  pid_t parent = stoi(argv[2]);
+
+  return serve(argv[1], [parent]() { return getppid() == parent; });
+}
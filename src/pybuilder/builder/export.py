@@ -7,6 +7,9 @@ import json
 
 from shutil import copyfile, copytree, rmtree, make_archive, move, copy
 import sys
+import py_compile
+from tempfile import TemporaryDirectory
+from zipfile import ZipFile, ZIP_STORED
 from distutils.dir_util import copy_tree
 from pathlib import Path
 
@@ -43,7 +46,8 @@ class PyfmuArchive():
                  model_description_path : Path = None,
                  main_script: Path = None,
                  main_class : Path = None,
-                 pyfmu_dir : Path = None
+                 pyfmu_dir : Path = None,
+                 bytecode_path : Path = None
     ):
         """Creates an object representation of the exported Python FMU.
 
@@ -66,6 +70,7 @@ class PyfmuArchive():
         self.wrapper_win64 = wrapper_win64
         self.wrapper_linux64 = wrapper_linux64
         self.pyfmu_dir = pyfmu_dir
+        self.bytecode_path = bytecode_path
 
 
 def import_by_source(path: str):
@@ -167,6 +172,42 @@ def _copy_pyfmu_lib_to_archive(archive: PyfmuArchive, project: PyfmuProject = No
 
     return archive
 
+def _write_bytecode_archive(archive: PyfmuArchive) -> PyfmuArchive:
+    """Compiles the main script and the pyfmu library into a zip of bytecode, from which the wrapper imports them.
+
+    The zip is placed at resources/__pycache__/bytecode.<cache tag>.zip, where the cache tag identifies the interpreter compiling it, e.g. cpython-37.
+    The wrapper only imports from it if the tag matches the interpreter loading the FMU, otherwise the sources, which are kept, are compiled as usual.
+    The bytecode is not validated against the sources, as the timestamps of the sources are not preserved by all tools extracting FMUs.
+
+    Arguments:
+        archive {PyfmuArchive} -- The archive being exported, to which the sources and the library have been copied.
+    """
+
+    cache_tag = sys.implementation.cache_tag
+
+    if(cache_tag is None):
+        _log.warning('The interpreter does not support caching bytecode, the FMU imports the slave from source.')
+        return archive
+
+    resources_dir = archive.root / 'resources'
+    bytecode_path = resources_dir / '__pycache__' / f'bytecode.{cache_tag}.zip'
+    sources = [archive.main_script_path] + sorted(archive.pyfmu_dir.rglob('*.py'))
+
+    makedirs(bytecode_path.parent, exist_ok=True)
+
+    # stored rather than compressed, such that importing does not pay for decompression
+    with TemporaryDirectory() as tmp, ZipFile(bytecode_path, 'w', ZIP_STORED) as zf:
+        for source in sources:
+            relative = source.relative_to(resources_dir)
+            compiled = Path(tmp) / 'module.pyc'
+            py_compile.compile(str(source), cfile=str(compiled), dfile=str(relative), doraise=True,
+                               invalidation_mode=py_compile.PycInvalidationMode.UNCHECKED_HASH)
+            zf.write(compiled, relative.with_suffix('.pyc').as_posix())
+
+    archive.bytecode_path = bytecode_path
+
+    return archive
+
 def _copy_binaries_to_archive(archive: PyfmuArchive) -> PyfmuArchive:
     """Copies the binaries to the archive.
     
@@ -225,7 +266,7 @@ def _copy_sources_to_archive(project: PyfmuProject, archive: PyfmuArchive) -> Py
 def _write_modelDescription_to_archive(project : PyfmuProject, archive : PyfmuArchive) -> PyfmuArchive:
     
     instance = _instantiate_main_class(archive.main_script_path, archive.main_class)
-    md = extract_model_description_v2(instance)
+    md = extract_model_description_v2(instance, project.project_configuration.get('stepping') == 'async')
 
     archive_model_description_path = archive.root / 'modelDescription.xml'
     
@@ -366,6 +407,9 @@ def export_project(project: PyfmuProject, outputPath: Path, overwrite=False, sto
     # copy pyfmu lib to archive, a fresh copy from resources is always used.
     _copy_pyfmu_lib_to_archive(archive)
 
+    # precompile the sources, such that instances do not compile them when the FMU is loaded
+    _write_bytecode_archive(archive)
+
     _copy_binaries_to_archive(archive)
 
     # generate model description and write
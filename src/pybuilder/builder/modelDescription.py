@@ -9,11 +9,47 @@ import uuid
 
 from jinja2 import Template
 
-from pybuilder.resources.pyfmu.fmi2types import Fmi2Causality
+from pybuilder.resources.pyfmu.fmi2types import Fmi2Causality, Fmi2Initial
 
 
-def extract_model_description_v2(fmu_instance) -> str:
-    
+def _state_capabilities(fmu_instance) -> (bool, bool):
+    """Returns whether the slave can get and set its state, and whether it can serialize it.
+
+    The state of the newly constructed slave is captured and serialized once, which by default requires the attributes of the slave to be picklable.
+    """
+    if not (callable(getattr(fmu_instance, 'get_state', None)) and callable(getattr(fmu_instance, 'set_state', None))):
+        return False, False
+
+    try:
+        state = fmu_instance.get_state()
+    except Exception:
+        return False, False
+
+    if not (callable(getattr(fmu_instance, 'serialize_state', None)) and callable(getattr(fmu_instance, 'deserialize_state', None))):
+        return True, False
+
+    try:
+        fmu_instance.serialize_state(state)
+    except Exception:
+        return True, False
+
+    return True, True
+
+
+def extract_model_description_v2(fmu_instance, can_run_asynchronously : bool = False) -> str:
+    """Generates the model description of the slave.
+
+    A ModelExchange element is added along with the CoSimulation element if the slave registered continuous states or event indicators.
+    Directional derivatives are declared as provided if the slave overrides get_directional_derivative or declared the dependencies of its unknowns,
+    in which case the finite differences approximated by the wrapper are sparse. The wrapper recomputes the outputs of a co-simulation slave
+    using evaluate_outputs, as such the approximated derivatives are only declared for co-simulation if the slave overrides it.
+    Inputs are declared as interpolated if the slave sets __interpolates_inputs__, derivatives of the outputs are provided up to __max_output_derivative_order__.
+    The FMU state is declared as retrievable and serializable if the state of the newly constructed slave can be captured and serialized.
+
+    Arguments:
+        can_run_asynchronously {bool} -- whether the wrapper is configured to take steps asynchronously, see the "stepping" option of the slave configuration
+    """
+
     data_time_obj = datetime.datetime.now()
     date_str_xsd = datetime.datetime.strftime(data_time_obj, '%Y-%m-%dT%H:%M:%SZ')
 
@@ -28,13 +64,54 @@ def extract_model_description_v2(fmu_instance) -> str:
     fmd.set('variableNamingConvention', 'structured')
     fmd.set("generationTool", 'pyfmu')
 
+    model_exchange = fmu_instance.__model_exchange__() if hasattr(fmu_instance, '__model_exchange__') else None
+    states, n_event_indicators = model_exchange if model_exchange is not None else ([], 0)
+
+    directional_derivatives = fmu_instance.__directional_derivatives__() if hasattr(fmu_instance, '__directional_derivatives__') else None
+    analytic, dependencies, evaluates_outputs = directional_derivatives if directional_derivatives is not None else (False, {}, False)
+    provides_directional_derivative = analytic or bool(dependencies)
+    provides_directional_derivative_cs = analytic or (bool(dependencies) and evaluates_outputs)
+
+    interpolation = fmu_instance.__interpolation__() if hasattr(fmu_instance, '__interpolation__') else None
+    can_interpolate_inputs = getattr(fmu_instance, '__interpolates_inputs__', False)
+    max_output_derivative_order = interpolation[2] if interpolation is not None else 0
+
+    can_get_and_set_state, can_serialize_state = _state_capabilities(fmu_instance)
+
+    if model_exchange is not None:
+        fmd.set('numberOfEventIndicators', str(n_event_indicators))
+
+        me = ET.SubElement(fmd, 'ModelExchange')
+        me.set("modelIdentifier", 'pyfmu')
+        me.set('needsExecutionTool','true')
+        me.set('canGetAndSetFMUstate',str(can_get_and_set_state).lower())
+        me.set('canSerializeFMUstate',str(can_serialize_state).lower())
+        if provides_directional_derivative:
+            me.set('providesDirectionalDerivative','true')
+
     cs = ET.SubElement(fmd,'CoSimulation')
     cs.set("modelIdentifier", 'pyfmu')
     cs.set('needsExecutionTool','true')
+    cs.set('canGetAndSetFMUstate',str(can_get_and_set_state).lower())
+    cs.set('canSerializeFMUstate',str(can_serialize_state).lower())
+    if provides_directional_derivative_cs:
+        cs.set('providesDirectionalDerivative','true')
+    if can_interpolate_inputs:
+        cs.set('canInterpolateInputs','true')
+    if max_output_derivative_order > 0:
+        cs.set('maxOutputDerivativeOrder', str(max_output_derivative_order))
+    if can_run_asynchronously:
+        cs.set('canRunAsynchronuously','true')
     
     
 
     mvs = ET.SubElement(fmd,'ModelVariables')
+
+    # indices of the variables in the model description start at 1
+    indices = {var.name : idx + 1 for idx, var in enumerate(fmu_instance.vars)}
+    indices_by_vr = {var.value_reference : idx + 1 for idx, var in enumerate(fmu_instance.vars)}
+    derivative_of = {derivative : state for state, derivative, _ in states}
+    nominals = {state : nominal for state, _, nominal in states if nominal != 1.0}
     
     variable_index = 0
 
@@ -67,6 +144,12 @@ def extract_model_description_v2(fmu_instance) -> str:
         if(var.start is not None):
             s = str(var.start)
             val.set("start", s)
+
+        if(var.name in derivative_of):
+            val.set("derivative", str(indices[derivative_of[var.name]]))
+
+        if(var.name in nominals):
+            val.set("nominal", str(nominals[var.name]))
         
         variable_index += 1
 
@@ -75,16 +158,34 @@ def extract_model_description_v2(fmu_instance) -> str:
     
     
 
+    # 2.2.8) An unknown without the dependencies attribute depends on all knowns, an empty attribute declares that it depends on none
+    def unknown(parent, idx, var):
+        attributes = {'index' : str(idx)}
+        if(var.value_reference in dependencies):
+            attributes['dependencies'] = ' '.join(str(indices_by_vr[vr]) for vr in sorted(dependencies[var.value_reference], key=indices_by_vr.get))
+        ET.SubElement(parent, 'Unknown', attributes)
+
     # 2.2.8) For each output we must declare 'Outputs' and 'InitialUnknowns'
     outputs = [(idx+1,o) for idx,o in enumerate(fmu_instance.vars) if o.causality.name == Fmi2Causality.output.name]
 
     if(outputs):
         os = ET.SubElement(ms,'Outputs')
         for idx,o in outputs:
-            ET.SubElement(os,'Unknown',{'index' : str(idx), 'dependencies' : ''})
+            unknown(os, idx, o)
 
+    if(states):
+        ds = ET.SubElement(ms, 'Derivatives')
+        for _, derivative, _ in states:
+            unknown(ds, indices[derivative], fmu_instance.vars[indices[derivative] - 1])
+
+    # 3.2.2) In Model Exchange the states and derivatives which are not initialized exactly are initial unknowns as well, in the order of the variables
+    initial_unknowns = {idx for idx, _ in outputs}
+    for state, derivative, _ in states:
+        initial_unknowns.update(indices[name] for name in (state, derivative) if fmu_instance.vars[indices[name] - 1].initial.name != Fmi2Initial.exact.name)
+
+    if(initial_unknowns):
         os = ET.SubElement(ms, 'InitialUnknowns')
-        for idx,o in outputs:
+        for idx in sorted(initial_unknowns):
             ET.SubElement(os,'Unknown',{'index' : str(idx), 'dependencies' : ''})
     
 
@@ -1,6 +1,7 @@
 """Defines logging related functionality
 """
 from enum import Enum
+from struct import Struct
 from typing import Iterable, List
 
 from .fmi2types import Fmi2Status
@@ -10,6 +11,13 @@ _internal_log_catergory = 'pyfmu'
 # default parameter for events
 _default_category = 'events'
 
+# layout of the log ring owned by the wrapper, mirrors LogRing in LogRing.hpp
+_ring_header = Struct('=iIII')
+_ring_alignment = 16
+_ring_category_definition = -1
+_ring_padding = -2
+_ring_write, _ring_read, _ring_dropped = range(3)
+
 
 class Fmi2StdLogCats(Enum):
     """Standard log categories defined in the FMI2 specification.
@@ -67,6 +75,167 @@ class Fmi2Logger():
         self._categories_to_predicates = {}
         self._active_categories = set()
 
+        # bit of each registered category in the set of active categories, reassigned when the wrapper attaches its filter
+        self._category_bits = {}
+        self._active_mask = 0
+
+        # bits of the registered categories matching messages, by category and status of the messages
+        self._masks = {}
+
+        # active categories of the wrapper, which take the place of _active_mask once attached
+        self._filter = None
+
+        # set once the wrapper attaches its log ring, to which messages are written instead of the stack
+        self._ring_indices = None
+        self._ring_data = None
+        self._category_ids = {}
+
+    def attach(self, indices: memoryview, data: memoryview) -> None:
+        """Writes messages into the log ring of the wrapper rather than keeping them on the stack.
+
+        Messages logged before the ring was attached are moved into it.
+
+        Arguments:
+            indices {memoryview} -- write index, read index and dropped counter of the ring.
+            data {memoryview} -- bytes of the record area, whose size is a power of two.
+        """
+        self._ring_indices = indices
+        self._ring_data = data
+
+        for msg in self._log_stack:
+            self._write(msg)
+        self._log_stack.clear()
+
+    def attach_filter(self, active: memoryview, ids: List[int]) -> None:
+        """Reads the active categories from the wrapper, which sets them without calling into Python.
+
+        Categories activated before the filter was attached remain active.
+
+        Arguments:
+            active {memoryview} -- the active categories as a bitset of two 32-bit words, mirroring Logger::activeWords.
+            ids {List[int]} -- the bits assigned by the wrapper to the categories returned by categories, None for those without a bit.
+        """
+        if(len(active) != 2):
+            raise ValueError(f'Expected the active categories as two 32-bit words, got {len(active)} words')
+
+        self._category_bits = dict(zip(self._categories_to_predicates, ids))
+        self._masks.clear()
+        self._filter = active
+
+        self._update_filter(True, self._active_categories)
+
+    def categories(self) -> List[str]:
+        """Returns the names of the registered categories, in the order of registration.
+        """
+        return list(self._categories_to_predicates)
+
+    def enabled(self, category: str = _default_category, status=Fmi2Status.ok) -> bool:
+        """Returns true if a message with the category and status is logged.
+
+        Checking this before building a costly message avoids building it while logging is off.
+        """
+        if(category == None):
+            category = _default_category
+
+        f = self._filter
+        active = self._active_mask if f is None else f[0] | (f[1] << 32)
+
+        if(not active):
+            return False
+
+        key = (category, status)
+        mask = self._masks.get(key)
+
+        if(mask is None):
+            msg = Fmi2LogMessage(status, category, "")
+            mask = 0
+            for c, p in self._categories_to_predicates.items():
+                bit = self._category_bits.get(c)
+                if(bit is not None and p(msg) == True):
+                    mask |= 1 << bit
+            self._masks[key] = mask
+
+        return (active & mask) != 0
+
+    def _update_filter(self, logging_on: bool, categories: Iterable[str]) -> None:
+        """Sets or clears the bits of the categories, in the filter of the wrapper if attached.
+        """
+        for c in categories:
+            bit = self._category_bits.get(c)
+
+            if(bit is None):
+                continue
+
+            if(self._filter is None):
+                if(logging_on):
+                    self._active_mask |= 1 << bit
+                else:
+                    self._active_mask &= ~(1 << bit)
+            else:
+                word, bit = divmod(bit, 32)
+                if(logging_on):
+                    self._filter[word] |= 1 << bit
+                else:
+                    self._filter[word] &= ~(1 << bit)
+
+    def _write(self, msg: Fmi2LogMessage) -> None:
+        """Writes the message into the log ring, along with the definition of its category if not yet sent.
+
+        The write index is published once all records are written, such that the wrapper never sees a partial message.
+        If the records do not fit, the message is dropped and the dropped counter incremented.
+        """
+        indices = self._ring_indices
+        write = indices[_ring_write]
+        used = (write - indices[_ring_read]) & 0xFFFFFFFF
+
+        # keep a single message from occupying most of the ring
+        capacity = len(self._ring_data)
+        text = msg.message[:capacity // 16]
+
+        category_id = self._category_ids.get(msg.category)
+        if(category_id is None):
+            category_id = len(self._category_ids)
+            write, used = self._append(write, used, _ring_category_definition, category_id, msg.category.encode())
+
+        write, used = self._append(write, used, msg.status.value, category_id, text.encode())
+
+        if(write is None):
+            indices[_ring_dropped] = (indices[_ring_dropped] + 1) & 0xFFFFFFFF
+            return
+
+        if(msg.category not in self._category_ids):
+            self._category_ids[msg.category] = category_id
+
+        indices[_ring_write] = write
+
+    def _append(self, write, used, status, category, payload):
+        """Appends a record at the write index, returning the advanced index and number of used bytes, or None if the record does not fit.
+        """
+        if(write is None):
+            return None, used
+
+        data = self._ring_data
+        capacity = len(data)
+        size = -(-(_ring_header.size + len(payload)) // _ring_alignment) * _ring_alignment
+        offset = write & (capacity - 1)
+
+        # records never wrap, the remainder of the area is skipped using a padding record
+        remainder = capacity - offset
+        skip = remainder if remainder < size else 0
+
+        if(used + skip + size > capacity):
+            return None, used
+
+        if(skip):
+            _ring_header.pack_into(data, offset, _ring_padding, 0, skip - _ring_header.size, 0)
+            offset = 0
+
+        _ring_header.pack_into(data, offset, status, category, len(payload), 0)
+        start = offset + _ring_header.size
+        data[start:start + len(payload)] = payload
+
+        return (write + skip + size) & 0xFFFFFFFF, used + skip + size
+
     def set_active_log_categories(self, logging_on: bool, categories: Iterable[str]):
 
         try:
@@ -78,13 +247,13 @@ class Fmi2Logger():
             Exception thrown by python was:
             {e}
             """
-            self.log(Fmi2Status.warning, _internal_log_catergory, msg)
+            self.log(msg, _internal_log_catergory, Fmi2Status.warning)
             return Fmi2Status.warning
 
         
         if(len(categories) == 0):
             msg = "Failed setting debug categories, list of categories is empty."
-            self.log(Fmi2Status.warning, _internal_log_catergory, msg)
+            self.log(msg, _internal_log_catergory, Fmi2Status.warning)
 
         not_strings = [c for c in categories if not isinstance(c, str)]
         strings = categories.difference(not_strings)
@@ -104,6 +273,8 @@ class Fmi2Logger():
             self._active_categories = self._active_categories.difference(
                 categories)
 
+        self._update_filter(logging_on, categories)
+
 
     def register_log_category(self, category: str, aliases=None, predicate=None) -> None:
         """Registers a new log category
@@ -114,6 +285,9 @@ class Fmi2Logger():
         Keyword Arguments:
             aliases {[type]} -- [description] (default: {None})
             predicate {[type]} -- [description] (default: {None})
+
+        The result of the predicate is cached by the category and status of the message, as such it must not depend on the text of the message.
+        Categories must be registered before the slave is instantiated by the wrapper, that is in the constructor of the slave.
         """
 
         if(aliases != None and predicate != None):
@@ -136,30 +310,39 @@ class Fmi2Logger():
 
             predicate = alias_predicate
 
-        self._categories_to_predicates[category] = predicate
+        self._register({category: predicate})
 
     def log(self, message: str,  category: str = _default_category, status=Fmi2Status.ok) -> None:
+        """Logs the message if an active category matches it.
+
+        The message may be a callable returning the text, which is only invoked if the message is logged.
+        """
 
+        # returns before evaluating any predicates if no category is active, which is the common case in production
+        f = self._filter
+        if(not (self._active_mask if f is None else f[0] or f[1])):
+            return
+
+        # log only for the active categories
+        if(not self.enabled(category, status)):
+            return
 
         if(category == None):
             category = _default_category
-            
-        msg = Fmi2LogMessage(status, category, message)
-        
 
-        # log only for the active categories
-        activate_categories_to_predicates = { c:p for c,p in self._categories_to_predicates.items() if c in self._active_categories}
+        if(callable(message)):
+            message = message()
 
-        for p in activate_categories_to_predicates.values():
-            
-            if(p(msg) == True):
-                self._log_stack.append(msg)
+        msg = Fmi2LogMessage(status, category, message)
 
-                # testing callback
-                if(self._callback):
-                    self._callback(msg)
+        if(self._ring_data is not None):
+            self._write(msg)
+        else:
+            self._log_stack.append(msg)
 
-                break
+        # testing callback
+        if(self._callback):
+            self._callback(msg)
 
     def register_standard_categories(self, categories: Iterable[str]) -> None:
 
@@ -223,8 +406,21 @@ class Fmi2Logger():
         predicate_matches = {cat: pred for cat,
                              pred in predicates.items() if cat in categories}
 
-        self._categories_to_predicates = {
-            **self._categories_to_predicates, **predicate_matches}
+        self._register(predicate_matches)
+
+    def _register(self, categories_to_predicates) -> None:
+        """Adds the categories, assigning each a bit in the set of active categories.
+        """
+        if(self._filter is not None):
+            raise RuntimeError(
+                'Log categories can not be registered once the wrapper has attached its filter.')
+
+        for c, p in categories_to_predicates.items():
+            self._categories_to_predicates[c] = p
+            self._category_bits.setdefault(c, len(self._category_bits))
+
+        self._masks.clear()
+        self._update_filter(True, self._active_categories.intersection(categories_to_predicates))
 
     def register_all_standard_categories(self) -> None:
         """Convenience method used to register all standard FMI2 log categories
@@ -1,10 +1,16 @@
 from abc import ABC, abstractmethod
-from typing import List, Iterable, Tuple
+from array import array
+from copy import deepcopy
+from itertools import product
+from math import prod
+from typing import Any, Dict, List, Iterable, Tuple
 from uuid import uuid4
 import logging
+import pickle
 
-from .fmi2types import Fmi2Causality, Fmi2DataTypes, Fmi2Initial, Fmi2Variability, Fmi2Status
+from .fmi2types import Fmi2Causality, Fmi2DataTypes, Fmi2EventInfo, Fmi2Initial, Fmi2Variability, Fmi2Status
 from .fmi2logging import Fmi2LogMessage, Fmi2Logger
+from .fmi2store import Fmi2NativeStore, NativeArray, NativeVariable, flatten, native_variable
 from .fmi2variables import ScalarVariable
 
 
@@ -13,8 +19,85 @@ _internal_log_catergory = 'pyfmu'
 log = logging.getLogger('fmu')
 
 
+def _as_list(values) -> list:
+    """Returns the values as a list, memoryviews passed by the wrapper are converted in a single call rather than element by element.
+    """
+    return values.tolist() if isinstance(values, memoryview) else values
+
+
+# data types of the value reference tables, in the order in which __value_references__ returns them
+_table_types = (Fmi2DataTypes.real, Fmi2DataTypes.integer, Fmi2DataTypes.boolean, Fmi2DataTypes.string)
+_REAL, _INTEGER, _BOOLEAN, _STRING = range(len(_table_types))
+
+# the tables are indexed directly by value reference, which bounds their size
+_value_reference_limit = 2 ** 20
+
+
+def _resolve(table: list, vr: int, type_name: str) -> str:
+    """Returns the name of the variable with the value reference, looked up in the table of the expected data type.
+    """
+    name = table[vr] if vr < len(table) else None
+
+    if name is None:
+        raise Exception(f"Variable with valueReference={vr} is not of type {type_name}!")
+
+    return name
+
+
+# values of these types can not be modified in place, as such snapshots may share them rather than copy them
+_immutable_types = frozenset({int, float, bool, str, bytes, complex, type(None)})
+
+
+def _copy_value(value):
+    """Returns a copy of the value which shares no mutable objects with it.
+
+    Containers holding only immutable values, such as a list of floats, are copied shallowly which is much cheaper than deepcopy.
+    """
+    t = type(value)
+
+    if t in _immutable_types:
+        return value
+
+    if t is list or t is set:
+        if _immutable_types.issuperset(map(type, value)):
+            return value.copy()
+    elif t is tuple:
+        if _immutable_types.issuperset(map(type, value)):
+            return value
+    elif t is dict:
+        if _immutable_types.issuperset(map(type, value.values())):
+            return value.copy()
+    elif t is array or t is bytearray:
+        return value[:]
+
+    return deepcopy(value)
+
+
 class Fmi2Slave:
 
+    # The getters and setters only index vrs and refs, which allows the wrapper to pass memoryviews of the arrays supplied by the tool, instead of lists.
+    # Subclasses overriding them with code that requires lists should set this to False.
+    __buffer_exchange__ = True
+
+    # Whether the slave uses the derivatives of its Real inputs set by the tool, see input_at, which is declared by canInterpolateInputs.
+    # The tool may only set them if this is True.
+    __interpolates_inputs__ = False
+
+    # Highest order of the derivatives of the Real outputs the tool may get, declared by maxOutputDerivativeOrder.
+    # Without get_real_output_derivatives, the wrapper estimates them from the outputs at the recent communication points, up to the second derivative.
+    __max_output_derivative_order__ = 2
+
+    # Whether the slave may be instantiated as an ensemble of members differing in the values of natively stored variables, see ensemble_size.
+    # The do_step of such slaves advances all members at once, computing on the values of the members rather than on a single value.
+    __ensemble__ = False
+
+    # Attributes describing the slave rather than the state of the model, which are not captured by get_state.
+    # Subclasses may extend the set with attributes of their own, for instance: __stateless_attributes__ = Fmi2Slave.__stateless_attributes__ | {'solver'}
+    __stateless_attributes__ = frozenset({'author', 'copyright', 'description', 'modelName', 'license', 'guid', 'vars', 'version',
+                                          'value_reference_counter', 'used_value_references', '_value_reference_tables', '_native_store', 'logger',
+                                          '_continuous_states', '_n_event_indicators', '_dependencies',
+                                          '_input_derivatives', '_input_derivatives_time'})
+
     def __init__(self, modelName: str, author="", copyright="", version="", description="", standard_log_categories=True):
         """Constructs a FMI2
 
@@ -39,6 +122,19 @@ class Fmi2Slave:
         self.version = version
         self.value_reference_counter = 0
         self.used_value_references = {}
+        self._value_reference_tables = [[] for _ in _table_types]
+        self._native_store = Fmi2NativeStore()
+
+        # (state, derivative, nominal) of the registered continuous states, None for the number of event indicators until either is registered
+        self._continuous_states = []
+        self._n_event_indicators = None
+
+        # names of the variables on which each output or derivative depends, for those whose dependencies were declared
+        self._dependencies = {}
+
+        # derivatives of the inputs set by the tool for the current step, by name and in increasing order, and the time at which they were set
+        self._input_derivatives = {}
+        self._input_derivatives_time = 0.0
 
         self.logger = Fmi2Logger()
         if(standard_log_categories):
@@ -53,7 +149,8 @@ class Fmi2Slave:
                           start=None,
                           description: str = "",
                           define_attribute: bool = True,
-                          value_reference: int = None
+                          value_reference: int = None,
+                          native: bool = False
                           ):
         """Add a variable to the model such as an input, output or parameter.
 
@@ -68,6 +165,9 @@ class Fmi2Slave:
             start {[type]} -- start value of the variable. (default: {None})
             description {str} -- a description of the variable which is added to the model description (default: {""})
             define_attribute {bool} -- if true, automatically add the specified attribute to instance if it does not already exist. (default: {True})
+            native {bool} -- if true, store the value in memory owned by the wrapper, allowing the tool to get and set it without calling into Python. 
+                             In turn accessing the attribute from Python is slower, making this suitable for variables which are exchanged more often than they are used by the model.
+                             Only Real, Integer and Boolean variables can be stored natively. (default: {False})
 
         Inference Rules:
             i1. shorthands and aliases:
@@ -305,13 +405,196 @@ class Fmi2Slave:
         if(value_reference is None):
             value_reference = self._acquire_unused_value_reference()
 
+        if(not 0 <= value_reference < _value_reference_limit):
+            raise ValueError(
+                f'Illegal value reference : {value_reference} of variable {name}, value references must be in the range [0, {_value_reference_limit}).')
+
+        if(value_reference in self.used_value_references):
+            raise ValueError(
+                f'The value reference : {value_reference} of variable {name} is already used by the variable {self.used_value_references[value_reference]}.')
+
         var = ScalarVariable(name=name, data_type=data_type, initial=initial, causality=causality,
                              variability=variability, description=description, start=start, value_reference=value_reference)
 
+        if(native):
+            self._define_native_variable(var)
+        elif(define_attribute):
+            self._define_variable(var)
+
         self.vars.append(var)
+        self.used_value_references[value_reference] = name
+
+        if(data_type in _table_types):
+            table = self._value_reference_tables[_table_types.index(data_type)]
+            if(value_reference >= len(table)):
+                table.extend([None] * (value_reference + 1 - len(table)))
+            table[value_reference] = name
+
+    def register_array(self,
+                       name: str,
+                       shape,
+                       data_type: Fmi2DataTypes = Fmi2DataTypes.real,
+                       causality=Fmi2Causality.local,
+                       variability=Fmi2Variability.continuous,
+                       initial: Fmi2Initial = None,
+                       start=None,
+                       description: str = "",
+                       value_reference: int = None):
+        """Add an array of variables, whose elements are stored natively in consecutive slots and have consecutive value references.
+
+        The elements are registered as variables named using the structured naming convention, for instance x[1,2] for the element in
+        the first row and second column of a matrix x, in row-major order. The array is exposed as an attribute of the slave, which is a NumPy array
+        if NumPy is available and a memoryview otherwise. Writes to either modify the store, such that the model can operate on the whole array
+        and the tool can get or set a block of elements with a single copy by the wrapper.
 
-        if(define_attribute):
-            self._define_variable(var)
+        Arguments:
+            name {str} -- name of the attribute, and of the elements before their indices
+            shape {int or tuple of int} -- number of elements along each dimension
+
+        Keyword Arguments:
+            data_type, causality, variability, initial and description are those of every element, see register_variable
+            start {[type]} -- start value of every element, or a nested sequence of start values of the shape (default: {None})
+            value_reference {int} -- value reference of the first element, by default the first of a block of unused value references (default: {None})
+        """
+        shape = (shape,) if isinstance(shape, int) else tuple(shape)
+
+        if(not shape or any(n < 1 for n in shape)):
+            raise ValueError(f'Illegal shape : {shape} of the array {name}, every dimension must have at least one element.')
+
+        existing = type(self).__dict__.get(name)
+
+        if(existing is not None and not (isinstance(existing, NativeArray) and existing.shape == shape)):
+            raise ValueError(
+                f'Unable to store the array {name} natively, the class already defines an attribute with this name.')
+
+        n = prod(shape)
+
+        if(value_reference is None):
+            value_reference = self._acquire_unused_value_references(n)
+
+        used = [vr for vr in range(value_reference, value_reference + n) if vr in self.used_value_references]
+
+        if(used):
+            raise ValueError(
+                f'The value references [{value_reference}, {value_reference + n}) of the array {name} overlap those of the variable {self.used_value_references[used[0]]}.')
+
+        starts = [start] * n if start is None or isinstance(start, (int, float, bool)) else flatten(start, shape)
+
+        # indices of the elements in row-major order, starting from 1 as in the structured naming convention
+        indices = list(product(*(range(1, d + 1) for d in shape)))
+        elements = [f'{name}[{",".join(map(str, index))}]' for index in indices]
+
+        for k, (element, element_start) in enumerate(zip(elements, starts)):
+            self.register_variable(element, data_type=data_type, causality=causality, variability=variability, initial=initial,
+                                   start=element_start, description=description, value_reference=value_reference + k, native=True)
+
+        first = type(self).__dict__[elements[0]]
+
+        if(isinstance(existing, NativeArray) and existing.data_type is first.data_type and existing.slot == first.slot):
+            return
+
+        if(existing is not None):
+            raise ValueError(
+                f'Unable to store the array {name} natively, the class already defines an array with this name but a different layout.')
+
+        setattr(type(self), name, NativeArray(first.data_type, first.slot, shape))
+
+    def register_state(self, state: str, derivative: str, nominal: float = 1.0):
+        """Declares a continuous state of the model and the variable holding its derivative, such that the slave can be simulated using Model Exchange.
+
+        The states are numbered in the order in which they are registered, which is the order of the vectors passed to
+        set_continuous_states, get_derivatives and the other Model Exchange functions.
+
+        Arguments:
+            state {str} -- name of the variable holding the state, a continuous Real variable registered using register_variable
+            derivative {str} -- name of the variable holding the derivative of the state with respect to time, a continuous Real variable registered using register_variable
+
+        Keyword Arguments:
+            nominal {float} -- nominal value of the state, which integrators use to scale their error estimates (default: {1.0})
+
+        Examples:
+
+        ```
+        self.register_variable('x', data_type=Fmi2DataTypes.real, initial=Fmi2Initial.exact, start=1.0)
+        self.register_variable('der_x', data_type=Fmi2DataTypes.real)
+        self.register_state('x', 'der_x')
+        ```
+        """
+        variables = {var.name: var for var in self.vars}
+
+        for name in (state, derivative):
+            var = variables.get(name)
+
+            if(var is None):
+                raise ValueError(
+                    f'Unable to register the state {state}, no variable named {name} has been registered.')
+
+            if(var.data_type is not Fmi2DataTypes.real or var.variability is not Fmi2Variability.continuous):
+                raise ValueError(
+                    f'Unable to register the state {state}, the variable {name} must be a continuous Real variable.')
+
+        if(state == derivative):
+            raise ValueError(f'The state {state} can not be its own derivative.')
+
+        used = {name for (s, d, _) in self._continuous_states for name in (s, d)}
+
+        if(state in used or derivative in used):
+            raise ValueError(
+                f'Unable to register the state {state}, either it or the derivative {derivative} is already part of a registered state.')
+
+        if(not nominal > 0):
+            raise ValueError(f'The nominal value of the state {state} must be positive, it was: {nominal}.')
+
+        self._continuous_states.append((state, derivative, float(nominal)))
+
+    def register_event_indicators(self, n: int):
+        """Declares the number of event indicators of the model, whose values are written by get_event_indicators.
+
+        The tool locates state events by detecting changes of the sign of the indicators between integrator steps.
+        Registering the indicators, even none, also allows a model without continuous states to be simulated using Model Exchange.
+        """
+        if(n < 0):
+            raise ValueError(f'The number of event indicators must not be negative, it was: {n}.')
+
+        self._n_event_indicators = n
+
+    def declare_dependencies(self, unknown: str, knowns: Iterable[str]):
+        """Declares the inputs and continuous states on which an output or a derivative depends, at the current time.
+
+        The dependencies are written to the model structure of the model description and make up the sparsity pattern
+        of the Jacobian assembled by the wrapper, see get_directional_derivative. Outputs and derivatives whose dependencies
+        are not declared are assumed to depend on all inputs and states.
+
+        Arguments:
+            unknown {str} -- name of an output or of a variable registered as the derivative of a state
+            knowns {Iterable[str]} -- names of the inputs and the states on which the unknown depends, which may be empty
+
+        Examples:
+
+        ```
+        self.declare_dependencies('der_v', ['x', 'v', 'force'])
+        ```
+        """
+        variables = {var.name: var for var in self.vars}
+        states = {s for (s, _, _) in self._continuous_states}
+        derivatives = {d for (_, d, _) in self._continuous_states}
+
+        var = variables.get(unknown)
+
+        if(var is None or not (var.causality.name == Fmi2Causality.output.name or unknown in derivatives)):
+            raise ValueError(
+                f'Unable to declare the dependencies of {unknown}, it must be an output or the derivative of a registered state.')
+
+        knowns = list(knowns)
+
+        for name in knowns:
+            known = variables.get(name)
+
+            if(known is None or not (known.causality.name == Fmi2Causality.input.name or name in states)):
+                raise ValueError(
+                    f'Unable to declare the dependencies of {unknown}, the variable {name} must be an input or a registered state.')
+
+        self._dependencies[unknown] = knowns
 
     def register_log_category(self, name: str):
         """Registers a new log category.
@@ -340,14 +623,317 @@ class Fmi2Slave:
         pass
 
     def do_step(self, current_time: float, step_size: float) -> bool:
+        """Advances the slave by a single communication step.
+
+        Returns:
+            bool -- False if the step was discarded, for instance because the slave could not reach the end of the step,
+            which the wrapper reports to the tool as fmi2Discard. Any other value, including None, marks the step as completed.
+        """
         pass
 
-    def reset(self):
+    def do_steps(self, current_time: float, step_sizes, input_vrs, inputs, output_vrs, outputs) -> int:
+        """Advances several contiguous communication steps, setting Real inputs before and recording Real outputs after each step.
+
+        This function is called by the tool through the pyfmuDoSteps function, which is an extension of the FMI API.
+
+        The inputs and outputs are flat sequences of one row per step, with one value per value reference,
+        for instance the value of output_vrs[j] after step k is written to outputs[k * len(output_vrs) + j].
+        The wrapper passes memoryviews of the arrays of the tool, which are only valid until the function returns.
+
+        By default do_step is called for every step. Slaves whose steps can be computed at once, for instance using NumPy,
+        may override this to avoid the cost of calling do_step, __set_real__ and __get_real__ for each step.
+
+        Returns:
+            int -- the number of completed steps, which is less than len(step_sizes) if a step was discarded.
+            A step which fails raises an exception, which the wrapper reports to the tool as fmi2Error.
+        """
+        input_vrs = _as_list(input_vrs)
+        output_vrs = _as_list(output_vrs)
+        inputs = _as_list(inputs)
+        n_inputs = len(input_vrs)
+        n_outputs = len(output_vrs)
+
+        for k, step_size in enumerate(_as_list(step_sizes)):
+            try:
+                if n_inputs:
+                    self.__set_real__(input_vrs, inputs[k * n_inputs:(k + 1) * n_inputs])
+
+                if self.do_step(current_time, step_size) is False:
+                    return k
+
+                if n_outputs:
+                    self.__get_real__(output_vrs, outputs[k * n_outputs:(k + 1) * n_outputs])
+            except Exception as e:
+                self.log(f"Step {k} at time {current_time} failed: {e!r}", status=Fmi2Status.error)
+                raise
+
+            current_time += step_size
+
+        return len(step_sizes)
+
+    def input_at(self, name: str, time: float) -> float:
+        """Returns the value of a Real input at a time within the current communication step, extrapolated using the derivatives set by the tool.
+
+        The input is extrapolated by the Taylor polynomial around the start of the step, from the value of the input and its derivatives
+        set by the tool through fmi2SetRealInputDerivatives. Without derivatives the value of the input is returned, as is the case
+        unless the slave sets __interpolates_inputs__ = True.
+
+        Examples:
+
+        ```
+        def do_step(self, current_time, step_size):
+            # Simpson's rule, which is exact for inputs extrapolated by polynomials of up to the third degree
+            u0, u1, u2 = (self.input_at('u', current_time + f * step_size) for f in (0, 0.5, 1))
+            self.y += step_size / 6 * (u0 + 4 * u1 + u2)
+        ```
+        """
+        value = getattr(self, name)
+        dt = time - self._input_derivatives_time
+        term = 1.0
+
+        for order, derivative in enumerate(self._input_derivatives.get(name, ()), start=1):
+            term *= dt / order
+            value = value + derivative * term
+
+        return value
+
+    def ensemble_size(self) -> int:
+        """Returns the number of members simulated by the instance, which is 1 unless the tool instantiated it using pyfmuInstantiateEnsemble.
+
+        The members share the slave, but have their own values of the natively stored variables. While simulating more than one member,
+        such variables read as a column of one value per member, a NumPy array if NumPy is installed and a strided memoryview otherwise,
+        and may be assigned a column or a single value, which is then set for all members. Other attributes are shared by all members.
+
+        Examples:
+
+        ```
+        def do_step(self, current_time, step_size):
+            if self.ensemble_size() == 1:
+                self.y = self.amplitude * sin(self.frequency * current_time)
+            else:
+                self.y = [a * sin(f * current_time) for a, f in zip(self.amplitude, self.frequency)]
+        ```
+        """
+        return self._native_store.members
+
+    def set_time(self, time: float) -> None:
+        """Sets the independent variable time of a slave simulated using Model Exchange.
+
+        This function is called by the tool through the fmi2SetTime function. The wrapper defers the call until the slave is called next,
+        such that an integrator setting the time and the states before getting the derivatives calls evaluate_derivatives only.
+
+        By default the time is assigned to the attribute time.
+        """
+        self.time = time
+
+    def set_continuous_states(self, states) -> None:
+        """Sets the values of the continuous states, ordered as registered using register_state.
+
+        This function is called by the tool through the fmi2SetContinuousStates function, deferred by the wrapper as set_time.
+        The states are a read-only memoryview of an array of the wrapper, whose values change as the tool sets the states, as such they must be copied.
+
+        By default the values are assigned to the variables holding the states.
+        """
+        for (state, _, _), value in zip(self._continuous_states, _as_list(states)):
+            setattr(self, state, value)
+
+    def get_continuous_states(self, states) -> None:
+        """Writes the values of the continuous states into the memoryview, ordered as registered using register_state.
+
+        This function is called by the tool through the fmi2GetContinuousStates function, unless the tool set the states since the slave was last called.
+        """
+        for i, (state, _, _) in enumerate(self._continuous_states):
+            states[i] = getattr(self, state)
+
+    def get_nominals_of_continuous_states(self, nominals) -> None:
+        """Writes the nominal values of the continuous states into the memoryview.
+
+        This function is called by the tool through the fmi2GetNominalsOfContinuousStates function.
+        By default the nominal values given to register_state are written.
+        """
+        for i, (_, _, nominal) in enumerate(self._continuous_states):
+            nominals[i] = nominal
+
+    def get_derivatives(self, derivatives) -> None:
+        """Writes the derivatives of the continuous states with respect to time into the memoryview, at the current time and states.
+
+        This function is called by the tool through the fmi2GetDerivatives function, unless the time or the states were set since the slave was last called,
+        in which case evaluate_derivatives is called instead.
+
+        By default the values of the variables holding the derivatives are written, which slaves must either keep up to date as the states change,
+        for instance in set_continuous_states, or compute by overriding this.
+        """
+        for i, (_, derivative, _) in enumerate(self._continuous_states):
+            derivatives[i] = getattr(self, derivative)
+
+    def get_event_indicators(self, indicators) -> None:
+        """Writes the values of the event indicators into the memoryview, at the current time and states.
+
+        This function is called by the tool through the fmi2GetEventIndicators function, unless the time or the states were set since the slave was last called,
+        in which case evaluate_event_indicators is called instead. Slaves registering event indicators must override this.
+        """
         pass
 
+    def evaluate_derivatives(self, time: float, states, derivatives) -> None:
+        """Sets the time and the continuous states, then writes the derivatives into the memoryview, in a single call.
+
+        This function is called by the wrapper for fmi2GetDerivatives if the time or the states were set since the slave was last called,
+        which is the sequence of calls made by integrators for every evaluation of the derivatives.
+        The states are passed as by set_continuous_states, the derivatives are a memoryview of the array of the tool, which is only valid until the function returns.
+
+        By default set_time, set_continuous_states and get_derivatives are called.
+        Slaves may override this to compute the derivatives from the arrays at once, for instance using NumPy,
+        in which case they must also adopt the time and the states as set_time and set_continuous_states would, since these are not called.
+        """
+        self.set_time(time)
+        self.set_continuous_states(states)
+        self.get_derivatives(derivatives)
+
+    def evaluate_event_indicators(self, time: float, states, indicators) -> None:
+        """Sets the time and the continuous states, then writes the event indicators into the memoryview, in a single call.
+
+        The counterpart of evaluate_derivatives, called for fmi2GetEventIndicators if the time or the states were set since the slave was last called.
+        """
+        self.set_time(time)
+        self.set_continuous_states(states)
+        self.get_event_indicators(indicators)
+
+    def enter_event_mode(self) -> None:
+        """Called by the tool through the fmi2EnterEventMode function, once an event was detected.
+        """
+        pass
+
+    def new_discrete_states(self) -> Fmi2EventInfo:
+        """Updates the discrete states of the model at an event, called by the tool through the fmi2NewDiscreteStates function.
+
+        Returns:
+            Fmi2EventInfo -- describes whether another iteration is needed and the time of the next time event, None is equivalent to Fmi2EventInfo()
+        """
+        return Fmi2EventInfo()
+
+    def enter_continuous_time_mode(self) -> None:
+        """Called by the tool through the fmi2EnterContinuousTimeMode function, once the event iteration has converged.
+        """
+        pass
+
+    def completed_integrator_step(self, no_set_fmu_state_prior_to_current_point: bool) -> Tuple[bool, bool]:
+        """Called by the tool through the fmi2CompletedIntegratorStep function once an integrator step has been accepted.
+
+        Returns:
+            Tuple[bool, bool] -- whether to enter event mode, for instance due to a step event, and whether to terminate the simulation
+        """
+        return False, False
+
+    def get_directional_derivative(self, unknowns, knowns, seed, sensitivity) -> None:
+        """Writes the partial derivatives of the unknowns with respect to the knowns, multiplied by the seed, into sensitivity.
+
+        This function is called by the tool through the fmi2GetDirectionalDerivative function, and by the wrapper for every group of
+        columns of a Jacobian assembled by pyfmuGetJacobian. The value references of the unknowns, outputs or derivatives, and of the knowns,
+        inputs or states, are passed as memoryviews, as are the seed and the sensitivity, one value per known and unknown respectively:
+
+            sensitivity[i] = sum(d unknowns[i] / d knowns[j] * seed[j] for j in range(len(knowns)))
+
+        Slaves which can compute the derivatives analytically, or using automatic differentiation, should override this.
+        Otherwise the wrapper approximates them by finite differences, perturbing the knowns of a snapshot of the slave, see get_state.
+        The unknowns of the perturbed slave are recomputed by evaluate_outputs and, for slaves providing Model Exchange, get_derivatives.
+        Slaves which provide neither can not approximate their derivatives, in which case the call fails.
+        """
+        raise NotImplementedError()
+
+    def evaluate_outputs(self) -> None:
+        """Computes the outputs from the current inputs, parameters and state, without advancing the time.
+
+        This function is called by the wrapper to approximate directional derivatives by finite differences, after perturbing the inputs.
+        Co-simulation slaves which compute their outputs in do_step, and which do not override get_directional_derivative,
+        should override this such that the wrapper can approximate their derivatives, see get_directional_derivative.
+
+        Examples:
+
+        ```
+        def evaluate_outputs(self):
+            self.s = self.a + self.b
+
+        def do_step(self, current_time, step_size):
+            self.evaluate_outputs()
+        ```
+        """
+        raise NotImplementedError()
+
+    def get_real_output_derivatives(self, vrs, orders, values) -> None:
+        """Writes the derivatives of the Real outputs at the end of the last step into values, the orders[i]-th derivative of the output vrs[i].
+
+        This function is called by the tool through the fmi2GetRealOutputDerivatives function, with memoryviews of its arrays.
+        The orders are at least 1 and at most __max_output_derivative_order__.
+
+        Slaves which know the derivatives of their outputs should override this, and set __max_output_derivative_order__ to the highest order they provide.
+        Otherwise the wrapper estimates the derivatives from the values of the outputs at the last communication points at which the tool got them.
+        """
+        raise NotImplementedError()
+
+    def reset(self):
+        """Returns the slave to the state it had after being instantiated, such that the instance may be simulated again.
+
+        This function is called by the tool through the fmi2Reset function, and by the wrapper before a pooled instance is reused.
+        The wrapper restores the state captured after instantiation before calling this, if the state of the slave can be captured.
+
+        By default the variables which define a start value are set to it. Slaves with further state should override this.
+        """
+        for var in self.vars:
+            if var.start is not None:
+                setattr(self, var.name, var.start)
+
     def terminate(self):
         pass
 
+    def get_state(self) -> Any:
+        """Returns a snapshot of the state of the slave, which the tool may restore later to roll back the simulation.
+
+        This function is called by the tool through the fmi2GetFMUstate function.
+
+        By default the snapshot is a copy of the attributes of the instance, except those listed in __stateless_attributes__.
+        Values of immutable types are shared rather than copied, other values are deep-copied.
+        The values of natively stored variables are captured by the wrapper and are not part of the snapshot.
+
+        Slaves keeping state outside of their attributes, or state which is expensive to copy, may override this along with set_state.
+        The wrapper treats the snapshot as opaque and never modifies it.
+        """
+        stateless = self.__stateless_attributes__
+        return {name: _copy_value(value) for name, value in self.__dict__.items() if name not in stateless}
+
+    def set_state(self, state: Any) -> None:
+        """Restores a snapshot returned by get_state.
+
+        This function is called by the tool through the fmi2SetFMUstate function.
+
+        The same snapshot may be restored several times, as such it must not be modified by the slave.
+        Attributes defined after the snapshot was taken are removed, except those listed in __stateless_attributes__.
+        """
+        stateless = self.__stateless_attributes__
+
+        for name in [name for name in self.__dict__ if name not in stateless and name not in state]:
+            del self.__dict__[name]
+
+        self.__dict__.update({name: _copy_value(value) for name, value in state.items()})
+
+    def serialize_state(self, state: Any) -> bytes:
+        """Serializes a snapshot returned by get_state, such that the tool may store it or pass it to another process.
+
+        This function is called by the tool through the fmi2SerializeFMUstate function.
+
+        By default the snapshot is pickled. Slaves whose state can not be pickled may override this along with deserialize_state.
+        The values of natively stored variables are serialized by the wrapper as raw arrays and are not part of the snapshot.
+        """
+        return pickle.dumps(state, protocol=pickle.HIGHEST_PROTOCOL)
+
+    def deserialize_state(self, data: memoryview) -> Any:
+        """Restores a snapshot serialized by serialize_state, without applying it to the slave.
+
+        This function is called by the tool through the fmi2DeSerializeFMUstate function.
+
+        The data is a read-only view of the buffer of the tool, which is only valid until the function returns.
+        """
+        return pickle.loads(data)
+
     def __set_debug_logging__(self, logging_on: bool, categories: Iterable[str]) -> None:
         """Defines the set of active log categories for which log messages will logged.
         Messages logged to any other categories will be ignored.
@@ -406,7 +992,8 @@ class Fmi2Slave:
         Arguments:
             status {Fmi2Status} -- The current status of the FMU.
             category {str} -- The category of the log message.
-            message {str} -- The log message itself.
+            message {str} -- The log message itself, or a callable returning it which is only invoked if the message is logged.
+                             This avoids formatting messages while logging is off, e.g. self.log(lambda: f"state is {self.x}")
 
         Logging categories mappings:
 
@@ -415,6 +1002,11 @@ class Fmi2Slave:
 
         self.logger.log(message, category, status)
 
+    def log_enabled(self, category=None, status=Fmi2Status.ok) -> bool:
+        """Returns true if a message logged with the category and status is passed to the tool.
+        """
+        return self.logger.enabled(category, status)
+
     def __pop_log_messages__(self, n: int) -> Tuple[str, str, str]:
         """Function called by the wrapper to fetch log messages
 
@@ -443,84 +1035,44 @@ class Fmi2Slave:
         return len(self.logger)
 
     def __get_integer__(self, vrs, refs):
-        for i in range(len(vrs)):
-            vr = vrs[i]
-            var = self.vars[vr]
-            if var.is_integer():
-                refs[i] = getattr(self, var.name)
-            else:
-                raise Exception(
-                    f"Variable with valueReference={vr} is not of type Integer!")
+        table = self._value_reference_tables[_INTEGER]
+        for i, vr in enumerate(_as_list(vrs)):
+            refs[i] = getattr(self, _resolve(table, vr, "Integer"))
 
     def __get_real__(self, vrs, refs):
-        for i in range(len(vrs)):
-            vr = vrs[i]
-            var = self.vars[vr]
-            if var.is_real():
-                refs[i] = getattr(self, var.name)
-            else:
-                raise Exception(
-                    f"Variable with valueReference={vr} is not of type Real!")
+        table = self._value_reference_tables[_REAL]
+        for i, vr in enumerate(_as_list(vrs)):
+            refs[i] = getattr(self, _resolve(table, vr, "Real"))
 
     def __get_boolean__(self, vrs, refs):
-        for i in range(len(vrs)):
-            vr = vrs[i]
-            var = self.vars[vr]
-            if var.is_boolean():
-                refs[i] = getattr(self, var.name)
-            else:
-                raise Exception(
-                    f"Variable with valueReference={vr} is not of type Boolean!")
+        table = self._value_reference_tables[_BOOLEAN]
+        for i, vr in enumerate(_as_list(vrs)):
+            refs[i] = getattr(self, _resolve(table, vr, "Boolean"))
 
     def __get_string__(self, vrs, refs):
-        for i in range(len(vrs)):
-            vr = vrs[i]
-            var = self.vars[vr]
-            if var.is_string():
-                refs[i] = getattr(self, var.name)
-            else:
-                raise Exception(
-                    f"Variable with valueReference={vr} is not of type String!")
+        table = self._value_reference_tables[_STRING]
+        for i, vr in enumerate(_as_list(vrs)):
+            refs[i] = getattr(self, _resolve(table, vr, "String"))
 
     def __set_integer__(self, vrs, values):
-        for i in range(len(vrs)):
-            vr = vrs[i]
-            var = self.vars[vr]
-            if var.is_integer:
-                setattr(self, var.name, values[i])
-            else:
-                raise Exception(
-                    f"Variable with valueReference={vr} is not of type Integer!")
+        table = self._value_reference_tables[_INTEGER]
+        for vr, value in zip(_as_list(vrs), _as_list(values)):
+            setattr(self, _resolve(table, vr, "Integer"), value)
 
     def __set_real__(self, vrs, values):
-        for i in range(len(vrs)):
-            vr = vrs[i]
-            var = self.vars[vr]
-            if var.is_real():
-                setattr(self, var.name, values[i])
-            else:
-                raise Exception(
-                    f"Variable with valueReference={vr} is not of type Real!")
+        table = self._value_reference_tables[_REAL]
+        for vr, value in zip(_as_list(vrs), _as_list(values)):
+            setattr(self, _resolve(table, vr, "Real"), value)
 
     def __set_boolean__(self, vrs, values):
-        for i in range(len(vrs)):
-            vr = vrs[i]
-            var = self.vars[vr]
-            if var.is_boolean():
-                setattr(self, var.name, values[i])
-            else:
-                raise Exception(
-                    f"Variable with valueReference={vr} is not of type Boolean!")
+        table = self._value_reference_tables[_BOOLEAN]
+        for vr, value in zip(_as_list(vrs), _as_list(values)):
+            setattr(self, _resolve(table, vr, "Boolean"), bool(value))
 
     def __set_string__(self, vrs, values):
-        for i in range(len(vrs)):
-            vr = vrs[i]
-            var = self.vars[vr]
-            if var.is_string():
-                setattr(self, var.name, values[i])
-            else:
-                raise Exception(
-                    f"Variable with valueReference={vr} is not of type String!")
+        table = self._value_reference_tables[_STRING]
+        for vr, value in zip(_as_list(vrs), _as_list(values)):
+            setattr(self, _resolve(table, vr, "String"), value)
 
     def _define_variable(self, sv: ScalarVariable):
 
@@ -539,6 +1091,137 @@ class Fmi2Slave:
                     "start value variable defined using the 'register_variable' function does not match initial value")
                 setattr(self, sv.name, new)
 
+    def _define_native_variable(self, sv: ScalarVariable):
+        """Stores the value of the variable in the native store and exposes it as an attribute of the class.
+
+        Note that the descriptor is shared by all instances of the class, as such all instances must register the same native variables in the same order.
+        """
+        # an attribute assigned prior to registration would be shadowed by the descriptor
+        assigned = self.__dict__.pop(sv.name, None)
+        value = sv.start if sv.start is not None else assigned
+
+        slot = self._native_store.add(sv.data_type, sv.value_reference, value)
+
+        existing = type(self).__dict__.get(sv.name)
+
+        if(isinstance(existing, NativeVariable) and existing.data_type is sv.data_type and existing.slot == slot):
+            return
+
+        if(existing is not None):
+            raise ValueError(
+                f'Unable to store the variable {sv.name} natively, the class already defines an attribute with this name.')
+
+        setattr(type(self), sv.name, native_variable(sv.data_type, slot))
+
+    def __value_references__(self) -> Tuple[List[int], List[int], List[int], List[int]]:
+        """Returns the value references of the Real, Integer, Boolean and String variables.
+
+        The function is called by the wrapper, which builds a table of its own to reject value references of the wrong type without calling into the slave.
+        """
+        return tuple([vr for vr, name in enumerate(table) if name is not None] for table in self._value_reference_tables)
+
+    def __model_exchange__(self) -> Tuple[List[Tuple[str, str, float]], int]:
+        """Returns the continuous states, as (state, derivative, nominal), and the number of event indicators, or None if the slave does not provide Model Exchange.
+
+        The function is called by the wrapper, which sizes the vectors exchanged with the tool accordingly, and by the exporter to describe the states.
+        """
+        if(not self._continuous_states and self._n_event_indicators is None):
+            return None
+
+        return list(self._continuous_states), self._n_event_indicators or 0
+
+    def __state_value_references__(self) -> List[int]:
+        """Returns the value references of the continuous states, ordered as registered using register_state.
+
+        The function is called by the wrapper, which perturbs the states through set_continuous_states rather than __set_real__ when approximating
+        directional derivatives, such that slaves computing the derivatives in evaluate_derivatives are passed the perturbed states.
+        """
+        vrs = {var.name: var.value_reference for var in self.vars}
+
+        return [vrs[state] for (state, _, _) in self._continuous_states]
+
+    def __directional_derivatives__(self) -> Tuple[bool, Dict[int, List[int]], bool]:
+        """Returns whether the slave overrides get_directional_derivative, the value references of the dependencies declared for outputs and derivatives,
+        and whether the slave overrides evaluate_outputs.
+
+        The function is called by the wrapper, which approximates the derivatives of slaves without get_directional_derivative using evaluate_outputs,
+        and uses the dependencies to perturb several knowns at once, and by the exporter.
+        """
+        vrs = {var.name: var.value_reference for var in self.vars}
+        dependencies = {vrs[unknown]: [vrs[name] for name in knowns] for unknown, knowns in self._dependencies.items()}
+
+        return (type(self).get_directional_derivative is not Fmi2Slave.get_directional_derivative, dependencies,
+                type(self).evaluate_outputs is not Fmi2Slave.evaluate_outputs)
+
+    def __interpolation__(self) -> Tuple[List[int], bool, int, List[int]]:
+        """Returns the value references of the Real inputs whose derivatives the tool may set, whether the slave overrides get_real_output_derivatives,
+        the highest order of the derivatives of the outputs, and the value references of the Real outputs.
+
+        The function is called by the wrapper and the exporter. No inputs are returned unless the slave sets __interpolates_inputs__ = True.
+        Unless the slave provides the derivatives, the wrapper records the outputs after every step to estimate them.
+        """
+        def real_variables(causality):
+            return [var.value_reference for var in self.vars
+                    if var.causality.name == causality.name and var.data_type.name == Fmi2DataTypes.real.name]
+
+        inputs = real_variables(Fmi2Causality.input) if self.__interpolates_inputs__ else []
+
+        provided = type(self).get_real_output_derivatives is not Fmi2Slave.get_real_output_derivatives
+        order = self.__max_output_derivative_order__ if provided else min(self.__max_output_derivative_order__, 2)
+
+        return inputs, provided, order, real_variables(Fmi2Causality.output)
+
+    def __set_input_derivatives__(self, time: float, derivatives: Dict[int, List[float]]) -> None:
+        """Adopts the derivatives of the inputs set by the tool for the step starting at time, by value reference, which replace those of the previous step.
+
+        The function is called by the wrapper before a step, if the tool set derivatives for it or for the previous step.
+        """
+        names = {var.value_reference: var.name for var in self.vars}
+
+        self._input_derivatives = {names[vr]: list(d) for vr, d in derivatives.items()}
+        self._input_derivatives_time = time
+
+    def __native_variables__(self):
+        """Returns the value references of the natively stored Real, Integer and Boolean variables, ordered by their position in the store.
+
+        The function is called by the wrapper, which allocates arrays of matching size and attaches them using __attach_native_store__.
+        """
+        return self._native_store.layout()
+
+    def __attach_native_store__(self, reals: memoryview, integers: memoryview, booleans: memoryview, members: int = 1) -> None:
+        """Moves the values of natively stored variables into the arrays of the wrapper.
+
+        The arrays hold one row of values per member of an ensemble, each of which starts from the current values.
+        """
+        self._native_store.attach(reals, integers, booleans, members)
+
+    def __log_categories__(self) -> List[str]:
+        """Returns the names of the registered log categories, which the wrapper assigns bits in its set of active categories.
+        """
+        return self.logger.categories()
+
+    def __attach_log_filter__(self, active: memoryview, ids: List[int]) -> None:
+        """Reads the active log categories from the wrapper, which then sets them without calling __set_debug_logging__.
+        """
+        self.logger.attach_filter(active, ids)
+
+    def __attach_log_ring__(self, indices: memoryview, data: memoryview) -> None:
+        """Directs log messages into the ring of the wrapper, which reads them without calling __get_log_size__ and __pop_log_messages__.
+        """
+        self.logger.attach(indices, data)
+
+    def _acquire_unused_value_references(self, n: int) -> int:
+        """ Returns the first of n consecutive unused value references
+        """
+        while(True):
+            vr = self.value_reference_counter
+
+            if(all(vr + k not in self.used_value_references for k in range(n))):
+                self.value_reference_counter += n
+                return vr
+
+            self.value_reference_counter += 1
+
     def _acquire_unused_value_reference(self) -> int:
         """ Returns the an unused value reference
         """
@@ -0,0 +1,258 @@
+"""Defines storage of variable values in contiguous arrays, which the wrapper can read and write without calling into Python.
+"""
+from array import array
+from math import prod
+from typing import List, Tuple
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+from .fmi2types import Fmi2DataTypes
+
+# data types which may be stored natively, in the order of the stores arrays
+_data_types = (Fmi2DataTypes.real, Fmi2DataTypes.integer, Fmi2DataTypes.boolean)
+
+# array type codes matching fmi2Real, fmi2Integer and fmi2Boolean
+_typecodes = ('d', 'i', 'i')
+
+_default_values = {
+    Fmi2DataTypes.real: 0.0,
+    Fmi2DataTypes.integer: 0,
+    Fmi2DataTypes.boolean: False,
+}
+
+
+class Fmi2NativeStore:
+    """Stores the values of natively backed variables in one contiguous array per data type.
+
+    Until the wrapper attaches memory of its own, the values are held in Python arrays.
+    This allows the slave to be used outside the wrapper, for instance when exporting or testing it.
+
+    The memory of an ensemble holds the values of every member, in which case the buffers are EnsembleColumns,
+    which are indexed by slot like the arrays of a single member but return the values of all members.
+    """
+
+    def __init__(self):
+        # indexed by position rather than data type, hashing an enum is too slow for attribute access
+        self.buffers = [array(c) for c in _typecodes]
+        self.value_references = [[] for _ in _typecodes]
+        self.attached = False
+        self.members = 1
+
+        # views of the blocks of array variables, by data type and first slot, created on first access
+        self._views = {}
+
+    def add(self, data_type: Fmi2DataTypes, value_reference: int, value) -> int:
+        """Adds a variable to the store and returns its position in the array of its data type.
+        """
+        if(self.attached):
+            raise RuntimeError(
+                'Variables can not be stored natively once the store has been attached to the wrapper.')
+
+        if(data_type not in _data_types):
+            raise ValueError(
+                f'Only Real, Integer and Boolean variables can be stored natively, the data type was: {data_type}')
+
+        if(value is None):
+            value = _default_values[data_type]
+
+        # an array exporting buffers can not grow
+        self._views.clear()
+
+        index = buffer_index(data_type)
+        buffer = self.buffers[index]
+        buffer.append(value)
+        self.value_references[index].append(value_reference)
+
+        return len(buffer) - 1
+
+    def attach(self, reals: memoryview, integers: memoryview, booleans: memoryview, members: int = 1) -> None:
+        """Moves the values into memory owned by the wrapper, exposed as writable memoryviews.
+
+        The memory of an ensemble holds members copies of the values, one after another, each of which starts from the current values.
+        """
+        for index, view in enumerate((reals, integers, booleans)):
+            values = self.buffers[index]
+            n = len(values)
+
+            for member in range(members):
+                view[member * n:(member + 1) * n] = values
+
+            self.buffers[index] = view if members == 1 else EnsembleColumns(view, n, members)
+
+        self._views.clear()
+        self.members = members
+        self.attached = True
+
+    def view(self, index: int, slot: int, shape: Tuple[int, ...]):
+        """Returns a view of the block of values starting at the slot, shaped like the array variable stored in it.
+
+        The view is a NumPy array if NumPy is available and a memoryview otherwise, in both cases writes to the view modify the store.
+        """
+        key = (index, slot)
+        view = self._views.get(key)
+
+        if(view is None and self.members > 1):
+            view = self.buffers[index].block(slot, shape)
+            self._views[key] = view
+
+        if(view is None):
+            block = memoryview(self.buffers[index])[slot:slot + prod(shape)]
+            view = block.cast('B').cast(_typecodes[index], shape)
+
+            if(numpy is not None):
+                view = numpy.asarray(view)
+
+            self._views[key] = view
+
+        return view
+
+    def layout(self) -> Tuple[List[int], List[int], List[int]]:
+        """Returns the value references of the Real, Integer and Boolean variables, ordered by their position in the store.
+        """
+        return tuple(self.value_references)
+
+
+class EnsembleColumns:
+    """Values of a data type of every member of an ensemble, which are indexed by slot like the array of a single member.
+
+    Reading a slot returns the values of the variable of every member, as a NumPy array if NumPy is available and as a memoryview otherwise.
+    Assigning a value to a slot sets the variable of every member, assigning a sequence sets that of each member to its element.
+    """
+    __slots__ = ('values', 'stride', 'members', 'columns')
+
+    def __init__(self, values: memoryview, stride: int, members: int):
+        self.values = values if numpy is None else numpy.asarray(values)
+        self.stride = stride
+        self.members = members
+
+        # the values of a variable are those at its slot of each member, a view with a step of the number of variables
+        self.columns = [self.values[slot::stride] for slot in range(stride)]
+
+    def __len__(self):
+        return self.stride
+
+    def __getitem__(self, slot: int):
+        return self.columns[slot]
+
+    def __setitem__(self, slot: int, value):
+        column = self.columns[slot]
+
+        if(numpy is not None):
+            column[:] = value
+        elif(isinstance(value, (int, float))):
+            column[:] = array(column.format, [value] * self.members)
+        else:
+            column[:] = array(column.format, value)
+
+    def block(self, slot: int, shape: Tuple[int, ...]):
+        """Returns a view of the array variable stored from the slot, whose leading dimension is that of the members.
+        """
+        if(numpy is None):
+            raise RuntimeError('Array variables of an ensemble are NumPy arrays, which requires NumPy to be installed.')
+
+        rows = self.values.reshape(self.members, self.stride)
+        return rows[:, slot:slot + prod(shape)].reshape((self.members,) + tuple(shape))
+
+
+def buffer_index(data_type: Fmi2DataTypes) -> int:
+    """Returns the index of the array storing variables of the specified data type.
+    """
+    return _data_types.index(data_type)
+
+
+class NativeVariable:
+    """Data descriptor exposing a natively stored value as an attribute of the slave.
+
+    Reading or writing the attribute invokes the descriptor, which is slower than accessing an ordinary attribute.
+    """
+    __slots__ = ('data_type', 'index', 'slot')
+
+    def __init__(self, data_type: Fmi2DataTypes, slot: int):
+        self.data_type = data_type
+        self.index = buffer_index(data_type)
+        self.slot = slot
+
+    def __get__(self, instance, owner):
+        if(instance is None):
+            return self
+
+        return instance._native_store.buffers[self.index][self.slot]
+
+    def __set__(self, instance, value):
+        instance._native_store.buffers[self.index][self.slot] = value
+
+
+class NativeBoolean(NativeVariable):
+    """Data descriptor exposing a natively stored Boolean, which is stored as an fmi2Boolean, as a bool.
+    """
+    __slots__ = ()
+
+    def __get__(self, instance, owner):
+        if(instance is None):
+            return self
+
+        value = instance._native_store.buffers[self.index][self.slot]
+
+        # the values of the members of an ensemble are returned as stored
+        return bool(value) if value.__class__ is int else value
+
+
+class NativeArray:
+    """Data descriptor exposing a block of natively stored values as an array attribute of the slave.
+
+    The elements are stored in row-major order in consecutive slots, which allows the wrapper to copy
+    a block of value references with a single copy rather than one per element.
+    """
+    __slots__ = ('data_type', 'index', 'slot', 'shape')
+
+    def __init__(self, data_type: Fmi2DataTypes, slot: int, shape: Tuple[int, ...]):
+        self.data_type = data_type
+        self.index = buffer_index(data_type)
+        self.slot = slot
+        self.shape = shape
+
+    def __get__(self, instance, owner):
+        if(instance is None):
+            return self
+
+        return instance._native_store.view(self.index, self.slot, self.shape)
+
+    def __set__(self, instance, values):
+        store = instance._native_store
+
+        if(store.members > 1):
+            store.view(self.index, self.slot, self.shape)[...] = values
+            return
+
+        n = prod(self.shape)
+        flat = flatten(values, self.shape)
+        store.buffers[self.index][self.slot:self.slot + n] = array(_typecodes[self.index], flat)
+
+
+def flatten(values, shape: Tuple[int, ...]) -> list:
+    """Returns the values of a nested sequence, or NumPy array, of the shape in row-major order.
+    """
+    if(numpy is not None and isinstance(values, numpy.ndarray)):
+        values = values.tolist()
+
+    flat = [values]
+
+    for n in shape:
+        if(any(len(v) != n for v in flat)):
+            raise ValueError(f'The values do not match the shape {shape} of the array.')
+
+        flat = [e for v in flat for e in v]
+
+    return flat
+
+
+def native_variable(data_type: Fmi2DataTypes, slot: int) -> NativeVariable:
+    """Returns a descriptor for the variable stored at the slot of the array of its data type.
+    """
+    if(data_type is Fmi2DataTypes.boolean):
+        return NativeBoolean(data_type, slot)
+
+    return NativeVariable(data_type, slot)
@@ -1,6 +1,6 @@
 
 from enum import Enum
-from typing import Union
+from typing import NamedTuple, Optional, Union
 
 class Fmi2Causality(Enum):
     """ Defines the causality of the variable, that is whether it is an input, output, parameter, etc.
@@ -83,4 +83,23 @@ class Fmi2Status(Enum):
     discard = 2
     error = 3
     fatal = 4
-    pending = 5
\ No newline at end of file
+    pending = 5
+
+class Fmi2EventInfo(NamedTuple):
+    """Describes the outcome of an event iteration, returned by new_discrete_states.
+
+    Values:
+        * new_discrete_states_needed: another iteration is required, the tool calls new_discrete_states again.
+        * terminate_simulation: the model requests the simulation to be terminated.
+        * nominals_of_continuous_states_changed: the nominal values returned by get_nominals_of_continuous_states changed.
+        * values_of_continuous_states_changed: the values of the continuous states changed, the tool reads them again.
+        * next_event_time: time of the next time event, or None if there is none.
+
+    Notes:
+        FMI section 3.2.2
+    """
+    new_discrete_states_needed: bool = False
+    terminate_simulation: bool = False
+    nominals_of_continuous_states_changed: bool = False
+    values_of_continuous_states_changed: bool = False
+    next_event_time: Optional[float] = None
@@ -3,6 +3,8 @@ import os
 from pathlib import Path
 from tempfile import TemporaryDirectory
 from shutil import rmtree
+import sys
+from zipfile import ZipFile
 
 from pybuilder.builder.export import export_project, PyfmuProject, PyfmuArchive, _copy_pyfmu_lib_to_archive, _copy_sources_to_archive
 from pybuilder.builder.generate import create_project, PyfmuProject
@@ -52,6 +54,18 @@ class TestExport():
 
             
 
+    def test_export_validProject_bytecodeArchiveGenerated(self):
+        with ExampleArchive('Adder') as a:
+            assert a.bytecode_path.is_file()
+            assert a.bytecode_path.name == f'bytecode.{sys.implementation.cache_tag}.zip'
+
+            with ZipFile(a.bytecode_path) as zf:
+                names = zf.namelist()
+
+            assert 'adder.pyc' in names
+            assert 'pyfmu/__init__.pyc' in names
+            assert 'pyfmu/fmi2slave.pyc' in names
+
     def test_export_validProject_modelDescriptionGenerated(self):
 
         with ExampleArchive('Adder') as a:
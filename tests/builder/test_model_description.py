@@ -1,5 +1,7 @@
+import xml.etree.ElementTree as ET
+
 from pybuilder.resources.pyfmu.fmi2slave import Fmi2Slave
-from pybuilder.resources.pyfmu.fmi2types import Fmi2DataTypes, Fmi2Causality, Fmi2Variability
+from pybuilder.resources.pyfmu.fmi2types import Fmi2DataTypes, Fmi2Causality, Fmi2Variability, Fmi2Initial
 from pybuilder.builder.modelDescription import extract_model_description_v2
 
 class Adder(Fmi2Slave):
@@ -20,4 +22,138 @@ class SineGenerator(Fmi2Slave):
         self.register_variable('amplitude',data_type = Fmi2DataTypes.real, causality= Fmi2Causality.parameter, start=1)
         self.register_variable('frequency', data_type = Fmi2DataTypes.real, causality=Fmi2Causality.parameter, start=1)
         self.register_variable('phase', data_type = Fmi2DataTypes.real, causality=Fmi2Causality.parameter, start=0)
-        self.register_variable('y', data_type = Fmi2DataTypes.real, causality=Fmi2Causality.output)
\ No newline at end of file
+        self.register_variable('y', data_type = Fmi2DataTypes.real, causality=Fmi2Causality.output)
+
+class Decay(Fmi2Slave):
+
+    def __init__(self):
+        super().__init__('Decay')
+        self.register_variable('x', data_type = Fmi2DataTypes.real, causality=Fmi2Causality.output, initial=Fmi2Initial.exact, start=1)
+        self.register_variable('der_x', data_type = Fmi2DataTypes.real)
+        self.register_state('x', 'der_x')
+        self.register_event_indicators(2)
+
+
+def test_modelExchange_declaresStatesAndEventIndicators():
+
+    md = ET.fromstring(extract_model_description_v2(Decay()))
+
+    assert(md.get('numberOfEventIndicators') == '2')
+    assert(md.find('ModelExchange') is not None)
+    assert(md.findall('ModelVariables/ScalarVariable')[1].find('Real').get('derivative') == '1')
+    assert([u.get('index') for u in md.findall('ModelStructure/Derivatives/Unknown')] == ['2'])
+    assert([u.get('index') for u in md.findall('ModelStructure/InitialUnknowns/Unknown')] == ['1', '2'])
+
+
+def test_coSimulationOnly_hasNoModelExchange():
+
+    md = ET.fromstring(extract_model_description_v2(Adder()))
+
+    assert(md.find('ModelExchange') is None)
+    assert(md.find('ModelStructure/Derivatives') is None)
+
+
+class EvaluatingAdder(Adder):
+
+    def evaluate_outputs(self):
+        self.c = self.a + self.b
+
+
+def test_declaredDependencies_writtenToModelStructure():
+
+    a = EvaluatingAdder()
+    a.declare_dependencies("c", ["b"])
+    md = ET.fromstring(extract_model_description_v2(a))
+
+    assert(md.find('CoSimulation').get('providesDirectionalDerivative') == 'true')
+    assert([u.get('dependencies') for u in md.findall('ModelStructure/Outputs/Unknown')] == ['2'])
+
+
+def test_declaredDependencies_outputsNotEvaluated_notProvidedForCoSimulation():
+
+    # the outputs of the slave are only computed by do_step, which the wrapper can not call to approximate the derivatives
+    a = Adder()
+    a.declare_dependencies("c", ["b"])
+    md = ET.fromstring(extract_model_description_v2(a))
+
+    assert(md.find('CoSimulation').get('providesDirectionalDerivative') is None)
+    assert([u.get('dependencies') for u in md.findall('ModelStructure/Outputs/Unknown')] == ['2'])
+
+
+def test_undeclaredDependencies_omitted():
+
+    md = ET.fromstring(extract_model_description_v2(Adder()))
+
+    assert(md.find('CoSimulation').get('providesDirectionalDerivative') is None)
+    assert(md.find('ModelStructure/Outputs/Unknown').get('dependencies') is None)
+
+
+class InterpolatingAdder(Adder):
+
+    __interpolates_inputs__ = True
+    __max_output_derivative_order__ = 1
+
+    def get_real_output_derivatives(self, vrs, orders, values):
+        pass
+
+
+def test_interpolation_declaredByCoSimulation():
+
+    cs = ET.fromstring(extract_model_description_v2(InterpolatingAdder())).find('CoSimulation')
+
+    assert(cs.get('canInterpolateInputs') == 'true')
+    assert(cs.get('maxOutputDerivativeOrder') == '1')
+
+    cs = ET.fromstring(extract_model_description_v2(Adder())).find('CoSimulation')
+
+    assert(cs.get('canInterpolateInputs') is None)
+    assert(cs.get('maxOutputDerivativeOrder') == '2')
+
+
+class Gain(Fmi2Slave):
+
+    def __init__(self):
+        super().__init__('Gain')
+        self.register_array('u', 2, data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=0)
+        self.register_array('K', (2, 2), data_type=Fmi2DataTypes.real, causality=Fmi2Causality.parameter,
+                            variability=Fmi2Variability.tunable, start=[[1, 0], [0, 1]])
+
+
+def test_arrayElements_haveStructuredNames():
+
+    md = ET.fromstring(extract_model_description_v2(Gain()))
+
+    assert(md.get('variableNamingConvention') == 'structured')
+
+    variables = md.findall('ModelVariables/ScalarVariable')
+    assert([v.get('name') for v in variables] == ['u[1]', 'u[2]', 'K[1,1]', 'K[1,2]', 'K[2,1]', 'K[2,2]'])
+    assert([v.get('valueReference') for v in variables] == [str(vr) for vr in range(6)])
+    assert([v.find('Real').get('start') for v in variables[2:]] == ['1', '0', '0', '1'])
+
+
+class UnpicklableAdder(Adder):
+
+    def __init__(self):
+        super().__init__()
+        self.transform = lambda x: x
+
+
+class StatelessAdder(Adder):
+
+    get_state = None
+
+
+def test_fmuState_declaredIfCapturedAndSerialized():
+
+    cs = ET.fromstring(extract_model_description_v2(Adder())).find('CoSimulation')
+    assert(cs.get('canGetAndSetFMUstate') == 'true')
+    assert(cs.get('canSerializeFMUstate') == 'true')
+
+    # functions are shared rather than copied by get_state, but can not be pickled
+    cs = ET.fromstring(extract_model_description_v2(UnpicklableAdder())).find('CoSimulation')
+    assert(cs.get('canGetAndSetFMUstate') == 'true')
+    assert(cs.get('canSerializeFMUstate') == 'false')
+
+    cs = ET.fromstring(extract_model_description_v2(StatelessAdder())).find('CoSimulation')
+    assert(cs.get('canGetAndSetFMUstate') == 'false')
+    assert(cs.get('canSerializeFMUstate') == 'false')
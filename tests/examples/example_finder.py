@@ -16,7 +16,15 @@ _correct_example = {
     'SineGenerator',
     'LoggerFMU',
     "BicycleKinematic",
-    "LivePlotting"
+    "LivePlotting",
+    "Recorder",
+    "Clock",
+    "Oscillator",
+    "HeatRod",
+    "LinearSystem",
+    "Integrator",
+    "MatrixGain",
+    "NativeAdder"
 }
 
 _incorrect_examples = {
@@ -21,9 +21,12 @@ class Adder(Fmi2Slave):
 
 
     def exit_initialization_mode(self):
-        self.s = self.a + self.b
+        self.evaluate_outputs()
         return True
 
-    def do_step(self, current_time: float, step_size: float) -> bool:
+    def evaluate_outputs(self):
         self.s = self.a + self.b
+
+    def do_step(self, current_time: float, step_size: float) -> bool:
+        self.evaluate_outputs()
         return True
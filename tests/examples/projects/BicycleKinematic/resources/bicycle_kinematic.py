@@ -69,7 +69,6 @@ class Bicycle_Kinematic(Fmi2Slave):
 
     @staticmethod
     def _derivatives(t, state,params):
-        print(t)
         df,a,lf,lr = params
 
         _,_,psi,v = state
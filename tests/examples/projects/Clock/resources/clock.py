@@ -0,0 +1,32 @@
+from pyfmu.fmi2slave import Fmi2Slave
+from pyfmu.fmi2types import Fmi2Causality, Fmi2Variability, Fmi2DataTypes
+
+
+class Clock(Fmi2Slave):
+    """Outputs the simulation time as a string, such that every step produces a new string.
+    """
+
+    def __init__(self):
+
+        author = ""
+        modelName = "Clock"
+        description = "Outputs the current time formatted as a string"
+
+        super().__init__(
+            modelName=modelName,
+            author=author,
+            description=description)
+
+        self.register_variable("label", data_type=Fmi2DataTypes.string, causality=Fmi2Causality.parameter, variability=Fmi2Variability.fixed, start="t")
+        self.register_variable("text", data_type=Fmi2DataTypes.string, causality=Fmi2Causality.output, variability=Fmi2Variability.discrete)
+        self.register_variable("ticks", data_type=Fmi2DataTypes.integer, causality=Fmi2Causality.output, variability=Fmi2Variability.discrete)
+
+    def exit_initialization_mode(self):
+        self.ticks = 0
+        self.text = f"{self.label}=0"
+        return True
+
+    def do_step(self, current_time: float, step_size: float) -> bool:
+        self.ticks += 1
+        self.text = f"{self.label}={current_time + step_size:g}"
+        return True
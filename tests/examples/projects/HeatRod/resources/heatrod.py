@@ -0,0 +1,86 @@
+from pyfmu.fmi2slave import Fmi2Slave
+from pyfmu.fmi2types import Fmi2Causality, Fmi2Variability, Fmi2DataTypes, Fmi2Initial
+
+
+class HeatRod(Fmi2Slave):
+    """Rod conducting heat, discretized into cells whose temperatures are the continuous states.
+
+    Heat flows into the first cell at the rate q, the other end of the rod is insulated.
+    Each derivative only depends on the temperatures of the cell and its neighbours, which is declared,
+    such that the Jacobian is tridiagonal and assembled from a handful of directional derivatives.
+    """
+
+    n_cells = 200
+
+    def __init__(self):
+
+        author = ""
+        modelName = "HeatRod"
+        description = "Rod conducting heat, discretized into cells"
+
+        super().__init__(
+            modelName=modelName,
+            author=author,
+            description=description)
+
+        self.register_variable("q", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=0.0)
+        self.register_variable("T_end", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output)
+        self.register_variable("alpha", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.parameter, variability=Fmi2Variability.fixed, start=1.0)
+
+        self._temperatures = [f"T_{i}" for i in range(self.n_cells)]
+        self._derivatives = [f"der_T_{i}" for i in range(self.n_cells)]
+
+        for i, (T, der_T) in enumerate(zip(self._temperatures, self._derivatives)):
+            # the rod starts out with a linear temperature profile
+            self.register_variable(T, data_type=Fmi2DataTypes.real, initial=Fmi2Initial.exact, start=float(i) / self.n_cells)
+            self.register_variable(der_T, data_type=Fmi2DataTypes.real)
+            self.register_state(T, der_T)
+
+        for i, der_T in enumerate(self._derivatives):
+            neighbours = self._temperatures[max(i - 1, 0):i + 2]
+            self.declare_dependencies(der_T, neighbours + ["q"] if i == 0 else neighbours)
+
+        self.declare_dependencies("T_end", [self._temperatures[-1]])
+
+    def _rates(self, T):
+        rates = [self.alpha * ((T[i - 1] if i > 0 else T[i]) - 2 * T[i] + (T[i + 1] if i + 1 < len(T) else T[i])) for i in range(len(T))]
+        rates[0] += self.q
+        return rates
+
+    def _temperature_profile(self):
+        return [getattr(self, T) for T in self._temperatures]
+
+    def _update(self, T):
+        for name, value in zip(self._temperatures, T):
+            setattr(self, name, value)
+
+        for name, value in zip(self._derivatives, self._rates(T)):
+            setattr(self, name, value)
+
+        self.T_end = T[-1]
+
+    def exit_initialization_mode(self):
+        self._update(self._temperature_profile())
+        return True
+
+    def evaluate_outputs(self):
+        self.T_end = getattr(self, self._temperatures[-1])
+
+    def get_derivatives(self, derivatives):
+        T = self._temperature_profile()
+        self._update(T)
+
+        for i, name in enumerate(self._derivatives):
+            derivatives[i] = getattr(self, name)
+
+    def do_step(self, current_time: float, step_size: float) -> bool:
+        # explicit Euler substeps, short enough to be stable
+        n_substeps = max(1, int(step_size * self.alpha / 0.4) + 1)
+        h = step_size / n_substeps
+        T = self._temperature_profile()
+
+        for _ in range(n_substeps):
+            T = [t + h * r for t, r in zip(T, self._rates(T))]
+
+        self._update(T)
+        return True
@@ -0,0 +1,44 @@
+from pyfmu.fmi2slave import Fmi2Slave
+from pyfmu.fmi2types import Fmi2Causality, Fmi2Variability, Fmi2DataTypes, Fmi2Initial
+
+
+class Integrator(Fmi2Slave):
+    """Integrates its input over time, using the derivatives of the input set by the tool to integrate it within a step.
+
+    Inputs extrapolated by polynomials of up to the third degree are integrated exactly, regardless of the step size.
+    """
+
+    __interpolates_inputs__ = True
+    __max_output_derivative_order__ = 1
+
+    def __init__(self):
+
+        author = ""
+        modelName = "Integrator"
+        description = "Integrates its input over time"
+
+        super().__init__(
+            modelName=modelName,
+            author=author,
+            description=description)
+
+        self.register_variable("u", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=0.0)
+        self.register_variable("y", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output, initial=Fmi2Initial.exact, start=0.0)
+
+        # the derivative of the output, which is the input at the end of the last step
+        self.dy = 0.0
+
+    def exit_initialization_mode(self):
+        self.dy = self.u
+        return True
+
+    def do_step(self, current_time: float, step_size: float) -> bool:
+        # Simpson's rule
+        u0, u1, u2 = (self.input_at("u", current_time + f * step_size) for f in (0.0, 0.5, 1.0))
+        self.y += step_size / 6 * (u0 + 4 * u1 + u2)
+        self.dy = u2
+        return True
+
+    def get_real_output_derivatives(self, vrs, orders, values):
+        for i in range(len(vrs)):
+            values[i] = self.dy
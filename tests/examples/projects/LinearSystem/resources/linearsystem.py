@@ -0,0 +1,67 @@
+from pyfmu.fmi2slave import Fmi2Slave
+from pyfmu.fmi2types import Fmi2Causality, Fmi2DataTypes, Fmi2Initial
+
+
+class LinearSystem(Fmi2Slave):
+    """Linear system dx/dt = A x + B u, whose output y is the last state.
+
+    The derivatives are only computed by evaluate_derivatives, which integrators call for every evaluation,
+    the default get_derivatives returns the values it last stored in the variables holding the derivatives.
+    """
+
+    A = [[-1.0, 1.0, 0.0],
+         [0.0, -2.0, 1.0],
+         [0.0, 0.0, -3.0]]
+
+    B = [1.0, 0.0, 0.5]
+
+    def __init__(self):
+
+        author = ""
+        modelName = "LinearSystem"
+        description = "Linear system of three states driven by an input"
+
+        super().__init__(
+            modelName=modelName,
+            author=author,
+            description=description)
+
+        self.register_variable("u", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=0.0)
+        self.register_variable("y", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output)
+
+        self._states = [f"x_{i}" for i in range(len(self.B))]
+        self._derivatives = [f"der_x_{i}" for i in range(len(self.B))]
+
+        for x, der_x in zip(self._states, self._derivatives):
+            self.register_variable(x, data_type=Fmi2DataTypes.real, initial=Fmi2Initial.exact, start=1.0)
+            self.register_variable(der_x, data_type=Fmi2DataTypes.real)
+            self.register_state(x, der_x)
+
+        for row, b, der_x in zip(self.A, self.B, self._derivatives):
+            knowns = [x for x, a in zip(self._states, row) if a != 0]
+            self.declare_dependencies(der_x, knowns + ["u"] if b != 0 else knowns)
+
+        self.declare_dependencies("y", [self._states[-1]])
+
+    def exit_initialization_mode(self):
+        self._update([getattr(self, x) for x in self._states])
+        return True
+
+    def _update(self, x):
+        rates = [sum(a * s for a, s in zip(row, x)) + b * self.u for row, b in zip(self.A, self.B)]
+
+        for name, value in zip(self._states, x):
+            setattr(self, name, value)
+
+        for name, value in zip(self._derivatives, rates):
+            setattr(self, name, value)
+
+        self.y = x[-1]
+
+        return rates
+
+    def evaluate_derivatives(self, time, states, derivatives):
+        # adopts the time and states without dispatching set_time, set_continuous_states and get_derivatives
+        self.time = time
+        for i, rate in enumerate(self._update(list(states))):
+            derivatives[i] = rate
@@ -0,0 +1,39 @@
+from pyfmu.fmi2slave import Fmi2Slave
+from pyfmu.fmi2types import Fmi2Causality, Fmi2Variability, Fmi2DataTypes, Fmi2Initial
+
+
+class MatrixGain(Fmi2Slave):
+    """Multiplies its input vector by a gain matrix, y = K u.
+
+    The vectors and the matrix are array variables, whose elements the tool gets and sets as blocks of consecutive value references.
+    """
+
+    n = 8
+
+    def __init__(self):
+
+        author = ""
+        modelName = "MatrixGain"
+        description = "Multiplies its input vector by a gain matrix"
+
+        super().__init__(
+            modelName=modelName,
+            author=author,
+            description=description)
+
+        n = self.n
+        identity = [[1.0 if i == j else 0.0 for j in range(n)] for i in range(n)]
+
+        # u[1] to u[n] have value references 0 to n - 1, K[1,1] to K[n,n] the following n * n in row-major order and y[1] to y[n] the last n
+        self.register_array("u", n, data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=0.0)
+        self.register_array("K", (n, n), data_type=Fmi2DataTypes.real, causality=Fmi2Causality.parameter,
+                            variability=Fmi2Variability.tunable, start=identity)
+        self.register_array("y", n, data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output, initial=Fmi2Initial.exact, start=0.0)
+
+    def do_step(self, current_time: float, step_size: float) -> bool:
+        u, K, y = self.u.tolist(), self.K.tolist(), self.y
+
+        for i, row in enumerate(K):
+            y[i] = sum(k * v for k, v in zip(row, u))
+
+        return True
@@ -0,0 +1,36 @@
+from pyfmu.fmi2slave import Fmi2Slave
+from pyfmu.fmi2types import Fmi2Causality, Fmi2Variability, Fmi2DataTypes, Fmi2Initial
+
+
+class NativeAdder(Fmi2Slave):
+    """Adds its inputs like the Adder, but stores its variables natively.
+
+    The tool gets and sets the variables without calling into Python, whereas every access from Python is slower than that of an ordinary attribute.
+    """
+
+    def __init__(self):
+
+        author = ""
+        modelName = "NativeAdder"
+        description = ""
+
+        super().__init__(
+            modelName=modelName,
+            author=author,
+            description=description)
+
+        self.register_variable("s", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output, native=True)
+        self.register_variable("a", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=0, native=True)
+        self.register_variable("b", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=0, native=True)
+
+
+    def exit_initialization_mode(self):
+        self.evaluate_outputs()
+        return True
+
+    def evaluate_outputs(self):
+        self.s = self.a + self.b
+
+    def do_step(self, current_time: float, step_size: float) -> bool:
+        self.evaluate_outputs()
+        return True
@@ -0,0 +1,84 @@
+from pyfmu.fmi2slave import Fmi2Slave
+from pyfmu.fmi2types import Fmi2Causality, Fmi2Variability, Fmi2DataTypes, Fmi2Initial
+
+
+class Oscillator(Fmi2Slave):
+    """Damped harmonic oscillator, which can be simulated using both Model Exchange and Co-Simulation.
+
+    The position crossing zero is detected by an event indicator, the crossings are counted.
+    """
+
+    def __init__(self):
+
+        author = ""
+        modelName = "Oscillator"
+        description = "Damped harmonic oscillator"
+
+        super().__init__(
+            modelName=modelName,
+            author=author,
+            description=description)
+
+        self.register_variable("x", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output, initial=Fmi2Initial.exact, start=1.0)
+        self.register_variable("v", data_type=Fmi2DataTypes.real, initial=Fmi2Initial.exact, start=0.0)
+        self.register_variable("der_x", data_type=Fmi2DataTypes.real)
+        self.register_variable("der_v", data_type=Fmi2DataTypes.real)
+        self.register_variable("k", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.parameter, variability=Fmi2Variability.fixed, start=1.0)
+        self.register_variable("c", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.parameter, variability=Fmi2Variability.fixed, start=0.1)
+        self.register_variable("crossings", data_type=Fmi2DataTypes.integer, causality=Fmi2Causality.output, variability=Fmi2Variability.discrete, initial=Fmi2Initial.exact, start=0)
+
+        self.register_state("x", "der_x")
+        self.register_state("v", "der_v")
+        self.register_event_indicators(1)
+
+        self.declare_dependencies("x", ["x"])
+        self.declare_dependencies("der_x", ["v"])
+        self.declare_dependencies("der_v", ["x", "v"])
+
+    def _derivatives(self, x: float, v: float):
+        return v, -self.k * x - self.c * v
+
+    def exit_initialization_mode(self):
+        self.der_x, self.der_v = self._derivatives(self.x, self.v)
+        return True
+
+    def get_derivatives(self, derivatives):
+        self.der_x, self.der_v = self._derivatives(self.x, self.v)
+        derivatives[0] = self.der_x
+        derivatives[1] = self.der_v
+
+    def evaluate_derivatives(self, time, states, derivatives):
+        # adopts the time and states without dispatching set_time and set_continuous_states
+        self.time = time
+        self.x, self.v = states
+        self.get_derivatives(derivatives)
+
+    def get_directional_derivative(self, unknowns, knowns, seed, sensitivity):
+        names = {var.value_reference: var.name for var in self.vars}
+        partials = {("x", "x"): 1.0, ("v", "v"): 1.0, ("der_x", "v"): 1.0, ("der_v", "x"): -self.k, ("der_v", "v"): -self.c}
+
+        for i, unknown in enumerate(unknowns):
+            sensitivity[i] = sum(partials.get((names[unknown], names[known]), 0.0) * s for known, s in zip(knowns, seed))
+
+    def get_event_indicators(self, indicators):
+        indicators[0] = self.x
+
+    def enter_event_mode(self):
+        self.crossings += 1
+
+    def do_step(self, current_time: float, step_size: float) -> bool:
+        # classical Runge-Kutta step, the position crossing zero is counted at the end of the step
+        x, v = self.x, self.v
+        k1 = self._derivatives(x, v)
+        k2 = self._derivatives(x + step_size / 2 * k1[0], v + step_size / 2 * k1[1])
+        k3 = self._derivatives(x + step_size / 2 * k2[0], v + step_size / 2 * k2[1])
+        k4 = self._derivatives(x + step_size * k3[0], v + step_size * k3[1])
+
+        self.x = x + step_size / 6 * (k1[0] + 2 * k2[0] + 2 * k3[0] + k4[0])
+        self.v = v + step_size / 6 * (k1[1] + 2 * k2[1] + 2 * k3[1] + k4[1])
+        self.der_x, self.der_v = self._derivatives(self.x, self.v)
+
+        if (x > 0) != (self.x > 0):
+            self.crossings += 1
+
+        return True
@@ -0,0 +1,36 @@
+from pyfmu.fmi2slave import Fmi2Slave
+from pyfmu.fmi2types import Fmi2Causality, Fmi2Variability, Fmi2DataTypes
+
+
+class Recorder(Fmi2Slave):
+    """Records its input at every step, such that its state grows with the number of steps taken.
+
+    The output is the mean of the recorded values.
+    """
+
+    def __init__(self):
+
+        author = ""
+        modelName = "Recorder"
+        description = "Outputs the mean of the recorded input"
+
+        super().__init__(
+            modelName=modelName,
+            author=author,
+            description=description)
+
+        self.register_variable("u", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=0)
+        self.register_variable("mean", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output)
+
+        self.history = []
+        self.total = 0.0
+
+    def exit_initialization_mode(self):
+        self.mean = self.u
+        return True
+
+    def do_step(self, current_time: float, step_size: float) -> bool:
+        self.history.append(self.u)
+        self.total += self.u
+        self.mean = self.total / len(self.history)
+        return True
@@ -1,10 +1,14 @@
 from pyfmu.fmi2slave import Fmi2Slave
 from pyfmu.fmi2types import Fmi2Causality, Fmi2Variability, Fmi2DataTypes
 
+from array import array
 from math import sin
 
 class SineGenerator(Fmi2Slave):
 
+    # the parameters and the output are stored natively, such that every member of an ensemble has its own
+    __ensemble__ = True
+
     def __init__(self):
 
         author = ""
@@ -16,23 +20,51 @@ class SineGenerator(Fmi2Slave):
             author=author,
             description=description)
 
-        self.register_variable("amplitude", data_type=Fmi2DataTypes.real, variability=Fmi2Variability.fixed, causality=Fmi2Causality.parameter, start=1)
-        self.register_variable("frequency", data_type=Fmi2DataTypes.real, variability=Fmi2Variability.fixed, causality=Fmi2Causality.parameter, start=1)
-        self.register_variable("phase", data_type=Fmi2DataTypes.real, variability = Fmi2Variability.fixed, causality=Fmi2Causality.parameter, start=0)
+        self.register_variable("amplitude", data_type=Fmi2DataTypes.real, variability=Fmi2Variability.fixed, causality=Fmi2Causality.parameter, start=1, native=True)
+        self.register_variable("frequency", data_type=Fmi2DataTypes.real, variability=Fmi2Variability.fixed, causality=Fmi2Causality.parameter, start=1, native=True)
+        self.register_variable("phase", data_type=Fmi2DataTypes.real, variability = Fmi2Variability.fixed, causality=Fmi2Causality.parameter, start=0, native=True)
 
-        self.register_variable("y", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output)
+        self.register_variable("y", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output, native=True)
+        self.y_vr = self.vars[-1].value_reference
 
     def setup_experiment(self, start_time: float):
         self.start_time = start_time
         return True
 
     def exit_initialization_mode(self) -> bool:
-        self.y = self.amplitude * sin(self.start_time * self.frequency + self.phase)
+        self.y = self.evaluate(self.start_time)
         return True
 
     def do_step(self, current_time: float, step_size: float):
         
-        self.y = self.amplitude * sin(current_time * self.frequency + self.phase)
+        self.y = self.evaluate(current_time)
         return True
 
+    def evaluate(self, time: float):
+
+        if self.ensemble_size() == 1:
+            return self.amplitude * sin(time * self.frequency + self.phase)
+
+        return [a * sin(time * f + p) for a, f, p in zip(self.amplitude, self.frequency, self.phase)]
+
+    def do_steps(self, current_time: float, step_sizes, input_vrs, inputs, output_vrs, outputs) -> int:
+
+        # the output only depends on the time, as such all steps are computed at once rather than dispatching do_step for each of them
+        # the parameters of an ensemble are columns, whose steps are left to do_step
+        if self.ensemble_size() != 1 or len(input_vrs) != 0 or list(output_vrs) not in ([], [self.y_vr]):
+            return super().do_steps(current_time, step_sizes, input_vrs, inputs, output_vrs, outputs)
+
+        amplitude, frequency, phase = self.amplitude, self.frequency, self.phase
+        values = array('d')
+
+        for step_size in step_sizes:
+            values.append(amplitude * sin(current_time * frequency + phase))
+            current_time += step_size
+
+        if len(output_vrs) != 0:
+            outputs[:] = values
+
+        if len(values) != 0:
+            self.y = values[-1]
 
+        return len(values)
@@ -1,3 +1,7 @@
+from array import array
+
+import pytest
+
 from pybuilder.resources.pyfmu.fmi2slave import Fmi2Slave
 from pybuilder.resources.pyfmu.fmi2types import Fmi2DataTypes, Fmi2Causality, Fmi2Variability, Fmi2Status,Fmi2Initial
 
@@ -133,6 +137,53 @@ def test_registerVariable_defaultStartValues():
     
 
 
+# test resolution of value references
+
+
+def test_registerVariable_arbitraryValueReferences_resolved():
+
+    s = Fmi2Slave("")
+    s.register_variable('x', 'real', 'input', start=1.0, value_reference=10)
+    s.register_variable('n', 'integer', 'input', 'discrete', start=2, value_reference=3)
+    s.register_variable('y', 'real', 'input', start=3.0, value_reference=0)
+
+    refs = [0.0, 0.0]
+    s.__get_real__([10, 0], refs)
+    assert(refs == [1.0, 3.0])
+
+    s.__set_integer__([3], [5])
+    assert(s.n == 5)
+
+    assert(s.__value_references__() == ([0, 10], [3], [], []))
+
+
+def test_registerVariable_valueReferenceUsed_raises():
+
+    s = Fmi2Slave("")
+    s.register_variable('x', 'real', 'input', start=1.0, value_reference=4)
+
+    with pytest.raises(ValueError):
+        s.register_variable('y', 'real', 'input', start=1.0, value_reference=4)
+
+    # automatically assigned value references skip those which are used
+    for name in ['a', 'b', 'c', 'd', 'e']:
+        s.register_variable(name, 'real', 'input', start=0.0)
+
+    assert(sorted(v.value_reference for v in s.vars) == [0, 1, 2, 3, 4, 5])
+
+
+def test_getReal_valueReferenceOfOtherType_raises():
+
+    s = Fmi2Slave("")
+    s.register_variable('n', 'integer', 'input', 'discrete', start=2, value_reference=0)
+
+    with pytest.raises(Exception, match="not of type Real"):
+        s.__get_real__([0], [0.0])
+
+    with pytest.raises(Exception, match="not of type Integer"):
+        s.__get_integer__([1], [0])
+
+
 # test logging functions used by the wrapper
 
 
@@ -180,3 +231,581 @@ def test__get_log_messages__():
     assert(isinstance(status,int))
     assert(category == "a")
     assert(message == 'test')
+
+
+# test exchange of values through memoryviews, as done by the wrapper
+
+
+def test_getReal_writesIntoMemoryview():
+
+    a = Adder()
+    a.a = 1.5
+    a.b = 2.5
+
+    vrs = memoryview(array('I', [0, 1])).toreadonly()
+    refs = memoryview(array('d', [0.0, 0.0]))
+
+    a.__get_real__(vrs, refs)
+
+    assert(refs.tolist() == [1.5, 2.5])
+
+
+def test_setReal_readsFromMemoryview():
+
+    a = Adder()
+
+    vrs = memoryview(array('I', [0, 1])).toreadonly()
+    values = memoryview(array('d', [3.0, 4.0])).toreadonly()
+
+    a.__set_real__(vrs, values)
+
+    assert(a.a == 3.0)
+    assert(a.b == 4.0)
+
+
+def test_setBoolean_convertsFromInteger():
+
+    s = Fmi2Slave("")
+    s.register_variable('flag', 'boolean', 'parameter', 'fixed', start=False, value_reference=0)
+
+    s.__set_boolean__(memoryview(array('I', [0])), memoryview(array('i', [1])))
+
+    assert(s.flag is True)
+
+    refs = memoryview(array('i', [0]))
+    s.__get_boolean__(memoryview(array('I', [0])), refs)
+
+    assert(refs[0] == 1)
+
+
+# test advancing several steps in a single call
+
+
+class SteppingAdder(Adder):
+
+    def do_step(self, current_time, step_size):
+        if self.a < 0:
+            raise ValueError("negative input")
+
+        if self.a > 100:
+            return False
+
+        self.c = self.a + self.b + current_time
+        return True
+
+
+def test_doSteps_setsInputsAndRecordsOutputs():
+
+    a = SteppingAdder()
+
+    step_sizes = memoryview(array('d', [1.0, 1.0, 0.5])).toreadonly()
+    inputs = memoryview(array('d', [1.0, 2.0, 3.0, 4.0, 5.0, 6.0])).toreadonly()
+    outputs = memoryview(array('d', [0.0] * 3))
+
+    completed = a.do_steps(10.0, step_sizes, memoryview(array('I', [0, 1])), inputs, memoryview(array('I', [2])), outputs)
+
+    assert(completed == 3)
+    assert(outputs.tolist() == [13.0, 18.0, 23.0])
+
+
+def test_doSteps_raisesAtFailingStep():
+
+    a = SteppingAdder()
+    a.__set_debug_logging__(True, ['logAll'])
+
+    outputs = array('d', [0.0] * 3)
+
+    with pytest.raises(ValueError):
+        a.do_steps(0.0, [1.0, 1.0, 1.0], [0], [1.0, -1.0, 1.0], [2], memoryview(outputs))
+
+    assert(outputs.tolist() == [1.0, 0.0, 0.0])
+    assert([m.status for m in a.logger.pop_messages(len(a.logger))] == [Fmi2Status.error])
+
+
+def test_doSteps_stopsAtDiscardedStep():
+
+    a = SteppingAdder()
+
+    outputs = array('d', [0.0] * 3)
+    completed = a.do_steps(0.0, [1.0, 1.0, 1.0], [0], [1.0, 101.0, 1.0], [2], memoryview(outputs))
+
+    assert(completed == 1)
+    assert(outputs.tolist() == [1.0, 0.0, 0.0])
+
+
+def test_reset_restoresStartValues():
+
+    a = SteppingAdder()
+    a.a = 3.0
+    a.b = 4.0
+    a.do_step(1.0, 1.0)
+
+    a.reset()
+
+    assert(a.a == 0)
+    assert(a.b == 0)
+    assert(a.c == 8.0)
+
+
+# test natively stored variables
+
+
+class NativeAdder(Fmi2Slave):
+
+    def __init__(self):
+        super().__init__("NativeAdder")
+
+        self.register_variable("a", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=1, native=True)
+        self.register_variable("b", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=2, native=True)
+        self.register_variable("c", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output, native=True)
+        self.register_variable("on", data_type=Fmi2DataTypes.boolean, causality=Fmi2Causality.input, variability=Fmi2Variability.discrete, start=True, native=True)
+
+
+def test_nativeVariable_behavesLikeAttribute():
+
+    s = NativeAdder()
+
+    assert(s.a == 1)
+    assert(s.b == 2)
+    assert(s.c == 0)
+    assert(s.on is True)
+
+    s.c = s.a + s.b
+    assert(s.c == 3)
+
+    refs = [0]
+    s.__get_real__([2], refs)
+    assert(refs[0] == 3)
+
+
+def test_nativeVariable_instancesDoNotShareValues():
+
+    s1 = NativeAdder()
+    s2 = NativeAdder()
+
+    s1.a = 10
+
+    assert(s2.a == 1)
+
+
+def test_nativeStore_attachMovesValuesIntoViews():
+
+    s = NativeAdder()
+
+    assert(s.__native_variables__() == ([0, 1, 2], [], [3]))
+
+    reals = array('d', [0.0] * 3)
+    integers = array('i')
+    booleans = array('i', [0])
+
+    s.__attach_native_store__(memoryview(reals), memoryview(integers), memoryview(booleans))
+
+    assert(reals.tolist() == [1.0, 2.0, 0.0])
+    assert(booleans.tolist() == [1])
+
+    # values written by the wrapper are visible to the slave and vice versa
+    reals[0] = 5
+    assert(s.a == 5)
+
+    s.on = False
+    assert(booleans[0] == 0)
+
+
+class NativeMatrix(Fmi2Slave):
+
+    def __init__(self):
+        super().__init__("NativeMatrix")
+
+        self.register_variable("g", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.parameter, variability=Fmi2Variability.fixed, start=1)
+        self.register_array("x", (2, 3), data_type=Fmi2DataTypes.real, causality=Fmi2Causality.input, start=[[1, 2, 3], [4, 5, 6]])
+        self.register_array("flags", 2, data_type=Fmi2DataTypes.boolean, causality=Fmi2Causality.input, variability=Fmi2Variability.discrete, start=True)
+
+
+def test_registerArray_elementsHaveConsecutiveValueReferences():
+
+    s = NativeMatrix()
+
+    names = [(v.name, v.value_reference) for v in s.vars]
+    assert(names == [('g', 0), ('x[1,1]', 1), ('x[1,2]', 2), ('x[1,3]', 3), ('x[2,1]', 4), ('x[2,2]', 5), ('x[2,3]', 6),
+                     ('flags[1]', 7), ('flags[2]', 8)])
+
+    assert(s.__native_variables__() == ([1, 2, 3, 4, 5, 6], [], [7, 8]))
+
+
+def test_registerArray_attributeIsViewOfElements():
+
+    s = NativeMatrix()
+
+    assert(s.x.shape == (2, 3))
+    assert(s.x.tolist() == [[1, 2, 3], [4, 5, 6]])
+    assert(getattr(s, 'x[2,1]') == 4)
+
+    s.x[0, 2] = 10
+
+    refs = [0] * 6
+    s.__get_real__([1, 2, 3, 4, 5, 6], refs)
+    assert(refs == [1, 2, 10, 4, 5, 6])
+
+    s.__set_real__([5], [20])
+    assert(s.x[1, 1] == 20)
+
+    s.x = [[0, 0, 0], [1, 1, 1]]
+    assert(s.x.tolist() == [[0, 0, 0], [1, 1, 1]])
+
+    try:
+        s.x = [[0, 0], [1, 1]]
+        assert(False)
+    except ValueError:
+        pass
+
+
+def test_registerArray_attachedViewsWriteThrough():
+
+    s = NativeMatrix()
+
+    reals = array('d', [0.0] * 6)
+    integers = array('i')
+    booleans = array('i', [0, 0])
+
+    s.__attach_native_store__(memoryview(reals), memoryview(integers), memoryview(booleans))
+
+    assert(booleans.tolist() == [1, 1])
+
+    reals[4] = 7
+    assert(s.x[1, 1] == 7)
+
+    s.x[0, 1] = 3
+    assert(reals[1] == 3)
+
+    s.x = [[9, 9, 9], [9, 9, 9]]
+    assert(reals.tolist() == [9] * 6)
+
+
+def test_registerArray_overlappingValueReferences_rejected():
+
+    # the arrays are defined on the class of the slave, which must not be Fmi2Slave itself
+    class Arrays(Fmi2Slave):
+        pass
+
+    s = Arrays("")
+    s.register_variable('a', 'real', 'input', start=0, value_reference=2)
+
+    try:
+        s.register_array('x', 4, causality='input', start=0, value_reference=0)
+        assert(False)
+    except ValueError:
+        pass
+
+    # without a value reference the array is placed after the used ones
+    s.register_array('y', 4, causality='input', start=0)
+    assert([v.value_reference for v in s.vars[1:]] == [3, 4, 5, 6])
+
+
+class NativeEnsemble(Fmi2Slave):
+
+    __ensemble__ = True
+
+    def __init__(self):
+        super().__init__("NativeEnsemble")
+
+        self.register_variable("a", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.parameter, variability=Fmi2Variability.fixed, start=1, native=True)
+        self.register_variable("y", data_type=Fmi2DataTypes.real, causality=Fmi2Causality.output, native=True)
+        self.register_variable("on", data_type=Fmi2DataTypes.boolean, causality=Fmi2Causality.input, variability=Fmi2Variability.discrete, start=True, native=True)
+
+
+def test_attachEnsemble_everyMemberStartsFromCurrentValues():
+
+    s = NativeEnsemble()
+    assert(s.ensemble_size() == 1)
+
+    reals = array('d', [0.0] * 6)
+    integers = array('i')
+    booleans = array('i', [0] * 3)
+
+    s.__attach_native_store__(memoryview(reals), memoryview(integers), memoryview(booleans), 3)
+
+    assert(s.ensemble_size() == 3)
+    assert(reals.tolist() == [1, 0] * 3)
+    assert(booleans.tolist() == [1] * 3)
+
+
+def test_attachEnsemble_attributesAreColumnsOfMembers():
+
+    s = NativeEnsemble()
+
+    reals = array('d', [0.0] * 6)
+    booleans = array('i', [0] * 3)
+    s.__attach_native_store__(memoryview(reals), memoryview(array('i')), memoryview(booleans), 3)
+
+    # the values of member m are those of row m, which the wrapper sets for each member
+    reals[2] = 2
+    reals[4] = 3
+    assert(list(s.a) == [1, 2, 3])
+
+    s.y = [a * 10 for a in s.a]
+    assert(reals.tolist() == [1, 10, 2, 20, 3, 30])
+
+    # a single value is set for every member
+    s.a = 5
+    assert(list(s.a) == [5, 5, 5])
+
+    booleans[1] = 0
+    assert([bool(on) for on in s.on] == [True, False, True])
+
+
+def test_nativeVariable_stringsNotSupported():
+
+    s = Fmi2Slave("")
+
+    try:
+        s.register_variable('text', 'string', 'parameter', 'fixed', start='', native=True)
+        assert(False)
+    except ValueError:
+        pass
+
+
+# test snapshots of the state used by fmi2GetFMUstate and fmi2SetFMUstate
+
+
+def test_setState_restoresAttributes():
+
+    a = Adder()
+    a.a = 1.0
+    a.history = [1.0]
+
+    state = a.get_state()
+
+    a.a = 2.0
+    a.history.append(2.0)
+    a.extra = 'defined after the snapshot'
+
+    a.set_state(state)
+
+    assert(a.a == 1.0)
+    assert(a.history == [1.0])
+    assert(not hasattr(a, 'extra'))
+
+
+def test_setState_canRestoreSnapshotRepeatedly():
+
+    a = Adder()
+    a.history = []
+
+    state = a.get_state()
+
+    for _ in range(2):
+        a.set_state(state)
+        a.history.append(1.0)
+
+    assert(a.history == [1.0])
+    assert(state['history'] == [])
+
+
+def test_getState_excludesStatelessAttributes():
+
+    a = Adder()
+
+    state = a.get_state()
+
+    assert('vars' not in state)
+    assert('logger' not in state)
+    assert('a' in state)
+
+
+def test_getState_copiesNestedContainers():
+
+    a = Adder()
+    a.table = {'row': [1.0]}
+
+    state = a.get_state()
+    a.table['row'].append(2.0)
+
+    assert(state['table'] == {'row': [1.0]})
+
+
+def test_deserializeState_restoresSerializedSnapshot():
+
+    a = Adder()
+    a.a = 1.0
+    a.history = [1.0, 2.0]
+
+    data = a.serialize_state(a.get_state())
+
+    b = Adder()
+    b.set_state(b.deserialize_state(memoryview(data)))
+
+    assert(b.a == 1.0)
+    assert(b.history == [1.0, 2.0])
+
+
+class Decay(Fmi2Slave):
+
+    def __init__(self):
+        super().__init__("Decay")
+
+        self.register_variable("x", data_type=Fmi2DataTypes.real, initial=Fmi2Initial.exact, start=1.0)
+        self.register_variable("der_x", data_type=Fmi2DataTypes.real)
+        self.register_state("x", "der_x", nominal=2.0)
+        self.register_event_indicators(1)
+
+    def get_derivatives(self, derivatives):
+        self.der_x = -self.x
+        derivatives[0] = self.der_x
+
+
+def test_registerState_unknownVariable_raises():
+
+    d = Dummy()
+    d.register_variable("x", data_type=Fmi2DataTypes.real, initial=Fmi2Initial.exact, start=0.0)
+
+    with pytest.raises(ValueError):
+        d.register_state("x", "der_x")
+
+
+def test_registerState_variableUsedTwice_raises():
+
+    d = Decay()
+    d.register_variable("y", data_type=Fmi2DataTypes.real, initial=Fmi2Initial.exact, start=0.0)
+
+    with pytest.raises(ValueError):
+        d.register_state("y", "der_x")
+
+
+def test_modelExchange_withoutStates_isNone():
+
+    assert(Adder().__model_exchange__() is None)
+
+
+def test_modelExchange_listsStatesAndEventIndicators():
+
+    assert(Decay().__model_exchange__() == ([("x", "der_x", 2.0)], 1))
+
+
+def test_stateValueReferences_orderedAsRegistered():
+
+    assert(Decay().__state_value_references__() == [0])
+    assert(Adder().__state_value_references__() == [])
+
+
+def test_evaluateDerivatives_setsTimeAndStates():
+
+    d = Decay()
+    derivatives = array('d', [0.0])
+
+    d.evaluate_derivatives(0.5, memoryview(array('d', [3.0])), memoryview(derivatives))
+
+    assert(d.time == 0.5)
+    assert(d.x == 3.0)
+    assert(derivatives[0] == -3.0)
+
+
+def test_getContinuousStates_readsStateVariables():
+
+    d = Decay()
+    d.set_continuous_states(array('d', [4.0]))
+
+    states = array('d', [0.0])
+    nominals = array('d', [0.0])
+    d.get_continuous_states(memoryview(states))
+    d.get_nominals_of_continuous_states(memoryview(nominals))
+
+    assert(states[0] == 4.0)
+    assert(nominals[0] == 2.0)
+
+
+def test_declareDependencies_recordedByValueReference():
+
+    a = Adder()
+    a.declare_dependencies("c", ["a"])
+
+    assert(a.__directional_derivatives__() == (False, {2: [0]}, False))
+
+
+def test_declareDependencies_unknownNotOutputOrDerivative_raises():
+
+    d = Decay()
+
+    with pytest.raises(ValueError):
+        d.declare_dependencies("x", ["x"])
+
+    d.declare_dependencies("der_x", ["x"])
+
+
+def test_declareDependencies_knownNotInputOrState_raises():
+
+    a = Adder()
+
+    with pytest.raises(ValueError):
+        a.declare_dependencies("c", ["c"])
+
+
+class LinearDecay(Decay):
+
+    def get_directional_derivative(self, unknowns, knowns, seed, sensitivity):
+        for i in range(len(unknowns)):
+            sensitivity[i] = -sum(seed)
+
+
+def test_directionalDerivatives_reportsOverride():
+
+    assert(Decay().__directional_derivatives__()[0] is False)
+    assert(LinearDecay().__directional_derivatives__()[0] is True)
+
+    with pytest.raises(NotImplementedError):
+        Decay().get_directional_derivative([1], [0], [1.0], array('d', [0.0]))
+
+
+class EvaluatingAdder(Adder):
+
+    def evaluate_outputs(self):
+        self.c = self.a + self.b
+
+
+def test_directionalDerivatives_reportsEvaluateOutputs():
+
+    assert(Adder().__directional_derivatives__()[2] is False)
+    assert(EvaluatingAdder().__directional_derivatives__()[2] is True)
+
+    with pytest.raises(NotImplementedError):
+        Adder().evaluate_outputs()
+
+
+class InterpolatingAdder(Adder):
+
+    __interpolates_inputs__ = True
+
+
+def test_inputAt_extrapolatesUsingDerivatives():
+
+    a = InterpolatingAdder()
+    a.a = 1.0
+    a.__set_input_derivatives__(2.0, {0: [2.0, 4.0]})
+
+    assert(a.input_at("a", 2.0) == 1.0)
+    assert(a.input_at("a", 2.5) == 1.0 + 2.0 * 0.5 + 4.0 * 0.5 ** 2 / 2)
+    assert(a.input_at("b", 2.5) == 0.0)
+
+    a.__set_input_derivatives__(3.0, {})
+    assert(a.input_at("a", 3.5) == 1.0)
+
+
+def test_interpolation_inputsOnlyIfDeclared():
+
+    assert(Adder().__interpolation__() == ([], False, 2, [2]))
+    assert(InterpolatingAdder().__interpolation__() == ([0, 1], False, 2, [2]))
+
+
+class DifferentiatedAdder(Adder):
+
+    __max_output_derivative_order__ = 3
+
+    def get_real_output_derivatives(self, vrs, orders, values):
+        pass
+
+
+def test_interpolation_reportsOutputDerivatives():
+
+    assert(DifferentiatedAdder().__interpolation__() == ([], True, 3, [2]))
+
+    with pytest.raises(NotImplementedError):
+        Adder().get_real_output_derivatives([2], [1], array('d', [0.0]))
@@ -1,3 +1,8 @@
+import struct
+from array import array
+
+import pytest
+
 from pybuilder.resources.pyfmu.fmi2logging import Fmi2Logger, Fmi2LogMessage, Fmi2StdLogCats
 from pybuilder.resources.pyfmu.fmi2types import Fmi2Status
 
@@ -333,8 +338,149 @@ def test_pop_returnsMessagesFifo():
     assert(messages == ['a','b'])
 
 
+# log ring
+
+def _ring(capacity=1024):
+    indices = memoryview(array('I', [0, 0, 0]))
+    data = memoryview(bytearray(capacity))
+    return indices, data
+
+def _drain(indices, data, categories=None):
+    """Reads the records of the ring the way the wrapper does, returning the messages as (status, category, message) tuples.
+    """
+    categories = {} if categories is None else categories
+    messages = []
+    read = indices[1]
 
+    while(read != indices[0]):
+        offset = read % len(data)
+        status, category, size, _ = struct.unpack_from('=iIII', data, offset)
+        payload = bytes(data[offset + 16:offset + 16 + size]).decode()
 
+        if(status == -1):
+            categories[category] = payload
+        elif(status != -2):
+            messages.append((status, categories[category], payload))
 
+        read += -(-(16 + size) // 16) * 16
 
+    indices[1] = read
+    return messages
+
+def test_attachedRing_messagesWrittenToRing():
+
+    logger = Fmi2Logger()
+    logger.register_log_category('test')
+    logger.set_active_log_categories(True, ['test'])
+    logger.log('before attach', 'test')
+
+    indices, data = _ring()
+    logger.attach(indices, data)
+    logger.log('after attach', 'test', Fmi2Status.warning)
+
+    assert(len(logger) == 0)
+    assert(_drain(indices, data) == [(Fmi2Status.ok.value, 'test', 'before attach'),
+                                     (Fmi2Status.warning.value, 'test', 'after attach')])
+
+def test_attachedRing_categoryDefinedOnce():
+
+    logger = Fmi2Logger()
+    logger.register_log_category('test')
+    logger.set_active_log_categories(True, ['test'])
+
+    indices, data = _ring()
+    logger.attach(indices, data)
+    logger.log('a', 'test')
+    first = indices[0]
+    logger.log('b', 'test')
+
+    # a message record without a definition record
+    assert(indices[0] - first == 32)
+    assert(len(_drain(indices, data)) == 2)
+
+def test_attachedRing_full_messagesDroppedAndCounted():
+
+    logger = Fmi2Logger()
+    logger.register_log_category('test')
+    logger.set_active_log_categories(True, ['test'])
+
+    indices, data = _ring(256)
+    logger.attach(indices, data)
+
+    for i in range(20):
+        logger.log(f'{i}', 'test')
+
+    categories = {}
+    messages = _drain(indices, data, categories)
+    assert(len(messages) + indices[2] == 20)
+    assert(indices[2] > 0)
+
+    # space is reclaimed once the wrapper has read the messages
+    logger.log('again', 'test')
+    assert(_drain(indices, data, categories)[-1][2] == 'again')
+
+def test_attachedRing_recordsNeverWrap():
+
+    logger = Fmi2Logger()
+    logger.register_log_category('test')
+    logger.set_active_log_categories(True, ['test'])
+
+    indices, data = _ring()
+    logger.attach(indices, data)
+
+    categories = {}
+    received = []
+    for i in range(50):
+        logger.log('x' * (i % 40), 'test')
+        received += _drain(indices, data, categories)
+
+    assert([m for _, _, m in received] == ['x' * (i % 40) for i in range(50)])
+    assert(indices[2] == 0)
+
+
+# active categories
+
+def test_disabled_messageNotBuilt():
+
+    logger = Fmi2Logger()
+    logger.register_log_category('test')
+
+    def build():
+        raise AssertionError('the message of a disabled category was built')
+
+    logger.log(build, 'test')
+    assert(len(logger) == 0)
+
+    logger.set_active_log_categories(True, ['test'])
+    logger.log(lambda: 'built', 'test')
+    assert(logger.pop_messages(1)[0].message == 'built')
+
+def test_attachedFilter_activeCategoriesReadFromWrapper():
+
+    logger = Fmi2Logger()
+    logger.register_standard_categories(['logEvents', 'logStatusError'])
+
+    active = memoryview(array('I', [0, 0]))
+    logger.attach_filter(active, [5, 40])
+
+    logger.log('event')
+    logger.log('error', status=Fmi2Status.error)
+    assert(len(logger) == 0)
+
+    # the wrapper sets the bit of logStatusError
+    active[1] = 1 << 8
+    logger.log('event')
+    logger.log('error', status=Fmi2Status.error)
+    assert([m.message for m in logger.pop_messages(1)] == ['error'])
+    assert(len(logger) == 0)
+
+    logger.set_active_log_categories(True, ['logEvents'])
+    assert(active[0] == 1 << 5)
+
+def test_attachedFilter_registerCategory_raises():
+
+    logger = Fmi2Logger()
+    logger.attach_filter(memoryview(array('I', [0, 0])), [])
 
+    with pytest.raises(RuntimeError):
+        logger.register_log_category('late')
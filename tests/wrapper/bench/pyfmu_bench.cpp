@@ -0,0 +1,514 @@
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "nlohmann/json.hpp"
+#include "spdlog/spdlog.h"
+
+#include "fmi/fmi2Functions.h"
+#include "bench.hpp"
+#include "example_finder.hpp"
+#include "pythonfmu/pyfmuFunctions.h"
+
+using namespace std;
+using namespace fmt;
+using json = nlohmann::json;
+
+/**
+ * @brief Micro-benchmarks of the FMI functions exported by the wrapper, driven against the example FMUs.
+ *
+ * The results are written to the standard output stream, or the file given by --out, as JSON,
+ * such that they can be compared across releases:
+ *
+ * ./pyfmu_bench [--out results.json] [--calls N] [--repetitions N] [--interpreter shared|isolated|process|fork] [--filter substring]
+ *
+ * Each benchmark is repeated and the median of the repetitions is reported in nanoseconds per call.
+ */
+
+namespace
+{
+
+fmi2CallbackFunctions callbacks = {.logger = bench_logger,
+                                   .allocateMemory = calloc,
+                                   .freeMemory = free,
+                                   .stepFinished = bench_stepFinished,
+                                   .componentEnvironment = nullptr};
+
+struct Options
+{
+  string out;
+  size_t calls = 10000;
+  size_t repetitions = 5;
+  string interpreter = "shared";
+  string filter;
+};
+
+/**
+ * @brief Collects the results of the benchmarks and the FMUs which were skipped.
+ */
+class Suite
+{
+public:
+  explicit Suite(const Options &options) : options_(options) {}
+
+  bool selected(const string &name) const
+  {
+    return options_.filter.empty() || name.find(options_.filter) != string::npos;
+  }
+
+  /**
+   * @brief Measure f, which is invoked calls times per repetition, and record the median time per call.
+   */
+  void measure(const string &name, const string &fmu, json parameters, const function<void()> &f, size_t calls = 0)
+  {
+    if (!selected(name))
+      return;
+
+    if (calls == 0)
+      calls = options_.calls;
+
+    // warm up caches and the lazily created state of the wrapper
+    ns_per_call(f, min<size_t>(calls, 100));
+
+    vector<double> samples;
+    for (size_t i = 0; i < options_.repetitions; ++i)
+      samples.push_back(ns_per_call(f, calls));
+
+    sort(samples.begin(), samples.end());
+    double median = samples[samples.size() / 2];
+
+    cerr << format("{:<24} {:<16} {:<24} {:12.1f} ns/call\n", name, fmu, parameters.dump(), median);
+
+    results_.push_back({{"name", name},
+                        {"fmu", fmu},
+                        {"parameters", move(parameters)},
+                        {"calls", calls},
+                        {"repetitions", options_.repetitions},
+                        {"ns_per_call", median},
+                        {"min_ns_per_call", samples.front()},
+                        {"max_ns_per_call", samples.back()}});
+  }
+
+  /**
+   * @brief Returns the number of calls per repetition for calls transferring nvr values, such that each repetition takes a similar time.
+   */
+  size_t calls_for(size_t nvr) const
+  {
+    return max<size_t>(options_.calls / max<size_t>(nvr / 16, 1), 1);
+  }
+
+  void skip(const string &fmu, const string &reason)
+  {
+    cerr << format("skipping {}: {}\n", fmu, reason);
+    skipped_.push_back({{"fmu", fmu}, {"reason", reason}});
+  }
+
+  json to_json() const
+  {
+    return {{"interpreter", options_.interpreter},
+            {"calls", options_.calls},
+            {"repetitions", options_.repetitions},
+            {"results", results_},
+            {"skipped", skipped_}};
+  }
+
+private:
+  const Options &options_;
+  json results_ = json::array();
+  json skipped_ = json::array();
+};
+
+/**
+ * @brief An initialized instance of an example FMU, freed when destroyed.
+ */
+class Instance
+{
+public:
+  Instance(ExampleArchive &archive, const string &name, bool loggingOn = false, fmi2Type fmuType = fmi2CoSimulation, size_t members = 1)
+  {
+    string resources_uri = archive.getResourcesURI();
+    c = pyfmuInstantiateEnsemble(name.c_str(), fmuType, "check?", resources_uri.c_str(), &callbacks, fmi2False, loggingOn ? fmi2True : fmi2False, members);
+
+    if (c == nullptr)
+      throw runtime_error("fmi2Instantiate failed");
+
+    if (fmi2SetupExperiment(c, fmi2False, 0.0, 0.0, fmi2False, 0.0) != fmi2OK ||
+        fmi2EnterInitializationMode(c) != fmi2OK ||
+        fmi2ExitInitializationMode(c) != fmi2OK)
+    {
+      fmi2FreeInstance(c);
+      throw runtime_error("the initialization failed");
+    }
+  }
+
+  Instance(const Instance &) = delete;
+  Instance &operator=(const Instance &) = delete;
+
+  ~Instance()
+  {
+    fmi2Terminate(c);
+    fmi2FreeInstance(c);
+  }
+
+  fmi2Component c;
+};
+
+/**
+ * @brief Returns nvr value references, repeating those given, as a tool requesting many variables of a small FMU would.
+ */
+vector<fmi2ValueReference> cycle(const vector<fmi2ValueReference> &vrs, size_t nvr)
+{
+  vector<fmi2ValueReference> cycled(nvr);
+  for (size_t i = 0; i < nvr; ++i)
+    cycled[i] = vrs[i % vrs.size()];
+  return cycled;
+}
+
+const size_t nvrs[] = {1, 16, 256, 4096};
+
+/**
+ * @brief Time the steps and the access of the real variables of the FMU, whose inputs and outputs are given.
+ */
+void bench_real(Suite &suite, ExampleArchive &archive, const string &fmu,
+                const vector<fmi2ValueReference> &inputs, const vector<fmi2ValueReference> &outputs)
+{
+  Instance i(archive, fmu);
+  double time = 0;
+
+  suite.measure("fmi2DoStep", fmu, json::object(), [&]() { fmi2DoStep(i.c, time, 0.001, fmi2True); time += 0.001; });
+
+  for (size_t nvr : nvrs)
+  {
+    size_t calls = suite.calls_for(nvr);
+
+    auto set_vrs = cycle(inputs, nvr);
+    vector<double> set_values(nvr, 1.0);
+    suite.measure("fmi2SetReal", fmu, {{"nvr", nvr}}, [&]() { fmi2SetReal(i.c, set_vrs.data(), nvr, set_values.data()); }, calls);
+
+    auto get_vrs = cycle(outputs, nvr);
+    vector<double> get_values(nvr);
+    suite.measure("fmi2GetReal", fmu, {{"nvr", nvr}}, [&]() { fmi2GetReal(i.c, get_vrs.data(), nvr, get_values.data()); }, calls);
+  }
+}
+
+/**
+ * @brief Time the access of the elements of array variables, whose value references 0 to n - 1 are stored natively in consecutive positions.
+ *
+ * The elements are accessed in order, which the wrapper copies as a block, and in reverse order, which it copies element by element.
+ */
+void bench_array(Suite &suite, ExampleArchive &archive, const string &fmu, size_t n)
+{
+  Instance i(archive, fmu);
+
+  vector<fmi2ValueReference> block(n);
+  iota(block.begin(), block.end(), 0);
+  vector<fmi2ValueReference> reversed(block.rbegin(), block.rend());
+  vector<double> values(n, 1.0);
+
+  for (auto &[order, vrs] : {pair{"block", &block}, pair{"reversed", &reversed}})
+  {
+    suite.measure("fmi2SetReal", fmu, {{"nvr", n}, {"order", order}}, [&]() { fmi2SetReal(i.c, vrs->data(), n, values.data()); });
+    suite.measure("fmi2GetReal", fmu, {{"nvr", n}, {"order", order}}, [&]() { fmi2GetReal(i.c, vrs->data(), n, values.data()); });
+  }
+}
+
+/**
+ * @brief Time a step of members copies of the FMU, which differ in the value of a parameter, and the read of their outputs,
+ * as separate instances and as the members of an ensemble.
+ */
+void bench_ensemble(Suite &suite, ExampleArchive &archive, const string &fmu, size_t members,
+                    fmi2ValueReference parameter, const vector<fmi2ValueReference> &outputs)
+{
+  if (!suite.selected("fmi2DoStep+fmi2GetReal") && !suite.selected("fmi2DoStep+pyfmuGetRealEnsemble"))
+    return;
+
+  size_t n = outputs.size();
+  vector<fmi2Real> parameters(members), values(members * n);
+  iota(parameters.begin(), parameters.end(), 1.0);
+
+  // each call steps every member, which are as many steps as the other benchmarks take in members calls
+  size_t calls = max<size_t>(suite.calls_for(1) / members, 3);
+
+  {
+    vector<unique_ptr<Instance>> instances;
+    for (size_t m = 0; m < members; ++m)
+    {
+      instances.push_back(make_unique<Instance>(archive, fmu));
+      fmi2SetReal(instances.back()->c, &parameter, 1, &parameters[m]);
+    }
+
+    double time = 0;
+    suite.measure("fmi2DoStep+fmi2GetReal", fmu, {{"members", members}}, [&]() {
+      for (size_t m = 0; m < members; ++m)
+      {
+        fmi2DoStep(instances[m]->c, time, 0.001, fmi2True);
+        fmi2GetReal(instances[m]->c, outputs.data(), n, values.data() + m * n);
+      }
+      time += 0.001;
+    },
+                  calls);
+  }
+
+  Instance ensemble(archive, fmu, false, fmi2CoSimulation, members);
+  pyfmuSetRealEnsemble(ensemble.c, &parameter, 1, parameters.data());
+
+  double time = 0;
+  suite.measure("fmi2DoStep+pyfmuGetRealEnsemble", fmu, {{"members", members}}, [&]() {
+    fmi2DoStep(ensemble.c, time, 0.001, fmi2True);
+    pyfmuGetRealEnsemble(ensemble.c, outputs.data(), n, values.data());
+    time += 0.001;
+  },
+                calls);
+}
+
+/**
+ * @brief Time the access of string variables, which are converted and buffered by the wrapper, unlike reals.
+ */
+void bench_string(Suite &suite, ExampleArchive &archive, const string &fmu,
+                  const vector<fmi2ValueReference> &inputs, const vector<fmi2ValueReference> &outputs)
+{
+  Instance i(archive, fmu);
+
+  for (size_t nvr : nvrs)
+  {
+    size_t calls = suite.calls_for(nvr);
+
+    auto set_vrs = cycle(inputs, nvr);
+    vector<fmi2String> set_values(nvr, "\u00b5s");
+    suite.measure("fmi2SetString", fmu, {{"nvr", nvr}}, [&]() { fmi2SetString(i.c, set_vrs.data(), nvr, set_values.data()); }, calls);
+
+    auto get_vrs = cycle(outputs, nvr);
+    vector<fmi2String> get_values(nvr);
+    suite.measure("fmi2GetString", fmu, {{"nvr", nvr}}, [&]() { fmi2GetString(i.c, get_vrs.data(), nvr, get_values.data()); }, calls);
+  }
+}
+
+/**
+ * @brief Time the steps of an FMU which logs a message in every step, with the debug logging of the instance turned on and off.
+ */
+void bench_logging(Suite &suite, ExampleArchive &archive, const string &fmu)
+{
+  for (bool loggingOn : {false, true})
+  {
+    Instance i(archive, fmu, loggingOn);
+
+    const char *categories[] = {"logEvents"};
+    fmi2SetDebugLogging(i.c, loggingOn ? fmi2True : fmi2False, 1, categories);
+
+    double time = 0;
+    suite.measure("fmi2DoStep", fmu, {{"logging", loggingOn}}, [&]() { fmi2DoStep(i.c, time, 0.001, fmi2True); time += 0.001; });
+  }
+}
+
+/**
+ * @brief Time the evaluation of the derivatives and event indicators of a Model Exchange FMU, as called by an integrator for each stage.
+ */
+void bench_model_exchange(Suite &suite, ExampleArchive &archive, const string &fmu, size_t nx, size_t ni)
+{
+  Instance i(archive, fmu, false, fmi2ModelExchange);
+  fmi2EnterContinuousTimeMode(i.c);
+
+  vector<fmi2Real> states(nx), derivatives(nx), indicators(ni);
+  fmi2GetContinuousStates(i.c, states.data(), nx);
+  double time = 0;
+
+  suite.measure("fmi2GetDerivatives", fmu, json::object(), [&]() { fmi2GetDerivatives(i.c, derivatives.data(), nx); });
+
+  suite.measure("fmi2GetDerivatives", fmu, {{"set_states", true}}, [&]() {
+    fmi2SetTime(i.c, time);
+    fmi2SetContinuousStates(i.c, states.data(), nx);
+    fmi2GetDerivatives(i.c, derivatives.data(), nx);
+    time += 0.001;
+  });
+
+  suite.measure("fmi2GetEventIndicators", fmu, {{"set_states", true}}, [&]() {
+    fmi2SetContinuousStates(i.c, states.data(), nx);
+    fmi2GetEventIndicators(i.c, indicators.data(), ni);
+  });
+}
+
+/**
+ * @brief Time the assembly of the Jacobian of the derivatives with respect to the states, column by column using fmi2GetDirectionalDerivative
+ * and grouped by the declared dependencies using pyfmuGetJacobian.
+ */
+void bench_jacobian(Suite &suite, ExampleArchive &archive, const string &fmu, const vector<fmi2ValueReference> &unknowns, const vector<fmi2ValueReference> &knowns)
+{
+  Instance i(archive, fmu, false, fmi2ModelExchange);
+  fmi2EnterContinuousTimeMode(i.c);
+
+  size_t n = knowns.size();
+  vector<fmi2Real> jacobian(unknowns.size() * n), seed(n, 0.0), column(unknowns.size());
+
+  // a Jacobian takes as many evaluations of the slave as it has columns, or colors
+  size_t calls = max<size_t>(suite.calls_for(1) / 1000, 3);
+
+  suite.measure("fmi2GetDirectionalDerivative", fmu, {{"columns", n}}, [&]() {
+    for (size_t j = 0; j < n; ++j)
+    {
+      seed[j] = 1.0;
+      fmi2GetDirectionalDerivative(i.c, unknowns.data(), unknowns.size(), knowns.data(), n, seed.data(), column.data());
+      seed[j] = 0.0;
+
+      for (size_t k = 0; k < unknowns.size(); ++k)
+        jacobian[k * n + j] = column[k];
+    }
+  },
+                calls);
+
+  suite.measure("pyfmuGetJacobian", fmu, {{"columns", n}}, [&]() {
+    pyfmuGetJacobian(i.c, unknowns.data(), unknowns.size(), knowns.data(), n, jacobian.data());
+  },
+                calls);
+}
+
+/**
+ * @brief Time the life cycle of an instance, from fmi2Instantiate to fmi2FreeInstance, without taking any steps.
+ */
+void bench_instantiate(Suite &suite, ExampleArchive &archive, const string &fmu)
+{
+  string resources_uri = archive.getResourcesURI();
+
+  // instantiating is orders of magnitude slower than the other calls
+  size_t calls = max<size_t>(suite.calls_for(1) / 1000, 3);
+
+  suite.measure("fmi2Instantiate+fmi2FreeInstance", fmu, json::object(), [&]() {
+    fmi2Component c = fmi2Instantiate(fmu.c_str(), fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+    if (c == nullptr)
+      throw runtime_error("fmi2Instantiate failed");
+    fmi2FreeInstance(c);
+  },
+                calls);
+}
+
+Options parse_options(int argc, char *argv[])
+{
+  Options options;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg = argv[i];
+
+    if (i + 1 >= argc)
+      throw invalid_argument(format("The option {} requires a value", arg));
+
+    string value = argv[++i];
+
+    if (arg == "--out")
+      options.out = value;
+    else if (arg == "--calls")
+      options.calls = stoul(value);
+    else if (arg == "--repetitions")
+      options.repetitions = max<size_t>(stoul(value), 1);
+    else if (arg == "--interpreter")
+      options.interpreter = value;
+    else if (arg == "--filter")
+      options.filter = value;
+    else
+      throw invalid_argument(format("Unknown option {}", arg));
+  }
+
+  return options;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  Options options;
+
+  try
+  {
+    options = parse_options(argc, argv);
+  }
+  catch (const exception &e)
+  {
+    cerr << e.what() << "\n"
+         << "usage: pyfmu_bench [--out results.json] [--calls N] [--repetitions N] [--interpreter shared|isolated|process|fork] [--filter substring]\n";
+    return 2;
+  }
+
+  // the progress of exporting the examples is logged to the standard output stream, to which the results may be written
+  spdlog::set_level(spdlog::level::warn);
+
+  Suite suite(options);
+
+  // every FMU is benchmarked on its own, such that one which can not be loaded, e.g. due to missing packages, does not abort the others
+  auto run = [&](const string &fmu, const function<void(ExampleArchive &)> &f) {
+    try
+    {
+      auto archive = ExampleArchive(fmu);
+      archive.setInterpreter(options.interpreter);
+      f(archive);
+    }
+    catch (const exception &e)
+    {
+      suite.skip(fmu, e.what());
+    }
+  };
+
+  run("Adder", [&](ExampleArchive &a) {
+    bench_real(suite, a, "Adder", {1, 2}, {0});
+    bench_instantiate(suite, a, "Adder");
+  });
+
+  run("NativeAdder", [&](ExampleArchive &a) { bench_real(suite, a, "NativeAdder", {1, 2}, {0}); });
+
+  run("SineGenerator", [&](ExampleArchive &a) {
+    bench_real(suite, a, "SineGenerator", {0, 1, 2}, {3});
+    bench_ensemble(suite, a, "SineGenerator", 1000, 0, {3});
+  });
+
+  run("BicycleKinematic", [&](ExampleArchive &a) {
+    bench_real(suite, a, "BicycleKinematic", {0, 1}, {2, 3, 4, 5});
+    bench_instantiate(suite, a, "BicycleKinematic");
+  });
+
+  run("LoggerFMU", [&](ExampleArchive &a) { bench_logging(suite, a, "LoggerFMU"); });
+
+  run("Clock", [&](ExampleArchive &a) { bench_string(suite, a, "Clock", {0}, {0, 1}); });
+
+  run("Oscillator", [&](ExampleArchive &a) { bench_model_exchange(suite, a, "Oscillator", 2, 1); });
+
+  run("HeatRod", [&](ExampleArchive &a) {
+    // the temperature and derivative of each of the 200 cells follow q, T_end and alpha
+    vector<fmi2ValueReference> derivatives, temperatures;
+    for (fmi2ValueReference k = 0; k < 200; ++k)
+    {
+      temperatures.push_back(3 + 2 * k);
+      derivatives.push_back(4 + 2 * k);
+    }
+
+    bench_model_exchange(suite, a, "HeatRod", 200, 0);
+    bench_jacobian(suite, a, "HeatRod", derivatives, temperatures);
+  });
+
+  run("MatrixGain", [&](ExampleArchive &a) { bench_array(suite, a, "MatrixGain", 80); });
+
+  string results = suite.to_json().dump(2);
+
+  if (options.out.empty())
+  {
+    cout << results << "\n";
+  }
+  else
+  {
+    ofstream out(options.out);
+    out << results << "\n";
+
+    if (!out)
+    {
+      cerr << format("Failed to write the results to {}\n", options.out);
+      return 1;
+    }
+  }
+
+  return 0;
+}
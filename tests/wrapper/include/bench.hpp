@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#include "fmi/fmi2Functions.h"
+
+/**
+ * Callbacks which discard the log messages and step notifications of the instances being benchmarked
+*/
+inline void bench_logger(void *env, const char *str1, fmi2Status s, const char *str2,
+                         const char *str3, ...)
+{
+}
+
+inline void bench_stepFinished(fmi2ComponentEnvironment componentEnvironment, fmi2Status status)
+{
+}
+
+/**
+ * Returns the average time in nanoseconds spent per invocation of f
+*/
+template <typename F>
+double ns_per_call(F f, std::size_t n_calls = 100000)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < n_calls; ++i)
+        f();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / n_calls;
+}
@@ -2,7 +2,9 @@
 /**
  * Provides functionality related to finding and instantiating example projects
 */
+#include <cstddef>
 #include <filesystem>
+#include <string>
 
 #include <tmpdir.hpp>
 
@@ -32,6 +34,31 @@ public:
     std::filesystem::path getResources();
     std::string getResourcesURI();
 
+    /**
+     * Select the interpreter in which instances of the archive are created, i.e. 'shared' or 'isolated'
+    */
+    void setInterpreter(std::string interpreter);
+
+    /**
+     * Select how the logger of instances of the archive delivers messages, i.e. 'sync' or 'async', and what it does when its queue is full
+    */
+    void setLogging(std::string mode, std::string overflow = "drop", std::size_t capacity = 4096);
+
+    /**
+     * Select how instances of the archive take steps, i.e. 'sync' or 'async'
+    */
+    void setStepping(std::string stepping);
+
+    /**
+     * Keep up to size freed instances of the archive for reuse, which may be destroyed once unused for max_idle seconds unless 0
+    */
+    void setPool(std::size_t size, double max_idle = 0);
+
+    /**
+     * Record latency histograms of the calls of instances of the archive, logging a summary when they are terminated if dumpOnTerminate is set
+    */
+    void setProfiling(bool enabled, bool dumpOnTerminate = false);
+
 private:
     TmpDir td;
     std::string exampleName;
@@ -0,0 +1,514 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "fmt/format.h"
+#include "Python.h"
+
+#include "fmi/fmi2Functions.h"
+#include "bench.hpp"
+#include "example_finder.hpp"
+#include "pythonfmu/ProcessChannel.hpp"
+#include "pythonfmu/pyfmuFunctions.h"
+
+using namespace std;
+using namespace fmt;
+
+/**
+ * @brief Benchmarks of the wrapper.
+ *
+ * The test cases are hidden and must be run explicitly, for example:
+ *
+ * ./tests [benchmark]
+ */
+
+namespace
+{
+
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+/**
+ * @brief Returns the resident and proportional set sizes in MiB, summed over the worker processes of the wrapper, including fork servers.
+ *
+ * The proportional set size divides the pages shared by several processes between them, as such it accounts for memory shared copy-on-write.
+ */
+pair<double, double> worker_memory()
+{
+  double rss = 0, pss = 0;
+
+  for (auto &entry : filesystem::directory_iterator("/proc"))
+  {
+    string comm;
+    ifstream(entry.path() / "comm") >> comm;
+
+    if (comm != "pyfmu_worker")
+      continue;
+
+    ifstream rollup(entry.path() / "smaps_rollup");
+    string line;
+
+    while (getline(rollup, line))
+    {
+      istringstream fields(line);
+      string key;
+      double kb = 0;
+      fields >> key >> kb;
+
+      if (key == "Rss:")
+        rss += kb / 1024;
+      else if (key == "Pss:")
+        pss += kb / 1024;
+    }
+  }
+
+  return {rss, pss};
+}
+#endif
+
+} // namespace
+
+TEST_CASE("Call overhead", "[.][benchmark]")
+{
+  auto a = ExampleArchive("Adder");
+  string resources_uri = a.getResourcesURI();
+
+  fmi2CallbackFunctions callbacks = {.logger = bench_logger,
+                                     .allocateMemory = calloc,
+                                     .freeMemory = free,
+                                     .stepFinished = bench_stepFinished,
+                                     .componentEnvironment = nullptr};
+
+  fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+  REQUIRE(c != nullptr);
+
+  SECTION("fmi2 functions")
+  {
+    unsigned int set_refs[] = {1, 2};
+    double set_vals[] = {5, 10};
+    unsigned int get_refs[] = {0};
+    double get_vals[] = {0};
+
+    print("fmi2DoStep:     {:8.1f} ns/call\n", ns_per_call([&]() { fmi2DoStep(c, 0, 1, fmi2False); }));
+    print("fmi2SetReal(2): {:8.1f} ns/call\n", ns_per_call([&]() { fmi2SetReal(c, set_refs, 2, set_vals); }));
+    print("fmi2GetReal(1): {:8.1f} ns/call\n", ns_per_call([&]() { fmi2GetReal(c, get_refs, 1, get_vals); }));
+  }
+
+  SECTION("method dispatch")
+  {
+    // the resources directory of the archive is on the interpreters path once the FMU is instantiated.
+    PyGILState_STATE gil = PyGILState_Ensure();
+
+    PyObject *module = PyImport_ImportModule("adder");
+    REQUIRE(module != nullptr);
+    PyObject *instance = PyObject_CallMethod(module, "Adder", nullptr);
+    REQUIRE(instance != nullptr);
+    PyObject *do_step = PyObject_GetAttrString(instance, "do_step");
+    REQUIRE(do_step != nullptr);
+
+    auto by_name = ns_per_call([&]() {
+      PyObject *r = PyObject_CallMethod(instance, "do_step", "(dd)", 0.0, 1.0);
+      Py_XDECREF(r);
+    });
+
+    // the wrapper is compiled against the limited API of Python 3.7 unless PYFMU_OWN_GIL is set, which leaves out
+    // vectorcall, so this fallback of PyCompat::PyObject_Vectorcall is the call path of the default build
+    auto pre_resolved = ns_per_call([&]() {
+      PyObject *current_time = PyFloat_FromDouble(0.0);
+      PyObject *step_size = PyFloat_FromDouble(1.0);
+      PyObject *r = PyObject_CallFunctionObjArgs(do_step, current_time, step_size, nullptr);
+      Py_DECREF(current_time);
+      Py_DECREF(step_size);
+      Py_XDECREF(r);
+    });
+
+    print("do_step by name:      {:8.1f} ns/call\n", by_name);
+    print("do_step pre-resolved: {:8.1f} ns/call (PyObject_CallFunctionObjArgs, vectorcall is only used with PYFMU_OWN_GIL)\n", pre_resolved);
+
+    Py_DECREF(do_step);
+    Py_DECREF(instance);
+    Py_DECREF(module);
+
+    PyGILState_Release(gil);
+  }
+
+  fmi2FreeInstance(c);
+}
+
+TEST_CASE("Parallel stepping", "[.][benchmark]")
+{
+  // each thread steps an instance of its own, ideally the throughput grows linearly with the number of threads
+  const size_t max_threads = max(2u, thread::hardware_concurrency());
+  const size_t n_steps = 200;
+
+  fmi2CallbackFunctions callbacks = {.logger = bench_logger,
+                                     .allocateMemory = calloc,
+                                     .freeMemory = free,
+                                     .stepFinished = bench_stepFinished,
+                                     .componentEnvironment = nullptr};
+
+  for (string interpreter : {"shared", "isolated"})
+  {
+    auto a = ExampleArchive("BicycleKinematic");
+    a.setInterpreter(interpreter);
+    string resources_uri = a.getResourcesURI();
+
+    double single_thread_throughput = 0;
+
+    for (size_t n_threads = 1; n_threads <= max_threads; ++n_threads)
+    {
+      vector<fmi2Component> components;
+
+      for (size_t i = 0; i < n_threads; ++i)
+      {
+        fmi2Component c = fmi2Instantiate(format("bicycle{}", i).c_str(), fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+        REQUIRE(c != nullptr);
+        REQUIRE(fmi2SetupExperiment(c, fmi2False, 0.0, 0.0, fmi2False, 0.0) == fmi2OK);
+        REQUIRE(fmi2EnterInitializationMode(c) == fmi2OK);
+        REQUIRE(fmi2ExitInitializationMode(c) == fmi2OK);
+        components.push_back(c);
+      }
+
+      vector<thread> threads;
+      auto start = chrono::steady_clock::now();
+
+      for (auto c : components)
+      {
+        threads.emplace_back([c, n_steps]() {
+          for (size_t step = 0; step < n_steps; ++step)
+            fmi2DoStep(c, step * 0.01, 0.01, fmi2False);
+        });
+      }
+
+      for (auto &t : threads)
+        t.join();
+
+      auto end = chrono::steady_clock::now();
+
+      double throughput = n_threads * n_steps / chrono::duration<double>(end - start).count();
+
+      if (n_threads == 1)
+        single_thread_throughput = throughput;
+
+      double efficiency = throughput / (n_threads * single_thread_throughput);
+
+      print("{:>8} interpreter, {:>2} threads: {:10.0f} steps/s, scaling efficiency {:5.2f}\n", interpreter, n_threads, throughput, efficiency);
+
+      for (auto c : components)
+        fmi2FreeInstance(c);
+    }
+  }
+}
+
+TEST_CASE("Round-trip latency", "[.][benchmark]")
+{
+  fmi2CallbackFunctions callbacks = {.logger = bench_logger,
+                                     .allocateMemory = calloc,
+                                     .freeMemory = free,
+                                     .stepFinished = bench_stepFinished,
+                                     .componentEnvironment = nullptr};
+
+  vector<string> interpreters = {"shared"};
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+  interpreters.push_back("process");
+#endif
+
+  for (auto &interpreter : interpreters)
+  {
+    auto a = ExampleArchive("Adder");
+    a.setInterpreter(interpreter);
+    string resources_uri = a.getResourcesURI();
+
+    fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+    REQUIRE(c != nullptr);
+
+    unsigned int set_refs[] = {1, 2};
+    double set_vals[] = {5, 10};
+    unsigned int get_refs[] = {0};
+    double get_vals[] = {0};
+
+    // a co-simulation step as seen by the master: set the inputs, step and get the outputs
+    auto do_step = ns_per_call([&]() { fmi2DoStep(c, 0, 1, fmi2False); }, 20000);
+    auto round_trip = ns_per_call([&]() {
+      fmi2SetReal(c, set_refs, 2, set_vals);
+      fmi2DoStep(c, 0, 1, fmi2False);
+      fmi2GetReal(c, get_refs, 1, get_vals);
+    },
+                                  20000);
+
+    print("{:>8} interpreter: fmi2DoStep {:8.1f} ns/call, set/step/get {:8.1f} ns/step\n", interpreter, do_step, round_trip);
+
+    fmi2FreeInstance(c);
+  }
+}
+
+TEST_CASE("Snapshot and restore", "[.][benchmark]")
+{
+  // the recorder appends its input to a list at every step, as such the size of its state grows with the number of steps
+  fmi2CallbackFunctions callbacks = {.logger = bench_logger,
+                                     .allocateMemory = calloc,
+                                     .freeMemory = free,
+                                     .stepFinished = bench_stepFinished,
+                                     .componentEnvironment = nullptr};
+
+  auto a = ExampleArchive("Recorder");
+  string resources_uri = a.getResourcesURI();
+
+  fmi2Component c = fmi2Instantiate("recorder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+  REQUIRE(c != nullptr);
+
+  fmi2FMUstate state = nullptr;
+  size_t n_steps = 0;
+
+  for (size_t size : {0, 10, 100, 1000, 10000, 100000})
+  {
+    for (; n_steps < size; ++n_steps)
+      fmi2DoStep(c, n_steps, 1, fmi2False);
+
+    size_t n_calls = max<size_t>(10, 100000 / (size + 1));
+
+    // overwriting the state reuses the handle, such that only the cost of the snapshot is measured
+    auto get = ns_per_call([&]() { fmi2GetFMUstate(c, &state); }, n_calls);
+    auto set = ns_per_call([&]() { fmi2SetFMUstate(c, state); }, n_calls);
+
+    print("{:>6} recorded values: fmi2GetFMUstate {:10.1f} ns/call, fmi2SetFMUstate {:10.1f} ns/call\n", size, get, set);
+
+    // a fresh snapshot is serialized on every call, as the serialized snapshot is kept along with the state
+    size_t n_bytes = 0;
+    vector<fmi2Byte> serialized;
+    auto serialize = ns_per_call([&]() {
+      fmi2GetFMUstate(c, &state);
+      fmi2SerializedFMUstateSize(c, state, &n_bytes);
+      serialized.resize(n_bytes);
+      fmi2SerializeFMUstate(c, state, serialized.data(), n_bytes);
+    },
+                                 n_calls);
+    auto deserialize = ns_per_call([&]() { fmi2DeSerializeFMUstate(c, serialized.data(), n_bytes, &state); }, n_calls);
+
+    print("{:>6} recorded values: serialized to {} bytes, get and serialize {:10.1f} ns/call, fmi2DeSerializeFMUstate {:10.1f} ns/call\n", size, n_bytes, serialize, deserialize);
+  }
+
+  fmi2FreeFMUstate(c, &state);
+  fmi2FreeInstance(c);
+}
+
+namespace
+{
+
+/**
+ * @brief Logger callback taking as long as writing to a slow terminal or a full pipe.
+ */
+void slow_logger(void *env, const char *str1, fmi2Status s, const char *str2,
+                 const char *str3, ...)
+{
+  this_thread::sleep_for(chrono::microseconds(20));
+}
+
+} // namespace
+
+TEST_CASE("Asynchronous logging", "[.][benchmark]")
+{
+  fmi2CallbackFunctions callbacks = {.logger = slow_logger,
+                                     .allocateMemory = calloc,
+                                     .freeMemory = free,
+                                     .stepFinished = bench_stepFinished,
+                                     .componentEnvironment = nullptr};
+
+  // LoggerFMU logs a message in every step
+  for (string mode : {"sync", "async"})
+  {
+    auto a = ExampleArchive("LoggerFMU");
+    a.setLogging(mode, "block");
+    string resources_uri = a.getResourcesURI();
+
+    fmi2Component c = fmi2Instantiate("logger", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+    REQUIRE(c != nullptr);
+
+    const char *categories[] = {"logEvents"};
+    REQUIRE(fmi2SetDebugLogging(c, fmi2True, 1, categories) == fmi2OK);
+
+    // fewer steps than fit in the queue, such that the asynchronous logger never blocks
+    size_t n_steps = 2000;
+    auto start = chrono::steady_clock::now();
+    double per_step = ns_per_call([&]() { fmi2DoStep(c, 0, 1, fmi2False); }, n_steps);
+    fmi2Terminate(c);
+    double total = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / n_steps;
+
+    print("{:5}: fmi2DoStep {:8.1f} ns/call, including the flush in fmi2Terminate {:6.1f} us/step\n", mode, per_step, total);
+
+    fmi2FreeInstance(c);
+  }
+}
+
+TEST_CASE("Batched stepping overhead", "[.][benchmark]")
+{
+  fmi2CallbackFunctions callbacks = {.logger = bench_logger,
+                                     .allocateMemory = calloc,
+                                     .freeMemory = free,
+                                     .stepFinished = bench_stepFinished,
+                                     .componentEnvironment = nullptr};
+
+  vector<string> interpreters = {"shared"};
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+  interpreters.push_back("process");
+#endif
+
+  // SineGenerator computes all steps at once in do_steps, Adder uses the default implementation which calls do_step for each step
+  for (string example : {"SineGenerator", "Adder"})
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto a = ExampleArchive(example);
+      a.setInterpreter(interpreter);
+      string resources_uri = a.getResourcesURI();
+
+      fmi2Component c = fmi2Instantiate("batched", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+      REQUIRE(c != nullptr);
+
+      // only the output is exchanged, such that the cost of the steps themselves is measured
+      fmi2ValueReference output = (example == "SineGenerator") ? 3 : 0;
+
+      for (size_t n_steps : {1, 10, 100, 1000})
+      {
+        vector<fmi2Real> step_sizes(n_steps, 0.001);
+        vector<fmi2Real> outputs(n_steps);
+        size_t n_calls = max<size_t>(20, 20000 / n_steps);
+
+        auto single = ns_per_call([&]() {
+          double t = 0;
+          for (size_t k = 0; k < n_steps; ++k)
+          {
+            fmi2DoStep(c, t, step_sizes[k], fmi2True);
+            fmi2GetReal(c, &output, 1, &outputs[k]);
+            t += step_sizes[k];
+          }
+        },
+                                  n_calls);
+
+        auto batched = ns_per_call([&]() {
+          pyfmuDoSteps(c, 0, step_sizes.data(), n_steps, nullptr, 0, nullptr, &output, 1, outputs.data(), nullptr);
+        },
+                                   n_calls);
+
+        print("{:>13} {:>8} interpreter, {:4} steps: fmi2DoStep/fmi2GetReal {:8.1f} ns/step, pyfmuDoSteps {:8.1f} ns/step, speedup {:5.1f}x\n",
+              example, interpreter, n_steps, single / n_steps, batched / n_steps, single / batched);
+      }
+
+      fmi2FreeInstance(c);
+    }
+  }
+}
+
+TEST_CASE("Startup", "[.][benchmark]")
+{
+  // time from fmi2Instantiate to the return of the first fmi2DoStep, as paid by every FMU of a sweep
+  const size_t n_instances = 20;
+
+  fmi2CallbackFunctions callbacks = {.logger = bench_logger,
+                                     .allocateMemory = calloc,
+                                     .freeMemory = free,
+                                     .stepFinished = bench_stepFinished,
+                                     .componentEnvironment = nullptr};
+
+  vector<string> interpreters = {"shared", "isolated"};
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+  interpreters.push_back("process");
+#endif
+
+  for (auto &interpreter : interpreters)
+  {
+    for (bool bytecode : {false, true})
+    {
+      auto a = ExampleArchive("SineGenerator");
+      a.setInterpreter(interpreter);
+      string resources_uri = a.getResourcesURI();
+
+      // the bytecode cached by the interpreter is removed, as in a freshly extracted FMU
+      auto clear_caches = [&]() {
+        if (!bytecode)
+          filesystem::remove_all(a.getResources() / "__pycache__");
+        filesystem::remove_all(a.getResources() / "pyfmu" / "__pycache__");
+      };
+
+      vector<double> durations;
+
+      for (size_t i = 0; i < n_instances; ++i)
+      {
+        clear_caches();
+
+        auto start = chrono::steady_clock::now();
+
+        fmi2Component c = fmi2Instantiate("startup", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+        REQUIRE(c != nullptr);
+        REQUIRE(fmi2SetupExperiment(c, fmi2False, 0.0, 0.0, fmi2False, 0.0) == fmi2OK);
+        REQUIRE(fmi2EnterInitializationMode(c) == fmi2OK);
+        REQUIRE(fmi2ExitInitializationMode(c) == fmi2OK);
+        REQUIRE(fmi2DoStep(c, 0, 0.01, fmi2True) == fmi2OK);
+
+        auto end = chrono::steady_clock::now();
+        durations.push_back(chrono::duration<double, milli>(end - start).count());
+
+        fmi2FreeInstance(c);
+      }
+
+      // the first instance of the shared interpreter imports the modules, later ones find them in sys.modules
+      double first = durations.front();
+      sort(durations.begin() + 1, durations.end());
+      double median = durations[1 + (durations.size() - 1) / 2];
+
+      print("{:>8} interpreter, {:>8}: first instance {:8.2f} ms, median of later instances {:8.2f} ms\n",
+            interpreter, bytecode ? "bytecode" : "source", first, median);
+    }
+  }
+}
+
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+TEST_CASE("Fork server", "[.][benchmark]")
+{
+  // instances alive at the same time, as in a parallel sweep, which may be lowered through PYFMU_BENCH_INSTANCES on small machines
+  const char *n_env = getenv("PYFMU_BENCH_INSTANCES");
+  const size_t n_instances = (n_env != nullptr) ? stoul(n_env) : 1000;
+
+  fmi2CallbackFunctions callbacks = {.logger = bench_logger,
+                                     .allocateMemory = calloc,
+                                     .freeMemory = free,
+                                     .stepFinished = bench_stepFinished,
+                                     .componentEnvironment = nullptr};
+
+  for (string interpreter : {"process", "fork"})
+  {
+    auto a = ExampleArchive("BicycleDynamical");
+    a.setInterpreter(interpreter);
+    string resources_uri = a.getResourcesURI();
+
+    vector<fmi2Component> instances;
+    instances.reserve(n_instances);
+
+    // includes starting the fork server, which is done by the first instance
+    auto start = chrono::steady_clock::now();
+
+    for (size_t i = 0; i < n_instances; ++i)
+    {
+      fmi2Component c = fmi2Instantiate(format("bicycle{}", i).c_str(), fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+      REQUIRE(c != nullptr);
+      instances.push_back(c);
+    }
+
+    auto end = chrono::steady_clock::now();
+    double seconds = chrono::duration<double>(end - start).count();
+
+    auto [rss, pss] = worker_memory();
+
+    print("{:>8} interpreter, {} instances: instantiated in {:7.2f} s, {:7.2f} ms per instance, aggregate RSS {:9.1f} MiB, PSS {:9.1f} MiB\n",
+          interpreter, n_instances, seconds, 1000 * seconds / n_instances, rss, pss);
+
+    for (auto c : instances)
+      fmi2FreeInstance(c);
+  }
+}
+#endif
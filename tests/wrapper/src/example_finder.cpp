@@ -2,11 +2,13 @@
 #include <stdexcept>
 #include <set>
 #include <iostream>
+#include <fstream>
 
 #include <fmt/format.h>
 #include "spdlog/spdlog.h"
 #include <Poco/URI.h>
 #include <Poco/Path.h>
+#include <nlohmann/json.hpp>
 
 #include "example_finder.hpp"
 
@@ -22,7 +24,16 @@ set<string> examples = {
     "ConstantSignalGenerator",
     "SineGenerator",
     "LoggerFMU",
-    "BicycleKinematic"
+    "BicycleKinematic",
+    "BicycleDynamical",
+    "Recorder",
+    "Clock",
+    "Oscillator",
+    "HeatRod",
+    "LinearSystem",
+    "Integrator",
+    "MatrixGain",
+    "NativeAdder"
     };
 
 /**
@@ -89,4 +100,54 @@ std::string ExampleArchive::getResourcesURI()
     auto uri = Poco::URI(p);
 
     return uri.toString();
-}
\ No newline at end of file
+}
+
+void ExampleArchive::setInterpreter(std::string interpreter)
+{
+    fs::path config_path = getResources() / "slave_configuration.json";
+
+    nlohmann::json config;
+    ifstream(config_path) >> config;
+    config["interpreter"] = interpreter;
+    ofstream(config_path) << config;
+}
+
+void ExampleArchive::setLogging(std::string mode, std::string overflow, std::size_t capacity)
+{
+    fs::path config_path = getResources() / "slave_configuration.json";
+
+    nlohmann::json config;
+    ifstream(config_path) >> config;
+    config["logging"] = {{"mode", mode}, {"overflow", overflow}, {"capacity", capacity}};
+    ofstream(config_path) << config;
+}
+
+void ExampleArchive::setStepping(std::string stepping)
+{
+    fs::path config_path = getResources() / "slave_configuration.json";
+
+    nlohmann::json config;
+    ifstream(config_path) >> config;
+    config["stepping"] = stepping;
+    ofstream(config_path) << config;
+}
+
+void ExampleArchive::setPool(std::size_t size, double max_idle)
+{
+    fs::path config_path = getResources() / "slave_configuration.json";
+
+    nlohmann::json config;
+    ifstream(config_path) >> config;
+    config["pool"] = {{"size", size}, {"max_idle", max_idle}};
+    ofstream(config_path) << config;
+}
+
+void ExampleArchive::setProfiling(bool enabled, bool dumpOnTerminate)
+{
+    fs::path config_path = getResources() / "slave_configuration.json";
+
+    nlohmann::json config;
+    ifstream(config_path) >> config;
+    config["profiling"] = {{"enabled", enabled}, {"dump_on_terminate", dumpOnTerminate}};
+    ofstream(config_path) << config;
+}
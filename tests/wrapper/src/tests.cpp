@@ -1,13 +1,37 @@
 #define CATCH_CONFIG_MAIN
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 #include "catch2/catch.hpp"
 #include "fmt/format.h"
+#include "nlohmann/json.hpp"
 #include "spdlog/spdlog.h"
 
 #include "fmi/fmi2Functions.h"
 #include "example_finder.hpp"
+#include "pythonfmu/Logger.hpp"
+#include "pythonfmu/ProcessChannel.hpp"
+#include "pythonfmu/Profile.hpp"
+#include "pythonfmu/PyGIL.hpp"
+#include "pythonfmu/PyInitializer.hpp"
+#include "pythonfmu/PyMemoryViews.hpp"
+#include "pythonfmu/pyfmuFunctions.h"
 #include "utility/utils.hpp"
 
 using namespace std;
@@ -21,10 +45,56 @@ void logger(void *env, const char *str1, fmi2Status s, const char *str2,
   //spdlog::info(str1);
 }
 
+/**
+ * @brief Logger callback appending the category and message to the vector<pair<string, string>> passed as environment.
+ */
+void collect_log(fmi2ComponentEnvironment env, fmi2String, fmi2Status, fmi2String category, fmi2String message, ...)
+{
+  static_cast<vector<pair<string, string>> *>(env)->emplace_back(category, message);
+}
+
 void stepFinished(fmi2ComponentEnvironment componentEnvironment, fmi2Status status)
 {
 }
 
+/**
+ * @brief Returns the interpreters in which the tests instantiate the examples, worker processes included where they are supported.
+ *
+ * @param fork whether to include instantiation by a fork server
+ */
+vector<string> all_interpreters(bool fork = false)
+{
+  vector<string> interpreters = {"shared", "isolated"};
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+  interpreters.push_back("process");
+  if (fork)
+    interpreters.push_back("fork");
+#endif
+  return interpreters;
+}
+
+/**
+ * @brief Sets up an experiment starting at 0 and takes the instance through initialization mode.
+ */
+void initialize(fmi2Component c)
+{
+  REQUIRE(fmi2SetupExperiment(c, fmi2False, 0.0, 0.0, fmi2False, 0.0) == fmi2OK);
+  REQUIRE(fmi2EnterInitializationMode(c) == fmi2OK);
+  REQUIRE(fmi2ExitInitializationMode(c) == fmi2OK);
+}
+
+/**
+ * @brief Returns the callbacks passed to fmi2Instantiate, allocating memory using calloc and free.
+ */
+fmi2CallbackFunctions make_callbacks(fmi2CallbackLogger log = logger, fmi2ComponentEnvironment env = nullptr, fmi2StepFinished step_finished = stepFinished)
+{
+  return {.logger = log,
+          .allocateMemory = calloc,
+          .freeMemory = free,
+          .stepFinished = step_finished,
+          .componentEnvironment = env};
+}
+
 
 
 
@@ -41,11 +111,7 @@ TEST_CASE("PyObjectWrapper")
     const char *resources_cstr = resources_uri.c_str();
 
 
-    fmi2CallbackFunctions callbacks = {.logger = logger,
-                                       .allocateMemory = calloc,
-                                       .freeMemory = free,
-                                       .stepFinished = stepFinished,
-                                       .componentEnvironment = nullptr};
+    fmi2CallbackFunctions callbacks = make_callbacks();
 
     fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", resources_cstr, &callbacks, fmi2False, fmi2True);
 
@@ -89,7 +155,69 @@ TEST_CASE("PyObjectWrapper")
     REQUIRE(get_vals[0] == 15);
   }
 
-  
+  SECTION("loggerfmu_manyValueReferences")
+  {
+    // enough values for the wrapper to pass memoryviews rather than lists to the slave, which stores its variables as plain attributes
+    auto a = ExampleArchive("LoggerFMU");
+    string resources_uri = a.getResourcesURI();
+
+    fmi2CallbackFunctions callbacks = make_callbacks();
+
+    fmi2Component c = fmi2Instantiate("logger", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+
+    const size_t n = 100;
+    vector<fmi2ValueReference> set_refs(n);
+    vector<fmi2Real> set_vals(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      set_refs[i] = 1 + i % 2;
+      set_vals[i] = i;
+    }
+
+    fmi2Status s = fmi2SetReal(c, set_refs.data(), n, set_vals.data());
+    REQUIRE(s == fmi2OK);
+    s = fmi2DoStep(c, 0, 1, false);
+    REQUIRE(s == fmi2OK);
+
+    vector<fmi2ValueReference> get_refs(n, 0);
+    vector<fmi2Real> get_vals(n, 0);
+    s = fmi2GetReal(c, get_refs.data(), n, get_vals.data());
+    REQUIRE(s == fmi2OK);
+
+    for (auto v : get_vals)
+      REQUIRE(v == set_vals[n - 2] + set_vals[n - 1]);
+
+    fmi2FreeInstance(c);
+  }
+
+  SECTION("invalidValueReferences_rejected")
+  {
+    auto a = ExampleArchive("Adder");
+    string resources_uri = a.getResourcesURI();
+
+    vector<pair<string, string>> messages;
+    fmi2CallbackFunctions callbacks = make_callbacks(collect_log, &messages);
+
+    fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+
+    // the variables of the Adder are Reals with value references 0 to 2
+    fmi2ValueReference unknown[] = {0, 7};
+    fmi2Real reals[] = {0, 0};
+    REQUIRE(fmi2GetReal(c, unknown, 2, reals) == fmi2Error);
+    REQUIRE(fmi2SetReal(c, unknown, 2, reals) == fmi2Error);
+    REQUIRE(messages.back().second == "Variable with valueReference=7 is not of type Real!\n");
+
+    fmi2ValueReference real[] = {1};
+    fmi2Integer integers[] = {0};
+    REQUIRE(fmi2GetInteger(c, real, 1, integers) == fmi2Error);
+    REQUIRE(messages.back().second == "Variable with valueReference=1 is not of type Integer!\n");
+
+    fmi2FreeInstance(c);
+  }
+
+
 
 }
 
@@ -113,11 +241,7 @@ TEST_CASE("Logging")
 
     spdlog::info("resources as cstr {}", resources_cstr);
 
-    fmi2CallbackFunctions callbacks = {.logger = logger,
-                                       .allocateMemory = calloc,
-                                       .freeMemory = free,
-                                       .stepFinished = stepFinished,
-                                       .componentEnvironment = nullptr};
+    fmi2CallbackFunctions callbacks = make_callbacks();
 
     fmi2Component c = fmi2Instantiate("logger", fmi2Type::fmi2CoSimulation, "check?", resources_cstr, &callbacks, fmi2False, fmi2True);
 
@@ -136,6 +260,195 @@ TEST_CASE("Logging")
     fmi2DoStep(c,0,1,false);
     REQUIRE(s == fmi2OK);
   }
+
+  SECTION("fmi2DoStep_messagesLoggedBySlave_passedToCallback")
+  {
+    ExampleArchive a("LoggerFMU");
+    string resources_uri = a.getResourcesURI();
+
+    vector<pair<string, string>> messages;
+
+    fmi2CallbackFunctions callbacks = make_callbacks(collect_log, &messages);
+
+    fmi2Component c = fmi2Instantiate("logger", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+
+    const char *categories[] = {"logAll"};
+    REQUIRE(fmi2SetDebugLogging(c, true, 1, categories) == fmi2OK);
+
+    for (int i = 0; i < 3; ++i)
+    {
+      messages.clear();
+      REQUIRE(fmi2DoStep(c, i, 1, false) == fmi2OK);
+      REQUIRE(count(messages.begin(), messages.end(), pair<string, string>("events", "Stepping!")) == 1);
+    }
+
+    fmi2FreeInstance(c);
+  }
+
+  SECTION("fmi2SetDebugLogging_categoriesDeactivated_noMessages")
+  {
+    ExampleArchive a("LoggerFMU");
+    string resources_uri = a.getResourcesURI();
+
+    vector<pair<string, string>> messages;
+
+    fmi2CallbackFunctions callbacks = make_callbacks(collect_log, &messages);
+
+    // logging is off until categories are activated
+    fmi2Component c = fmi2Instantiate("logger", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+    REQUIRE(c != nullptr);
+    REQUIRE(fmi2DoStep(c, 0, 1, false) == fmi2OK);
+    REQUIRE(messages.empty());
+
+    const char *events[] = {"logEvents"};
+    REQUIRE(fmi2SetDebugLogging(c, true, 1, events) == fmi2OK);
+    REQUIRE(fmi2DoStep(c, 1, 1, false) == fmi2OK);
+    REQUIRE(messages == vector<pair<string, string>>{{"events", "Stepping!"}});
+
+    messages.clear();
+    REQUIRE(fmi2SetDebugLogging(c, false, 0, nullptr) == fmi2OK);
+    REQUIRE(fmi2DoStep(c, 2, 1, false) == fmi2OK);
+    REQUIRE(messages.empty());
+
+    fmi2FreeInstance(c);
+  }
+
+  SECTION("fmi2Terminate_asynchronousLogger_messagesDelivered")
+  {
+    ExampleArchive a("LoggerFMU");
+    a.setLogging("async");
+    string resources_uri = a.getResourcesURI();
+
+    vector<pair<string, string>> messages;
+
+    fmi2CallbackFunctions callbacks = make_callbacks(collect_log, &messages);
+
+    fmi2Component c = fmi2Instantiate("logger", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+    REQUIRE(c != nullptr);
+
+    const char *events[] = {"logEvents"};
+    REQUIRE(fmi2SetDebugLogging(c, true, 1, events) == fmi2OK);
+
+    for (int i = 0; i < 100; ++i)
+      REQUIRE(fmi2DoStep(c, i, 1, false) == fmi2OK);
+
+    // the messages are only accessed after the flush, as they are appended by the background thread
+    REQUIRE(fmi2Terminate(c) == fmi2OK);
+    REQUIRE(messages == vector<pair<string, string>>(100, {"events", "Stepping!"}));
+
+    fmi2FreeInstance(c);
+  }
+}
+
+namespace
+{
+
+/**
+ * @brief Records the messages delivered by a logger, optionally holding up the delivery until released.
+ */
+struct Recorder
+{
+  atomic<bool> hold{false};
+  vector<string> messages;
+  set<thread::id> threads;
+
+  static void callback(fmi2ComponentEnvironment env, fmi2String, fmi2Status, fmi2String, fmi2String message, ...)
+  {
+    auto recorder = static_cast<Recorder *>(env);
+
+    while (recorder->hold)
+      this_thread::yield();
+
+    recorder->messages.emplace_back(message);
+    recorder->threads.insert(this_thread::get_id());
+  }
+};
+
+} // namespace
+
+TEST_CASE("Asynchronous logger")
+{
+  Recorder recorder;
+
+  SECTION("flush_messagesDeliveredInOrderOnBackgroundThread")
+  {
+    Logger logger(&recorder, Recorder::callback, "async");
+    logger.startAsync(16, Logger::Overflow::block);
+
+    // more messages than fit in the queue, blocking until there is room
+    for (int i = 0; i < 1000; ++i)
+      logger.log(fmi2OK, "test", to_string(i));
+
+    logger.flush();
+
+    REQUIRE(recorder.messages.size() == 1000);
+    for (int i = 0; i < 1000; ++i)
+      REQUIRE(recorder.messages[i] == to_string(i));
+
+    REQUIRE(recorder.threads.size() == 1);
+    REQUIRE(recorder.threads.count(this_thread::get_id()) == 0);
+
+    auto counters = logger.counters();
+    REQUIRE(counters.queued == 1000);
+    REQUIRE(counters.delivered == 1000);
+    REQUIRE(counters.dropped == 0);
+  }
+
+  SECTION("log_queueFull_messagesDroppedAndReported")
+  {
+    Logger logger(&recorder, Recorder::callback, "async");
+    logger.startAsync(8, Logger::Overflow::drop);
+
+    recorder.hold = true;
+    for (int i = 0; i < 20; ++i)
+      logger.log(fmi2OK, "test", to_string(i));
+
+    auto counters = logger.counters();
+    recorder.hold = false;
+    logger.flush();
+
+    // the background thread may have taken one message out of the queue before being held up
+    REQUIRE(counters.queued + counters.dropped == 20);
+    REQUIRE(counters.dropped >= 11);
+
+    REQUIRE(recorder.messages.size() == counters.queued + 1);
+    REQUIRE(recorder.messages.back() == format("Dropped {} log messages which did not fit in the queue of the logger\n", counters.dropped));
+  }
+
+  SECTION("log_queueHalfFull_messagesSampled")
+  {
+    Logger logger(&recorder, Recorder::callback, "async");
+    logger.startAsync(64, Logger::Overflow::sample);
+
+    recorder.hold = true;
+    for (int i = 0; i < 200; ++i)
+      logger.log(fmi2OK, "test", to_string(i));
+
+    // errors are not sampled
+    logger.log(fmi2Error, "test", "error");
+
+    auto counters = logger.counters();
+    recorder.hold = false;
+    logger.flush();
+
+    REQUIRE(counters.queued + counters.dropped == 201);
+    REQUIRE(counters.queued < 64);
+    REQUIRE(count(recorder.messages.begin(), recorder.messages.end(), "error") == 1);
+  }
+
+  SECTION("destructor_messagesDelivered")
+  {
+    {
+      Logger logger(&recorder, Recorder::callback, "async");
+      logger.startAsync(16, Logger::Overflow::block);
+
+      for (int i = 0; i < 100; ++i)
+        logger.log(fmi2OK, "test", to_string(i));
+    }
+
+    REQUIRE(recorder.messages.size() == 100);
+  }
 }
 
 /**
@@ -155,11 +468,7 @@ TEST_CASE("Instantiation and Deallocation")
     string resources_uri = archive.getResourcesURI();
     const char *resources_cstr = resources_uri.c_str();
 
-    fmi2CallbackFunctions callbacks = {.logger = logger,
-                                       .allocateMemory = calloc,
-                                       .freeMemory = free,
-                                       .stepFinished = stepFinished,
-                                       .componentEnvironment = nullptr};
+    fmi2CallbackFunctions callbacks = make_callbacks();
 
     fmi2Component a = fmi2Instantiate("a", fmi2Type::fmi2CoSimulation, "check?",
                                       resources_cstr, &callbacks, fmi2False, fmi2True);
@@ -167,10 +476,1959 @@ TEST_CASE("Instantiation and Deallocation")
     fmi2Component b = fmi2Instantiate("b", fmi2Type::fmi2CoSimulation, "check?",
                                       resources_cstr, &callbacks, fmi2False, fmi2True);
 
-    REQUIRE(true);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    REQUIRE(a != b);
+
+    // instances must not share values
+    unsigned int set_refs[] = {1, 2};
+    double a_vals[] = {1, 2};
+    double b_vals[] = {10, 20};
+    REQUIRE(fmi2SetReal(a, set_refs, 2, a_vals) == fmi2OK);
+    REQUIRE(fmi2SetReal(b, set_refs, 2, b_vals) == fmi2OK);
+    REQUIRE(fmi2DoStep(a, 0, 1, fmi2False) == fmi2OK);
+    REQUIRE(fmi2DoStep(b, 0, 1, fmi2False) == fmi2OK);
+
+    unsigned int get_refs[] = {0};
+    double get_vals[] = {0};
+    REQUIRE(fmi2GetReal(a, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 3);
+
+    // freeing one instance must leave the interpreter alive for the other
+    fmi2FreeInstance(a);
+
+    REQUIRE(fmi2DoStep(b, 0, 1, fmi2False) == fmi2OK);
+    REQUIRE(fmi2GetReal(b, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 30);
+
+    fmi2FreeInstance(b);
+  }
+
+  SECTION("fmi2instantiate_isolatedInterpreter_OK")
+  {
+    auto archive = ExampleArchive("Adder");
+    archive.setInterpreter("isolated");
+    string resources_uri = archive.getResourcesURI();
+
+    fmi2CallbackFunctions callbacks = make_callbacks();
+
+    fmi2Component a = fmi2Instantiate("a", fmi2Type::fmi2CoSimulation, "check?",
+                                      resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    fmi2Component b = fmi2Instantiate("b", fmi2Type::fmi2CoSimulation, "check?",
+                                      resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+
+    // each instance is stepped from a thread of its own, Catch assertions are not thread safe so the results are checked after joining
+    auto step = [](fmi2Component c, double a_val, bool *ok) {
+      unsigned int set_refs[] = {1, 2};
+      double set_vals[] = {a_val, 1};
+      *ok = fmi2SetReal(c, set_refs, 2, set_vals) == fmi2OK;
+      for (int i = 0; i < 100; ++i)
+        *ok = *ok && fmi2DoStep(c, i, 1, fmi2False) == fmi2OK;
+    };
+
+    bool a_ok = false, b_ok = false;
+    thread ta(step, a, 1.0, &a_ok);
+    thread tb(step, b, 2.0, &b_ok);
+    ta.join();
+    tb.join();
+    REQUIRE(a_ok);
+    REQUIRE(b_ok);
+
+    unsigned int get_refs[] = {0};
+    double get_vals[] = {0};
+    REQUIRE(fmi2GetReal(a, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 2);
+    REQUIRE(fmi2GetReal(b, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 3);
+
+    fmi2FreeInstance(a);
+    fmi2FreeInstance(b);
+  }
+
+#ifdef PYFMU_HAS_PROCESS_SLAVE
+  SECTION("fmi2instantiate_workerProcess_OK")
+  {
+    auto archive = ExampleArchive("Adder");
+    archive.setInterpreter("process");
+    string resources_uri = archive.getResourcesURI();
+
+    fmi2CallbackFunctions callbacks = make_callbacks();
+
+    fmi2Component a = fmi2Instantiate("a", fmi2Type::fmi2CoSimulation, "check?",
+                                      resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    fmi2Component b = fmi2Instantiate("b", fmi2Type::fmi2CoSimulation, "check?",
+                                      resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+
+    unsigned int set_refs[] = {1, 2};
+    double a_vals[] = {1, 1};
+    double b_vals[] = {2, 1};
+    REQUIRE(fmi2SetReal(a, set_refs, 2, a_vals) == fmi2OK);
+    REQUIRE(fmi2SetReal(b, set_refs, 2, b_vals) == fmi2OK);
+    REQUIRE(fmi2DoStep(a, 0, 1, fmi2False) == fmi2OK);
+    REQUIRE(fmi2DoStep(b, 0, 1, fmi2False) == fmi2OK);
+
+    unsigned int get_refs[] = {0};
+    double get_vals[] = {0};
+    REQUIRE(fmi2GetReal(a, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 2);
+    REQUIRE(fmi2GetReal(b, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 3);
+
+    fmi2FreeInstance(a);
+    fmi2FreeInstance(b);
+  }
+
+  SECTION("fmi2instantiate_forkServer_workersForkedFromSameServer")
+  {
+    auto archive = ExampleArchive("Adder");
+    archive.setInterpreter("fork");
+    string resources_uri = archive.getResourcesURI();
+
+    vector<pair<string, string>> messages;
+    fmi2CallbackFunctions callbacks = make_callbacks(collect_log, &messages);
+
+    fmi2Component a = fmi2Instantiate("a", fmi2Type::fmi2CoSimulation, "check?",
+                                      resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    fmi2Component b = fmi2Instantiate("b", fmi2Type::fmi2CoSimulation, "check?",
+                                      resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+
+    auto count = [&](const string &prefix) {
+      return count_if(messages.begin(), messages.end(), [&](auto &m) { return m.second.rfind(prefix, 0) == 0; });
+    };
+
+    REQUIRE(count("Starting fork server") == 1);
+    REQUIRE(count("Forked worker process") == 2);
+
+    // the workers do not share the variables of the slave
+    unsigned int set_refs[] = {1, 2};
+    double a_vals[] = {1, 1};
+    double b_vals[] = {2, 1};
+    REQUIRE(fmi2SetReal(a, set_refs, 2, a_vals) == fmi2OK);
+    REQUIRE(fmi2SetReal(b, set_refs, 2, b_vals) == fmi2OK);
+    REQUIRE(fmi2DoStep(a, 0, 1, fmi2False) == fmi2OK);
+    REQUIRE(fmi2DoStep(b, 0, 1, fmi2False) == fmi2OK);
+
+    unsigned int get_refs[] = {0};
+    double get_vals[] = {0};
+    REQUIRE(fmi2GetReal(a, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 2);
+    REQUIRE(fmi2GetReal(b, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 3);
+
+    fmi2FreeInstance(a);
+    fmi2FreeInstance(b);
+
+    // the fork server outlives the instances
+    fmi2Component c = fmi2Instantiate("c", fmi2Type::fmi2CoSimulation, "check?",
+                                      resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+    REQUIRE(count("Starting fork server") == 1);
+    REQUIRE(fmi2DoStep(c, 0, 1, fmi2False) == fmi2OK);
+    fmi2FreeInstance(c);
+  }
+#endif
+
+  SECTION("fmi2instantiate_mainScriptsNamedAlike_importsEachScript")
+  {
+    auto added = ExampleArchive("Adder");
+    auto subtracted = ExampleArchive("Adder");
+
+    // both main scripts are named adder.py, but only the second subtracts its inputs, the bytecode compiled from the original is removed
+    auto script = subtracted.getResources() / "adder.py";
+    ifstream in(script);
+    string source((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+
+    string sum = "self.a + self.b";
+    source.replace(source.find(sum), sum.size(), "self.a - self.b");
+    ofstream(script) << source;
+    filesystem::remove_all(subtracted.getResources() / "__pycache__");
+
+    string added_uri = added.getResourcesURI();
+    string subtracted_uri = subtracted.getResourcesURI();
+
+    fmi2CallbackFunctions callbacks = make_callbacks();
+
+    fmi2Component a = fmi2Instantiate("a", fmi2Type::fmi2CoSimulation, "check?", added_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    fmi2Component b = fmi2Instantiate("b", fmi2Type::fmi2CoSimulation, "check?", subtracted_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+
+    unsigned int set_refs[] = {1, 2};
+    double set_vals[] = {5, 3};
+    REQUIRE(fmi2SetReal(a, set_refs, 2, set_vals) == fmi2OK);
+    REQUIRE(fmi2SetReal(b, set_refs, 2, set_vals) == fmi2OK);
+    REQUIRE(fmi2DoStep(a, 0, 1, fmi2False) == fmi2OK);
+    REQUIRE(fmi2DoStep(b, 0, 1, fmi2False) == fmi2OK);
+
+    unsigned int get_refs[] = {0};
+    double get_vals[] = {0};
+    REQUIRE(fmi2GetReal(a, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 8);
+    REQUIRE(fmi2GetReal(b, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 2);
+
+    fmi2FreeInstance(a);
+    fmi2FreeInstance(b);
+  }
+
+  SECTION("fmi2instantiate_afterAllInstancesFreed_OK")
+  {
+    auto archive = ExampleArchive("Adder");
+    string resources_uri = archive.getResourcesURI();
+
+    fmi2CallbackFunctions callbacks = make_callbacks();
+
+    // the interpreter outlives the last instance, and is reused by the next
+    for (int i = 0; i < 2; ++i)
+    {
+      fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?",
+                                        resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      REQUIRE(fmi2DoStep(c, 0, 1, fmi2False) == fmi2OK);
+      fmi2FreeInstance(c);
+    }
+  }
+}
+
+/**
+ * @brief Tests capturing and restoring the state of instances using fmi2GetFMUstate, fmi2SetFMUstate and fmi2FreeFMUstate.
+ */
+TEST_CASE("FMU state")
+{
+  fmi2CallbackFunctions callbacks = make_callbacks();
+
+  auto interpreters = all_interpreters(true);
+
+  SECTION("fmi2SetFMUstate_rollsBackAttributes")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Recorder");
+      archive.setInterpreter(interpreter);
+      string resources_uri = archive.getResourcesURI();
+
+      fmi2Component c = fmi2Instantiate("recorder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+
+      fmi2ValueReference u = 0, mean = 1;
+      fmi2Real value = 1;
+      REQUIRE(fmi2SetReal(c, &u, 1, &value) == fmi2OK);
+      REQUIRE(fmi2DoStep(c, 0, 1, fmi2False) == fmi2OK);
+
+      fmi2FMUstate state = nullptr;
+      REQUIRE(fmi2GetFMUstate(c, &state) == fmi2OK);
+      REQUIRE(state != nullptr);
+
+      // the recorded history is part of the state, the same state may be restored several times
+      for (int i = 0; i < 2; ++i)
+      {
+        value = 3;
+        REQUIRE(fmi2SetReal(c, &u, 1, &value) == fmi2OK);
+        REQUIRE(fmi2DoStep(c, 1, 1, fmi2False) == fmi2OK);
+        REQUIRE(fmi2GetReal(c, &mean, 1, &value) == fmi2OK);
+        REQUIRE(value == 2);
+
+        REQUIRE(fmi2SetFMUstate(c, state) == fmi2OK);
+        REQUIRE(fmi2GetReal(c, &mean, 1, &value) == fmi2OK);
+        REQUIRE(value == 1);
+      }
+
+      REQUIRE(fmi2FreeFMUstate(c, &state) == fmi2OK);
+      REQUIRE(state == nullptr);
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("fmi2SetFMUstate_rollsBackNativeVariables")
+  {
+    auto archive = ExampleArchive("NativeAdder");
+    string resources_uri = archive.getResourcesURI();
+
+    fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+
+    unsigned int set_refs[] = {1, 2};
+    double set_vals[] = {1, 2};
+    REQUIRE(fmi2SetReal(c, set_refs, 2, set_vals) == fmi2OK);
+
+    fmi2FMUstate state = nullptr;
+    REQUIRE(fmi2GetFMUstate(c, &state) == fmi2OK);
+
+    // overwriting the state keeps the handle
+    fmi2FMUstate first = state;
+    REQUIRE(fmi2GetFMUstate(c, &state) == fmi2OK);
+    REQUIRE(state == first);
+
+    set_vals[0] = 10;
+    REQUIRE(fmi2SetReal(c, set_refs, 2, set_vals) == fmi2OK);
+    REQUIRE(fmi2SetFMUstate(c, state) == fmi2OK);
+    REQUIRE(fmi2DoStep(c, 0, 1, fmi2False) == fmi2OK);
+
+    unsigned int get_refs[] = {0};
+    double get_vals[] = {0};
+    REQUIRE(fmi2GetReal(c, get_refs, 1, get_vals) == fmi2OK);
+    REQUIRE(get_vals[0] == 3);
+
+    // states not freed by the tool are released along with the instance
+    fmi2FreeInstance(c);
+  }
+
+  SECTION("fmi2DeSerializeFMUstate_restoresSerializedState")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Recorder");
+      archive.setInterpreter(interpreter);
+      string resources_uri = archive.getResourcesURI();
+
+      fmi2Component a = fmi2Instantiate("a", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      fmi2Component b = fmi2Instantiate("b", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(a != nullptr);
+      REQUIRE(b != nullptr);
+
+      fmi2ValueReference u = 0, mean = 1;
+      fmi2Real value = 4;
+      REQUIRE(fmi2SetReal(a, &u, 1, &value) == fmi2OK);
+      REQUIRE(fmi2DoStep(a, 0, 1, fmi2False) == fmi2OK);
+
+      fmi2FMUstate state = nullptr;
+      size_t size = 0;
+      REQUIRE(fmi2GetFMUstate(a, &state) == fmi2OK);
+      REQUIRE(fmi2SerializedFMUstateSize(a, state, &size) == fmi2OK);
+
+      vector<fmi2Byte> serialized(size);
+      REQUIRE(fmi2SerializeFMUstate(a, state, serialized.data(), size) == fmi2OK);
+      REQUIRE(fmi2SerializeFMUstate(a, state, serialized.data(), size - 1) == fmi2Error);
+      REQUIRE(fmi2FreeFMUstate(a, &state) == fmi2OK);
+
+      // the serialized state may be restored by any instance of the FMU
+      REQUIRE(fmi2DeSerializeFMUstate(b, serialized.data(), size, &state) == fmi2OK);
+      REQUIRE(fmi2SetFMUstate(b, state) == fmi2OK);
+
+      value = 2;
+      REQUIRE(fmi2SetReal(b, &u, 1, &value) == fmi2OK);
+      REQUIRE(fmi2DoStep(b, 1, 1, fmi2False) == fmi2OK);
+      REQUIRE(fmi2GetReal(b, &mean, 1, &value) == fmi2OK);
+      REQUIRE(value == 3);
+
+      // corrupted states are rejected
+      serialized[0] = 'X';
+      fmi2FMUstate corrupted = nullptr;
+      REQUIRE(fmi2DeSerializeFMUstate(b, serialized.data(), size, &corrupted) == fmi2Error);
+
+      fmi2FreeInstance(a);
+      fmi2FreeInstance(b);
+    }
+  }
+
+  SECTION("fmi2SetFMUstate_stateOfOtherInstance_fails")
+  {
+    auto archive = ExampleArchive("Adder");
+    string resources_uri = archive.getResourcesURI();
+
+    fmi2Component a = fmi2Instantiate("a", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    fmi2Component b = fmi2Instantiate("b", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+
+    fmi2FMUstate state = nullptr;
+    REQUIRE(fmi2GetFMUstate(a, &state) == fmi2OK);
+    REQUIRE(fmi2SetFMUstate(b, state) == fmi2Error);
+    REQUIRE(fmi2FreeFMUstate(b, &state) == fmi2Error);
+    REQUIRE(fmi2FreeFMUstate(a, &state) == fmi2OK);
+
+    fmi2FreeInstance(a);
+    fmi2FreeInstance(b);
   }
 }
 
+TEST_CASE("Instance pooling")
+{
+  auto interpreters = all_interpreters();
+
+  auto reused = [](const vector<pair<string, string>> &messages) {
+    return count_if(messages.begin(), messages.end(), [](auto &m) { return m.second == "Reusing a pooled instance\n"; });
+  };
+
+  SECTION("fmi2Reset_restoresInitialState")
+  {
+    fmi2CallbackFunctions callbacks = make_callbacks();
+
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Recorder");
+      archive.setInterpreter(interpreter);
+      string resources_uri = archive.getResourcesURI();
+
+      fmi2Component c = fmi2Instantiate("recorder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+
+      fmi2ValueReference u = 0, mean = 1;
+      fmi2Real value = 4;
+      REQUIRE(fmi2SetReal(c, &u, 1, &value) == fmi2OK);
+      REQUIRE(fmi2DoStep(c, 0, 1, fmi2False) == fmi2OK);
+
+      REQUIRE(fmi2Reset(c) == fmi2OK);
+
+      // the input is back at its start value and the recorded history is gone
+      REQUIRE(fmi2GetReal(c, &u, 1, &value) == fmi2OK);
+      REQUIRE(value == 0);
+
+      value = 2;
+      REQUIRE(fmi2SetReal(c, &u, 1, &value) == fmi2OK);
+      REQUIRE(fmi2DoStep(c, 0, 1, fmi2False) == fmi2OK);
+      REQUIRE(fmi2GetReal(c, &mean, 1, &value) == fmi2OK);
+      REQUIRE(value == 2);
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("fmi2Instantiate_poolEnabled_reusesFreedInstance")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Recorder");
+      archive.setInterpreter(interpreter);
+      archive.setPool(1);
+      string resources_uri = archive.getResourcesURI();
+
+      vector<pair<string, string>> first, second;
+      fmi2CallbackFunctions callbacks = make_callbacks(collect_log, &first);
+
+      fmi2Component a = fmi2Instantiate("a", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(a != nullptr);
+      REQUIRE(reused(first) == 0);
+
+      fmi2ValueReference u = 0, mean = 1;
+      fmi2Real value = 4;
+      REQUIRE(fmi2SetReal(a, &u, 1, &value) == fmi2OK);
+      REQUIRE(fmi2DoStep(a, 0, 1, fmi2False) == fmi2OK);
+
+      fmi2FMUstate state = nullptr;
+      REQUIRE(fmi2GetFMUstate(a, &state) == fmi2OK);
+      fmi2FreeInstance(a);
+
+      // messages of the reused instance are delivered to the callbacks of the new instance
+      fmi2CallbackFunctions reusing = make_callbacks(collect_log, &second);
+
+      fmi2Component b = fmi2Instantiate("b", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &reusing, fmi2False, fmi2True);
+      REQUIRE(b == a);
+      REQUIRE(reused(second) == 1);
+
+      // the states of the freed instance are gone
+      REQUIRE(fmi2SetFMUstate(b, state) == fmi2Error);
+
+      REQUIRE(fmi2GetReal(b, &u, 1, &value) == fmi2OK);
+      REQUIRE(value == 0);
+
+      value = 2;
+      REQUIRE(fmi2SetReal(b, &u, 1, &value) == fmi2OK);
+      REQUIRE(fmi2DoStep(b, 0, 1, fmi2False) == fmi2OK);
+      REQUIRE(fmi2GetReal(b, &mean, 1, &value) == fmi2OK);
+      REQUIRE(value == 2);
+
+      // the pool holds a single instance, a second instance is created while the first is in use
+      fmi2Component c = fmi2Instantiate("c", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &reusing, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      REQUIRE(c != b);
+      REQUIRE(reused(second) == 1);
+
+      fmi2FreeInstance(b);
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("fmi2Instantiate_idleInstanceExpired_createsNewInstance")
+  {
+    auto archive = ExampleArchive("Adder");
+    archive.setPool(1, 0.05);
+    string resources_uri = archive.getResourcesURI();
+
+    vector<pair<string, string>> messages;
+    fmi2CallbackFunctions callbacks = make_callbacks(collect_log, &messages);
+
+    fmi2Component a = fmi2Instantiate("a", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(a != nullptr);
+    fmi2FreeInstance(a);
+
+    this_thread::sleep_for(chrono::milliseconds(100));
+
+    fmi2Component b = fmi2Instantiate("b", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(b != nullptr);
+    REQUIRE(reused(messages) == 0);
+    fmi2FreeInstance(b);
+  }
+
+  SECTION("fmi2Instantiate_asynchronousStepping_reusesFreedInstance")
+  {
+    auto archive = ExampleArchive("Adder");
+    archive.setStepping("async");
+    archive.setPool(1);
+    string resources_uri = archive.getResourcesURI();
+
+    vector<pair<string, string>> messages;
+    fmi2CallbackFunctions callbacks = make_callbacks(collect_log, &messages);
+
+    for (int i = 0; i < 2; ++i)
+    {
+      fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+
+      REQUIRE(fmi2DoStep(c, 0, 1, fmi2False) == fmi2Pending);
+
+      fmi2Status status = fmi2Pending;
+      while (status == fmi2Pending)
+        REQUIRE(fmi2GetStatus(c, fmi2DoStepStatus, &status) == fmi2OK);
+      REQUIRE(status == fmi2OK);
+
+      fmi2FreeInstance(c);
+    }
+
+    REQUIRE(reused(messages) == 1);
+  }
+}
+
+TEST_CASE("String variables")
+{
+  fmi2CallbackFunctions callbacks = make_callbacks();
+
+  auto interpreters = all_interpreters();
+
+  SECTION("fmi2GetString_returnsStringsValidUntilNextCall")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Clock");
+      archive.setInterpreter(interpreter);
+      string resources_uri = archive.getResourcesURI();
+
+      fmi2Component c = fmi2Instantiate("clock", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+
+      fmi2ValueReference label = 0, text = 1;
+      fmi2String value = "\u00b5s";
+      REQUIRE(fmi2SetString(c, &label, 1, &value) == fmi2OK);
+      REQUIRE(fmi2SetupExperiment(c, fmi2False, 0.0, 0.0, fmi2False, 0.0) == fmi2OK);
+      REQUIRE(fmi2EnterInitializationMode(c) == fmi2OK);
+      REQUIRE(fmi2ExitInitializationMode(c) == fmi2OK);
+
+      // the same variable may be requested several times, each value has its own buffer
+      fmi2ValueReference vrs[] = {label, text, label};
+      fmi2String values[3] = {};
+      REQUIRE(fmi2GetString(c, vrs, 3, values) == fmi2OK);
+      REQUIRE(string(values[0]) == "\u00b5s");
+      REQUIRE(string(values[1]) == "\u00b5s=0");
+      REQUIRE(string(values[2]) == "\u00b5s");
+
+      REQUIRE(fmi2DoStep(c, 0, 0.5, fmi2False) == fmi2OK);
+      REQUIRE(fmi2GetString(c, &text, 1, values) == fmi2OK);
+      REQUIRE(string(values[0]) == "\u00b5s=0.5");
+
+      fmi2FreeInstance(c);
+    }
+  }
+}
+
+TEST_CASE("Batched stepping")
+{
+  fmi2CallbackFunctions callbacks = make_callbacks();
+
+  auto interpreters = all_interpreters();
+
+  SECTION("pyfmuDoSteps_matchesIndividualSteps")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("SineGenerator");
+      archive.setInterpreter(interpreter);
+      string resources_uri = archive.getResourcesURI();
+
+      fmi2Component single = fmi2Instantiate("single", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      fmi2Component batched = fmi2Instantiate("batched", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(single != nullptr);
+      REQUIRE(batched != nullptr);
+      initialize(single);
+      initialize(batched);
+
+      const size_t n_steps = 100;
+      fmi2ValueReference y = 3;
+      vector<fmi2Real> step_sizes(n_steps), expected(n_steps), actual(n_steps);
+
+      double t = 0;
+      for (size_t k = 0; k < n_steps; ++k)
+      {
+        step_sizes[k] = 0.01 * (1 + k % 3);
+        REQUIRE(fmi2DoStep(single, t, step_sizes[k], fmi2True) == fmi2OK);
+        REQUIRE(fmi2GetReal(single, &y, 1, &expected[k]) == fmi2OK);
+        t += step_sizes[k];
+      }
+
+      size_t completed = 0;
+      REQUIRE(pyfmuDoSteps(batched, 0, step_sizes.data(), n_steps, nullptr, 0, nullptr, &y, 1, actual.data(), &completed) == fmi2OK);
+      REQUIRE(completed == n_steps);
+      REQUIRE(actual == expected);
+
+      // the state of the slave is that following the last step
+      fmi2Real value = 0;
+      REQUIRE(fmi2GetReal(batched, &y, 1, &value) == fmi2OK);
+      REQUIRE(value == expected.back());
+
+      fmi2FreeInstance(single);
+      fmi2FreeInstance(batched);
+    }
+  }
+
+  SECTION("pyfmuDoSteps_setsInputsOfEachStep")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Adder");
+      archive.setInterpreter(interpreter);
+      string resources_uri = archive.getResourcesURI();
+
+      fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      fmi2ValueReference inputs[] = {1, 2};
+      fmi2ValueReference outputs[] = {0};
+      fmi2Real step_sizes[] = {1, 1, 1};
+      fmi2Real input_values[] = {1, 2, 3, 4, 5, 6};
+      fmi2Real output_values[3] = {};
+
+      size_t completed = 0;
+      REQUIRE(pyfmuDoSteps(c, 0, step_sizes, 3, inputs, 2, input_values, outputs, 1, output_values, &completed) == fmi2OK);
+      REQUIRE(completed == 3);
+      REQUIRE(output_values[0] == 3);
+      REQUIRE(output_values[1] == 7);
+      REQUIRE(output_values[2] == 11);
+
+      fmi2FreeInstance(c);
+    }
+  }
+}
+
+/**
+ * @brief Environment of the callbacks of an instance taking steps asynchronously.
+ * 
+ * Counts the steps reported by stepFinished and, while holding is set, keeps steps pending by blocking the callback of the slave logging "Stepping!".
+ */
+struct AsyncSteps
+{
+  mutex m;
+  condition_variable cv;
+  size_t finished = 0;
+  fmi2Status status = fmi2Fatal;
+  bool holding = false;
+  bool held = false;
+  fmi2Component freeing = nullptr; // freed by stepFinished before the step is counted
+
+  bool wait(function<bool()> predicate)
+  {
+    unique_lock<mutex> lock(m);
+    return cv.wait_for(lock, chrono::seconds(30), predicate);
+  }
+
+  void release()
+  {
+    lock_guard<mutex> lock(m);
+    holding = false;
+    cv.notify_all();
+  }
+};
+
+void async_steps_log(fmi2ComponentEnvironment env, fmi2String, fmi2Status, fmi2String, fmi2String message, ...)
+{
+  auto steps = static_cast<AsyncSteps *>(env);
+
+  if (string(message) != "Stepping!")
+    return;
+
+  unique_lock<mutex> lock(steps->m);
+  steps->held = true;
+  steps->cv.notify_all();
+  steps->cv.wait(lock, [steps]() { return !steps->holding; });
+}
+
+void async_steps_finished(fmi2ComponentEnvironment env, fmi2Status status)
+{
+  auto steps = static_cast<AsyncSteps *>(env);
+
+  // tools commonly free the instance once its last step is finished
+  if (steps->freeing != nullptr)
+    fmi2FreeInstance(steps->freeing);
+
+  lock_guard<mutex> lock(steps->m);
+  ++steps->finished;
+  steps->status = status;
+  steps->cv.notify_all();
+}
+
+TEST_CASE("Asynchronous stepping")
+{
+  AsyncSteps steps;
+
+  fmi2CallbackFunctions callbacks = make_callbacks(async_steps_log, &steps, async_steps_finished);
+
+  auto interpreters = all_interpreters();
+
+  SECTION("fmi2DoStep_returnsPending_stepFinishedReportsStatus")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("SineGenerator");
+      archive.setInterpreter(interpreter);
+      archive.setStepping("async");
+      auto reference_archive = ExampleArchive("SineGenerator");
+      reference_archive.setInterpreter(interpreter);
+
+      steps.finished = 0;
+
+      fmi2Component c = fmi2Instantiate("async", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      fmi2Component reference = fmi2Instantiate("sync", fmi2Type::fmi2CoSimulation, "check?", reference_archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      REQUIRE(reference != nullptr);
+      initialize(c);
+      initialize(reference);
+
+      fmi2ValueReference y = 3;
+      double t = 0;
+
+      for (size_t k = 0; k < 10; ++k)
+      {
+        REQUIRE(fmi2DoStep(c, t, 0.1, fmi2True) == fmi2Pending);
+        REQUIRE(fmi2DoStep(reference, t, 0.1, fmi2True) == fmi2OK);
+        REQUIRE(steps.wait([&]() { return steps.finished == k + 1; }));
+        REQUIRE(steps.status == fmi2OK);
+        t += 0.1;
+
+        fmi2Status status = fmi2Fatal;
+        REQUIRE(fmi2GetStatus(c, fmi2DoStepStatus, &status) == fmi2OK);
+        REQUIRE(status == fmi2OK);
+
+        fmi2Real last = -1;
+        REQUIRE(fmi2GetRealStatus(c, fmi2LastSuccessfulTime, &last) == fmi2OK);
+        REQUIRE(last == t);
+
+        fmi2Real value = 0, expected = 0;
+        REQUIRE(fmi2GetReal(c, &y, 1, &value) == fmi2OK);
+        REQUIRE(fmi2GetReal(reference, &y, 1, &expected) == fmi2OK);
+        REQUIRE(value == expected);
+      }
+
+      fmi2FreeInstance(c);
+      fmi2FreeInstance(reference);
+    }
+  }
+
+  SECTION("fmi2CancelStep_pendingStep_otherCallsFailAndStepFinishedNotInvoked")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("LoggerFMU");
+      archive.setInterpreter(interpreter);
+      archive.setStepping("async");
+
+      steps.finished = 0;
+      steps.held = false;
+
+      fmi2Component c = fmi2Instantiate("async", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      const char *categories[] = {"logAll"};
+      REQUIRE(fmi2SetDebugLogging(c, true, 1, categories) == fmi2OK);
+
+      steps.holding = true;
+      REQUIRE(fmi2DoStep(c, 0, 1, fmi2True) == fmi2Pending);
+      REQUIRE(steps.wait([&]() { return steps.held; }));
+
+      fmi2Status status = fmi2Fatal;
+      REQUIRE(fmi2GetStatus(c, fmi2DoStepStatus, &status) == fmi2OK);
+      REQUIRE(status == fmi2Pending);
+
+      fmi2String pending = nullptr;
+      REQUIRE(fmi2GetStringStatus(c, fmi2PendingStatus, &pending) == fmi2OK);
+      REQUIRE(string(pending).find("Taking the step") != string::npos);
+
+      fmi2ValueReference s = 0;
+      fmi2Real value = 0;
+      REQUIRE(fmi2GetReal(c, &s, 1, &value) == fmi2Error);
+      REQUIRE(fmi2DoStep(c, 1, 1, fmi2True) == fmi2Error);
+
+      REQUIRE(fmi2CancelStep(c) == fmi2OK);
+      REQUIRE(fmi2GetStringStatus(c, fmi2PendingStatus, &pending) == fmi2OK);
+      REQUIRE(string(pending).find("Canceling") != string::npos);
+
+      steps.release();
+
+      // waits for the canceled step to return
+      REQUIRE(fmi2Terminate(c) == fmi2OK);
+      REQUIRE(fmi2GetStatus(c, fmi2DoStepStatus, &status) == fmi2OK);
+      REQUIRE(status == fmi2OK);
+      REQUIRE(steps.finished == 0);
+      REQUIRE(fmi2CancelStep(c) == fmi2Error);
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("fmi2FreeInstance_calledByStepFinished_freesInstance")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      // a pooled instance is detached from the thread taking its steps rather than destroyed along with it
+      for (size_t pool : {0, 1})
+      {
+        auto archive = ExampleArchive("SineGenerator");
+        archive.setInterpreter(interpreter);
+        archive.setStepping("async");
+        archive.setPool(pool);
+
+        steps.finished = 0;
+
+        fmi2Component c = fmi2Instantiate("freed", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+        REQUIRE(c != nullptr);
+        initialize(c);
+
+        steps.freeing = c;
+        REQUIRE(fmi2DoStep(c, 0, 0.1, fmi2True) == fmi2Pending);
+        REQUIRE(steps.wait([&]() { return steps.finished == 1; }));
+        REQUIRE(steps.status == fmi2OK);
+        steps.freeing = nullptr;
+      }
+    }
+  }
+
+  SECTION("fmi2Instantiate_noStepFinished_stepsSynchronously")
+  {
+    auto archive = ExampleArchive("SineGenerator");
+    archive.setStepping("async");
+
+    fmi2CallbackFunctions sync_callbacks = make_callbacks(logger, nullptr, nullptr);
+
+    fmi2Component c = fmi2Instantiate("sync", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &sync_callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+    initialize(c);
+
+    REQUIRE(fmi2DoStep(c, 0, 0.5, fmi2True) == fmi2OK);
+
+    fmi2Real last = -1;
+    REQUIRE(fmi2GetRealStatus(c, fmi2LastSuccessfulTime, &last) == fmi2OK);
+    REQUIRE(last == 0.5);
+
+    fmi2Status status = fmi2Fatal;
+    REQUIRE(fmi2GetStatus(c, fmi2DoStepStatus, &status) == fmi2Error);
+    REQUIRE(fmi2CancelStep(c) == fmi2Error);
+
+    fmi2FreeInstance(c);
+  }
+
+  SECTION("fmi2SetFMUstate_rollsBackLastSuccessfulTime")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      for (string stepping : {"sync", "async"})
+      {
+        auto archive = ExampleArchive("SineGenerator");
+        archive.setInterpreter(interpreter);
+        archive.setStepping(stepping);
+
+        steps.finished = 0;
+
+        fmi2Component c = fmi2Instantiate("rollback", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+        REQUIRE(c != nullptr);
+        initialize(c);
+
+        auto step = [&](double t, double h) {
+          fmi2Status status = fmi2DoStep(c, t, h, fmi2True);
+
+          if (stepping == "async")
+          {
+            REQUIRE(status == fmi2Pending);
+            REQUIRE(steps.wait([&]() { return steps.finished == 1; }));
+            steps.finished = 0;
+            status = steps.status;
+          }
+
+          REQUIRE(status == fmi2OK);
+        };
+
+        auto last_successful_time = [&]() {
+          fmi2Real last = -1;
+          REQUIRE(fmi2GetRealStatus(c, fmi2LastSuccessfulTime, &last) == fmi2OK);
+          return last;
+        };
+
+        step(0, 0.5);
+
+        fmi2FMUstate state = nullptr;
+        REQUIRE(fmi2GetFMUstate(c, &state) == fmi2OK);
+
+        step(0.5, 0.5);
+        REQUIRE(last_successful_time() == 1.0);
+
+        REQUIRE(fmi2SetFMUstate(c, state) == fmi2OK);
+        REQUIRE(last_successful_time() == 0.5);
+
+        // the time is part of the serialized state, which takes effect once the deserialized state is set
+        size_t size = 0;
+        REQUIRE(fmi2SerializedFMUstateSize(c, state, &size) == fmi2OK);
+        vector<fmi2Byte> serialized(size);
+        REQUIRE(fmi2SerializeFMUstate(c, state, serialized.data(), size) == fmi2OK);
+        REQUIRE(fmi2FreeFMUstate(c, &state) == fmi2OK);
+
+        step(0.5, 1.5);
+        REQUIRE(last_successful_time() == 2.0);
+
+        REQUIRE(fmi2DeSerializeFMUstate(c, serialized.data(), size, &state) == fmi2OK);
+        REQUIRE(last_successful_time() == 2.0);
+        REQUIRE(fmi2SetFMUstate(c, state) == fmi2OK);
+        REQUIRE(last_successful_time() == 0.5);
+
+        fmi2FreeInstance(c);
+      }
+    }
+  }
+}
+
+TEST_CASE("Model Exchange")
+{
+  fmi2CallbackFunctions callbacks = make_callbacks();
+
+  auto interpreters = all_interpreters();
+
+  fmi2ValueReference x_vr = 0;
+  fmi2ValueReference crossings_vr = 6;
+
+  SECTION("fmi2GetDerivatives_evaluatesSetStates")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Oscillator");
+      archive.setInterpreter(interpreter);
+
+      fmi2Component c = fmi2Instantiate("oscillator", fmi2Type::fmi2ModelExchange, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      fmi2Real states[2] = {};
+      REQUIRE(fmi2GetContinuousStates(c, states, 2) == fmi2OK);
+      REQUIRE(states[0] == 1.0);
+      REQUIRE(states[1] == 0.0);
+
+      fmi2Real nominals[2] = {};
+      REQUIRE(fmi2GetNominalsOfContinuousStates(c, nominals, 2) == fmi2OK);
+      REQUIRE(nominals[0] == 1.0);
+      REQUIRE(nominals[1] == 1.0);
+
+      fmi2Real set[2] = {2.0, 3.0};
+      REQUIRE(fmi2SetTime(c, 0.5) == fmi2OK);
+      REQUIRE(fmi2SetContinuousStates(c, set, 2) == fmi2OK);
+      REQUIRE(fmi2GetContinuousStates(c, states, 2) == fmi2OK);
+      REQUIRE(states[0] == 2.0);
+      REQUIRE(states[1] == 3.0);
+
+      // der_x = v, der_v = -k x - c v, with k = 1 and c = 0.1
+      fmi2Real derivatives[2] = {};
+      REQUIRE(fmi2GetDerivatives(c, derivatives, 2) == fmi2OK);
+      REQUIRE(derivatives[0] == 3.0);
+      REQUIRE(derivatives[1] == Approx(-2.3));
+
+      fmi2Real x = 0;
+      REQUIRE(fmi2GetReal(c, &x_vr, 1, &x) == fmi2OK);
+      REQUIRE(x == 2.0);
+
+      fmi2Real indicator = 0;
+      REQUIRE(fmi2GetEventIndicators(c, &indicator, 1) == fmi2OK);
+      REQUIRE(indicator == 2.0);
+
+      REQUIRE(fmi2SetContinuousStates(c, set, 1) == fmi2Error);
+
+      // the indicators are evaluated for states which have been set, but not yet passed to the slave
+      fmi2Real moved[2] = {-1.0, 0.0};
+      REQUIRE(fmi2SetContinuousStates(c, moved, 2) == fmi2OK);
+      REQUIRE(fmi2GetEventIndicators(c, &indicator, 1) == fmi2OK);
+      REQUIRE(indicator == -1.0);
+
+      fmi2Boolean enterEventMode = fmi2True;
+      fmi2Boolean terminateSimulation = fmi2True;
+      REQUIRE(fmi2CompletedIntegratorStep(c, fmi2True, &enterEventMode, &terminateSimulation) == fmi2OK);
+      REQUIRE(enterEventMode == fmi2False);
+      REQUIRE(terminateSimulation == fmi2False);
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("explicitEuler_matchesAnalyticSolution")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Oscillator");
+      archive.setInterpreter(interpreter);
+
+      fmi2Component c = fmi2Instantiate("oscillator", fmi2Type::fmi2ModelExchange, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      fmi2EventInfo eventInfo{};
+      REQUIRE(fmi2NewDiscreteStates(c, &eventInfo) == fmi2OK);
+      REQUIRE(!eventInfo.newDiscreteStatesNeeded);
+      REQUIRE(!eventInfo.terminateSimulation);
+      REQUIRE(!eventInfo.nextEventTimeDefined);
+      REQUIRE(fmi2EnterContinuousTimeMode(c) == fmi2OK);
+
+      const double h = 0.001;
+      fmi2Real states[2] = {};
+      fmi2Real derivatives[2] = {};
+      fmi2Real indicator = 1.0;
+      REQUIRE(fmi2GetContinuousStates(c, states, 2) == fmi2OK);
+
+      // the position crosses zero once, at about t = 1.6
+      for (size_t k = 1; k <= 2000; ++k)
+      {
+        REQUIRE(fmi2GetDerivatives(c, derivatives, 2) == fmi2OK);
+        states[0] += h * derivatives[0];
+        states[1] += h * derivatives[1];
+
+        REQUIRE(fmi2SetTime(c, k * h) == fmi2OK);
+        REQUIRE(fmi2SetContinuousStates(c, states, 2) == fmi2OK);
+
+        fmi2Real previous = indicator;
+        REQUIRE(fmi2GetEventIndicators(c, &indicator, 1) == fmi2OK);
+
+        if ((previous > 0) != (indicator > 0))
+        {
+          REQUIRE(fmi2EnterEventMode(c) == fmi2OK);
+          REQUIRE(fmi2NewDiscreteStates(c, &eventInfo) == fmi2OK);
+          REQUIRE(fmi2EnterContinuousTimeMode(c) == fmi2OK);
+        }
+      }
+
+      double wd = sqrt(1 - 0.05 * 0.05);
+      double expected = exp(-0.05 * 2.0) * (cos(wd * 2.0) + 0.05 / wd * sin(wd * 2.0));
+
+      fmi2Real x = 0;
+      REQUIRE(fmi2GetReal(c, &x_vr, 1, &x) == fmi2OK);
+      REQUIRE(x == states[0]);
+      REQUIRE(x == Approx(expected).margin(1e-2));
+
+      fmi2Integer crossings = 0;
+      REQUIRE(fmi2GetInteger(c, &crossings_vr, 1, &crossings) == fmi2OK);
+      REQUIRE(crossings == 1);
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("fmi2Instantiate_withoutStates_fails")
+  {
+    auto archive = ExampleArchive("Adder");
+
+    fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2ModelExchange, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c == nullptr);
+  }
+
+  SECTION("fmi2SetTime_coSimulation_fails")
+  {
+    auto archive = ExampleArchive("Adder");
+
+    fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+    initialize(c);
+
+    fmi2Real derivative = 0;
+    REQUIRE(fmi2SetTime(c, 1.0) == fmi2Error);
+    REQUIRE(fmi2GetDerivatives(c, &derivative, 1) == fmi2Error);
+
+    fmi2FreeInstance(c);
+  }
+}
+
+TEST_CASE("Directional derivatives")
+{
+  fmi2CallbackFunctions callbacks = make_callbacks();
+
+  auto interpreters = all_interpreters();
+
+  SECTION("getDirectionalDerivative_overridden_callsSlave")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Oscillator");
+      archive.setInterpreter(interpreter);
+
+      fmi2Component c = fmi2Instantiate("oscillator", fmi2Type::fmi2ModelExchange, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      // der_x = v, der_v = -k x - c v, with k = 1 and c = 0.1
+      fmi2ValueReference unknowns[] = {2, 3};
+      fmi2ValueReference knowns[] = {0, 1};
+      fmi2Real seed[] = {1.0, 2.0};
+      fmi2Real sensitivity[2] = {};
+
+      REQUIRE(fmi2GetDirectionalDerivative(c, unknowns, 2, knowns, 2, seed, sensitivity) == fmi2OK);
+      REQUIRE(sensitivity[0] == 2.0);
+      REQUIRE(sensitivity[1] == Approx(-1.2));
+
+      fmi2Real jacobian[4] = {};
+      REQUIRE(pyfmuGetJacobian(c, unknowns, 2, knowns, 2, jacobian) == fmi2OK);
+      REQUIRE(jacobian[0] == 0.0);
+      REQUIRE(jacobian[1] == 1.0);
+      REQUIRE(jacobian[2] == -1.0);
+      REQUIRE(jacobian[3] == Approx(-0.1));
+
+      fmi2ValueReference integer = 6;
+      REQUIRE(fmi2GetDirectionalDerivative(c, unknowns, 2, &integer, 1, seed, sensitivity) == fmi2Error);
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("getJacobian_declaredDependencies_matchesAnalyticJacobian")
+  {
+    // q, T_end and alpha are followed by the temperature and derivative of each cell
+    const size_t n = 200;
+    auto T_vr = [](size_t i) { return fmi2ValueReference(3 + 2 * i); };
+    auto der_T_vr = [](size_t i) { return fmi2ValueReference(4 + 2 * i); };
+
+    vector<fmi2ValueReference> unknowns, knowns;
+    for (size_t i = 0; i < n; ++i)
+    {
+      unknowns.push_back(der_T_vr(i));
+      knowns.push_back(T_vr(i));
+    }
+    unknowns.push_back(1);
+    knowns.push_back(0);
+
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("HeatRod");
+      archive.setInterpreter(interpreter);
+
+      fmi2Component c = fmi2Instantiate("heatrod", fmi2Type::fmi2ModelExchange, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      vector<fmi2Real> states(n), moved(n);
+      REQUIRE(fmi2GetContinuousStates(c, states.data(), n) == fmi2OK);
+
+      // the states set by the tool are those which are perturbed
+      for (size_t i = 0; i < n; ++i)
+        moved[i] = states[i] * states[i];
+      REQUIRE(fmi2SetContinuousStates(c, moved.data(), n) == fmi2OK);
+
+      size_t m = knowns.size();
+      vector<fmi2Real> jacobian(unknowns.size() * m, -1.0);
+      REQUIRE(pyfmuGetJacobian(c, unknowns.data(), unknowns.size(), knowns.data(), m, jacobian.data()) == fmi2OK);
+
+      // the derivative of the first cell includes the heat flux q, the last cell is the output T_end
+      for (size_t i = 0; i < unknowns.size(); ++i)
+      {
+        for (size_t j = 0; j < m; ++j)
+        {
+          double expected = 0;
+
+          if (i == n)
+            expected = (j == n - 1) ? 1.0 : 0.0;
+          else if (j == n)
+            expected = (i == 0) ? 1.0 : 0.0;
+          else if (i == j)
+            expected = (i == 0 || i == n - 1) ? -1.0 : -2.0;
+          else if (i == j + 1 || j == i + 1)
+            expected = 1.0;
+
+          INFO(format("J[{}][{}] using the {} interpreter", i, j, interpreter));
+          REQUIRE(jacobian[i * m + j] == Approx(expected).margin(1e-6));
+        }
+      }
+
+      // a single direction is the corresponding column of the Jacobian
+      vector<fmi2Real> seed(m, 0.0), sensitivity(unknowns.size());
+      seed[1] = 1.0;
+      REQUIRE(fmi2GetDirectionalDerivative(c, unknowns.data(), unknowns.size(), knowns.data(), m, seed.data(), sensitivity.data()) == fmi2OK);
+
+      for (size_t i = 0; i < unknowns.size(); ++i)
+        REQUIRE(sensitivity[i] == Approx(jacobian[i * m + 1]).margin(1e-6));
+
+      // the perturbations are undone
+      REQUIRE(fmi2GetContinuousStates(c, states.data(), n) == fmi2OK);
+      REQUIRE(states == moved);
+
+      fmi2Real T_end = 0;
+      fmi2ValueReference T_end_vr = 1;
+      vector<fmi2Real> derivatives(n);
+      REQUIRE(fmi2GetDerivatives(c, derivatives.data(), n) == fmi2OK);
+      REQUIRE(fmi2GetReal(c, &T_end_vr, 1, &T_end) == fmi2OK);
+      REQUIRE(T_end == moved[n - 1]);
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("getJacobian_evaluateDerivativesOnly_statesPerturbedThroughEvaluateDerivatives")
+  {
+    // der_x_0, der_x_1, der_x_2 and y, with respect to x_0, x_1, x_2 and u
+    fmi2ValueReference unknowns[] = {3, 5, 7, 1};
+    fmi2ValueReference knowns[] = {2, 4, 6, 0};
+    double expected[4][4] = {{-1, 1, 0, 1}, {0, -2, 1, 0}, {0, 0, -3, 0.5}, {0, 0, 1, 0}};
+
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("LinearSystem");
+      archive.setInterpreter(interpreter);
+
+      fmi2Component c = fmi2Instantiate("linear", fmi2Type::fmi2ModelExchange, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      vector<fmi2Real> states = {1, 2, 3};
+      REQUIRE(fmi2SetContinuousStates(c, states.data(), states.size()) == fmi2OK);
+
+      vector<fmi2Real> jacobian(16, -1.0);
+      REQUIRE(pyfmuGetJacobian(c, unknowns, 4, knowns, 4, jacobian.data()) == fmi2OK);
+
+      for (size_t i = 0; i < 4; ++i)
+      {
+        for (size_t j = 0; j < 4; ++j)
+        {
+          INFO(format("J[{}][{}] using the {} interpreter", i, j, interpreter));
+          REQUIRE(jacobian[i * 4 + j] == Approx(expected[i][j]).margin(1e-6));
+        }
+      }
+
+      vector<fmi2Real> restored(3);
+      REQUIRE(fmi2GetContinuousStates(c, restored.data(), restored.size()) == fmi2OK);
+      REQUIRE(restored == states);
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("getDirectionalDerivative_coSimulation_approximated")
+  {
+    auto archive = ExampleArchive("HeatRod");
+
+    fmi2Component c = fmi2Instantiate("heatrod", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+    initialize(c);
+
+    fmi2ValueReference unknown = 1;
+    fmi2ValueReference known = 3 + 2 * 199;
+    fmi2Real seed = 0.5;
+    fmi2Real sensitivity = 0;
+
+    REQUIRE(fmi2GetDirectionalDerivative(c, &unknown, 1, &known, 1, &seed, &sensitivity) == fmi2OK);
+    REQUIRE(sensitivity == Approx(0.5).margin(1e-6));
+
+    REQUIRE(fmi2DoStep(c, 0.0, 0.1, fmi2True) == fmi2OK);
+
+    fmi2Real zero = 0;
+    REQUIRE(fmi2GetDirectionalDerivative(c, &unknown, 1, &known, 1, &zero, &sensitivity) == fmi2OK);
+    REQUIRE(sensitivity == 0.0);
+
+    fmi2FreeInstance(c);
+  }
+
+  SECTION("getDirectionalDerivative_coSimulationOnly_evaluatesOutputs")
+  {
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Adder");
+      archive.setInterpreter(interpreter);
+
+      fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      // s = a + b is computed by evaluate_outputs, without taking a step
+      fmi2ValueReference s = 0;
+      fmi2ValueReference inputs[] = {1, 2};
+      fmi2Real values[] = {1, 2};
+      REQUIRE(fmi2SetReal(c, inputs, 2, values) == fmi2OK);
+
+      fmi2Real seed[] = {0.5, 2};
+      fmi2Real sensitivity = 0;
+      REQUIRE(fmi2GetDirectionalDerivative(c, &s, 1, inputs, 2, seed, &sensitivity) == fmi2OK);
+      REQUIRE(sensitivity == Approx(2.5).margin(1e-6));
+
+      fmi2Real jacobian[2] = {0, 0};
+      REQUIRE(pyfmuGetJacobian(c, &s, 1, inputs, 2, jacobian) == fmi2OK);
+      REQUIRE(jacobian[0] == Approx(1.0).margin(1e-6));
+      REQUIRE(jacobian[1] == Approx(1.0).margin(1e-6));
+
+      // the output computed by the last step is restored along with the inputs
+      fmi2Real output = -1;
+      REQUIRE(fmi2GetReal(c, &s, 1, &output) == fmi2OK);
+      REQUIRE(output == 0.0);
+      REQUIRE(fmi2GetReal(c, inputs, 2, values) == fmi2OK);
+      REQUIRE(values[0] == 1.0);
+      REQUIRE(values[1] == 2.0);
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("getDirectionalDerivative_outputsOnlyComputedByStep_returnsError")
+  {
+    auto archive = ExampleArchive("Integrator");
+
+    fmi2Component c = fmi2Instantiate("integrator", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+    initialize(c);
+
+    fmi2ValueReference u = 0, y = 1;
+    fmi2Real seed = 1, sensitivity = 0;
+    REQUIRE(fmi2GetDirectionalDerivative(c, &y, 1, &u, 1, &seed, &sensitivity) == fmi2Error);
+    REQUIRE(pyfmuGetJacobian(c, &y, 1, &u, 1, &sensitivity) == fmi2Error);
+
+    fmi2FreeInstance(c);
+  }
+}
+
+TEST_CASE("Interpolation")
+{
+  fmi2CallbackFunctions callbacks = make_callbacks();
+
+  auto interpreters = all_interpreters();
+
+  SECTION("setRealInputDerivatives_ramp_integratedExactly")
+  {
+    fmi2ValueReference u_vr = 0;
+    fmi2ValueReference y_vr = 1;
+    fmi2Integer first = 1;
+    fmi2Integer second = 2;
+
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Integrator");
+      archive.setInterpreter(interpreter);
+
+      fmi2Component c = fmi2Instantiate("integrator", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      // u = t, whose integral t^2 / 2 is exact despite the large steps, where holding u would yield 1.5 at t = 2
+      const double h = 0.5;
+      for (size_t k = 0; k < 4; ++k)
+      {
+        fmi2Real u = k * h;
+        fmi2Real du = 1.0;
+        REQUIRE(fmi2SetReal(c, &u_vr, 1, &u) == fmi2OK);
+        REQUIRE(fmi2SetRealInputDerivatives(c, &u_vr, 1, &first, &du) == fmi2OK);
+        REQUIRE(fmi2DoStep(c, k * h, h, fmi2True) == fmi2OK);
+      }
+
+      fmi2Real y = 0;
+      REQUIRE(fmi2GetReal(c, &y_vr, 1, &y) == fmi2OK);
+      REQUIRE(y == Approx(2.0));
+
+      // the derivative of the output is the extrapolated input at the end of the step
+      fmi2Real dy = 0;
+      REQUIRE(fmi2GetRealOutputDerivatives(c, &y_vr, 1, &first, &dy) == fmi2OK);
+      REQUIRE(dy == Approx(2.0));
+      REQUIRE(fmi2GetRealOutputDerivatives(c, &y_vr, 1, &second, &dy) == fmi2Error);
+
+      // the derivatives only apply to the step for which they were set
+      fmi2Real u = 2.0;
+      REQUIRE(fmi2SetReal(c, &u_vr, 1, &u) == fmi2OK);
+      REQUIRE(fmi2DoStep(c, 2.0, h, fmi2True) == fmi2OK);
+      REQUIRE(fmi2GetReal(c, &y_vr, 1, &y) == fmi2OK);
+      REQUIRE(y == Approx(3.0));
+
+      fmi2Real du = 1.0;
+      REQUIRE(fmi2SetRealInputDerivatives(c, &y_vr, 1, &first, &du) == fmi2Error);
+      fmi2Integer zeroth = 0;
+      REQUIRE(fmi2SetRealInputDerivatives(c, &u_vr, 1, &zeroth, &du) == fmi2Error);
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("getRealOutputDerivatives_notProvided_estimatedFromHistory")
+  {
+    fmi2ValueReference s_vr = 0;
+    fmi2ValueReference a_vr = 1;
+
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Adder");
+      archive.setInterpreter(interpreter);
+
+      fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      fmi2Real da = 1.0;
+      fmi2Integer first = 1;
+      REQUIRE(fmi2SetRealInputDerivatives(c, &a_vr, 1, &first, &da) == fmi2Error);
+
+      // s = (t - h)^2 at the end of each step, a quadratic whose derivatives are exact once three communication points are known
+      const double h = 0.25;
+      fmi2ValueReference vrs[] = {s_vr, s_vr};
+      fmi2Integer orders[] = {1, 2};
+      fmi2Real derivatives[2] = {};
+
+      for (size_t k = 0; k < 6; ++k)
+      {
+        fmi2Real a = (k * h) * (k * h);
+        REQUIRE(fmi2SetReal(c, &a_vr, 1, &a) == fmi2OK);
+        REQUIRE(fmi2DoStep(c, k * h, h, fmi2True) == fmi2OK);
+        REQUIRE(fmi2GetRealOutputDerivatives(c, vrs, 2, orders, derivatives) == fmi2OK);
+
+        if (k == 0)
+        {
+          REQUIRE(derivatives[0] == 0.0);
+          REQUIRE(derivatives[1] == 0.0);
+        }
+        else if (k >= 2)
+        {
+          REQUIRE(derivatives[0] == Approx(2 * k * h));
+          REQUIRE(derivatives[1] == Approx(2.0));
+        }
+      }
+
+      fmi2Integer third = 3;
+      REQUIRE(fmi2GetRealOutputDerivatives(c, &s_vr, 1, &third, derivatives) == fmi2Error);
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("getRealOutputDerivatives_firstRequestAfterSteps_estimatedFromEveryStep")
+  {
+    fmi2ValueReference s_vr = 0;
+    fmi2ValueReference a_vr = 1;
+
+    for (auto &interpreter : interpreters)
+    {
+      auto archive = ExampleArchive("Adder");
+      archive.setInterpreter(interpreter);
+
+      fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      initialize(c);
+
+      // s = (t - h)^2 at the end of each step as above, the outputs are recorded by the steps rather than by requests of the tool
+      const double h = 0.25;
+
+      for (size_t k = 0; k < 3; ++k)
+      {
+        fmi2Real a = (k * h) * (k * h);
+        REQUIRE(fmi2SetReal(c, &a_vr, 1, &a) == fmi2OK);
+        REQUIRE(fmi2DoStep(c, k * h, h, fmi2True) == fmi2OK);
+      }
+
+      fmi2Real step_sizes[] = {h, h};
+      fmi2Real inputs[] = {9 * h * h, 16 * h * h};
+      fmi2Real outputs[2] = {};
+      size_t completed = 0;
+      REQUIRE(pyfmuDoSteps(c, 3 * h, step_sizes, 2, &a_vr, 1, inputs, &s_vr, 1, outputs, &completed) == fmi2OK);
+      REQUIRE(completed == 2);
+
+      fmi2ValueReference vrs[] = {s_vr, s_vr};
+      fmi2Integer orders[] = {1, 2};
+      fmi2Real derivatives[2] = {};
+      REQUIRE(fmi2GetRealOutputDerivatives(c, vrs, 2, orders, derivatives) == fmi2OK);
+      REQUIRE(derivatives[0] == Approx(8 * h));
+      REQUIRE(derivatives[1] == Approx(2.0));
+
+      fmi2FreeInstance(c);
+    }
+  }
+}
+
+TEST_CASE("Array variables")
+{
+  fmi2CallbackFunctions callbacks = make_callbacks();
+
+  // the elements of u, K and y are stored natively with consecutive value references, u from 0, K from n and y from n + n * n
+  const size_t n = 8;
+  auto block = [](fmi2ValueReference first, size_t count) {
+    vector<fmi2ValueReference> vrs(count);
+    iota(vrs.begin(), vrs.end(), first);
+    return vrs;
+  };
+
+  auto u_vrs = block(0, n);
+  auto K_vrs = block(n, n * n);
+  auto y_vrs = block(n + n * n, n);
+
+  SECTION("blocks_setAndGet_matchElementwise")
+  {
+    auto archive = ExampleArchive("MatrixGain");
+    fmi2Component c = fmi2Instantiate("gain", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+
+    // K[i,j] = i + 1 if j = 0, and u[j] = j + 1, such that y[i] = i + 1
+    vector<fmi2Real> K(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i)
+      K[i * n] = i + 1;
+
+    vector<fmi2Real> u(n);
+    iota(u.begin(), u.end(), 1.0);
+
+    REQUIRE(fmi2SetReal(c, K_vrs.data(), K_vrs.size(), K.data()) == fmi2OK);
+    REQUIRE(fmi2SetReal(c, u_vrs.data(), u_vrs.size(), u.data()) == fmi2OK);
+    REQUIRE(fmi2DoStep(c, 0.0, 1.0, fmi2True) == fmi2OK);
+
+    vector<fmi2Real> y(n);
+    REQUIRE(fmi2GetReal(c, y_vrs.data(), y_vrs.size(), y.data()) == fmi2OK);
+    for (size_t i = 0; i < n; ++i)
+      REQUIRE(y[i] == i + 1);
+
+    // value references in any order, crossing the boundaries of the arrays, are copied element by element where they are not consecutive
+    vector<fmi2ValueReference> mixed = {y_vrs[3], y_vrs[2], K_vrs[n * n - 1], y_vrs[0], y_vrs[1], u_vrs[0], u_vrs[1]};
+    vector<fmi2Real> values(mixed.size());
+    REQUIRE(fmi2GetReal(c, mixed.data(), mixed.size(), values.data()) == fmi2OK);
+    REQUIRE(values == vector<fmi2Real>{4, 3, 0, 1, 2, 1, 2});
+
+    // a block extending beyond the last array is not copied by the store, but rejected by the slave
+    auto beyond = block(n + n * n, n + 1);
+    vector<fmi2Real> zeros(beyond.size(), 0.0);
+    REQUIRE(fmi2GetReal(c, beyond.data(), beyond.size(), zeros.data()) == fmi2Error);
+
+    fmi2FreeInstance(c);
+  }
+
+  SECTION("reset_restoresStartValuesOfElements")
+  {
+    auto archive = ExampleArchive("MatrixGain");
+    fmi2Component c = fmi2Instantiate("gain", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+
+    vector<fmi2Real> K(n * n, 2.0);
+    REQUIRE(fmi2SetReal(c, K_vrs.data(), K_vrs.size(), K.data()) == fmi2OK);
+    REQUIRE(fmi2Reset(c) == fmi2OK);
+
+    REQUIRE(fmi2GetReal(c, K_vrs.data(), K_vrs.size(), K.data()) == fmi2OK);
+    for (size_t i = 0; i < n; ++i)
+    {
+      for (size_t j = 0; j < n; ++j)
+        REQUIRE(K[i * n + j] == (i == j ? 1.0 : 0.0));
+    }
+
+    fmi2FreeInstance(c);
+  }
+}
+
+TEST_CASE("Ensembles")
+{
+  fmi2CallbackFunctions callbacks = make_callbacks();
+
+  // amplitude, frequency and phase of the SineGenerator, whose output y is amplitude * sin(time * frequency + phase)
+  const vector<fmi2ValueReference> parameter_vrs = {0, 1, 2};
+  const fmi2ValueReference y_vr = 3;
+  const size_t members = 5;
+
+  SECTION("doStep_advancesEveryMember")
+  {
+    auto archive = ExampleArchive("SineGenerator");
+    fmi2Component c = pyfmuInstantiateEnsemble("sines", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True, members);
+    REQUIRE(c != nullptr);
+
+    // member m has the amplitude m + 1 and the frequency 1 / (m + 1)
+    vector<fmi2Real> parameters;
+    for (size_t m = 0; m < members; ++m)
+      parameters.insert(parameters.end(), {m + 1.0, 1.0 / (m + 1), 0.0});
+
+    REQUIRE(pyfmuSetRealEnsemble(c, parameter_vrs.data(), parameter_vrs.size(), parameters.data()) == fmi2OK);
+    REQUIRE(fmi2SetupExperiment(c, fmi2False, 0.0, 0.0, fmi2False, 0.0) == fmi2OK);
+    REQUIRE(fmi2EnterInitializationMode(c) == fmi2OK);
+    REQUIRE(fmi2ExitInitializationMode(c) == fmi2OK);
+    REQUIRE(fmi2DoStep(c, 1.0, 0.1, fmi2True) == fmi2OK);
+
+    vector<fmi2Real> y(members);
+    REQUIRE(pyfmuGetRealEnsemble(c, &y_vr, 1, y.data()) == fmi2OK);
+    for (size_t m = 0; m < members; ++m)
+      REQUIRE(y[m] == Approx((m + 1) * sin(1.0 / (m + 1))));
+
+    // the standard functions access member 0
+    fmi2Real y0 = 0.0;
+    REQUIRE(fmi2GetReal(c, &y_vr, 1, &y0) == fmi2OK);
+    REQUIRE(y0 == y[0]);
+
+    fmi2FreeInstance(c);
+  }
+
+  SECTION("reset_restoresStartValuesOfEveryMember")
+  {
+    auto archive = ExampleArchive("SineGenerator");
+    fmi2Component c = pyfmuInstantiateEnsemble("sines", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True, members);
+    REQUIRE(c != nullptr);
+
+    vector<fmi2Real> parameters(members * parameter_vrs.size(), 3.0);
+    REQUIRE(pyfmuSetRealEnsemble(c, parameter_vrs.data(), parameter_vrs.size(), parameters.data()) == fmi2OK);
+    REQUIRE(fmi2Reset(c) == fmi2OK);
+
+    REQUIRE(pyfmuGetRealEnsemble(c, parameter_vrs.data(), parameter_vrs.size(), parameters.data()) == fmi2OK);
+    for (size_t m = 0; m < members; ++m)
+      REQUIRE(vector<fmi2Real>(parameters.begin() + m * 3, parameters.begin() + m * 3 + 3) == vector<fmi2Real>{1.0, 1.0, 0.0});
+
+    fmi2FreeInstance(c);
+  }
+
+  SECTION("slaveWithoutEnsembleSupport_returnsNull")
+  {
+    auto archive = ExampleArchive("NativeAdder");
+    fmi2Component c = pyfmuInstantiateEnsemble("adders", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True, members);
+    REQUIRE(c == nullptr);
+
+    // a single member is an ordinary instance, whose natively stored variables may be accessed by the ensemble functions
+    c = pyfmuInstantiateEnsemble("adder", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True, 1);
+    REQUIRE(c != nullptr);
+
+    fmi2ValueReference a_vr = 1;
+    fmi2Real a = 2.0;
+    REQUIRE(pyfmuSetRealEnsemble(c, &a_vr, 1, &a) == fmi2OK);
+    a = 0.0;
+    REQUIRE(fmi2GetReal(c, &a_vr, 1, &a) == fmi2OK);
+    REQUIRE(a == 2.0);
+
+    fmi2FreeInstance(c);
+  }
+
+  SECTION("variableNotStoredNatively_returnsError")
+  {
+    auto archive = ExampleArchive("Integrator");
+    fmi2Component c = fmi2Instantiate("integrator", fmi2Type::fmi2CoSimulation, "check?", archive.getResourcesURI().c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+
+    fmi2ValueReference vr = 0;
+    fmi2Real value = 0.0;
+    REQUIRE(pyfmuGetRealEnsemble(c, &vr, 1, &value) == fmi2Error);
+
+    fmi2FreeInstance(c);
+  }
+}
+
+/**
+ * @brief Returns the resident set size of the process in bytes, or 0 if it can not be determined on the platform.
+ */
+size_t resident_set_size()
+{
+#ifdef __linux__
+  size_t pages = 0, resident = 0;
+  ifstream statm("/proc/self/statm");
+  statm >> pages >> resident;
+  return resident * sysconf(_SC_PAGESIZE);
+#else
+  return 0;
+#endif
+}
+
+TEST_CASE("Shared views")
+{
+  Logger log(nullptr, logger, "views");
+  auto interpreter = pythonfmu::PyInitializer::acquire(&log);
+
+  PyGIL g;
+  pythonfmu::PyMemoryViews views;
+  PyObject *globals = PyModule_GetDict(PyImport_AddModule("__main__"));
+
+  // the memory is owned by a capsule, which counts its deletions
+  static int deleted;
+  deleted = 0;
+
+  auto memory = new vector<fmi2Real>{1.0, 2.0, 3.0, 4.0};
+  PyObject *owner = PyCapsule_New(memory, "memory", [](PyObject *capsule) {
+    delete static_cast<vector<fmi2Real> *>(PyCapsule_GetPointer(capsule, "memory"));
+    ++deleted;
+  });
+  REQUIRE(owner != nullptr);
+
+  pythonfmu::SharedView shared[] = {views.shared(memory->data(), memory->size())};
+  REQUIRE(shared[0].view != nullptr);
+  REQUIRE(PyDict_SetItemString(globals, "view", shared[0].view) == 0);
+
+  auto eval = [&](const char *expression) {
+    PyObject *result = PyRun_String(expression, Py_eval_input, globals, globals);
+    REQUIRE(result != nullptr);
+    bool truth = PyObject_IsTrue(result) == 1;
+    Py_DECREF(result);
+    return truth;
+  };
+
+  SECTION("release_noDerivedViews_deletesMemory")
+  {
+    REQUIRE(PyDict_DelItemString(globals, "view") == 0);
+
+    REQUIRE(views.release(shared, owner, &log));
+    Py_DECREF(owner);
+    REQUIRE(deleted == 1);
+  }
+
+  SECTION("release_derivedViewsSurvive_keepsMemoryUntilTheyAreDestroyed")
+  {
+    // a cast and a slice share the buffer of the view rather than exporting it
+    REQUIRE(PyRun_SimpleString("derived = [memoryview(view).cast('B').cast('d'), view[1:3]]\ndel view") == 0);
+
+    REQUIRE_FALSE(views.release(shared, owner, &log));
+    Py_DECREF(owner);
+    REQUIRE(deleted == 0);
+
+    REQUIRE(eval("derived[0].tolist() == [1.0, 2.0, 3.0, 4.0] and derived[1].tolist() == [2.0, 3.0]"));
+
+    REQUIRE(PyRun_SimpleString("del derived[0]") == 0);
+    REQUIRE(deleted == 0);
+
+    REQUIRE(PyRun_SimpleString("del derived") == 0);
+    REQUIRE(deleted == 1);
+  }
+}
+
+TEST_CASE("Profiling")
+{
+  SECTION("LatencyHistogram_percentiles_withinBucketWidth")
+  {
+    pythonfmu::LatencyHistogram h;
+
+    for (uint64_t ns = 1; ns <= 100000; ++ns)
+      h.record(ns);
+
+    REQUIRE(h.count() == 100000);
+    REQUIRE(h.min() == 1);
+    REQUIRE(h.max() == 100000);
+
+    // the upper bound of a bucket exceeds the latencies counted by it by at most 1/subBuckets
+    for (double p : {0.5, 0.9, 0.99})
+    {
+      double exact = p * 100000;
+      REQUIRE(h.percentile(p) >= exact);
+      REQUIRE(h.percentile(p) <= exact * (1 + 1.0 / pythonfmu::LatencyHistogram::subBuckets));
+    }
+
+    for (size_t bucket = 0; bucket + 1 < pythonfmu::LatencyHistogram::nBuckets; ++bucket)
+    {
+      REQUIRE(pythonfmu::LatencyHistogram::bucket_of(pythonfmu::LatencyHistogram::lower_bound(bucket)) == bucket);
+      REQUIRE(pythonfmu::LatencyHistogram::bucket_of(pythonfmu::LatencyHistogram::lower_bound(bucket + 1) - 1) == bucket);
+    }
+  }
+
+  SECTION("pyfmuGetProfile_profilingDisabled_returnsError")
+  {
+    fmi2CallbackFunctions callbacks = make_callbacks();
+
+    auto archive = ExampleArchive("Adder");
+    string resources_uri = archive.getResourcesURI();
+
+    fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+    REQUIRE(c != nullptr);
+
+    fmi2String profile = nullptr;
+    REQUIRE(pyfmuGetProfile(c, &profile) == fmi2Error);
+    REQUIRE(pyfmuResetProfile(c) == fmi2Error);
+
+    fmi2FreeInstance(c);
+  }
+
+#ifdef PYFMU_PROFILING
+  SECTION("pyfmuGetProfile_profilingEnabled_countsCallsAndPhases")
+  {
+    auto interpreters = all_interpreters();
+
+    fmi2CallbackFunctions callbacks = make_callbacks();
+
+    for (auto &interpreter : interpreters)
+    {
+      // LoggerFMU stores its variables in Python, such that getting and setting them calls into the slave
+      auto archive = ExampleArchive("LoggerFMU");
+      archive.setInterpreter(interpreter);
+      archive.setProfiling(true);
+      string resources_uri = archive.getResourcesURI();
+
+      fmi2Component c = fmi2Instantiate("logger", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+
+      REQUIRE(fmi2SetupExperiment(c, fmi2False, 0.0, 0.0, fmi2False, 0.0) == fmi2OK);
+      REQUIRE(fmi2EnterInitializationMode(c) == fmi2OK);
+      REQUIRE(fmi2ExitInitializationMode(c) == fmi2OK);
+
+      fmi2ValueReference vrs[] = {1, 2};
+      fmi2Real values[] = {1, 2};
+
+      for (int i = 0; i < 10; ++i)
+      {
+        REQUIRE(fmi2SetReal(c, vrs, 2, values) == fmi2OK);
+        REQUIRE(fmi2DoStep(c, i, 1, fmi2False) == fmi2OK);
+      }
+
+      fmi2String profile = nullptr;
+      REQUIRE(pyfmuGetProfile(c, &profile) == fmi2OK);
+
+      auto j = nlohmann::json::parse(profile);
+      auto &functions = j["functions"];
+      REQUIRE(functions["fmi2Instantiate"]["count"] == 1);
+      REQUIRE(functions["fmi2SetReal"]["count"] == 10);
+      REQUIRE(functions["fmi2DoStep"]["count"] == 10);
+      REQUIRE(!functions.contains("fmi2GetReal"));
+
+      auto &step = functions["fmi2DoStep"];
+      REQUIRE(step["min_ns"] <= step["p50_ns"]);
+      REQUIRE(step["p50_ns"] <= step["max_ns"]);
+
+      uint64_t counted = 0;
+      for (auto &bucket : step["buckets"])
+        counted += bucket[1].get<uint64_t>();
+      REQUIRE(counted == 10);
+
+      // phases are only recorded for slaves executed in the process of the tool
+      if (interpreter != "process")
+      {
+        REQUIRE(j["phases"]["gil_wait"]["count"] >= 20);
+        REQUIRE(j["phases"]["python_call"]["count"] >= 20);
+        REQUIRE(j["phases"]["marshal"]["count"] >= 20);
+      }
+      else
+        REQUIRE(j["phases"].empty());
+
+      REQUIRE(pyfmuResetProfile(c) == fmi2OK);
+      REQUIRE(pyfmuGetProfile(c, &profile) == fmi2OK);
+      REQUIRE(nlohmann::json::parse(profile)["functions"].empty());
+
+      fmi2FreeInstance(c);
+    }
+  }
+
+  SECTION("fmi2Terminate_dumpOnTerminate_logsSummary")
+  {
+    vector<pair<string, string>> messages;
+    fmi2CallbackFunctions callbacks = make_callbacks(collect_log, &messages);
+
+    auto archive = ExampleArchive("Adder");
+    archive.setProfiling(true, true);
+    string resources_uri = archive.getResourcesURI();
+
+    // the summary is logged regardless of the active categories
+    fmi2Component c = fmi2Instantiate("adder", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2False);
+    REQUIRE(c != nullptr);
+
+    REQUIRE(fmi2SetupExperiment(c, fmi2False, 0.0, 0.0, fmi2False, 0.0) == fmi2OK);
+    REQUIRE(fmi2EnterInitializationMode(c) == fmi2OK);
+    REQUIRE(fmi2ExitInitializationMode(c) == fmi2OK);
+    REQUIRE(fmi2DoStep(c, 0, 1, fmi2False) == fmi2OK);
+    REQUIRE(fmi2Terminate(c) == fmi2OK);
+
+    auto summary = find_if(messages.begin(), messages.end(), [](auto &m) { return m.first == "profile"; });
+    REQUIRE(summary != messages.end());
+    REQUIRE(summary->second.find("fmi2DoStep") != string::npos);
+    REQUIRE(summary->second.find("fmi2Terminate") != string::npos);
+
+    fmi2FreeInstance(c);
+  }
+#endif
+}
+
+/**
+ * @brief Instantiates, steps and frees many instances, checking that memory is reclaimed.
+ * 
+ * The test is hidden and must be run explicitly:
+ * 
+ * ./tests [stress]
+ */
+TEST_CASE("Instantiation stress", "[.][stress]")
+{
+  auto archive = ExampleArchive("Adder");
+  string resources_uri = archive.getResourcesURI();
+
+  fmi2CallbackFunctions callbacks = make_callbacks();
+
+  const size_t n_rounds = 10;
+  const size_t n_instances = 200;
+  vector<size_t> rss;
+
+  for (size_t round = 0; round < n_rounds; ++round)
+  {
+    vector<fmi2Component> components;
+
+    for (size_t i = 0; i < n_instances; ++i)
+    {
+      fmi2Component c = fmi2Instantiate(format("adder{}", i).c_str(), fmi2Type::fmi2CoSimulation, "check?",
+                                        resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+      REQUIRE(c != nullptr);
+      components.push_back(c);
+    }
+
+    for (auto c : components)
+    {
+      REQUIRE(fmi2SetupExperiment(c, fmi2False, 0.0, 0.0, fmi2False, 0.0) == fmi2OK);
+      REQUIRE(fmi2EnterInitializationMode(c) == fmi2OK);
+      REQUIRE(fmi2ExitInitializationMode(c) == fmi2OK);
+      for (int step = 0; step < 10; ++step)
+        REQUIRE(fmi2DoStep(c, step, 1, fmi2False) == fmi2OK);
+      REQUIRE(fmi2Terminate(c) == fmi2OK);
+    }
+
+    for (auto c : components)
+      fmi2FreeInstance(c);
+
+    rss.push_back(resident_set_size());
+    print("round {}: resident set size {:.1f} MiB\n", round, rss.back() / (1024.0 * 1024.0));
+  }
+
+  // the first rounds warm up allocators and caches, after that the memory should be reclaimed
+  size_t growth = rss.back() > rss[2] ? rss.back() - rss[2] : 0;
+  REQUIRE(growth < 16 * 1024 * 1024);
+}
+
+/**
+ * @brief Gets a new string after each of a million steps, checking that the memory used by the strings is reused.
+ * 
+ * The test is hidden and must be run explicitly:
+ * 
+ * ./tests [stress]
+ */
+TEST_CASE("String soak", "[.][stress]")
+{
+  auto archive = ExampleArchive("Clock");
+  string resources_uri = archive.getResourcesURI();
+
+  fmi2CallbackFunctions callbacks = make_callbacks();
+
+  fmi2Component c = fmi2Instantiate("clock", fmi2Type::fmi2CoSimulation, "check?", resources_uri.c_str(), &callbacks, fmi2False, fmi2True);
+  REQUIRE(c != nullptr);
+  REQUIRE(fmi2SetupExperiment(c, fmi2False, 0.0, 0.0, fmi2False, 0.0) == fmi2OK);
+  REQUIRE(fmi2EnterInitializationMode(c) == fmi2OK);
+  REQUIRE(fmi2ExitInitializationMode(c) == fmi2OK);
+
+  const size_t n_rounds = 10;
+  const size_t n_steps = 100000;
+  fmi2ValueReference text = 1;
+  fmi2String value = nullptr;
+  vector<size_t> rss;
+
+  for (size_t round = 0; round < n_rounds; ++round)
+  {
+    for (size_t step = 0; step < n_steps; ++step)
+    {
+      double t = static_cast<double>(round * n_steps + step);
+      REQUIRE(fmi2DoStep(c, t, 1, fmi2False) == fmi2OK);
+      REQUIRE(fmi2GetString(c, &text, 1, &value) == fmi2OK);
+    }
+
+    rss.push_back(resident_set_size());
+    print("round {}: resident set size {:.1f} MiB, last value {}\n", round, rss.back() / (1024.0 * 1024.0), value);
+  }
+
+  REQUIRE(string(value) == format("t={:g}", static_cast<double>(n_rounds * n_steps)));
+
+  fmi2FreeInstance(c);
+
+  // a leak of a single string per step would exceed the bound several times over
+  size_t growth = rss.back() > rss[1] ? rss.back() - rss[1] : 0;
+  REQUIRE(growth < 4 * 1024 * 1024);
+}
+
 
 /**
  * @brief Tests the URI parsing on different platforms.